@@ -30,8 +30,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include "clothBWMT.h"
+#include "threadPool.h"
 
-#include <pthread.h>
 
 ClothBWMT::ClothBWMT(int numParticles_, double * masses_, double * restPositions_, int numTriangles_,
                       int * triangles_, int * triangleGroups_, int numMaterialGroups_,
@@ -80,19 +80,19 @@ ClothBWMT::~ClothBWMT()
   free(internalForceBuffer);
 }
 
-// data structure to hold data for each thread
+// data structure to hold data for the threads (shared by all the tasks of one computation)
 struct ClothBWMT_threadArg
 {
   ClothBWMT * clothBW_MT;
   double * u;
   double * uSecondary;
-  void * targetBuffer;
-  int rank;
+  double * forceBuffer; // per-thread sub-buffers of length 3 * numParticles
+  SparseMatrix ** matrixBuffer; // one matrix per thread
   enum ClothBWMT_computationTargetType computationTarget;
 };
 
-// global function
-void * ClothBWMT_WorkerThread(void * arg)
+// global function (executed by the thread pool, once for each rank)
+void ClothBWMT_WorkerThread(void * arg, int rank)
 {
   // cast to struct
   struct ClothBWMT_threadArg * threadArgp = (struct ClothBWMT_threadArg*) arg;
@@ -100,7 +100,6 @@ void * ClothBWMT_WorkerThread(void * arg)
   // copy info into local vars
   ClothBWMT * clothBW_MT = threadArgp->clothBW_MT;
   double * u = threadArgp->u;
-  int rank = threadArgp->rank;
   int startTriangle = clothBW_MT->GetStartTriangle(rank);
   int endTriangle = clothBW_MT->GetEndTriangle(rank);
   int startQuad = clothBW_MT->GetStartQuad(rank);
@@ -111,28 +110,28 @@ void * ClothBWMT_WorkerThread(void * arg)
   {
     case STRETCH_SHEAR_FORCE:
     {
-      double * targetBuffer = (double*)(threadArgp->targetBuffer);
+      double * targetBuffer = &threadArgp->forceBuffer[rank * 3 * clothBW_MT->GetNumParticles()];
       clothBW_MT->AddStretchAndShearForce(u, targetBuffer, startTriangle, endTriangle);
     }
       break;
       
     case BEND_FORCE:
     {
-      double * targetBuffer = (double*)(threadArgp->targetBuffer);
+      double * targetBuffer = &threadArgp->forceBuffer[rank * 3 * clothBW_MT->GetNumParticles()];
       clothBW_MT->AddBendForce(u, targetBuffer, startQuad, endQuad);
     }
       break;
       
     case STRETCH_SHEAR_STIFFNESS:
     {
-      SparseMatrix * targetBuffer = (SparseMatrix*)(threadArgp->targetBuffer);
+      SparseMatrix * targetBuffer = threadArgp->matrixBuffer[rank];
       clothBW_MT->AddStretchAndShearStiffnessMatrix(u, targetBuffer, startTriangle, endTriangle);
     }
       break;
       
     case BEND_STIFFNESS:
     {
-      SparseMatrix * targetBuffer = (SparseMatrix*)(threadArgp->targetBuffer);
+      SparseMatrix * targetBuffer = threadArgp->matrixBuffer[rank];
       clothBW_MT->AddBendStiffnessMatrix(u, targetBuffer, startQuad, endQuad);
     }
       break;
@@ -142,9 +141,6 @@ void * ClothBWMT_WorkerThread(void * arg)
       exit(1);
       break;
   }
-  
-  return NULL;
-  
 }
 
 // multi-threaded computations
@@ -272,19 +268,15 @@ void ClothBWMT::Initialize()
 
 void ClothBWMT::ComputeHelper(enum ClothBWMT_computationTargetType computationTarget, double * u, double * uSecondary, void * target, bool addQuantity)
 {
-  // launch threads
+  // run the tasks on the persistent thread pool
   int numParticles3 = 3*numParticles;
-  struct ClothBWMT_threadArg * threadArgv = (struct ClothBWMT_threadArg*) malloc (sizeof(struct ClothBWMT_threadArg) * numThreads);
-  
-  pthread_t * tid = (pthread_t*) malloc (sizeof(pthread_t) * numThreads);
-  
-  for(int i=0; i<numThreads; i++)
-  {
-    threadArgv[i].clothBW_MT = this;
-    threadArgv[i].u = u;
-    threadArgv[i].rank = i;
-    threadArgv[i].computationTarget = computationTarget;
-  }
+  struct ClothBWMT_threadArg threadArg;
+  threadArg.clothBW_MT = this;
+  threadArg.u = u;
+  threadArg.uSecondary = uSecondary;
+  threadArg.forceBuffer = internalForceBuffer;
+  threadArg.matrixBuffer = sparseMatrixBuffer;
+  threadArg.computationTarget = computationTarget;
   
   switch(computationTarget)
   {
@@ -292,8 +284,6 @@ void ClothBWMT::ComputeHelper(enum ClothBWMT_computationTargetType computationTa
     case STRETCH_SHEAR_FORCE:
     case BEND_FORCE:
     {
-      for(int i=0; i<numThreads; i++)
-        threadArgv[i].targetBuffer = (void*)(&internalForceBuffer[i * numParticles3]);
       memset(internalForceBuffer, 0, sizeof(double) * numParticles3 * numThreads);
     }
       break;
@@ -303,10 +293,7 @@ void ClothBWMT::ComputeHelper(enum ClothBWMT_computationTargetType computationTa
     case BEND_STIFFNESS:
     {
       for(int i=0; i<numThreads; i++)
-      {
-        threadArgv[i].targetBuffer = (void*)(sparseMatrixBuffer[i]);
         sparseMatrixBuffer[i]->ResetToZero();
-      }
     }
       break;
       
@@ -316,26 +303,7 @@ void ClothBWMT::ComputeHelper(enum ClothBWMT_computationTargetType computationTa
       break;
   }
   
-  for(int i=0; i<numThreads; i++)  
-  {
-    if (pthread_create(&tid[i], NULL, ClothBWMT_WorkerThread, &threadArgv[i]) != 0)
-    {
-      printf("Error: unable to launch thread %d.\n", i);
-      exit(1);
-    }
-  }
-  
-  for(int i=0; i<numThreads; i++)
-  {
-    if (pthread_join(tid[i], NULL) != 0)
-    {
-      printf("Error: unable to join thread %d.\n", i);
-      exit(1);
-    }
-  }
-  
-  free(threadArgv);
-  free(tid);
+  ThreadPool::GetGlobalThreadPool()->Execute(numThreads, ClothBWMT_WorkerThread, &threadArg);
   
   // assemble results
   switch(computationTarget)
@@ -28,7 +28,7 @@
 
 /*
  Multi-threaded version of the ClothBW class. 
- It uses the POSIX threads ("pthreads").
+ It uses the POSIX threads ("pthreads"), via the process-wide thread pool (see threadPool.h).
 */
 
 #ifndef _CLOTHBWMT_H_
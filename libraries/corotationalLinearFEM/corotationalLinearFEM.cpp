@@ -293,18 +293,38 @@ void CorotationalLinearFEM::ComputeForceAndStiffnessMatrix(double * u, double *
   ComputeForceAndStiffnessMatrixOfSubmesh(u, f, stiffnessMatrix, warp, 0, tetMesh->getNumElements());
 }
 
-void CorotationalLinearFEM::ComputeForceAndStiffnessMatrixOfSubmesh(double * u, double * f, SparseMatrix * stiffnessMatrix, int warp, int elementLo, int elementHi)
+void CorotationalLinearFEM::ComputeForceAndStiffnessMatrixBlock3(double * u, double * f, SparseMatrixBlock3 * stiffnessMatrix, int warp)
 {
-  // clear f to zero
+  // clear f and the stiffness matrix to zero
   if (f != NULL)
     memset(f, 0, sizeof(double) * 3 * numVertices);
+  if (stiffnessMatrix != NULL)
+    stiffnessMatrix->ResetToZero();
 
-  // clear stiffness matrix to zero
+  ComputeForceAndStiffnessMatrixOfSubmeshWorkhorse(u, f, NULL, stiffnessMatrix, warp, NULL, 0, tetMesh->getNumElements());
+}
+
+void CorotationalLinearFEM::ComputeForceAndStiffnessMatrixOfSubmesh(double * u, double * f, SparseMatrix * stiffnessMatrix, int warp, int elementLo, int elementHi)
+{
+  // clear f and the stiffness matrix to zero
+  if (f != NULL)
+    memset(f, 0, sizeof(double) * 3 * numVertices);
   if (stiffnessMatrix != NULL)
     stiffnessMatrix->ResetToZero();
 
-  for (int el=elementLo; el < elementHi; el++)
+  ComputeForceAndStiffnessMatrixOfSubmeshWorkhorse(u, f, stiffnessMatrix, NULL, warp, NULL, elementLo, elementHi);
+}
+
+void CorotationalLinearFEM::AddForceAndStiffnessMatrixOfElements(double * u, double * f, SparseMatrix * stiffnessMatrix, int warp, const int * elementList, int elementLo, int elementHi)
+{
+  ComputeForceAndStiffnessMatrixOfSubmeshWorkhorse(u, f, stiffnessMatrix, NULL, warp, elementList, elementLo, elementHi);
+}
+
+void CorotationalLinearFEM::ComputeForceAndStiffnessMatrixOfSubmeshWorkhorse(double * u, double * f, SparseMatrix * stiffnessMatrix, SparseMatrixBlock3 * blockStiffnessMatrix, int warp, const int * elementList, int elementLo, int elementHi)
+{
+  for (int elementIndex=elementLo; elementIndex < elementHi; elementIndex++)
   {
+    int el = (elementList != NULL) ? elementList[elementIndex] : elementIndex;
     int vtxIndex[4];
     for (int vtx=0; vtx<4; vtx++)
       vtxIndex[vtx] = tetMesh->getVertexIndex(el, vtx);
@@ -552,6 +572,22 @@ void CorotationalLinearFEM::ComputeForceAndStiffnessMatrixOfSubmesh(double * u,
             for(int l=0; l<3; l++)
               stiffnessMatrix->AddEntry(3 * rowIndex[i] + k, 3 * columnIndex[4 * i + j] + l, KElement[12 * (3 * i + k) + 3 * j + l]);
     }
+
+    if (blockStiffnessMatrix != NULL)
+    {
+      int * rowIndex = rowIndices[el];
+      int * columnIndex = columnIndices[el];
+
+      // add KElement to the global block stiffness matrix (columnIndex is the position of the block within the block row)
+      for (int i=0; i<4; i++)
+        for (int j=0; j<4; j++)
+        {
+          double * block = blockStiffnessMatrix->GetBlock(rowIndex[i], columnIndex[4 * i + j]);
+          for(int k=0; k<3; k++)
+            for(int l=0; l<3; l++)
+              block[3 * k + l] += KElement[12 * (3 * i + k) + 3 * j + l];
+        }
+    }
   }
 }
 
@@ -48,6 +48,7 @@
 
 #include "tetMesh.h"
 #include "sparseMatrix.h"
+#include "sparseMatrixBlock3.h"
 
 class CorotationalLinearFEM
 {
@@ -73,6 +74,14 @@ public:
   // this routine is same as above, except that it only traverses elements from elementLo <= element <= elementHi - 1
   void ComputeForceAndStiffnessMatrixOfSubmesh(double * vertexDisplacements, double * internalForces, SparseMatrix * stiffnessMatrix, int warp, int elementLo, int elementHi);
 
+  // this routine traverses elements elementList[elementLo], ..., elementList[elementHi-1], and adds their contributions to internalForces and stiffnessMatrix
+  // (unlike the routines above, it does not clear internalForces and stiffnessMatrix to zero; either of them may be NULL)
+  void AddForceAndStiffnessMatrixOfElements(double * vertexDisplacements, double * internalForces, SparseMatrix * stiffnessMatrix, int warp, const int * elementList, int elementLo, int elementHi);
+
+  // same as ComputeForceAndStiffnessMatrix, except that the element 3x3 blocks are written directly into a block matrix
+  // the block matrix must have been created from the matrix returned by GetStiffnessMatrixTopology
+  void ComputeForceAndStiffnessMatrixBlock3(double * vertexDisplacements, double * internalForces, SparseMatrixBlock3 * stiffnessMatrix, int warp=1);
+
   inline TetMesh * GetTetMesh() { return tetMesh; }
 
 protected:
@@ -91,6 +100,10 @@ protected:
   int ** columnIndices;
   void ClearRowColumnIndices();
   void BuildRowColumnIndices(SparseMatrix * sparseMatrix);
+
+  // at most one of stiffnessMatrix, blockStiffnessMatrix is non-NULL; adds the contributions (does not clear the outputs to zero)
+  // if elementList is NULL, elements elementLo <= el < elementHi are traversed, otherwise elements elementList[elementLo], ..., elementList[elementHi-1]
+  void ComputeForceAndStiffnessMatrixOfSubmeshWorkhorse(double * vertexDisplacements, double * internalForces, SparseMatrix * stiffnessMatrix, SparseMatrixBlock3 * blockStiffnessMatrix, int warp, const int * elementList, int elementLo, int elementHi);
 };
 
 #endif
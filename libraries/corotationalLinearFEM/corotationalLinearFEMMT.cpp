@@ -30,12 +30,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <pthread.h>
-#include <vector>
-#include <set>
-#include "macros.h"
 #include "corotationalLinearFEMMT.h"
-using namespace std;
+#include "generateElementColoring.h"
+#include "threadPool.h"
 
 CorotationalLinearFEMMT::CorotationalLinearFEMMT(TetMesh * tetMesh, int numThreads_) : CorotationalLinearFEM(tetMesh), numThreads(numThreads_)
 {
@@ -46,149 +43,73 @@ CorotationalLinearFEMMT::~CorotationalLinearFEMMT()
 {
   free(startElement);
   free(endElement);
-  free(internalForceBuffer);
-  for(int i=0; i<numThreads; i++)
-    delete(stiffnessMatrixBuffer[i]);
-  free(stiffnessMatrixBuffer);
+  free(colorStarts);
+  free(coloredElements);
 }
 
+// shared by all the tasks of one color
 struct CorotationalLinearFEMMT_threadArg
 {
   CorotationalLinearFEMMT * corotationalLinearFEMMT;
   double * u;
-  double * f;
-  SparseMatrix * stiffnessMatrix;
+  double * f; // the global force vector (can be NULL)
+  SparseMatrix * stiffnessMatrix; // the global matrix (can be NULL)
   int warp;
-  int rank;
+  int color;
 };
 
-void * CorotationalLinearFEMMT_WorkerThread(void * arg)
+void CorotationalLinearFEMMT_WorkerThread(void * arg, int rank)
 {
   struct CorotationalLinearFEMMT_threadArg * threadArgp = (struct CorotationalLinearFEMMT_threadArg*) arg;
   CorotationalLinearFEMMT * corotationalLinearFEMMT = threadArgp->corotationalLinearFEMMT;
-  double * u = threadArgp->u;
-  double * f = threadArgp->f;
-  SparseMatrix * stiffnessMatrix = threadArgp->stiffnessMatrix;
-  int warp = threadArgp->warp;
-  int rank = threadArgp->rank;
-  int startElement = corotationalLinearFEMMT->GetStartElement(rank);
-  int endElement = corotationalLinearFEMMT->GetEndElement(rank);
+  int startElement = corotationalLinearFEMMT->GetStartElement(threadArgp->color, rank);
+  int endElement = corotationalLinearFEMMT->GetEndElement(threadArgp->color, rank);
 
   //printf("%d %d\n", startElement, endElement);
-  corotationalLinearFEMMT->ComputeForceAndStiffnessMatrixOfSubmesh(u, f, stiffnessMatrix, warp, startElement, endElement);
-
-  return NULL;
+  corotationalLinearFEMMT->AddForceAndStiffnessMatrixOfElements(threadArgp->u, threadArgp->f, threadArgp->stiffnessMatrix, threadArgp->warp, corotationalLinearFEMMT->GetColoredElements(), startElement, endElement);
 }
 
 void CorotationalLinearFEMMT::Initialize()
 {
-  internalForceBuffer = (double*) malloc (sizeof(double) * numThreads * 3 * tetMesh->getNumVertices());
-
-  // generate skeleton matrices
-  stiffnessMatrixBuffer = (SparseMatrix**) malloc (sizeof(SparseMatrix*) * numThreads);
-
-  SparseMatrix * sparseMatrix;
-  GetStiffnessMatrixTopology(&sparseMatrix);
-  for(int i=0; i<numThreads; i++)
-    stiffnessMatrixBuffer[i] = new SparseMatrix(*sparseMatrix);
+  // color the elements; elements of the same color do not share any vertices
+  numColors = GenerateElementColoring::Generate(tetMesh, &colorStarts, &coloredElements);
 
-  // split the workload
-  int numElements = tetMesh->getNumElements();
-  startElement = (int*) malloc (sizeof(int) * numThreads);
-  endElement = (int*) malloc (sizeof(int) * numThreads);
-
-  int remainder = numElements % numThreads;
-  // the first 'remainder' nodes will process one edge more
-  int jobSize = numElements / numThreads;
-
-  for(int rank=0; rank < numThreads; rank++)
-  {
-    if (rank < remainder)
-    {
-      startElement[rank] = rank * (jobSize+1);
-      endElement[rank] = (rank+1) * (jobSize+1);
-    }
-    else
-    {
-      startElement[rank] = remainder * (jobSize+1) + (rank-remainder) * jobSize;
-      endElement[rank] = remainder * (jobSize+1) + ((rank-remainder)+1) * jobSize;
-    }
-  }
+  // split the workload of each color
+  GenerateElementColoring::PartitionColors(numColors, colorStarts, numThreads, &startElement, &endElement);
 
-  //printf("Total elements: %d \n", numElements);
+  //printf("Total elements: %d \n", tetMesh->getNumElements());
   //printf("Num threads: %d \n", numThreads);
-  //printf("Canonical job size: %d \n", jobSize);
-  //printf("Num threads with job size augmented by one edge: %d \n", remainder);
 }
 
 void CorotationalLinearFEMMT::ComputeForceAndStiffnessMatrix(double * u, double * f, SparseMatrix * stiffnessMatrix, int warp)
 {
-  // launch threads
-  struct CorotationalLinearFEMMT_threadArg * threadArgv = (struct CorotationalLinearFEMMT_threadArg*) malloc (sizeof(struct CorotationalLinearFEMMT_threadArg) * numThreads);
-
-  pthread_t * tid = (pthread_t*) malloc (sizeof(pthread_t) * numThreads);
-
-  int numVertices3 = 3 * tetMesh->getNumVertices();
-
-  for(int i=0; i<numThreads; i++)
-  {
-    threadArgv[i].corotationalLinearFEMMT = this;
-    threadArgv[i].u = u;
-    threadArgv[i].f = &internalForceBuffer[i * numVertices3];
-    threadArgv[i].stiffnessMatrix = stiffnessMatrixBuffer[i];
-    threadArgv[i].warp = warp;
-    threadArgv[i].rank = i;
-  }
-
-  for(int i=0; i<numThreads; i++)  
-  {
-    if (pthread_create(&tid[i], NULL, CorotationalLinearFEMMT_WorkerThread, &threadArgv[i]) != 0)
-    {
-      printf("Error: unable to launch thread %d.\n", i);
-      exit(1);
-    }
-  }
-
-  for(int i=0; i<numThreads; i++)
-  {
-    if (pthread_join(tid[i], NULL) != 0)
-    {
-      printf("Error: unable to join thread %d.\n", i);
-      exit(1);
-    }
-  }
-
-  free(threadArgv);
-  free(tid);
-
   if (f != NULL) 
-    memset(f, 0, sizeof(double) * numVertices3);
+    memset(f, 0, sizeof(double) * 3 * tetMesh->getNumVertices());
 
   if (stiffnessMatrix != NULL) 
-  {
     stiffnessMatrix->ResetToZero();
 
-    for(int i=0; i<numThreads; i++)
-    {
-       double * source = &internalForceBuffer[i * numVertices3];
-       if (f != NULL) 
-       {
-         for(int j=0; j<numVertices3; j++)
-           f[j] += source[j];
-       }
+  // run the tasks on the persistent thread pool, one color at a time
+  struct CorotationalLinearFEMMT_threadArg threadArg;
+  threadArg.corotationalLinearFEMMT = this;
+  threadArg.u = u;
+  threadArg.f = f;
+  threadArg.stiffnessMatrix = stiffnessMatrix;
+  threadArg.warp = warp;
 
-       *stiffnessMatrix += *(stiffnessMatrixBuffer[i]);
-    }
+  for(int color=0; color<numColors; color++)
+  {
+    threadArg.color = color;
+    ThreadPool::GetGlobalThreadPool()->Execute(numThreads, CorotationalLinearFEMMT_WorkerThread, &threadArg);
   }
 }
 
-int CorotationalLinearFEMMT::GetStartElement(int rank)
+int CorotationalLinearFEMMT::GetStartElement(int color, int rank)
 {
-  return startElement[rank];
+  return startElement[color * numThreads + rank];
 }
 
-int CorotationalLinearFEMMT::GetEndElement(int rank)
+int CorotationalLinearFEMMT::GetEndElement(int color, int rank)
 {
-  return endElement[rank];
+  return endElement[color * numThreads + rank];
 }
-
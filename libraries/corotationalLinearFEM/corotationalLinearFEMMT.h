@@ -33,7 +33,11 @@
 
 /*
    Multi-threaded version of the CorotationalLinearFEM class. 
-   It uses the POSIX threads ("pthreads").
+   It uses the POSIX threads ("pthreads"), via the process-wide thread pool (see threadPool.h).
+   The mesh elements are partitioned into colors, such that no two elements of the same color share a vertex
+   (see generateElementColoring.h). The colors are processed one after another; within each color, each thread
+   assembles the internal forces and stiffness matrix of a subset of the color's elements directly into the global
+   force vector and the global stiffness matrix (no per-thread copies, and no final reduction are needed).
    See also corotationalLinearFEM.h
 */
 
@@ -46,18 +50,21 @@ public:
 
   virtual void ComputeForceAndStiffnessMatrix(double * vertexDisplacements, double * internalForces, SparseMatrix * stiffnessMatrix, int warp=1);
 
-  int GetStartElement(int rank);
-  int GetEndElement(int rank);
+  inline int GetNumColors() { return numColors; }
+  inline const int * GetColoredElements() { return coloredElements; } // all elements, sorted by color
+  // the elements processed by thread "rank" during color "color" are
+  // GetColoredElements()[GetStartElement(color, rank)], ..., GetColoredElements()[GetEndElement(color, rank)-1]
+  int GetStartElement(int color, int rank);
+  int GetEndElement(int color, int rank);
 
 protected:
   int numThreads;
-  int * startElement, * endElement;
-  double * internalForceBuffer;
-  SparseMatrix ** stiffnessMatrixBuffer;
+  int numColors;
+  int * colorStarts;
+  int * coloredElements;
+  int * startElement, * endElement; // numColors x numThreads
 
   void Initialize();
-  void ComputeHelper(double * u, double * uSecondary, void * target, bool addQuantity);
-
 };
 
 #endif
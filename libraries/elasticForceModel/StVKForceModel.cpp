@@ -27,6 +27,7 @@
  *************************************************************************/
 
 #include "StVKForceModel.h"
+#include "StVKTetStiffnessMatrix.h"
 
 StVKForceModel::StVKForceModel(StVKInternalForces * stVKInternalForces_, StVKStiffnessMatrix * stVKStiffnessMatrix_): stVKInternalForces(stVKInternalForces_), stVKStiffnessMatrix(stVKStiffnessMatrix_)
 {
@@ -34,9 +35,17 @@ StVKForceModel::StVKForceModel(StVKInternalForces * stVKInternalForces_, StVKSti
   ownStiffnessMatrix = false;
   if (stVKStiffnessMatrix == NULL)
   {
-    stVKStiffnessMatrix = new StVKStiffnessMatrix(stVKInternalForces);
+    StVKTetInternalForces * stVKTetInternalForces = dynamic_cast<StVKTetInternalForces*>(stVKInternalForces);
+    if (stVKTetInternalForces != NULL)
+      stVKStiffnessMatrix = new StVKTetStiffnessMatrix(stVKTetInternalForces);
+    else
+      stVKStiffnessMatrix = new StVKStiffnessMatrix(stVKInternalForces);
     ownStiffnessMatrix = true;
   }
+
+  // the one-pass force+matrix evaluation is only consistent with GetInternalForce if the stiffness matrix uses the same internal force object
+  // (it only saves work with StVKTetStiffnessMatrix; the base class simply calls ComputeForces and ComputeStiffnessMatrix)
+  fusedForceAndMatrix = (dynamic_cast<StVKTetStiffnessMatrix*>(stVKStiffnessMatrix) != NULL) && (stVKStiffnessMatrix->GetInternalForces() == stVKInternalForces);
 }
 
 StVKForceModel::~StVKForceModel()
@@ -60,3 +69,14 @@ void StVKForceModel::GetTangentStiffnessMatrix(double * u, SparseMatrix * tangen
   stVKStiffnessMatrix->ComputeStiffnessMatrix(u, tangentStiffnessMatrix);
 } 
 
+void StVKForceModel::GetForceAndMatrix(double * u, double * internalForces, SparseMatrix * tangentStiffnessMatrix)
+{
+  if (fusedForceAndMatrix)
+    stVKStiffnessMatrix->ComputeForceAndStiffnessMatrix(u, internalForces, tangentStiffnessMatrix);
+  else
+  {
+    stVKInternalForces->ComputeForces(u, internalForces);
+    stVKStiffnessMatrix->ComputeStiffnessMatrix(u, tangentStiffnessMatrix);
+  }
+}
+
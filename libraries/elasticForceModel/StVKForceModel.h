@@ -28,6 +28,8 @@
 
 /*
   Force model corresponding to the StVK material.
+  With tet meshes, StVKTetInternalForces and StVKTetStiffnessMatrix can be used
+  instead of the ABCD-based classes (see StVKTetInternalForces.h).
 */
 
 #ifndef _STVKFORCEMODEL_H_
@@ -46,11 +48,13 @@ public:
   virtual void GetInternalForce(double * u, double * internalForces);
   virtual void GetTangentStiffnessMatrixTopology(SparseMatrix ** tangentStiffnessMatrix);
   virtual void GetTangentStiffnessMatrix(double * u, SparseMatrix * tangentStiffnessMatrix); 
+  virtual void GetForceAndMatrix(double * u, double * internalForces, SparseMatrix * tangentStiffnessMatrix); 
 
 protected:
   StVKInternalForces * stVKInternalForces;
   StVKStiffnessMatrix * stVKStiffnessMatrix;
   bool ownStiffnessMatrix;
+  bool fusedForceAndMatrix;
 };
 
 #endif
@@ -79,7 +79,9 @@ The code supports the following solvers:
 1. SPOOLES (a free solver), 
 2. PARDISO (we used the commercial version that comes with Intel MKL; this 
 solver is multi-threaded and can be executed across multiple cores of a CPU),
-3. our own Jacobi-preconditioned Conjugate Solver (from our "sparseMatrix" library).
+3. our own Jacobi-preconditioned Conjugate Solver (from our "sparseSolver" library),
+4. our own sparse direct (supernodal Cholesky) solver (from our "sparseSolver" library).
+The solver is selected at run-time (see integratorSparse/integratorSparseSolver.h).
 We were able to run sparse simulations on Windows, Linux and Mac OS X.
 
 The code also supports static simulations, i.e., simulations where the dynamic
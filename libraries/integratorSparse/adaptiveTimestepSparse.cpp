@@ -0,0 +1,306 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "integrator" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC     *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "adaptiveTimestepSparse.h"
+#include "implicitNewmarkSparse.h"
+#include "centralDifferencesSparse.h"
+
+AdaptiveTimestepSparse::AdaptiveTimestepSparse(IntegratorBaseSparse * integrator_, double relativeTolerance_, double absoluteTolerance_): integrator(integrator_), relativeTolerance(relativeTolerance_), absoluteTolerance(absoluteTolerance_)
+{
+  if (dynamic_cast<CentralDifferencesSparse*>(integrator) != NULL)
+  {
+    printf("Error: adaptive timestepping is not supported for central differences.\n");
+    exit(1);
+  }
+
+  r = integrator->GetNumDOFs();
+  timestep = integrator->GetTimeStep();
+  if (timestep <= 0)
+  {
+    printf("Error: adaptive timestepping requires a positive initial timestep.\n");
+    exit(1);
+  }
+
+  minTimestep = 1E-6 * timestep;
+  maxTimestep = 1E6 * timestep;
+  minFactor = 0.2;
+  maxFactor = 5.0;
+  safety = 0.9;
+  failureFactor = 0.25;
+  newtonFailureFactor = 0.5;
+  newtonFailureThreshold = 1E-2;
+  maxNumAttempts = 20;
+
+  q0 = (double*) malloc (sizeof(double) * r);
+  qvel0 = (double*) malloc (sizeof(double) * r);
+  qaccel0 = (double*) malloc (sizeof(double) * r);
+  acceleration = (double*) malloc (sizeof(double) * r);
+
+  time = 0.0;
+  numAcceptedSteps = 0;
+  numRejectedSteps = 0;
+  numFailedSteps = 0;
+
+  timestepHistory = NULL;
+  timestepHistoryLength = 0;
+  timestepHistoryCapacity = 0;
+
+  Reset();
+}
+
+AdaptiveTimestepSparse::~AdaptiveTimestepSparse()
+{
+  free(q0);
+  free(qvel0);
+  free(qaccel0);
+  free(acceleration);
+  free(timestepHistory);
+}
+
+void AdaptiveTimestepSparse::Reset()
+{
+  lastTimestep = 0.0;
+  lastError = 0.0;
+  previousError = 0.0;
+  accelerationIsAvailable = 0;
+}
+
+void AdaptiveTimestepSparse::SetTolerances(double relativeTolerance, double absoluteTolerance)
+{
+  this->relativeTolerance = relativeTolerance;
+  this->absoluteTolerance = absoluteTolerance;
+}
+
+void AdaptiveTimestepSparse::SetTimestepBounds(double minTimestep, double maxTimestep)
+{
+  this->minTimestep = minTimestep;
+  this->maxTimestep = maxTimestep;
+  if (timestep < minTimestep)
+    timestep = minTimestep;
+  if (timestep > maxTimestep)
+    timestep = maxTimestep;
+}
+
+void AdaptiveTimestepSparse::SetStepFactorBounds(double minFactor, double maxFactor)
+{
+  this->minFactor = minFactor;
+  this->maxFactor = maxFactor;
+}
+
+void AdaptiveTimestepSparse::ClearTimestepHistory()
+{
+  timestepHistoryLength = 0;
+}
+
+void AdaptiveTimestepSparse::PrintStatistics()
+{
+  printf("Adaptive timestepping: time=%G, accepted steps=%d, rejected steps=%d, failed steps=%d, last timestep=%G, next timestep=%G\n",
+    time, numAcceptedSteps, numRejectedSteps, numFailedSteps, lastTimestep, timestep);
+}
+
+double AdaptiveTimestepSparse::ComputeErrorEstimate(double h)
+{
+  double * q = integrator->Getq();
+  double * qvel = integrator->Getqvel();
+  const double * a = accelerationIsAvailable ? acceleration : qaccel0;
+  double halfh2 = 0.5 * h * h;
+
+  double error = 0.0;
+  int finite = 1;
+  #ifdef USE_OPENMP
+    #pragma omp parallel for reduction(+:error) reduction(&&:finite)
+  #endif
+  for(int i=0; i<r; i++)
+  {
+    if (!isfinite(q[i]) || !isfinite(qvel[i]))
+      finite = 0;
+    double predicted = q0[i] + h * qvel0[i] + halfh2 * a[i];
+    double scale = absoluteTolerance + relativeTolerance * fmax(fabs(q0[i]), fabs(q[i]));
+    double e = (q[i] - predicted) / scale;
+    error += e * e;
+  }
+
+  if (!finite || !isfinite(error))
+    return -1.0;
+
+  return sqrt(error / r);
+}
+
+int AdaptiveTimestepSparse::NewtonFailed(int * slowConvergence)
+{
+  *slowConvergence = 0;
+  ImplicitNewmarkSparse * implicitIntegrator = dynamic_cast<ImplicitNewmarkSparse*>(integrator);
+  if (implicitIntegrator == NULL)
+    return 0;
+
+  int maxIterations = implicitIntegrator->GetMaxIterations();
+  if (maxIterations <= 1)
+    return 0; // semi-implicit: convergence is not checked
+
+  if (implicitIntegrator->GetNumNewtonIterations() < maxIterations)
+    return 0; // converged
+
+  double reduction = implicitIntegrator->GetNewtonResidualReduction();
+  *slowConvergence = (reduction > newtonFailureThreshold * newtonFailureThreshold);
+  return (reduction > newtonFailureThreshold);
+}
+
+int AdaptiveTimestepSparse::DoTimestep(double maxLength)
+{
+  integrator->GetqState(q0, qvel0, qaccel0);
+
+  double h = timestep;
+  int stepWasShortened = 0;
+  if ((maxLength > 0) && (h > maxLength))
+  {
+    h = maxLength;
+    stepWasShortened = 1;
+  }
+
+  int rejected = 0;
+  for(int attempt=0; attempt<maxNumAttempts; attempt++)
+  {
+    integrator->SetTimestep(h);
+    int code = integrator->DoTimestep();
+
+    double error = -1.0;
+    int slowConvergence = 0;
+    int newtonFailed = 0;
+    if (code == 0)
+    {
+      error = ComputeErrorEstimate(h);
+      newtonFailed = NewtonFailed(&slowConvergence);
+    }
+
+    double reduction = 0.0;
+    if ((code != 0) || (error < 0))
+      reduction = failureFactor;
+    else if (newtonFailed)
+      reduction = newtonFailureFactor;
+
+    if ((reduction == 0.0) && (error <= 1.0))
+    {
+      // accept the step
+      double * qvel = integrator->Getqvel();
+      #ifdef USE_OPENMP
+        #pragma omp parallel for
+      #endif
+      for(int i=0; i<r; i++)
+        acceleration[i] = (qvel[i] - qvel0[i]) / h;
+      accelerationIsAvailable = 1;
+
+      // propose the next timestep (PI controller)
+      double errorClamped = (error > 1E-10) ? error : 1E-10;
+      double factor;
+      if ((previousError > 0) && !rejected)
+        factor = safety * pow(errorClamped, -0.7 / 3.0) * pow(previousError, 0.4 / 3.0);
+      else
+        factor = safety * pow(errorClamped, -1.0 / 3.0);
+      if (factor < minFactor)
+        factor = minFactor;
+      if (factor > maxFactor)
+        factor = maxFactor;
+      if ((rejected || slowConvergence) && (factor > 1.0))
+        factor = 1.0;
+
+      double nextTimestep = h * factor;
+      // after a step that was shortened to meet the end of an interval, keep the proposed timestep, unless the error estimate indicates that it is too long
+      if (stepWasShortened && !rejected && (nextTimestep < timestep))
+        nextTimestep = fmin(timestep, h * safety * pow(errorClamped, -1.0 / 3.0));
+      if (nextTimestep < minTimestep)
+        nextTimestep = minTimestep;
+      if (nextTimestep > maxTimestep)
+        nextTimestep = maxTimestep;
+      timestep = nextTimestep;
+
+      lastTimestep = h;
+      lastError = error;
+      previousError = errorClamped;
+      time += h;
+      numAcceptedSteps++;
+
+      if (timestepHistoryLength == timestepHistoryCapacity)
+      {
+        timestepHistoryCapacity = (timestepHistoryCapacity == 0) ? 64 : 2 * timestepHistoryCapacity;
+        timestepHistory = (double*) realloc (timestepHistory, sizeof(double) * timestepHistoryCapacity);
+      }
+      timestepHistory[timestepHistoryLength++] = h;
+
+      return 0;
+    }
+
+    // reject the step: restore the state and retry with a smaller timestep
+    integrator->SetqState(q0, qvel0, qaccel0);
+    if (reduction > 0.0)
+      numFailedSteps++;
+    else
+    {
+      numRejectedSteps++;
+      reduction = safety * pow(error, -1.0 / 3.0);
+      if (reduction < minFactor)
+        reduction = minFactor;
+      if (reduction > 0.9)
+        reduction = 0.9;
+    }
+    rejected = 1;
+
+    if (h <= minTimestep)
+      break;
+    h *= reduction;
+    if (h < minTimestep)
+      h = minTimestep;
+    timestep = h;
+  }
+
+  printf("Error: adaptive timestepping could not find an acceptable step at time %G (timestep=%G).\n", time, h);
+  integrator->SetTimestep(timestep);
+  return 1;
+}
+
+int AdaptiveTimestepSparse::Advance(double duration)
+{
+  double endTime = time + duration;
+  // stop when the remaining interval is negligible compared to the duration
+  while (endTime - time > 1E-10 * duration)
+  {
+    double remaining = endTime - time;
+    double maxLength = remaining;
+    // avoid a very short last step: if the proposed timestep covers more than half of the remaining interval
+    // (but not all of it), split the remainder into two equal steps
+    if ((timestep < remaining) && (timestep > 0.5 * remaining))
+      maxLength = 0.5 * remaining;
+    if (DoTimestep(maxLength) != 0)
+      return 1;
+  }
+  time = endTime;
+  return 0;
+}
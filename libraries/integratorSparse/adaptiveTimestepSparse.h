@@ -0,0 +1,146 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "integrator" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC     *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+/*
+  Adaptive timestepping with local error control, for the one-step sparse integrators
+  (ImplicitNewmarkSparse, ImplicitBackwardEulerSparse, EulerSparse).
+
+  The driver advances a given integrator with a variable timestep. After each step
+  of length h, it estimates the local truncation error by comparing the new position
+  with the explicit (Newmark) predictor
+    q_pred = q_n + h * qvel_n + h^2 / 2 * a_n ,
+  where a_n is the average acceleration (qvel_n - qvel_{n-1}) / h_{n-1} of the previous step
+  (at the first step, the acceleration stored in the integrator is used).
+  The difference is O(h^3) for smooth motion, and becomes large on impacts and other abrupt changes.
+  It is measured in the weighted RMS norm
+    err = sqrt( 1/r * sum_i ( e_i / (absoluteTolerance + relativeTolerance * max(|q_n,i|, |q_{n+1},i|)) )^2 ) .
+
+  A step is accepted if err <= 1. Otherwise, the state is restored and the step is retried
+  with a smaller timestep. The next timestep is chosen by a PI controller:
+    h_{n+1} = h_n * safety * err_n^(-0.7/3) * err_{n-1}^(0.4/3) ,
+  limited to [minFactor * h_n, maxFactor * h_n] and to [minTimestep, maxTimestep].
+  The timestep does not grow right after a rejected step.
+
+  Steps where DoTimestep fails (e.g., the linear solver fails, or the state is not finite) are retried
+  with the timestep reduced by failureFactor. For the implicit integrators with more than one Newton
+  iteration, a step that used all Newton iterations, but reduced the residual (at the unconstrained DOFs)
+  by less than newtonFailureThreshold is also retried with a smaller timestep (newtonFailureFactor).
+  The timestep is not grown after steps that used all Newton iterations and reduced the residual
+  by less than newtonFailureThreshold^2.
+
+  Central differences (CentralDifferencesSparse) is a two-step method that assumes a constant timestep,
+  and is not supported.
+
+  The integrator is not owned by this class. Its timestep is changed by this class before each step.
+*/
+
+#ifndef _ADAPTIVETIMESTEPSPARSE_H_
+#define _ADAPTIVETIMESTEPSPARSE_H_
+
+#include "integratorBaseSparse.h"
+
+class AdaptiveTimestepSparse
+{
+public:
+
+  // the initial timestep is the current timestep of the integrator
+  AdaptiveTimestepSparse(IntegratorBaseSparse * integrator, double relativeTolerance=1E-3, double absoluteTolerance=1E-6);
+  virtual ~AdaptiveTimestepSparse();
+
+  // performs one accepted step (retrying rejected attempts), with the current timestep (see GetTimestep), but not longer than maxLength (if positive)
+  // returns 0 on success, and 1 if no acceptable step was found (the integrator state is then the state before the call)
+  int DoTimestep(double maxLength=-1.0);
+  // advances the simulation by "duration" seconds, using as many steps as needed (the last step is shortened to end exactly at the given time)
+  // returns 0 on success, and 1 on failure (the integrator state is then the state at the beginning of the failed step)
+  int Advance(double duration);
+
+  // call this when the state of the integrator was changed externally (e.g., SetState, ResetToRest)
+  void Reset();
+
+  // === parameters ===
+  void SetTolerances(double relativeTolerance, double absoluteTolerance);
+  void SetTimestepBounds(double minTimestep, double maxTimestep); // default: [1E-6, 1E6] times the initial timestep
+  void SetStepFactorBounds(double minFactor, double maxFactor); // default: [0.2, 5.0]
+  inline void SetSafetyFactor(double safety) { this->safety = safety; } // default: 0.9
+  inline void SetMaxNumAttempts(int maxNumAttempts) { this->maxNumAttempts = maxNumAttempts; } // per step; default: 20
+  inline void SetNewtonFailureThreshold(double newtonFailureThreshold) { this->newtonFailureThreshold = newtonFailureThreshold; } // default: 1E-2
+  inline void SetTimestep(double timestep) { this->timestep = timestep; } // sets the timestep for the next step
+
+  // === state and statistics ===
+  inline double GetTimestep() { return timestep; } // the timestep proposed for the next step
+  inline double GetLastTimestep() { return lastTimestep; } // the length of the last accepted step
+  inline double GetLastErrorEstimate() { return lastError; } // the normalized error estimate of the last accepted step
+  inline double GetTime() { return time; } // the total time of all accepted steps
+  inline void SetTime(double time) { this->time = time; }
+  inline int GetNumAcceptedSteps() { return numAcceptedSteps; }
+  inline int GetNumRejectedSteps() { return numRejectedSteps; } // rejected because of the error estimate
+  inline int GetNumFailedSteps() { return numFailedSteps; } // rejected because of integrator or Newton failures
+
+  // the lengths of all accepted steps, in order (since construction or the last call to ClearTimestepHistory)
+  inline int GetTimestepHistoryLength() { return timestepHistoryLength; }
+  inline const double * GetTimestepHistory() { return timestepHistory; }
+  void ClearTimestepHistory();
+
+  // prints the statistics to stdout
+  void PrintStatistics();
+
+protected:
+  IntegratorBaseSparse * integrator;
+  int r;
+
+  double relativeTolerance, absoluteTolerance;
+  double minTimestep, maxTimestep;
+  double minFactor, maxFactor;
+  double safety;
+  double failureFactor, newtonFailureFactor;
+  double newtonFailureThreshold;
+  int maxNumAttempts;
+
+  double timestep;
+  double lastTimestep;
+  double lastError;
+  double previousError; // error of the previous accepted step (for the PI controller); 0 if not available
+  double time;
+
+  // state at the beginning of the current step (used for the error estimate, and to restore the state of a rejected step)
+  double * q0, * qvel0, * qaccel0;
+  double * acceleration; // average acceleration over the last accepted step
+  int accelerationIsAvailable;
+
+  int numAcceptedSteps, numRejectedSteps, numFailedSteps;
+  double * timestepHistory;
+  int timestepHistoryLength, timestepHistoryCapacity;
+
+  // returns the normalized error estimate of a step of length h from (q0, qvel0), or -1 if the new state is not finite
+  double ComputeErrorEstimate(double h);
+  // returns 1 if the Newton iteration of the last step did not converge, and sets slowConvergence if the timestep should not grow
+  int NewtonFailed(int * slowConvergence);
+};
+
+#endif
+
@@ -32,15 +32,38 @@
 #include <string.h>
 #include <float.h>
 #include "performanceCounter.h"
-#include "insertRows.h"
 #include "centralDifferencesSparse.h"
 
-CentralDifferencesSparse::CentralDifferencesSparse(int numDOFs, double timestep, SparseMatrix * massMatrix_, ForceModel * forceModel_, int numConstrainedDOFs, int * constrainedDOFs, double dampingMassCoef, double dampingStiffnessCoef, int tangentialDampingMode_, int numSolverThreads_): IntegratorBaseSparse(numDOFs, timestep, massMatrix_, forceModel_, numConstrainedDOFs, constrainedDOFs, dampingMassCoef, dampingStiffnessCoef), tangentialDampingMode(tangentialDampingMode_), numSolverThreads(numSolverThreads_), timestepIndex(0)
+CentralDifferencesSparse::CentralDifferencesSparse(int numDOFs, double timestep, SparseMatrix * massMatrix_, ForceModel * forceModel_, int numConstrainedDOFs, int * constrainedDOFs, double dampingMassCoef, double dampingStiffnessCoef, int tangentialDampingMode_, int numSolverThreads_, IntegratorSparseSolver::solverType solver, int lumpedMass_): IntegratorBaseSparse(numDOFs, timestep, massMatrix_, forceModel_, numConstrainedDOFs, constrainedDOFs, dampingMassCoef, dampingStiffnessCoef), tangentialDampingMode(tangentialDampingMode_), numSolverThreads(numSolverThreads_), timestepIndex(0), systemMatrixIsDecomposed(0), lumpedMass(lumpedMass_), lumpedMassMatrix(NULL), invLumpedMass(NULL)
 {
   rhs = (double*) malloc (sizeof(double) * r);
   rhsConstrained = (double*) malloc (sizeof(double) * (r - numConstrainedDOFs));
 
+  if (lumpedMass)
+  {
+    printf("Using the lumped mass matrix for central differences.\n");
+    invLumpedMass = (double*) malloc (sizeof(double) * r);
+    massMatrix->SumRowEntries(invLumpedMass);
+    SparseMatrixOutline outline(r);
+    for(int i=0; i<r; i++)
+    {
+      if (invLumpedMass[i] <= 0.0)
+      {
+        printf("Error: lumped mass of DOF %d is not positive (%G).\n", i, invLumpedMass[i]);
+        exit(1);
+      }
+      outline.AddEntry(i, i, invLumpedMass[i]);
+      invLumpedMass[i] = 1.0 / invLumpedMass[i];
+    }
+    for(int i=0; i<numConstrainedDOFs; i++)
+      invLumpedMass[constrainedDOFs[i]] = 0.0;
+    lumpedMassMatrix = new SparseMatrix(&outline);
+    massMatrix = lumpedMassMatrix;
+  }
+
   forceModel->GetTangentStiffnessMatrixTopology(&tangentStiffnessMatrix);
+  // keep the stiffness matrix (and all the matrices copied from it below) in a single contiguous block
+  tangentStiffnessMatrix->ConvertToContiguousStorage();
   rayleighDampingMatrix = new SparseMatrix(*tangentStiffnessMatrix);
   rayleighDampingMatrix->BuildSubMatrixIndices(*massMatrix);
   tangentStiffnessMatrix->BuildSubMatrixIndices(*massMatrix);
@@ -53,51 +76,42 @@ CentralDifferencesSparse::CentralDifferencesSparse(int numDOFs, double timestep,
 
   systemMatrix = new SparseMatrix(*tangentStiffnessMatrix);
   systemMatrix->RemoveRowsColumns(numConstrainedDOFs, constrainedDOFs);
-  systemMatrix->BuildSuperMatrixIndices(numConstrainedDOFs, constrainedDOFs, tangentStiffnessMatrix);
 
-  #ifdef PARDISO
-    printf("Creating Pardiso solver for central differences.\n");
-    int positiveDefiniteSolver = 0;
-    pardisoSolver = new PardisoSolver(systemMatrix, numSolverThreads, positiveDefiniteSolver);
-  #endif
+  // the system matrix is assembled directly, without the constrained rows and columns, from the terms K (0) and M (1)
+  // (the pattern of the mass matrix must be a subset of the stiffness matrix pattern)
+  systemMatrixCombination = new SparseMatrixLinearCombination(systemMatrix);
+  systemMatrixCombination->AddTerm(tangentStiffnessMatrix, numConstrainedDOFs, constrainedDOFs);
+  systemMatrixCombination->AddTerm(massMatrix, numConstrainedDOFs, constrainedDOFs);
 
-  #ifdef SPOOLES
-    spoolesSolver = NULL;
-  #endif
-
-  #ifdef PCG
-    printf("Creating Jacobi solver for central differences.\n");
-    jacobiPreconditionedCGSolver = new CGSolver(systemMatrix);
-  #endif
+  printf("Creating %s solver for central differences.\n", IntegratorSparseSolver::GetSolverName(solver));
+  int positiveDefiniteSolver = 0;
+  linearSolver = new IntegratorSparseSolver(solver, systemMatrix, positiveDefiniteSolver, numSolverThreads);
 
   DecomposeSystemMatrix();
 }
 
 CentralDifferencesSparse::~CentralDifferencesSparse()
 {
-  #ifdef PARDISO
-    delete(pardisoSolver);
-  #endif
-
-  #ifdef SPOOLES
-    if (spoolesSolver != NULL)
-      delete(spoolesSolver);
-  #endif
-
-  #ifdef PCG
-    delete(jacobiPreconditionedCGSolver);
-  #endif
-
+  delete(systemMatrixCombination);
   delete(systemMatrix);
   delete(tangentStiffnessMatrix);
   delete(rayleighDampingMatrix);
   free(rhs);
   free(rhsConstrained);
+  delete(lumpedMassMatrix);
+  free(invLumpedMass);
 }
 
 void CentralDifferencesSparse::DecomposeSystemMatrix()
 {
   //printf("*** Central differences: decomposing the system matrix.\n");
+  if (lumpedMass && (dampingStiffnessCoef == 0.0))
+  {
+    // the system matrix is diagonal, and is inverted directly in DoLumpedMassTimestep
+    systemMatrixIsDecomposed = 0;
+    return;
+  }
+
   // construct damping matrix
   // rayleigh damping matrix = dampingMasscoef * massMatrix + dampingStiffnessCoef * stiffness matrix
   forceModel->GetTangentStiffnessMatrix(q, tangentStiffnessMatrix);
@@ -107,44 +121,50 @@ void CentralDifferencesSparse::DecomposeSystemMatrix()
   rayleighDampingMatrix->AddSubMatrix(dampingMassCoef, *massMatrix);
 
   // system matrix = mass matrix + 0.5 * timestep * damping matrix (and remove constrained rows and columns)
-  rayleighDampingMatrix->ScalarMultiply(0.5 * timestep, tangentStiffnessMatrix);
-  tangentStiffnessMatrix->AddSubMatrix(1.0, *massMatrix);
-  systemMatrix->AssignSuperMatrix(tangentStiffnessMatrix);
+  // = (1 + 0.5 * timestep * dampingMassCoef) * mass matrix + 0.5 * timestep * dampingStiffnessCoef * stiffness matrix,
+  // assembled directly into the constrained system matrix
+  double systemFactors[2] = { 0.5 * timestep * dampingStiffnessCoef, 1.0 + 0.5 * timestep * dampingMassCoef };
+  systemMatrixCombination->Evaluate(systemFactors, systemMatrix);
 
   //systemMatrix->SaveToMatlabFormat("system.mat");
   
-  #ifdef PARDISO
-    int info = pardisoSolver->ComputeCholeskyDecomposition(systemMatrix);
-    if (info != 0)
-    {
-      printf("Error: PARDISO solver returned non-zero exit code %d.\n", info);
-      exit(1);
-    }
-  #endif
-
-  #ifdef SPOOLES
-    printf("Creating SPOOLES solver for central differences.\n");
-    if (spoolesSolver != NULL)
-      delete(spoolesSolver);
-    if (numSolverThreads > 1)
-      spoolesSolver = new SPOOLESSolverMT(systemMatrix, numSolverThreads);
-    else
-      spoolesSolver = new SPOOLESSolver(systemMatrix);
-  #endif
+  // the pattern of systemMatrix does not change: direct solvers only re-compute the numerical factorization
+  int info = linearSolver->Factor();
+  if (info != 0)
+  {
+    printf("Error: %s solver returned non-zero exit code %d.\n", linearSolver->GetSolverName(), info);
+    exit(1);
+  }
+  systemMatrixIsDecomposed = 1;
 }
 
 int CentralDifferencesSparse::DoTimestep()
 {
   PerformanceCounter counterForceAssemblyTime;
     forceModel->GetInternalForce(q, internalForces);
+    #ifdef USE_OPENMP
+      #pragma omp parallel for
+    #endif
     for (int i=0; i<r; i++)
       internalForces[i] *= internalForceScalingFactor;
   counterForceAssemblyTime.StopCounter();
   forceAssemblyTime = counterForceAssemblyTime.GetElapsedTime();
 
+  if (lumpedMass && (dampingStiffnessCoef == 0.0))
+  {
+    DoLumpedMassTimestep();
+    timestepIndex++;
+    return 0;
+  }
+
   if (tangentialDampingMode > 0)
+  {
     if (timestepIndex % tangentialDampingMode == 0)
       DecomposeSystemMatrix(); // this routines also updates the damping and system matrices
+  }
+
+  if (!systemMatrixIsDecomposed) // e.g., lumped mass, and stiffness damping was enabled after the last decomposition
+    DecomposeSystemMatrix();
   
   // update equation is (see WRIGGERS P.: Computational Contact Mechanics. John Wiley & Sons, Ltd., 2002., page 275) :
   //
@@ -156,63 +176,52 @@ int CentralDifferencesSparse::DoTimestep()
   // fint is the vector of internal forces
 
   // compute rhs = (dt)^2 * (fext - fint(q(t))) + dt / 2 * C * (q(t-1) - q(t)) + M * (q(t) - q(t-1))
-  // first, compute rhs = M * (q - q_1)
-  for (int i=0; i<r; i++)
-    buffer[i] = q[i] - q_1[i];
-  massMatrix->MultiplyVector(buffer, rhs);
-  
-  // rhs += dt / 2 * dampingMatrix * (q_{n-1} - q_n)
+  // qdelta = q_{n-1} - q_n ; rhs = M * qdelta ; buffer = dampingMatrix * qdelta
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
   for (int i=0; i<r; i++)
     qdelta[i] = q_1[i] - q[i];
+  massMatrix->MultiplyVector(qdelta, rhs);
   rayleighDampingMatrix->MultiplyVector(qdelta, buffer);
-  for (int i=0; i<r; i++)
-    rhs[i] += 0.5 * timestep * buffer[i];
 
-  // rhs += dt * dt * (fext - fint(q(t))) 
+  // assemble the right-hand side directly into the constrained vector:
+  // rhsConstrained = -rhs + dt / 2 * buffer + dt * dt * (fext - fint(q(t)))
   double timestep2 = timestep * timestep;
-  for (int i=0; i<r; i++)
-    rhs[i] += timestep2 * (externalForces[i] - internalForces[i]);
-
-  // now rhs contains the correct value
-
-  RemoveRows(r, rhsConstrained, rhs, numConstrainedDOFs, constrainedDOFs);
+  int numUnconstrainedDOFs = r - numConstrainedDOFs;
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
+  for (int i=0; i<numUnconstrainedDOFs; i++)
+  {
+    int dof = constrainedToFullDOFs[i];
+    rhsConstrained[i] = -rhs[dof] + 0.5 * timestep * buffer[dof] + timestep2 * (externalForces[dof] - internalForces[dof]);
+  }
 
   PerformanceCounter counterSystemSolveTime;
 
   memset(buffer, 0, sizeof(double) * r);
 
-  #ifdef SPOOLES
-    int info = spoolesSolver->SolveLinearSystem(buffer, rhsConstrained);
-    char solverString[16] = "SPOOLES";
-  #endif
-
-  #ifdef PARDISO
-    int info = pardisoSolver->SolveLinearSystem(buffer, rhsConstrained);
-    char solverString[16] = "PARDISO";
-  #endif
-  
-  #ifdef PCG
-    int info = jacobiPreconditionedCGSolver->SolveLinearSystemWithJacobiPreconditioner(buffer, rhsConstrained, 1e-6, 10000);
-    if (info > 0)
-      info = 0;
-    char solverString[16] = "PCG";
-  #endif
-
-  InsertRows(r, buffer, qdelta, numConstrainedDOFs, constrainedDOFs);
+  int info = linearSolver->Solve(buffer, rhsConstrained);
 
   counterSystemSolveTime.StopCounter();
   systemSolveTime = counterSystemSolveTime.GetElapsedTime();
 
   if (info != 0)
   {
-    printf("Error: %s sparse solver returned non-zero exit status %d.\n", solverString, (int)info);
+    printf("Error: %s sparse solver returned non-zero exit status %d.\n", linearSolver->GetSolverName(), (int)info);
     return 1;
   }
 
-  // the new value of q is now in buffer
-  // update velocity, and previous and current positions
+  // the new value of q - q_n is now in buffer (without the constrained DOFs)
+  // scatter it into qdelta, and update velocity, and previous and current positions
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
   for (int i=0; i<r; i++)
   {
+    int index = fullToConstrainedDOFs[i];
+    qdelta[i] = (index >= 0) ? buffer[index] : 0.0;
     q_1[i] = q[i];
     qvel[i] = qdelta[i] / timestep;
     qaccel[i] = (qvel[i] - qvel_1[i]) / timestep;
@@ -226,6 +235,38 @@ int CentralDifferencesSparse::DoTimestep()
   return 0;
 }
 
+void CentralDifferencesSparse::DoLumpedMassTimestep()
+{
+  PerformanceCounter counterSystemSolveTime;
+
+  // (1 + dt / 2 * dampingMassCoef) * M * (q(t+1) - q(t)) = (dt)^2 * (fext(t) - fint(q(t))) + (1 - dt / 2 * dampingMassCoef) * M * (q(t) - q(t-1))
+  // a single pass: solve the diagonal system, and update velocity, previous and current positions
+  // (invLumpedMass is zero for the constrained DOFs, so they do not move)
+  double timestep2 = timestep * timestep;
+  double invTimestep = 1.0 / timestep;
+  double rhsFactor = timestep2 / (1.0 + 0.5 * timestep * dampingMassCoef);
+  double previousDeltaFactor = (1.0 - 0.5 * timestep * dampingMassCoef) / (1.0 + 0.5 * timestep * dampingMassCoef);
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
+  for (int i=0; i<r; i++)
+  {
+    double delta = rhsFactor * invLumpedMass[i] * (externalForces[i] - internalForces[i]) + previousDeltaFactor * (q[i] - q_1[i]);
+    if (invLumpedMass[i] == 0.0) // constrained DOF
+      delta = 0.0;
+    qdelta[i] = delta;
+    q_1[i] = q[i];
+    qvel[i] = delta * invTimestep;
+    qaccel[i] = (qvel[i] - qvel_1[i]) * invTimestep;
+    qvel_1[i] = qvel[i];
+    qaccel_1[i] = qaccel[i];
+    q[i] += delta;
+  }
+
+  counterSystemSolveTime.StopCounter();
+  systemSolveTime = counterSystemSolveTime.GetElapsedTime();
+}
+
 // sets the state based on given q, qvel
 // automatically computes acceleration assuming zero external force
 int CentralDifferencesSparse::SetState(double * q_, double * qvel_)
@@ -56,6 +56,13 @@ In order to use this class, you need to set the timestep very small, or
 else the explicit integrator will go unstable. Roughly speaking, the timestep 
 must resolve the highest frequency present in your simulation. 
 
+Lumped-mass mode: the mass matrix is replaced by the diagonal matrix of its row sums.
+If there is no stiffness damping (dampingStiffnessCoef = 0), the system matrix
+M + dt / 2 * dampingMassCoef * M is then diagonal, and the timestep is a single pass 
+over the state vectors, without any linear system solve (and without computing the 
+tangent stiffness matrix). With stiffness damping, the linear solver is used as usual, 
+with the lumped mass matrix.
+
 See also integratorBase.h .
 
 */
@@ -63,23 +70,16 @@ See also integratorBase.h .
 #ifndef _CENTRALDIFFERENCESSPARSE_H_
 #define _CENTRALDIFFERENCESSPARSE_H_
 
+#include "sparseMatrixLinearCombination.h"
 #include "integratorBaseSparse.h"
-#include "integratorSolverSelection.h"
-
-#ifdef PARDISO
-  #include "sparseSolvers.h"
-#endif
-#ifdef SPOOLES
-  #include "sparseSolvers.h"
-#endif
-#ifdef PCG
-  #include "CGSolver.h"
-#endif
+#include "integratorSparseSolver.h"
 
 class CentralDifferencesSparse : public IntegratorBaseSparse
 {
 public:
-  CentralDifferencesSparse(int numDOFs, double timestep, SparseMatrix * massMatrix, ForceModel * forceModel, int numConstrainedDOFs=0, int * constrainedDOFs=NULL, double dampingMassCoef=0.0, double dampingStiffnessCoef=0.0, int tangentialDampingMode=1, int numSolverThreads=0);
+  // solver selects the sparse linear solver (see integratorSparseSolver.h)
+  // lumpedMass selects the lumped-mass mode (see above)
+  CentralDifferencesSparse(int numDOFs, double timestep, SparseMatrix * massMatrix, ForceModel * forceModel, int numConstrainedDOFs=0, int * constrainedDOFs=NULL, double dampingMassCoef=0.0, double dampingStiffnessCoef=0.0, int tangentialDampingMode=1, int numSolverThreads=0, IntegratorSparseSolver::solverType solver=IntegratorSparseSolver::PCG, int lumpedMass=0);
 
   virtual ~CentralDifferencesSparse();
 
@@ -102,29 +102,27 @@ public:
 
   virtual void ResetToRest();
 
+  inline int UsesLumpedMass() { return lumpedMass; }
+
 protected:
   double * rhs;
   double * rhsConstrained;
   SparseMatrix * rayleighDampingMatrix;
   SparseMatrix * tangentStiffnessMatrix;
   SparseMatrix * systemMatrix;
+  SparseMatrixLinearCombination * systemMatrixCombination; // K (0) and M (1), with the constrained DOFs removed, to assemble systemMatrix
   int tangentialDampingMode;
   int numSolverThreads;
   int timestepIndex;
+  int systemMatrixIsDecomposed;
 
-  void DecomposeSystemMatrix();
-
-  #ifdef PARDISO
-    PardisoSolver * pardisoSolver;
-  #endif
+  // lumped-mass mode
+  int lumpedMass;
+  SparseMatrix * lumpedMassMatrix; // replaces the user's mass matrix
+  double * invLumpedMass; // inverse of the diagonal of lumpedMassMatrix, zero for the constrained DOFs
 
-  #ifdef SPOOLES
-    LinearSolver * spoolesSolver;
-  #endif
-
-  #ifdef PCG
-    CGSolver * jacobiPreconditionedCGSolver;
-  #endif
+  void DecomposeSystemMatrix();
+  void DoLumpedMassTimestep();
 };
 
 #endif
@@ -34,47 +34,45 @@
 #include "insertRows.h"
 #include "eulerSparse.h"
 
-EulerSparse::EulerSparse(int r, double timestep, SparseMatrix * massMatrix_, ForceModel * forceModel_, int symplectic_, int numConstrainedDOFs_, int * constrainedDOFs_, double dampingMassCoef): IntegratorBaseSparse(r, timestep, massMatrix_, forceModel_, numConstrainedDOFs_, constrainedDOFs_, dampingMassCoef, 0.0), symplectic(symplectic_)
+EulerSparse::EulerSparse(int r, double timestep, SparseMatrix * massMatrix_, ForceModel * forceModel_, int symplectic_, int numConstrainedDOFs_, int * constrainedDOFs_, double dampingMassCoef, IntegratorSparseSolver::solverType solver, int numSolverThreads, int lumpedMass_): IntegratorBaseSparse(r, timestep, massMatrix_, forceModel_, numConstrainedDOFs_, constrainedDOFs_, dampingMassCoef, 0.0), symplectic(symplectic_), lumpedMass(lumpedMass_), lumpedMassMatrix(NULL), invLumpedMass(NULL)
 {
-  #ifdef PARDISO
-    printf("Creating Pardiso solver for M.\n");
-    int positiveDefiniteSolver = 1;
-    pardisoSolver = new PardisoSolver(massMatrix, 1, positiveDefiniteSolver);
-    int info = pardisoSolver->ComputeCholeskyDecomposition(massMatrix);
-    if (info != 0)
+  if (lumpedMass)
+  {
+    printf("Using the lumped mass matrix.\n");
+    invLumpedMass = (double*) malloc (sizeof(double) * r);
+    massMatrix->SumRowEntries(invLumpedMass);
+    SparseMatrixOutline outline(r);
+    for(int i=0; i<r; i++)
     {
-      printf("Error: PARDISO solver returned non-zero exit code %d.\n", info);
-      exit(1);
+      if (invLumpedMass[i] <= 0.0)
+      {
+        printf("Error: lumped mass of DOF %d is not positive (%G).\n", i, invLumpedMass[i]);
+        exit(1);
+      }
+      outline.AddEntry(i, i, invLumpedMass[i]);
+      invLumpedMass[i] = 1.0 / invLumpedMass[i];
     }
-    printf("Solver created.\n");
-  #endif
-
-  #ifdef SPOOLES
-    printf("Creating SPOOLES solver for M.\n");
-    spoolesSolver = new SPOOLESSolver(massMatrix);
-    printf("Solver created.\n");
-  #endif
+    lumpedMassMatrix = new SparseMatrix(&outline);
+    massMatrix = lumpedMassMatrix;
+    return;
+  }
 
-  #ifdef PCG
-    printf("Creating Jacobi solver for M.\n");
-    jacobiPreconditionedCGSolver = new CGSolver(massMatrix);
-    printf("Solver created.\n");
-  #endif
+  printf("Creating %s solver for M.\n", IntegratorSparseSolver::GetSolverName(solver));
+  int positiveDefiniteSolver = 1;
+  linearSolver = new IntegratorSparseSolver(solver, massMatrix, positiveDefiniteSolver, numSolverThreads);
+  int info = linearSolver->Factor();
+  if (info != 0)
+  {
+    printf("Error: %s solver returned non-zero exit code %d.\n", linearSolver->GetSolverName(), info);
+    exit(1);
+  }
+  printf("Solver created.\n");
 }
 
 EulerSparse::~EulerSparse()
 {
-  #ifdef PARDISO
-    delete(pardisoSolver);
-  #endif
-
-  #ifdef SPOOLES
-    delete(spoolesSolver);
-  #endif
-
-  #ifdef PCG
-    delete(jacobiPreconditionedCGSolver);
-  #endif
+  delete(lumpedMassMatrix);
+  free(invLumpedMass);
 }
 
 // sets the state based on given q, qvel
@@ -94,93 +92,81 @@ int EulerSparse::DoTimestep()
   // v_{n+1} = v_n + h * (F_n / m)
   // x_{n+1} = x_n + h * v_{n+1}
 
-  // store current state
-  for(int i=0; i<r; i++)
-  {
-    q_1[i] = q[i]; 
-    qvel_1[i] = qvel[i];
-    qaccel_1[i] = qaccel[i];
-  }
-
   PerformanceCounter counterForceAssemblyTime;
   forceModel->GetInternalForce(q, internalForces);
   counterForceAssemblyTime.StopCounter();
   forceAssemblyTime = counterForceAssemblyTime.GetElapsedTime();
 
-  // scale internal forces
-  for(int i=0; i<r; i++)
-    internalForces[i] *= internalForceScalingFactor;
+  if (lumpedMass)
+  {
+    DoLumpedMassTimestep();
+    return 0;
+  }
 
-  // damping
-  double * dampingForces = buffer;
-  massMatrix->MultiplyVector(qvel, dampingForces);
-  for(int i=0; i<r; i++)
-    dampingForces[i] *= dampingMassCoef;
-  dampingMatrix->MultiplyVectorAdd(qvel, dampingForces);
+  // damping: buffer = M * qvel, qresidual = C * qvel
+  massMatrix->MultiplyVector(qvel, buffer);
+  dampingMatrix->MultiplyVector(qvel, qresidual);
 
   //printf("C=\n");
   //dampingMatrix->Print();
   //dampingMatrix->Save("C");
 
+  // a single pass: scale internal forces, set qresidual = F_n for a subsequent solve M * qdelta = h * F_n, and reset the initial guess
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
   for(int i=0; i<r; i++)
   {
-    // set qresidual = F_n, for a subsequent solve M * qdelta = h * F_n
-    qresidual[i] = externalForces[i] - internalForces[i] - dampingForces[i];
+    internalForces[i] *= internalForceScalingFactor;
+    qresidual[i] = externalForces[i] - internalForces[i] - dampingMassCoef * buffer[i] - qresidual[i];
+    qdelta[i] = 0.0;
   }
 
   PerformanceCounter counterSystemSolveTime;
 
   // solve: M * qdelta = qresidual
-
-  memset(qdelta, 0.0, sizeof(double)*r);
-
-  #ifdef PARDISO
-    int info = pardisoSolver->SolveLinearSystem(qdelta, qresidual);
-    char solverString[16] = "PARDISO";
-  #endif
-
-  #ifdef SPOOLES
-    int info = spoolesSolver->SolveLinearSystem(qdelta, qresidual);
-    char solverString[16] = "SPOOLES";
-  #endif
-
-  #ifdef PCG
-    int info = jacobiPreconditionedCGSolver->SolveLinearSystemWithJacobiPreconditioner(qdelta, qresidual, 1e-6, 10000);
-    if (info > 0)
-      info = 0;
-    char solverString[16] = "PCG";
-  #endif
-
+  int info = linearSolver->Solve(qdelta, qresidual);
   if (info != 0)
   {
-    printf("Error: %s sparse solver returned non-zero exit status %d.\n", solverString, (int)info);
+    printf("Error: %s sparse solver returned non-zero exit status %d.\n", linearSolver->GetSolverName(), (int)info);
     return 1;
   }
 
   counterSystemSolveTime.StopCounter();
   systemSolveTime = counterSystemSolveTime.GetElapsedTime();
 
-  // update state
+  // a single pass: store the current state, and update the state
   if (symplectic)
   {
+    #ifdef USE_OPENMP
+      #pragma omp parallel for
+    #endif
     for(int i=0; i<r; i++)
     {
+      q_1[i] = q[i]; 
+      qvel_1[i] = qvel[i];
+      qaccel_1[i] = qaccel[i];
       qvel[i] += timestep * qdelta[i];
       q[i] += timestep * qvel[i];
+      qaccel[i] = qdelta[i];
     }	
   }
   else
   {
+    #ifdef USE_OPENMP
+      #pragma omp parallel for
+    #endif
     for(int i=0; i<r; i++)
     {
+      q_1[i] = q[i]; 
+      qvel_1[i] = qvel[i];
+      qaccel_1[i] = qaccel[i];
       q[i] += timestep * qvel[i];
       qvel[i] += timestep * qdelta[i];
+      qaccel[i] = qdelta[i];
     }
   }
 
-  for(int i=0; i<r; i++)
-    qaccel[i] = qdelta[i];
-
   // constrain fixed DOFs
   for(int i=0; i<numConstrainedDOFs; i++)
     q[constrainedDOFs[i]] = qvel[constrainedDOFs[i]] = qaccel[constrainedDOFs[i]] = 0.0;
@@ -188,3 +174,54 @@ int EulerSparse::DoTimestep()
   return 0;
 }
 
+void EulerSparse::DoLumpedMassTimestep()
+{
+  PerformanceCounter counterSystemSolveTime;
+
+  // buffer = C * qvel (the mass damping is applied below, with the lumped mass)
+  dampingMatrix->MultiplyVector(qvel, buffer);
+
+  // a single pass: store the current state, compute the acceleration (F_n / m), and update the state
+  double scaling = internalForceScalingFactor;
+  if (symplectic)
+  {
+    #ifdef USE_OPENMP
+      #pragma omp parallel for
+    #endif
+    for(int i=0; i<r; i++)
+    {
+      q_1[i] = q[i]; 
+      qvel_1[i] = qvel[i];
+      qaccel_1[i] = qaccel[i];
+      internalForces[i] *= scaling;
+      double accel = invLumpedMass[i] * (externalForces[i] - internalForces[i] - buffer[i]) - dampingMassCoef * qvel[i];
+      qvel[i] += timestep * accel;
+      q[i] += timestep * qvel[i];
+      qaccel[i] = accel;
+    }
+  }
+  else
+  {
+    #ifdef USE_OPENMP
+      #pragma omp parallel for
+    #endif
+    for(int i=0; i<r; i++)
+    {
+      q_1[i] = q[i]; 
+      qvel_1[i] = qvel[i];
+      qaccel_1[i] = qaccel[i];
+      internalForces[i] *= scaling;
+      double accel = invLumpedMass[i] * (externalForces[i] - internalForces[i] - buffer[i]) - dampingMassCoef * qvel[i];
+      q[i] += timestep * qvel[i];
+      qvel[i] += timestep * accel;
+      qaccel[i] = accel;
+    }
+  }
+
+  // constrain fixed DOFs
+  for(int i=0; i<numConstrainedDOFs; i++)
+    q[constrainedDOFs[i]] = qvel[constrainedDOFs[i]] = qaccel[constrainedDOFs[i]] = 0.0;
+
+  counterSystemSolveTime.StopCounter();
+  systemSolveTime = counterSystemSolveTime.GetElapsedTime();
+}
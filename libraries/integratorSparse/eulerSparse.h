@@ -36,23 +36,18 @@
   symplectic Euler
   v_{n+1} = v_n + h * (F_n / m)
   x_{n+1} = x_n + h * v_{n+1}
+
+  By default, each timestep solves a linear system with the mass matrix M.
+  In the lumped-mass mode, M is replaced by the diagonal matrix of its row sums
+  (exact for the diagonal mass matrices of mass-spring systems), and the timestep
+  is a single pass over the state vectors, without any linear system solve.
 */
 
 #ifndef _EULERSPARSE_H_
 #define _EULERSPARSE_H_
 
-#include "integratorSolverSelection.h"
 #include "integratorBaseSparse.h"
-
-#ifdef PARDISO
-  #include "sparseSolvers.h"
-#endif
-#ifdef SPOOLES
-  #include "sparseSolvers.h"
-#endif
-#ifdef PCG
-  #include "CGSolver.h"
-#endif
+#include "integratorSparseSolver.h"
 
 
 class EulerSparse : public IntegratorBaseSparse
@@ -62,7 +57,9 @@ public:
   // constrainedDOFs is an integer array of degrees of freedom that are to be fixed to zero (e.g., to permanently fix a vertex in a deformable simulation)
   // constrainedDOFs are 0-indexed (separate DOFs for x,y,z), and must be pre-sorted (ascending)
   // dampingMatrix is optional and provides damping (in addition to mass damping)
-  EulerSparse(int r, double timestep, SparseMatrix * massMatrix, ForceModel * forceModel, int symplectic=0, int numConstrainedDOFs=0, int * constrainedDOFs=NULL, double dampingMassCoef=0.0);
+  // solver selects the sparse linear solver for the mass matrix (see integratorSparseSolver.h); numSolverThreads applies only to the PARDISO, SPOOLES and CHOLESKY solvers
+  // if lumpedMass is 1, the mass matrix is lumped (row sums) and no linear solver is created (GetLinearSolver() returns NULL)
+  EulerSparse(int r, double timestep, SparseMatrix * massMatrix, ForceModel * forceModel, int symplectic=0, int numConstrainedDOFs=0, int * constrainedDOFs=NULL, double dampingMassCoef=0.0, IntegratorSparseSolver::solverType solver=IntegratorSparseSolver::PCG, int numSolverThreads=0, int lumpedMass=0);
 
   virtual ~EulerSparse();
 
@@ -72,20 +69,15 @@ public:
 
   virtual int DoTimestep(); 
 
+  inline int UsesLumpedMass() { return lumpedMass; }
+
 protected:
   int symplectic;
-  
-  #ifdef PARDISO
-    PardisoSolver * pardisoSolver;
-  #endif
-
-  #ifdef SPOOLES
-    SPOOLESSolver * spoolesSolver;
-  #endif
-
-  #ifdef PCG
-    CGSolver * jacobiPreconditionedCGSolver;
-  #endif
+  int lumpedMass;
+  SparseMatrix * lumpedMassMatrix; // replaces the user's mass matrix (lumped-mass mode only)
+  double * invLumpedMass; // inverse of the diagonal of lumpedMassMatrix
+
+  void DoLumpedMassTimestep();
 };
 
 #endif
@@ -31,15 +31,15 @@
   A class to timestep large sparse dynamics using implicit backward Euler.
 */
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "matrixIO.h"
 #include "performanceCounter.h"
-#include "insertRows.h"
 #include "implicitBackwardEulerSparse.h"
 
-ImplicitBackwardEulerSparse::ImplicitBackwardEulerSparse(int r, double timestep, SparseMatrix * massMatrix_, ForceModel * forceModel_, int positiveDefiniteSolver_, int numConstrainedDOFs_, int * constrainedDOFs_, double dampingMassCoef, double dampingStiffnessCoef, int maxIterations, double epsilon, int numSolverThreads_): ImplicitNewmarkSparse(r, timestep, massMatrix_, forceModel_, positiveDefiniteSolver_, numConstrainedDOFs_, constrainedDOFs_, dampingMassCoef, dampingStiffnessCoef, maxIterations, epsilon, 0.25, 0.5, numSolverThreads_)
+ImplicitBackwardEulerSparse::ImplicitBackwardEulerSparse(int r, double timestep, SparseMatrix * massMatrix_, ForceModel * forceModel_, int positiveDefiniteSolver_, int numConstrainedDOFs_, int * constrainedDOFs_, double dampingMassCoef, double dampingStiffnessCoef, int maxIterations, double epsilon, int numSolverThreads_, IntegratorSparseSolver::solverType solver): ImplicitNewmarkSparse(r, timestep, massMatrix_, forceModel_, positiveDefiniteSolver_, numConstrainedDOFs_, constrainedDOFs_, dampingMassCoef, dampingStiffnessCoef, maxIterations, epsilon, 0.25, 0.5, numSolverThreads_, solver)
 {
 }
 
@@ -56,17 +56,25 @@ int ImplicitBackwardEulerSparse::SetState(double * q_, double * qvel_)
   if (qvel_ != NULL)
     memcpy(qvel, qvel_, sizeof(double)*r);
 
+  lastStepTimestep = 0.0; // the update of the last timestep is no longer a useful warm start
+
   return 0;
 }
 
 int ImplicitBackwardEulerSparse::DoTimestep()
 {
+  PerformanceCounter counterTimestepTime;
+  numLinearSolverIterations = 0;
+
   int numIter = 0;
 
   double error0 = 0; // error after the first step
   double errorQuotient;
 
   // store current amplitudes and set initial guesses for qaccel, qvel
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
   for(int i=0; i<r; i++)
   {
     qaccel_1[i] = qaccel[i] = 0; // acceleration is actually not used in this integrator
@@ -84,10 +92,6 @@ int ImplicitBackwardEulerSparse::DoTimestep()
     //tangentStiffnessMatrix->Print();
     //tangentStiffnessMatrix->Save("K");
 
-    // scale internal forces
-    for(int i=0; i<r; i++)
-      internalForces[i] *= internalForceScalingFactor;
-
 /*
     printf("q:\n");
     for(int i=0; i<r; i++)
@@ -100,67 +104,75 @@ int ImplicitBackwardEulerSparse::DoTimestep()
     printf("\n");
 */
 
-    // scale stiffness matrix
-    *tangentStiffnessMatrix *= internalForceScalingFactor;
+    // (the internal forces and the stiffness matrix are scaled by internalForceScalingFactor below,
+    // when forming the residual and the system matrix)
 
-    memset(qresidual, 0, sizeof(double) * r);
+    // the residual is qresidual = residualScale * (qresidual + internalForces - externalForces) (+ M * (qvel_1 - qvel), if addMassTerm)
+    double residualScale;
+    int addMassTerm = 0;
 
     if (useStaticSolver)
     {
       // fint + K * qdelta = fext
-
-      // add externalForces, internalForces
-      for(int i=0; i<r; i++)
-      {
-        qresidual[i] = externalForces[i] - internalForces[i];
-        qdelta[i] = qresidual[i];
-      }
+      memset(qresidual, 0, sizeof(double) * r);
+      residualScale = -1.0;
     }
     else
     {
-      tangentStiffnessMatrix->ScalarMultiply(dampingStiffnessCoef, rayleighDampingMatrix);
-      rayleighDampingMatrix->AddSubMatrix(dampingMassCoef, *massMatrix);
-
       // build effective stiffness: 
       // Keff = M + h D + h^2 * K
       // compute force residual, store it into aux variable qresidual
       // qresidual = h * (-D qdot - fint + fext - h * K * qdot)) // this is semi-implicit Euler
       // qresidual = M (qvel_1 - qvel) + h * (-D qdot - fint + fext - K * (q_1 - q + h qdot) )) // for fully implicit Euler
 
-      if (numIter != 0) // can skip on first iteration (zero contribution)
-      {
-        // add K * (q_1 - q) to qresidual (will multiply by -h later)
-        for(int i=0; i<r; i++)
-          buffer[i] = q_1[i] - q[i];
-        tangentStiffnessMatrix->MultiplyVectorAdd(buffer, qresidual);
-      }
-
-      //add mass matrix and damping matrix to tangentStiffnessMatrix
-      *tangentStiffnessMatrix *= timestep;
-
-      *tangentStiffnessMatrix += *rayleighDampingMatrix;
-      tangentStiffnessMatrix->AddSubMatrix(1.0, *dampingMatrix, 1); // at this point, tangentStiffnessMatrix = h * K + D
-      tangentStiffnessMatrix->MultiplyVectorAdd(qvel, qresidual);
-      *tangentStiffnessMatrix *= timestep;
-      tangentStiffnessMatrix->AddSubMatrix(1.0, *massMatrix);
-      
-      // add externalForces, internalForces
+      // with D = dampingStiffnessCoef * K + dampingMassCoef * M + dampingMatrix, the matrix-vector products
+      // K * (q_1 - q) + (h * K + D) * qvel = K * (q_1 - q + (h + dampingStiffnessCoef) * qvel) + M * (dampingMassCoef * qvel) + dampingMatrix * qvel
+      // are evaluated in one traversal, into qresidual (will multiply by -h later)
+      // (the term K * (q_1 - q) can be skipped on first iteration (zero contribution))
+      // qdelta = qvel_1 - qvel is used below
+      double stiffnessVelocityFactor = timestep + dampingStiffnessCoef;
+      int firstIteration = (numIter == 0);
+      #ifdef USE_OPENMP
+        #pragma omp parallel for
+      #endif
       for(int i=0; i<r; i++)
       {
-        qresidual[i] += internalForces[i] - externalForces[i];
-        qresidual[i] *= -timestep;
+        double positionDelta = firstIteration ? 0.0 : q_1[i] - q[i];
+        buffer[i] = positionDelta + stiffnessVelocityFactor * qvel[i];
+        qdelta[i] = qvel_1[i] - qvel[i];
       }
+      double residualFactors[3] = { internalForceScalingFactor, dampingMassCoef, 1.0 };
+      const double * residualVectors[3] = { buffer, qvel, qvel };
+      residualCombination->MultiplyVector(residualFactors, residualVectors, qresidual);
 
+      residualScale = -timestep;
       if (numIter != 0) // can skip on first iteration (zero contribution)
       {
-        // add M * (qvel_1 - qvel) to qresidual
-        for(int i=0; i<r; i++)
-          buffer[i] = qvel_1[i] - qvel[i];
-        massMatrix->MultiplyVectorAdd(buffer, qresidual);
+        // buffer = M * (qvel_1 - qvel)
+        massMatrix->MultiplyVector(qdelta, buffer);
+        addMassTerm = 1;
       }
+    }
 
-      for(int i=0; i<r; i++)
-        qdelta[i] = qresidual[i];
+    // scale internal forces, add externalForces and internalForces to the residual,
+    // gather the right-hand side of the constrained system, and compute its norm, all in one pass
+    double error = 0.0;
+    #ifdef USE_OPENMP
+      #pragma omp parallel for reduction(+:error)
+    #endif
+    for(int i=0; i<r; i++)
+    {
+      internalForces[i] *= internalForceScalingFactor;
+      double residual = residualScale * (qresidual[i] + (internalForces[i] - externalForces[i]));
+      if (addMassTerm)
+        residual += buffer[i];
+      qresidual[i] = residual;
+      int index = fullToConstrainedDOFs[i];
+      if (index >= 0)
+      {
+        bufferConstrained[index] = residual;
+        error += residual * residual;
+      }
     }
 
 /*
@@ -182,13 +194,6 @@ int ImplicitBackwardEulerSparse::DoTimestep()
 
     //tangentStiffnessMatrix->Save("Keff");
 
-    // remove rows corresponding to fixed vertices from qdelta, and store the result in bufferConstrained
-    RemoveRows(r, bufferConstrained, qdelta, numConstrainedDOFs, constrainedDOFs);
-
-    double error = 0.0;
-    for(int i=0; i<r - numConstrainedDOFs; i++)
-      error += bufferConstrained[i] * bufferConstrained[i];
-
     //printf("numIter: %d error2: %G\n", numIter, error);
 
     // on the first iteration, compute initial error
@@ -202,60 +207,36 @@ int ImplicitBackwardEulerSparse::DoTimestep()
       // error divided by the initial error, before performing this iteration
       errorQuotient = error / error0; 
     }
+    newtonResidualReduction = (error0 > 0) ? sqrt(errorQuotient) : 0.0;
 
     if (errorQuotient < epsilon * epsilon)
       break;
 
-    systemMatrix->AssignSuperMatrix(tangentStiffnessMatrix);
+    // Keff = M + h * (h * K + D), assembled directly into the constrained system matrix, in one pass
+    double systemFactors[3] = { internalForceScalingFactor, 0.0, 0.0 };
+    if (!useStaticSolver)
+    {
+      systemFactors[0] = internalForceScalingFactor * timestep * (timestep + dampingStiffnessCoef);
+      systemFactors[1] = 1.0 + timestep * dampingMassCoef;
+      systemFactors[2] = timestep;
+    }
+    systemMatrixCombination->Evaluate(systemFactors, systemMatrix);
 
     // solve: systemMatrix * buffer = bufferConstrained
 
     PerformanceCounter counterSystemSolveTime;
-    memset(buffer, 0, sizeof(double) * r);
-
-    #ifdef SPOOLES
-      int info;
-      if (numSolverThreads > 1)
-      {
-        SPOOLESSolverMT * solver = new SPOOLESSolverMT(systemMatrix, numSolverThreads);
-        info = solver->SolveLinearSystem(buffer, bufferConstrained);
-        delete(solver);
-      }
-      else
-      {
-        SPOOLESSolver * solver = new SPOOLESSolver(systemMatrix);
-        info = solver->SolveLinearSystem(buffer, bufferConstrained);
-        delete(solver);
-      }
-      char solverString[16] = "SPOOLES";
-    #endif
-
-    #ifdef PARDISO
-      int info = pardisoSolver->ComputeCholeskyDecomposition(systemMatrix);
-      if (info == 0)
-        info = pardisoSolver->SolveLinearSystem(buffer, bufferConstrained);
-      char solverString[16] = "PARDISO";
-    #endif
-
-    #ifdef PCG
-      int info = jacobiPreconditionedCGSolver->SolveLinearSystemWithJacobiPreconditioner(buffer, bufferConstrained, 1e-6, 10000);
-      if (info > 0)
-        info = 0;
-      char solverString[16] = "PCG";
-    #endif
 
+    int info = SolveNewtonSystem(numIter);
     if (info != 0)
     {
-      printf("Error: %s sparse solver returned non-zero exit status %d.\n", solverString, (int)info);
-      exit(-1);
+      printf("Error: %s sparse solver returned non-zero exit status %d.\n", linearSolver->GetSolverName(), (int)info);
+      numNewtonIterations = numIter;
       return 1;
     }
 
     counterSystemSolveTime.StopCounter();
     systemSolveTime = counterSystemSolveTime.GetElapsedTime();
 
-    InsertRows(r, buffer, qdelta, numConstrainedDOFs, constrainedDOFs);
-
 /*
     printf("qdelta:\n");
     for(int i=0; i<r; i++)
@@ -263,31 +244,56 @@ int ImplicitBackwardEulerSparse::DoTimestep()
     printf("\n");
     exit(1);
 */
-    // update state
+    // scatter the solution into qdelta and update state (the constrained DOFs are set to zero)
     if (useStaticSolver)
     {
+      #ifdef USE_OPENMP
+        #pragma omp parallel for
+      #endif
       for(int i=0; i<r; i++)
       {
-        q[i] += qdelta[i];
-        qvel[i] = (q[i] - q_1[i]) / timestep;
+        int index = fullToConstrainedDOFs[i];
+        if (index >= 0)
+        {
+          qdelta[i] = buffer[index];
+          q[i] += qdelta[i];
+          qvel[i] = (q[i] - q_1[i]) / timestep;
+        }
+        else
+          qdelta[i] = q[i] = qvel[i] = qaccel[i] = 0.0;
       }
     }
     else
     {
+      #ifdef USE_OPENMP
+        #pragma omp parallel for
+      #endif
       for(int i=0; i<r; i++)
       {
-        qvel[i] += qdelta[i];
-        q[i] += q_1[i] - q[i] + timestep * qvel[i];
+        int index = fullToConstrainedDOFs[i];
+        if (index >= 0)
+        {
+          qdelta[i] = buffer[index];
+          qvel[i] += qdelta[i];
+          q[i] = q_1[i] + timestep * qvel[i];
+        }
+        else
+          qdelta[i] = q[i] = qvel[i] = qaccel[i] = 0.0;
       }
     }
 
-    for(int i=0; i<numConstrainedDOFs; i++)
-      q[constrainedDOFs[i]] = qvel[constrainedDOFs[i]] = qaccel[constrainedDOFs[i]] = 0.0;
-
     numIter++;
   }
   while (numIter < maxIterations);
 
+  numNewtonIterations = numIter;
+  if (useStaticSolver)
+    StoreStepUpdate(q, q_1);
+  else
+    StoreStepUpdate(qvel, qvel_1); // the Newton unknowns of dynamic backward Euler are the velocities
+  counterTimestepTime.StopCounter();
+  timestepTime = counterTimestepTime.GetElapsedTime();
+
 /*
   printf("q:\n");
   for(int i=0; i<r; i++)
@@ -26,26 +26,26 @@
  *                                                                       *
  *************************************************************************/
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "matrixIO.h"
 #include "performanceCounter.h"
-#include "insertRows.h"
 #include "implicitNewmarkSparse.h"
 
-ImplicitNewmarkSparse::ImplicitNewmarkSparse(int r, double timestep, SparseMatrix * massMatrix_, ForceModel * forceModel_, int positiveDefiniteSolver_, int numConstrainedDOFs_, int * constrainedDOFs_, double dampingMassCoef, double dampingStiffnessCoef, int maxIterations, double epsilon, double NewmarkBeta, double NewmarkGamma, int numSolverThreads_): IntegratorBaseSparse(r, timestep, massMatrix_, forceModel_, numConstrainedDOFs_, constrainedDOFs_, dampingMassCoef, dampingStiffnessCoef), positiveDefiniteSolver(positiveDefiniteSolver_), numSolverThreads(numSolverThreads_)
+ImplicitNewmarkSparse::ImplicitNewmarkSparse(int r, double timestep, SparseMatrix * massMatrix_, ForceModel * forceModel_, int positiveDefiniteSolver_, int numConstrainedDOFs_, int * constrainedDOFs_, double dampingMassCoef, double dampingStiffnessCoef, int maxIterations, double epsilon, double NewmarkBeta, double NewmarkGamma, int numSolverThreads_, IntegratorSparseSolver::solverType solver): IntegratorBaseSparse(r, timestep, massMatrix_, forceModel_, numConstrainedDOFs_, constrainedDOFs_, dampingMassCoef, dampingStiffnessCoef), positiveDefiniteSolver(positiveDefiniteSolver_), numSolverThreads(numSolverThreads_)
 {
   this->maxIterations = maxIterations; // maxIterations = 1 for semi-implicit
   this->epsilon = epsilon; 
   this->NewmarkBeta = NewmarkBeta;
   this->NewmarkGamma = NewmarkGamma;
 
-  useStaticSolver = false;
-
   UpdateAlphas();
 
   forceModel->GetTangentStiffnessMatrixTopology(&tangentStiffnessMatrix);
+  // keep the stiffness matrix (and all the matrices copied from it below) in a single contiguous block
+  tangentStiffnessMatrix->ConvertToContiguousStorage();
 
   if (tangentStiffnessMatrix->Getn() != massMatrix->Getn())
   {
@@ -53,49 +53,164 @@ ImplicitNewmarkSparse::ImplicitNewmarkSparse(int r, double timestep, SparseMatri
     exit(1);
   }
 
-  rayleighDampingMatrix = new SparseMatrix(*tangentStiffnessMatrix);
-
-  rayleighDampingMatrix->BuildSubMatrixIndices(*massMatrix);
-  tangentStiffnessMatrix->BuildSubMatrixIndices(*massMatrix);
-  tangentStiffnessMatrix->BuildSubMatrixIndices(*dampingMatrix, 1);
-
   if (tangentStiffnessMatrix->GetNumRows() != massMatrix->GetNumRows())
   {
     printf("Error: mass matrix and stiffness matrix don't have same dimensions.\n");
     exit(1);
   }
 
-  bufferConstrained = (double*) malloc (sizeof(double) * (r - numConstrainedDOFs));
-
   systemMatrix = new SparseMatrix(*tangentStiffnessMatrix);
   systemMatrix->RemoveRowsColumns(numConstrainedDOFs, constrainedDOFs);
-  systemMatrix->BuildSuperMatrixIndices(numConstrainedDOFs, constrainedDOFs, tangentStiffnessMatrix);
 
-  #ifdef PARDISO
-    printf("Creating Pardiso solver. Positive-definite solver: %d. Num threads: %d\n", positiveDefiniteSolver, numSolverThreads);
-    pardisoSolver = new PardisoSolver(systemMatrix, numSolverThreads, positiveDefiniteSolver);
-  #endif
+  InitializeWorkspace();
 
-  #ifdef PCG
-    jacobiPreconditionedCGSolver = new CGSolver(systemMatrix);
-  #endif
+  linearSolver = new IntegratorSparseSolver(solver, systemMatrix, positiveDefiniteSolver, numSolverThreads);
+}
+
+ImplicitNewmarkSparse::ImplicitNewmarkSparse(ImplicitNewmarkSparse * source, int numSolverThreads_): IntegratorBaseSparse(source->r, source->timestep, source->massMatrix, source->forceModel, source->numConstrainedDOFs, source->constrainedDOFs, source->dampingMassCoef, source->dampingStiffnessCoef), positiveDefiniteSolver(source->positiveDefiniteSolver), numSolverThreads(numSolverThreads_)
+{
+  maxIterations = source->maxIterations;
+  epsilon = source->epsilon;
+  NewmarkBeta = source->NewmarkBeta;
+  NewmarkGamma = source->NewmarkGamma;
+  internalForceScalingFactor = source->internalForceScalingFactor;
+  UpdateAlphas();
+
+  // the matrices of "source" already have the right topology
+  tangentStiffnessMatrix = new SparseMatrix(*source->tangentStiffnessMatrix);
+  systemMatrix = new SparseMatrix(*source->systemMatrix);
+
+  InitializeWorkspace();
+
+  if (!source->ownDampingMatrix)
+    SetDampingMatrix(source->dampingMatrix);
+
+  linearSolver = new IntegratorSparseSolver(source->linearSolver, systemMatrix, numSolverThreads);
+}
+
+void ImplicitNewmarkSparse::InitializeWorkspace()
+{
+  useStaticSolver = false;
+
+  inexactNewton = 0;
+  maxForcingTerm = 0.1;
+  forcingTerm = maxForcingTerm;
+  firstNewtonError = 0.0;
+  lastNewtonError = 0.0;
+  lastStepUpdate = (double*) calloc (r, sizeof(double));
+  lastStepTimestep = 0.0;
+  numNewtonIterations = 0;
+  newtonResidualReduction = 0.0;
+  numLinearSolverIterations = 0;
+  timestepTime = 0.0;
+
+  bufferConstrained = (double*) malloc (sizeof(double) * (r - numConstrainedDOFs));
+
+  // the residual and the system matrix are linear combinations of the stiffness, mass and damping matrix
+  // (the patterns of the mass and damping matrix must be subsets of the stiffness matrix pattern)
+  residualCombination = new SparseMatrixLinearCombination(tangentStiffnessMatrix);
+  residualCombination->AddTerm(tangentStiffnessMatrix);
+  residualCombination->AddTerm(massMatrix);
+  residualCombination->AddTerm(dampingMatrix);
+
+  // the system matrix is assembled directly, without the constrained rows and columns
+  systemMatrixCombination = new SparseMatrixLinearCombination(systemMatrix);
+  systemMatrixCombination->AddTerm(tangentStiffnessMatrix, numConstrainedDOFs, constrainedDOFs);
+  systemMatrixCombination->AddTerm(massMatrix, numConstrainedDOFs, constrainedDOFs);
+  systemMatrixCombination->AddTerm(dampingMatrix, numConstrainedDOFs, constrainedDOFs);
 }
 
 ImplicitNewmarkSparse::~ImplicitNewmarkSparse()
 {
+  delete(residualCombination);
+  delete(systemMatrixCombination);
   delete(tangentStiffnessMatrix);
-  delete(rayleighDampingMatrix);
   delete(systemMatrix);
   free(bufferConstrained);
-  #ifdef PARDISO
-    delete(pardisoSolver);
-  #endif
+  free(lastStepUpdate);
 }
 
 void ImplicitNewmarkSparse::SetDampingMatrix(SparseMatrix * dampingMatrix)
 {
   IntegratorBaseSparse::SetDampingMatrix(dampingMatrix);
-  tangentStiffnessMatrix->BuildSubMatrixIndices(*dampingMatrix, 1);
+  residualCombination->SetTerm(2, dampingMatrix);
+  systemMatrixCombination->SetTerm(2, dampingMatrix);
+}
+
+void ImplicitNewmarkSparse::UseInexactNewton(int inexactNewton, double maxForcingTerm)
+{
+  this->inexactNewton = inexactNewton;
+  this->maxForcingTerm = maxForcingTerm;
+}
+
+int ImplicitNewmarkSparse::SolveNewtonSystem(int numIter)
+{
+  if (!inexactNewton)
+  {
+    memset(buffer, 0, sizeof(double) * r);
+    int info = linearSolver->FactorAndSolve(buffer, bufferConstrained);
+    numLinearSolverIterations += linearSolver->GetLastNumIterations();
+    return info;
+  }
+
+  // initial guess
+  if ((numIter == 0) && (lastStepTimestep > 0))
+  {
+    // extrapolate the update of the previous timestep
+    double timestepRatio = timestep / lastStepTimestep;
+    int numUnconstrainedDOFs = r - numConstrainedDOFs;
+    #ifdef USE_OPENMP
+      #pragma omp parallel for
+    #endif
+    for(int i=0; i<numUnconstrainedDOFs; i++)
+      buffer[i] = timestepRatio * lastStepUpdate[constrainedToFullDOFs[i]];
+  }
+  else
+    memset(buffer, 0, sizeof(double) * r);
+
+  // the nonlinear residual of the unconstrained DOFs
+  double error = 0.0;
+  for(int i=0; i<r - numConstrainedDOFs; i++)
+    error += bufferConstrained[i] * bufferConstrained[i];
+  if (numIter == 0)
+    firstNewtonError = error;
+
+  // forcing term (Eisenstat-Walker, choice 2, with gamma=0.9, alpha=2):
+  // eta_k = gamma * (|F_k| / |F_{k-1}|)^2, safeguarded by gamma * eta_{k-1}^2
+  double forcingTermEW = maxForcingTerm;
+  if ((numIter > 0) && (lastNewtonError > 0))
+  {
+    forcingTermEW = 0.9 * error / lastNewtonError;
+    double safeguard = 0.9 * forcingTerm * forcingTerm;
+    if ((safeguard > 0.1) && (safeguard > forcingTermEW))
+      forcingTermEW = safeguard;
+  }
+
+  // Newton stops when |F_k| < epsilon * |F_0|: solving more accurately than that would be wasted
+  double minForcingTerm = (error > 0) ? 0.5 * epsilon * sqrt(firstNewtonError / error) : 0.5 * epsilon;
+  if (numIter == maxIterations - 1)
+    forcingTerm = minForcingTerm; // no further Newton iteration will correct the error of this solve
+  else
+    forcingTerm = (forcingTermEW > minForcingTerm) ? forcingTermEW : minForcingTerm;
+  if (forcingTerm > maxForcingTerm)
+    forcingTerm = maxForcingTerm;
+  lastNewtonError = error;
+
+  int info = linearSolver->Factor();
+  if (info == 0)
+    info = linearSolver->SolveInexact(buffer, bufferConstrained, forcingTerm);
+  numLinearSolverIterations += linearSolver->GetLastNumIterations();
+  return info;
+}
+
+void ImplicitNewmarkSparse::StoreStepUpdate(const double * unknown, const double * unknown_1)
+{
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
+  for(int i=0; i<r; i++)
+    lastStepUpdate[i] = unknown[i] - unknown_1[i];
+  lastStepTimestep = timestep;
 }
 
 void ImplicitNewmarkSparse::UpdateAlphas()
@@ -119,6 +234,13 @@ int ImplicitNewmarkSparse::SetState(double * q_, double * qvel_)
   else
     memset(qvel, 0, sizeof(double)*r);
 
+  lastStepTimestep = 0.0; // the update of the last timestep is no longer a useful warm start
+
+  return ComputeAcceleration(q, qvel, qaccel);
+}
+
+int ImplicitNewmarkSparse::ComputeAcceleration(double * q, double * qvel, double * qaccel)
+{
   for(int i=0; i<numConstrainedDOFs; i++)
     q[constrainedDOFs[i]] = qvel[constrainedDOFs[i]] = 0.0;
 
@@ -128,68 +250,63 @@ int ImplicitNewmarkSparse::SetState(double * q_, double * qvel_)
 
   forceModel->GetForceAndMatrix(q, internalForces, tangentStiffnessMatrix);
 
-  *rayleighDampingMatrix = dampingStiffnessCoef * (*tangentStiffnessMatrix);
-  rayleighDampingMatrix->AddSubMatrix(dampingMassCoef, *massMatrix);
-
-  // buffer = C * qvel
-  rayleighDampingMatrix->MultiplyVector(qvel, buffer);
-  dampingMatrix->MultiplyVectorAdd(qvel, buffer);
-
-  for(int i=0; i<r; i++)
-    buffer[i] = -buffer[i] - internalForces[i];
+  // buffer = C * qvel = (dampingStiffnessCoef * K + dampingMassCoef * M + dampingMatrix) * qvel
+  double dampingFactors[3] = { dampingStiffnessCoef, dampingMassCoef, 1.0 };
+  const double * dampingVectors[3] = { qvel, qvel, qvel };
+  residualCombination->MultiplyVector(dampingFactors, dampingVectors, buffer);
 
   // solve M * qaccel = buffer
-  RemoveRows(r, bufferConstrained, buffer, numConstrainedDOFs, constrainedDOFs);
+  int numUnconstrainedDOFs = r - numConstrainedDOFs;
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
+  for(int i=0; i<numUnconstrainedDOFs; i++)
+  {
+    int dof = constrainedToFullDOFs[i];
+    bufferConstrained[i] = -buffer[dof] - internalForces[dof];
+  }
 
-  // use tangentStiffnessMatrix as the buffer place
-  tangentStiffnessMatrix->ResetToZero();
-  tangentStiffnessMatrix->AddSubMatrix(1.0, *massMatrix);
-  tangentStiffnessMatrix->AddSubMatrix(1.0, *dampingMatrix, 1);
-  systemMatrix->AssignSuperMatrix(tangentStiffnessMatrix); // must go via a matrix with tangentStiffnessMatrix's topology, because the AssignSuperMatrix indices were computed with respect to such topology
+  // system matrix = M + dampingMatrix (assembled directly with the constrained DOFs removed)
+  double systemFactors[3] = { 0.0, 1.0, 1.0 };
+  systemMatrixCombination->Evaluate(systemFactors, systemMatrix);
 
   memset(buffer, 0, sizeof(double) * r);
 
-  #ifdef SPOOLES
-    SPOOLESSolver solver(systemMatrix);
-    int info = solver.SolveLinearSystem(buffer, bufferConstrained);
-    char solverString[16] = "SPOOLES";
-  #endif
-
   //massMatrix->Save("M");
   //systemMatrix->Save("A");
 
-  #ifdef PARDISO
-    pardisoSolver->ComputeCholeskyDecomposition(systemMatrix);
-    int info = pardisoSolver->SolveLinearSystem(buffer, bufferConstrained);
-    char solverString[16] = "PARDISO";
-  #endif
-
-  #ifdef PCG
-    int info = jacobiPreconditionedCGSolver->SolveLinearSystemWithJacobiPreconditioner(buffer, bufferConstrained, 1e-6, 10000);
-    if (info > 0)
-      info = 0;
-    char solverString[16] = "PCG";
-  #endif
-
+  int info = linearSolver->FactorAndSolve(buffer, bufferConstrained);
   if (info != 0)
   {
-    printf("Error: %s sparse solver returned non-zero exit status %d.\n", solverString, (int)info);
+    printf("Error: %s sparse solver returned non-zero exit status %d.\n", linearSolver->GetSolverName(), (int)info);
     return 1;
   }
   
-  InsertRows(r, buffer, qaccel, numConstrainedDOFs, constrainedDOFs);
+  InsertConstrainedDOFs(buffer, qaccel);
 
   return 0;
 }
  
 int ImplicitNewmarkSparse::DoTimestep()
 {
+  return DoTimestep(q, qvel, qaccel, externalForces);
+}
+
+int ImplicitNewmarkSparse::DoTimestep(double * q, double * qvel, double * qaccel, const double * externalForces)
+{
+  PerformanceCounter counterTimestepTime;
+  numLinearSolverIterations = 0;
+
   int numIter = 0;
 
   double error0 = 0; // error after the first step
   double errorQuotient;
+  double freeError0 = 0; // the same, restricted to the unconstrained DOFs
 
   // store current amplitudes and set initial guesses for qaccel, qvel
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
   for(int i=0; i<r; i++)
   {
     q_1[i] = q[i]; 
@@ -202,8 +319,6 @@ int ImplicitNewmarkSparse::DoTimestep()
 
   do
   {
-    int i;
-
 /*
     printf("q:\n");
     for(int i=0; i<r; i++)
@@ -224,44 +339,49 @@ int ImplicitNewmarkSparse::DoTimestep()
     //tangentStiffnessMatrix->Print();
     //tangentStiffnessMatrix->Save("K");
 
-    // scale internal forces
-    for(i=0; i<r; i++)
-      internalForces[i] *= internalForceScalingFactor;
-
-    *tangentStiffnessMatrix *= internalForceScalingFactor;
-
-    memset(qresidual, 0, sizeof(double) * r);
+    // (the internal forces and the stiffness matrix are scaled by internalForceScalingFactor below,
+    // when forming the residual and the system matrix)
 
     if (useStaticSolver)
     {
-      // no operation
+      memset(qresidual, 0, sizeof(double) * r);
     }
     else
     {
-      // build effective stiffness: add mass matrix and damping matrix to tangentStiffnessMatrix
-      tangentStiffnessMatrix->ScalarMultiply(dampingStiffnessCoef, rayleighDampingMatrix);
-      rayleighDampingMatrix->AddSubMatrix(dampingMassCoef, *massMatrix);
-
-      rayleighDampingMatrix->ScalarMultiplyAdd(alpha4, tangentStiffnessMatrix);
-      //*tangentStiffnessMatrix += alpha4 * *rayleighDampingMatrix;
-      tangentStiffnessMatrix->AddSubMatrix(alpha4, *dampingMatrix, 1);
-
-      tangentStiffnessMatrix->AddSubMatrix(alpha1, *massMatrix);
-      
       // compute force residual, store it into aux variable qresidual
       // qresidual = M * qaccel + C * qvel - externalForces + internalForces
-
-      massMatrix->MultiplyVector(qaccel, qresidual);
-      rayleighDampingMatrix->MultiplyVectorAdd(qvel, qresidual);
-      dampingMatrix->MultiplyVectorAdd(qvel, qresidual);
+      // with C = dampingStiffnessCoef * K + dampingMassCoef * M + dampingMatrix, the matrix-vector products are
+      // K * (dampingStiffnessCoef * qvel) + M * (qaccel + dampingMassCoef * qvel) + dampingMatrix * qvel, evaluated in one traversal
+      #ifdef USE_OPENMP
+        #pragma omp parallel for
+      #endif
+      for(int i=0; i<r; i++)
+        buffer[i] = qaccel[i] + dampingMassCoef * qvel[i];
+
+      double residualFactors[3] = { internalForceScalingFactor * dampingStiffnessCoef, 1.0, 1.0 };
+      const double * residualVectors[3] = { qvel, buffer, qvel };
+      residualCombination->MultiplyVector(residualFactors, residualVectors, qresidual);
     }
 
-    // add externalForces, internalForces
-    for(i=0; i<r; i++)
+    // scale internal forces, add externalForces and internalForces to the residual,
+    // compute the error, and gather the right-hand side of the constrained system, all in one pass
+    double error = 0;
+    double freeError = 0; // error without the reaction forces at the constrained DOFs
+    #ifdef USE_OPENMP
+      #pragma omp parallel for reduction(+:error,freeError)
+    #endif
+    for(int i=0; i<r; i++)
     {
-      qresidual[i] += internalForces[i] - externalForces[i];
-      qresidual[i] *= -1;
-      qdelta[i] = qresidual[i];
+      internalForces[i] *= internalForceScalingFactor;
+      double residual = externalForces[i] - internalForces[i] - qresidual[i];
+      qresidual[i] = residual;
+      error += residual * residual;
+      int index = fullToConstrainedDOFs[i];
+      if (index >= 0)
+      {
+        bufferConstrained[index] = residual;
+        freeError += residual * residual;
+      }
     }
 
 /*
@@ -281,14 +401,11 @@ int ImplicitNewmarkSparse::DoTimestep()
     printf("\n");
 */
 
-    double error = 0;
-    for(i=0; i<r; i++)
-      error += qresidual[i] * qresidual[i];
-
     // on the first iteration, compute initial error
     if (numIter == 0) 
     {
       error0 = error;
+      freeError0 = freeError;
       errorQuotient = 1.0;
     }
     else
@@ -296,52 +413,39 @@ int ImplicitNewmarkSparse::DoTimestep()
       // error divided by the initial error, before performing this iteration
       errorQuotient = error / error0; 
     }
+    newtonResidualReduction = (freeError0 > 0) ? sqrt(freeError / freeError0) : 0.0;
 
     if (errorQuotient < epsilon * epsilon)
     {
       break;
     }
 
-    //tangentStiffnessMatrix->Save("Keff");
-    RemoveRows(r, bufferConstrained, qdelta, numConstrainedDOFs, constrainedDOFs);
-    systemMatrix->AssignSuperMatrix(tangentStiffnessMatrix);
+    // build effective stiffness, directly in the constrained system matrix, in one pass:
+    // Keff = K + alpha4 * (dampingStiffnessCoef * K + dampingMassCoef * M + dampingMatrix) + alpha1 * M
+    double systemFactors[3] = { internalForceScalingFactor, 0.0, 0.0 };
+    if (!useStaticSolver)
+    {
+      systemFactors[0] = internalForceScalingFactor * (1.0 + alpha4 * dampingStiffnessCoef);
+      systemFactors[1] = alpha1 + alpha4 * dampingMassCoef;
+      systemFactors[2] = alpha4;
+    }
+    systemMatrixCombination->Evaluate(systemFactors, systemMatrix);
 
     // solve: systemMatrix * buffer = bufferConstrained
 
     PerformanceCounter counterSystemSolveTime;
-    memset(buffer, 0, sizeof(double) * r);
-
-    #ifdef SPOOLES
-      SPOOLESSolver solver(systemMatrix);
-      int info = solver.SolveLinearSystem(buffer, bufferConstrained);
-      char solverString[16] = "SPOOLES";
-    #endif
-
-    #ifdef PARDISO
-      int info = pardisoSolver->ComputeCholeskyDecomposition(systemMatrix);
-      if (info == 0)
-        info = pardisoSolver->SolveLinearSystem(buffer, bufferConstrained);
-      char solverString[16] = "PARDISO";
-    #endif
-
-    #ifdef PCG
-      int info = jacobiPreconditionedCGSolver->SolveLinearSystemWithJacobiPreconditioner(buffer, bufferConstrained, 1e-6, 10000);
-      if (info > 0)
-        info = 0;
-      char solverString[16] = "PCG";
-    #endif
 
+    int info = SolveNewtonSystem(numIter);
     if (info != 0)
     {
-      printf("Error: %s sparse solver returned non-zero exit status %d.\n", solverString, (int)info);
+      printf("Error: %s sparse solver returned non-zero exit status %d.\n", linearSolver->GetSolverName(), (int)info);
+      numNewtonIterations = numIter;
       return 1;
     }
 
     counterSystemSolveTime.StopCounter();
     systemSolveTime = counterSystemSolveTime.GetElapsedTime();
 
-    InsertRows(r, buffer, qdelta, numConstrainedDOFs, constrainedDOFs);
-
 /*
     printf("qdelta:\n");
     for(int i=0; i<r; i++)
@@ -349,21 +453,33 @@ int ImplicitNewmarkSparse::DoTimestep()
     printf("\n");
     exit(1);
 */
-    // update state
-    for(i=0; i<r; i++)
+    // scatter the solution into qdelta and update state (the constrained DOFs are set to zero)
+    #ifdef USE_OPENMP
+      #pragma omp parallel for
+    #endif
+    for(int i=0; i<r; i++)
     {
-      q[i] += qdelta[i];
-      qaccel[i] = alpha1 * (q[i] - q_1[i]) - alpha2 * qvel_1[i] - alpha3 * qaccel_1[i];
-      qvel[i] = alpha4 * (q[i] - q_1[i]) + alpha5 * qvel_1[i] + alpha6 * qaccel_1[i];
+      int index = fullToConstrainedDOFs[i];
+      if (index >= 0)
+      {
+        qdelta[i] = buffer[index];
+        q[i] += qdelta[i];
+        qaccel[i] = alpha1 * (q[i] - q_1[i]) - alpha2 * qvel_1[i] - alpha3 * qaccel_1[i];
+        qvel[i] = alpha4 * (q[i] - q_1[i]) + alpha5 * qvel_1[i] + alpha6 * qaccel_1[i];
+      }
+      else
+        qdelta[i] = q[i] = qvel[i] = qaccel[i] = 0.0;
     }
 
-    for(int i=0; i<numConstrainedDOFs; i++)
-      q[constrainedDOFs[i]] = qvel[constrainedDOFs[i]] = qaccel[constrainedDOFs[i]] = 0.0;
-
     numIter++;
   }
   while (numIter < maxIterations);
 
+  numNewtonIterations = numIter;
+  StoreStepUpdate(q, q_1);
+  counterTimestepTime.StopCounter();
+  timestepTime = counterTimestepTime.GetElapsedTime();
+
 /*
   printf("qvel:\n");
   for(int i=0; i<r; i++)
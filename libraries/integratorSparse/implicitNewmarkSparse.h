@@ -32,12 +32,11 @@
 
   See also integratorBase.h .
 
-  This class either uses SPOOLES, PARDISO, or our own Jacobi-preconitioned 
-  CG to solve the large sparse linear systems.
+  This class uses SPOOLES, PARDISO, our own Jacobi-preconitioned CG,
+  or our own sparse direct (Cholesky) solver to solve the large sparse linear systems.
 
-  You can switch between these solvers at compile time,
-  by modifying the file integratorSolverSelection.h (see below)
-  (run-time solver switching would be possible too with more coding).
+  The solver is selected at run-time, via the "solver" parameter of the constructor
+  (see integratorSparseSolver.h).
 */
 
 #ifndef _IMPLICITNEWMARKSPARSE_H_
@@ -47,27 +46,16 @@
   #include "TargetConditionals.h"
 #endif
 
-// This code supports three different solvers for sparse linear systems of equations:
-// SPOOLES, PARDISO, Jacobi-preconditioned Conjugate Gradients
-// You must define exactly one of the macros SPOOLES, PARDISO, PCG,
-// by changing the file integratorSolverSelection.h .
-// PCG is available with our code; look for it in the "sparseMatrix" library (CGSolver.h)
+// This code supports four different solvers for sparse linear systems of equations:
+// SPOOLES, PARDISO, Jacobi-preconditioned Conjugate Gradients (PCG), and a built-in sparse direct solver (CHOLESKY)
+// PCG and CHOLESKY are available with our code; look for them in the "sparseSolver" library (CGSolver.h, SparseCholeskySolver.h)
 // SPOOLES is available at: http://www.netlib.org/linalg/spooles/spooles.2.2.html
 // For PARDISO, the class was tested with the PARDISO implementation from the Intel Math Kernel Library
 
-#include "integratorSolverSelection.h"
 #include "sparseMatrix.h"
+#include "sparseMatrixLinearCombination.h"
 #include "integratorBaseSparse.h"
-
-#ifdef PARDISO
-  #include "sparseSolvers.h"
-#endif
-#ifdef SPOOLES
-  #include "sparseSolvers.h"
-#endif
-#ifdef PCG
-  #include "CGSolver.h"
-#endif
+#include "integratorSparseSolver.h"
 
 class ImplicitNewmarkSparse : public IntegratorBaseSparse
 {
@@ -75,8 +63,14 @@ public:
 
   // constrainedDOFs is an integer array of degrees of freedom that are to be fixed to zero (e.g., to permanently fix a vertex in a deformable simulation)
   // constrainedDOFs are 0-indexed (separate DOFs for x,y,z), and must be pre-sorted (ascending)
-  // numThreads applies only to the PARDISO solver; if numThreads > 0, the sparse linear solves are multi-threaded; default: 0 (use single-threading)
-  ImplicitNewmarkSparse(int r, double timestep, SparseMatrix * massMatrix, ForceModel * forceModel, int positiveDefiniteSolver=0, int numConstrainedDOFs=0, int * constrainedDOFs=NULL, double dampingMassCoef=0.0, double dampingStiffnessCoef=0.0, int maxIterations = 1, double epsilon = 1E-6, double NewmarkBeta=0.25, double NewmarkGamma=0.5, int numSolverThreads=0); 
+  // numThreads applies only to the PARDISO, SPOOLES and CHOLESKY solvers; if numThreads > 0, the sparse linear solves are multi-threaded; default: 0 (use single-threading)
+  // solver selects the sparse linear solver (see integratorSparseSolver.h)
+  ImplicitNewmarkSparse(int r, double timestep, SparseMatrix * massMatrix, ForceModel * forceModel, int positiveDefiniteSolver=0, int numConstrainedDOFs=0, int * constrainedDOFs=NULL, double dampingMassCoef=0.0, double dampingStiffnessCoef=0.0, int maxIterations = 1, double epsilon = 1E-6, double NewmarkBeta=0.25, double NewmarkGamma=0.5, int numSolverThreads=0, IntegratorSparseSolver::solverType solver=IntegratorSparseSolver::PCG); 
+
+  // creates an integrator for the same object as "source" (mass matrix, force model, constrained DOFs, damping and Newmark parameters),
+  // with its own state and its own matrices and buffers; the linear solver shares the symbolic factorization of the solver of "source"
+  // (see integratorSparseSolver.h), so "source" must not be deleted before this integrator
+  ImplicitNewmarkSparse(ImplicitNewmarkSparse * source, int numSolverThreads=0);
 
   virtual ~ImplicitNewmarkSparse();
 
@@ -94,17 +88,42 @@ public:
   // failure can occur, for example, if you are using the positive definite solver and the system matrix has negative eigenvalues
   virtual int DoTimestep(); 
 
+  // the same as SetState and DoTimestep, but on the given state vectors (r entries each) instead of the state of this integrator
+  // (the matrices, the solver and the buffers of this integrator are used as the workspace; see implicitNewmarkSparseBatch.h)
+  // ComputeAcceleration sets the constrained DOFs of q and qvel to zero, and computes qaccel assuming zero external force
+  int ComputeAcceleration(double * q, double * qvel, double * qaccel);
+  int DoTimestep(double * q, double * qvel, double * qaccel, const double * externalForces);
+
   inline void SetNewmarkBeta(double NewmarkBeta) { this->NewmarkBeta = NewmarkBeta; UpdateAlphas(); }
   inline void SetNewmarkGamma(double NewmarkGamma) { this->NewmarkGamma = NewmarkGamma; UpdateAlphas(); }
 
   // dynamic solver is default (i.e. useStaticSolver=false)
   virtual void UseStaticSolver(bool useStaticSolver);
 
+  // inexact Newton mode (default: off); intended for the PCG solver:
+  // - the first linear solve of each timestep is warm-started from the update of the previous timestep, scaled by the timestep ratio
+  // - the PCG tolerance (the "forcing term") is chosen from the decrease of the nonlinear residual (Eisenstat-Walker, choice 2),
+  //   bounded from above by maxForcingTerm (0 < maxForcingTerm < 1)
+  // - PCG never solves more accurately than needed to reach the Newton convergence threshold "epsilon"
+  // With the direct solvers, the warm start and the forcing term have no effect.
+  void UseInexactNewton(int inexactNewton, double maxForcingTerm=0.1);
+
+  // statistics of the last timestep (e.g., for benchmarking)
+  inline int GetNumNewtonIterations() { return numNewtonIterations; } // number of linear system solves
+  inline int GetMaxIterations() { return maxIterations; }
+  // norm of the residual at the unconstrained DOFs at the last convergence check of the last timestep, divided by its norm at the first iteration
+  inline double GetNewtonResidualReduction() { return newtonResidualReduction; }
+  inline int GetNumLinearSolverIterations() { return numLinearSolverIterations; } // total number of PCG iterations (0 for the direct solvers)
+  inline double GetTimestepTime() { return timestepTime; } // wall-clock time of the last call to DoTimestep, in seconds
+
 protected:
-  SparseMatrix * rayleighDampingMatrix;
   SparseMatrix * tangentStiffnessMatrix;
   SparseMatrix * systemMatrix;
 
+  // the terms K (0), M (1) and dampingMatrix (2), evaluated in a single pass (see sparseMatrixLinearCombination.h):
+  SparseMatrixLinearCombination * residualCombination; // at full size, for the matrix-vector products of the residual
+  SparseMatrixLinearCombination * systemMatrixCombination; // with the constrained DOFs removed, to assemble systemMatrix
+
   double * bufferConstrained;
 
   // parameters for implicit Newmark
@@ -114,17 +133,32 @@ protected:
   int maxIterations;
 
   void UpdateAlphas();
+  // allocates the buffers and builds the linear combinations, once tangentStiffnessMatrix and systemMatrix exist
+  void InitializeWorkspace();
   bool useStaticSolver;
 
   int positiveDefiniteSolver;
   int numSolverThreads;
-  #ifdef PARDISO
-    PardisoSolver * pardisoSolver;
-  #endif
 
-  #ifdef PCG
-    CGSolver * jacobiPreconditionedCGSolver;
-  #endif
+  // inexact Newton
+  int inexactNewton;
+  double maxForcingTerm;
+  double forcingTerm; // forcing term of the last Newton iteration
+  double firstNewtonError; // squared norm of the right-hand side at the first Newton iteration of the current timestep
+  double lastNewtonError; // squared norm of the right-hand side at the last Newton iteration
+  double * lastStepUpdate; // change of the Newton unknowns over the last timestep (used for the warm start)
+  double lastStepTimestep; // timestep of lastStepUpdate; 0 if lastStepUpdate is not available
+
+  int numNewtonIterations;
+  double newtonResidualReduction;
+  int numLinearSolverIterations;
+  double timestepTime;
+
+  // solves systemMatrix * buffer = bufferConstrained, at the given Newton iteration of the current timestep
+  // returns the solver's exit code (0 on success)
+  int SolveNewtonSystem(int numIter);
+  // stores the change of the Newton unknowns over the timestep (unknown - unknown_1), for the warm start of the next timestep
+  void StoreStepUpdate(const double * unknown, const double * unknown_1);
 };
 
 #endif
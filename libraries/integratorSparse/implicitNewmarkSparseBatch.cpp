@@ -0,0 +1,186 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "integrator" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC     *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "performanceCounter.h"
+#include "threadPool.h"
+#include "implicitNewmarkSparseBatch.h"
+
+ImplicitNewmarkSparseBatch::ImplicitNewmarkSparseBatch(int numInstances_, int r_, double timestep, SparseMatrix * massMatrix, ForceModel * forceModel, int positiveDefiniteSolver, int numConstrainedDOFs, int * constrainedDOFs, double dampingMassCoef, double dampingStiffnessCoef, int maxIterations, double epsilon, double NewmarkBeta, double NewmarkGamma, int numThreads, IntegratorSparseSolver::solverType solver): numInstances(numInstances_), r(r_), timestepTime(0.0)
+{
+  if (numInstances < 1)
+  {
+    printf("Error: the number of instances must be positive.\n");
+    exit(1);
+  }
+
+  // per-instance state
+  size_t stateSize = sizeof(double) * numInstances * r;
+  q = (double*) malloc (stateSize);
+  qvel = (double*) malloc (stateSize);
+  qaccel = (double*) malloc (stateSize);
+  externalForces = (double*) malloc (stateSize);
+  instanceStatus = (int*) malloc (sizeof(int) * numInstances);
+  ResetToRest();
+  SetExternalForcesToZero();
+
+  // per-worker workspace
+  if (numThreads <= 0)
+    numThreads = ThreadPool::GetGlobalThreadPool()->GetNumThreads();
+  numWorkers = (numThreads < numInstances) ? numThreads : numInstances;
+
+  // the solvers of the other workers share the symbolic factorization of the first solver
+  // (each worker's solver is single-threaded, except if there is only one worker)
+  int numSolverThreads = (numWorkers == 1) ? numThreads : 1;
+  workers = (ImplicitNewmarkSparse**) malloc (sizeof(ImplicitNewmarkSparse*) * numWorkers);
+  workers[0] = new ImplicitNewmarkSparse(r, timestep, massMatrix, forceModel, positiveDefiniteSolver, numConstrainedDOFs, constrainedDOFs, dampingMassCoef, dampingStiffnessCoef, maxIterations, epsilon, NewmarkBeta, NewmarkGamma, numSolverThreads, solver);
+  for(int worker=1; worker<numWorkers; worker++)
+    workers[worker] = new ImplicitNewmarkSparse(workers[0], numSolverThreads);
+}
+
+ImplicitNewmarkSparseBatch::~ImplicitNewmarkSparseBatch()
+{
+  // delete the workers in reverse order: the solver of the first worker owns the shared symbolic factorization
+  for(int worker=numWorkers-1; worker>=0; worker--)
+    delete(workers[worker]);
+  free(workers);
+
+  free(q);
+  free(qvel);
+  free(qaccel);
+  free(externalForces);
+  free(instanceStatus);
+}
+
+void ImplicitNewmarkSparseBatch::SetTimestep(double timestep)
+{
+  for(int worker=0; worker<numWorkers; worker++)
+    workers[worker]->SetTimestep(timestep);
+}
+
+void ImplicitNewmarkSparseBatch::SetDampingMatrix(SparseMatrix * dampingMatrix)
+{
+  for(int worker=0; worker<numWorkers; worker++)
+    workers[worker]->SetDampingMatrix(dampingMatrix);
+}
+
+void ImplicitNewmarkSparseBatch::SetInternalForceScalingFactor(double internalForceScalingFactor)
+{
+  for(int worker=0; worker<numWorkers; worker++)
+    workers[worker]->SetInternalForceScalingFactor(internalForceScalingFactor);
+}
+
+void ImplicitNewmarkSparseBatch::SetDampingMassCoef(double dampingMassCoef)
+{
+  for(int worker=0; worker<numWorkers; worker++)
+    workers[worker]->SetDampingMassCoef(dampingMassCoef);
+}
+
+void ImplicitNewmarkSparseBatch::SetDampingStiffnessCoef(double dampingStiffnessCoef)
+{
+  for(int worker=0; worker<numWorkers; worker++)
+    workers[worker]->SetDampingStiffnessCoef(dampingStiffnessCoef);
+}
+
+void ImplicitNewmarkSparseBatch::ResetToRest(int instance)
+{
+  size_t offset = InstanceOffset(instance);
+  memset(&q[offset], 0, sizeof(double) * r);
+  memset(&qvel[offset], 0, sizeof(double) * r);
+  memset(&qaccel[offset], 0, sizeof(double) * r);
+  instanceStatus[instance] = 0;
+}
+
+void ImplicitNewmarkSparseBatch::ResetToRest()
+{
+  for(int instance=0; instance<numInstances; instance++)
+    ResetToRest(instance);
+}
+
+void ImplicitNewmarkSparseBatch::SetExternalForces(int instance, double * externalForces_)
+{
+  memcpy(&externalForces[InstanceOffset(instance)], externalForces_, sizeof(double) * r);
+}
+
+void ImplicitNewmarkSparseBatch::SetExternalForcesToZero()
+{
+  memset(externalForces, 0, sizeof(double) * numInstances * r);
+}
+
+// sets the state based on given q, qvel
+// automatically computes acceleration assuming zero external force (with the workspace of the first worker)
+int ImplicitNewmarkSparseBatch::SetState(int instance, double * q_, double * qvel_)
+{
+  double * q = Getq(instance);
+  double * qvel = Getqvel(instance);
+
+  memcpy(q, q_, sizeof(double)*r);
+
+  if (qvel_ != NULL)
+    memcpy(qvel, qvel_, sizeof(double)*r);
+  else
+    memset(qvel, 0, sizeof(double)*r);
+
+  if (workers[0]->ComputeAcceleration(q, qvel, Getqaccel(instance)) != 0)
+    return 1;
+
+  instanceStatus[instance] = 0;
+  return 0;
+}
+
+void ImplicitNewmarkSparseBatch::WorkerTask(void * data, int rank)
+{
+  ImplicitNewmarkSparseBatch * batch = (ImplicitNewmarkSparseBatch*) data;
+  // contiguous range of instances
+  int instanceStart = (int)(((long long)batch->numInstances * rank) / batch->numWorkers);
+  int instanceEnd = (int)(((long long)batch->numInstances * (rank + 1)) / batch->numWorkers);
+  for(int instance=instanceStart; instance<instanceEnd; instance++)
+    batch->instanceStatus[instance] = batch->workers[rank]->DoTimestep(batch->Getq(instance), batch->Getqvel(instance), batch->Getqaccel(instance), batch->GetExternalForces(instance));
+}
+
+int ImplicitNewmarkSparseBatch::DoTimestep()
+{
+  PerformanceCounter counterTimestepTime;
+
+  if (numWorkers == 1)
+    WorkerTask(this, 0); // on the calling thread, so that the force model and the solver can use the thread pool
+  else
+    ThreadPool::GetGlobalThreadPool()->Execute(numWorkers, WorkerTask, this);
+
+  counterTimestepTime.StopCounter();
+  timestepTime = counterTimestepTime.GetElapsedTime();
+
+  for(int instance=0; instance<numInstances; instance++)
+    if (instanceStatus[instance] != 0)
+      return 1;
+  return 0;
+}
+
@@ -0,0 +1,135 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "integrator" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC     *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+/*
+  Timesteps many independent copies ("instances") of the same deformable object
+  with implicit Newmark (the same method as ImplicitNewmarkSparse), in one call.
+
+  All instances share the read-only data: the force model (and therefore the mesh, the precomputed
+  integrals and the sparsity patterns), the mass and damping matrices, the constrained DOFs and,
+  with the CHOLESKY solver, the ordering and the symbolic factorization of the system matrix.
+  The instances differ in their state and their external forces.
+
+  The per-instance state is stored as a structure of arrays: q, qvel, qaccel and the external forces
+  are each one contiguous array of numInstances * r doubles, where instance i occupies entries
+  i * r, ..., (i+1) * r - 1 (so that the state of each instance is a regular vector, usable with the force models).
+
+  The matrices and vectors needed only during a timestep (tangent stiffness matrix, system matrix and its
+  factorization, residual, ...) are not stored per instance, but per worker thread: each worker owns an ImplicitNewmarkSparse
+  integrator, and steps its instances with ImplicitNewmarkSparse::DoTimestep(q, qvel, qaccel, externalForces). DoTimestep splits the
+  instances into contiguous ranges, one per worker, and steps the ranges in parallel on the global thread pool
+  (see threadPool.h). The memory therefore grows with the number of threads, and only the state grows with
+  the number of instances. With a single worker (numThreads=1, or a single instance), the instances are stepped
+  one after another on the calling thread, and the multi-threaded force models (e.g., StVKInternalForcesMT and
+  StVKStiffnessMatrixMT) and the solver may use the thread pool to parallelize over the elements of each instance.
+  (Inside the worker tasks, the thread pool is busy, and the multi-threaded force models run serially.)
+
+  Since the force model is shared, its GetForceAndMatrix must support concurrent calls with different arguments
+  (this holds for StVKForceModel, with both the single-threaded and the multi-threaded StVK classes).
+  Force models that keep per-call state in the object must be used with numThreads=1.
+
+  See also implicitNewmarkSparse.h .
+*/
+
+#ifndef _IMPLICITNEWMARKSPARSEBATCH_H_
+#define _IMPLICITNEWMARKSPARSEBATCH_H_
+
+#include "sparseMatrix.h"
+#include "forceModel.h"
+#include "implicitNewmarkSparse.h"
+
+class ImplicitNewmarkSparseBatch
+{
+public:
+
+  // the parameters have the same meaning as with ImplicitNewmarkSparse; all instances start at rest
+  // numThreads: number of worker threads (0 = the number of threads of the global thread pool)
+  ImplicitNewmarkSparseBatch(int numInstances, int r, double timestep, SparseMatrix * massMatrix, ForceModel * forceModel, int positiveDefiniteSolver=0, int numConstrainedDOFs=0, int * constrainedDOFs=NULL, double dampingMassCoef=0.0, double dampingStiffnessCoef=0.0, int maxIterations=1, double epsilon=1E-6, double NewmarkBeta=0.25, double NewmarkGamma=0.5, int numThreads=0, IntegratorSparseSolver::solverType solver=IntegratorSparseSolver::PCG);
+  virtual ~ImplicitNewmarkSparseBatch();
+
+  // performs one timestep of all instances
+  // returns 0 if all instances succeeded, and 1 if the linear solver failed for at least one instance (see GetInstanceStatus)
+  int DoTimestep();
+
+  // === state of the individual instances ===
+  inline int GetNumInstances() { return numInstances; }
+  inline int Getr() { return r; }
+  inline double * Getq(int instance) { return &q[InstanceOffset(instance)]; }
+  inline double * Getqvel(int instance) { return &qvel[InstanceOffset(instance)]; }
+  inline double * Getqaccel(int instance) { return &qaccel[InstanceOffset(instance)]; }
+  inline double * GetExternalForces(int instance) { return &externalForces[InstanceOffset(instance)]; }
+  // the arrays of all instances (numInstances * r entries each)
+  inline double * Getq() { return q; }
+  inline double * Getqvel() { return qvel; }
+  inline double * Getqaccel() { return qaccel; }
+  inline double * GetExternalForces() { return externalForces; }
+
+  // sets the state of one instance; computes the acceleration assuming zero external forces
+  // (same as ImplicitNewmarkSparse::SetState); returns 0 on success
+  int SetState(int instance, double * q, double * qvel=NULL);
+  void ResetToRest(int instance);
+  void ResetToRest(); // all instances
+  void SetExternalForces(int instance, double * externalForces);
+  void SetExternalForcesToZero(); // all instances
+  // 0 if the last timestep of the instance succeeded, 1 if the linear solver failed (the state of the instance is then undefined)
+  inline int GetInstanceStatus(int instance) { return instanceStatus[instance]; }
+
+  // === shared parameters ===
+  void SetTimestep(double timestep);
+  inline double GetTimeStep() { return workers[0]->GetTimeStep(); }
+  // damping matrix provides damping in addition to mass and stiffness damping; it is not copied
+  void SetDampingMatrix(SparseMatrix * dampingMatrix);
+  void SetInternalForceScalingFactor(double internalForceScalingFactor);
+  void SetDampingMassCoef(double dampingMassCoef);
+  void SetDampingStiffnessCoef(double dampingStiffnessCoef);
+  inline int GetNumWorkers() { return numWorkers; }
+
+  // statistics of the last timestep
+  inline double GetTimestepTime() { return timestepTime; } // wall-clock time of the last call to DoTimestep, in seconds
+  inline double GetInstancesPerSecond() { return (timestepTime > 0) ? numInstances / timestepTime : 0.0; } // throughput of the last call to DoTimestep
+
+protected:
+  int numInstances;
+  int r;
+
+  // per-instance state (numInstances * r entries each)
+  double * q, * qvel, * qaccel, * externalForces;
+  int * instanceStatus;
+  inline size_t InstanceOffset(int instance) { return (size_t)instance * r; }
+
+  // per-worker workspace (numWorkers entries); the integrators of the other workers are created from the first one
+  int numWorkers;
+  ImplicitNewmarkSparse ** workers;
+
+  double timestepTime;
+
+  static void WorkerTask(void * data, int rank);
+};
+
+#endif
+
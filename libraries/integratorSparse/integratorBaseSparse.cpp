@@ -35,10 +35,34 @@ IntegratorBaseSparse::IntegratorBaseSparse(int r, double timestep, SparseMatrix
 {
   systemSolveTime = 0.0;
   forceAssemblyTime = 0.0;
+  linearSolver = NULL;
 
   constrainedDOFs = (int*) malloc (sizeof(int) * numConstrainedDOFs);
   memcpy(constrainedDOFs, constrainedDOFs_, sizeof(int) * numConstrainedDOFs);
 
+  fullToConstrainedDOFs = (int*) malloc (sizeof(int) * r);
+  constrainedToFullDOFs = (int*) malloc (sizeof(int) * (r - numConstrainedDOFs));
+  for(int i=0; i<r; i++)
+    fullToConstrainedDOFs[i] = 0;
+  for(int i=0; i<numConstrainedDOFs; i++)
+  {
+    if ((constrainedDOFs[i] < 0) || (constrainedDOFs[i] >= r) || ((i > 0) && (constrainedDOFs[i] <= constrainedDOFs[i-1])))
+    {
+      printf("Error: constrained DOFs must be sorted, distinct, and in the range [0, %d).\n", r);
+      exit(1);
+    }
+    fullToConstrainedDOFs[constrainedDOFs[i]] = -1;
+  }
+  int numUnconstrainedDOFs = 0;
+  for(int i=0; i<r; i++)
+  {
+    if (fullToConstrainedDOFs[i] < 0)
+      continue;
+    constrainedToFullDOFs[numUnconstrainedDOFs] = i;
+    fullToConstrainedDOFs[i] = numUnconstrainedDOFs;
+    numUnconstrainedDOFs++;
+  }
+
   ownDampingMatrix = 1;
   SparseMatrixOutline outline(r);
   dampingMatrix = new SparseMatrix(&outline);
@@ -47,6 +71,9 @@ IntegratorBaseSparse::IntegratorBaseSparse(int r, double timestep, SparseMatrix
 IntegratorBaseSparse::~IntegratorBaseSparse()
 {
   free(constrainedDOFs);
+  free(fullToConstrainedDOFs);
+  free(constrainedToFullDOFs);
+  delete(linearSolver);
   if (ownDampingMatrix)
     delete(dampingMatrix);
 }
@@ -60,6 +87,28 @@ void IntegratorBaseSparse::SetDampingMatrix(SparseMatrix * dampingMatrix_)
   ownDampingMatrix = 0;
 }
 
+void IntegratorBaseSparse::RemoveConstrainedDOFs(const double * x, double * xConstrained)
+{
+  int numUnconstrainedDOFs = r - numConstrainedDOFs;
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
+  for(int i=0; i<numUnconstrainedDOFs; i++)
+    xConstrained[i] = x[constrainedToFullDOFs[i]];
+}
+
+void IntegratorBaseSparse::InsertConstrainedDOFs(const double * xConstrained, double * x)
+{
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
+  for(int i=0; i<r; i++)
+  {
+    int index = fullToConstrainedDOFs[i];
+    x[i] = (index >= 0) ? xConstrained[index] : 0.0;
+  }
+}
+
 double IntegratorBaseSparse::GetKineticEnergy()
 {
   return 0.5 * massMatrix->QuadraticForm(qvel);
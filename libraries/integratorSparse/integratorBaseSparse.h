@@ -30,6 +30,9 @@
   A base class to timestep large sparse dynamics.
   E.g., unreduced nonlinear FEM deformable dynamics.
 
+  The loops over the state vectors in the derived classes are fused into as few passes as possible.
+  If the code is compiled with -fopenmp -DUSE_OPENMP (see the Makefile-header file), these loops run in parallel.
+
   See also integratorBase.h .
 */
 
@@ -39,6 +42,7 @@
 #include "sparseMatrix.h"
 #include "forceModel.h"
 #include "integratorBase.h"
+#include "integratorSparseSolver.h"
 
 class IntegratorBaseSparse : public IntegratorBase
 {
@@ -64,6 +68,9 @@ public:
   inline virtual double GetSystemSolveTime() { return systemSolveTime; }
   inline virtual double GetForceAssemblyTime() { return forceAssemblyTime; }
 
+  // returns the sparse linear solver used by the integrator (e.g., to select the PCG preconditioner, or to query solver statistics)
+  inline IntegratorSparseSolver * GetLinearSolver() { return linearSolver; }
+
   virtual double GetKineticEnergy();
   virtual double GetTotalMass();
 
@@ -78,6 +85,16 @@ protected:
 
   double systemSolveTime;
   double forceAssemblyTime;
+
+  IntegratorSparseSolver * linearSolver; // created by the derived classes, released by this class
+
+  // maps between the full DOFs and the DOFs of the constrained system (built once, at construction)
+  int * fullToConstrainedDOFs; // r entries; -1 for a constrained DOF
+  int * constrainedToFullDOFs; // r - numConstrainedDOFs entries
+  // xConstrained = x, with the constrained DOFs removed (same as RemoveRows, see insertRows.h)
+  void RemoveConstrainedDOFs(const double * x, double * xConstrained);
+  // x = xConstrained, with zeros inserted at the constrained DOFs (same as InsertRows, see insertRows.h)
+  void InsertConstrainedDOFs(const double * xConstrained, double * x);
 };
 
 #endif
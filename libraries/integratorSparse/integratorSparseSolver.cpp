@@ -0,0 +1,310 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "integrator" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC     *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "integratorSparseSolver.h"
+#include "sparseSolverAvailability.h"
+#include "performanceCounter.h"
+
+IntegratorSparseSolver::IntegratorSparseSolver(solverType solver_, SparseMatrix * A_, int positiveDefinite_, int numThreads_): solver(solver_), A(A_), positiveDefinite(positiveDefinite_), numThreads(numThreads_), pcgEpsilon(1E-6), pcgMaxIterations(10000), cgSolver(NULL), pcgPreconditionerType(CGPreconditioner::JACOBI), pcgPreconditioner(NULL), pcgPreconditionerIsComputed(0), pardisoSolver(NULL), spoolesSolver(NULL), spoolesSolverMT(NULL), choleskySolver(NULL)
+{
+  CreateSolver(NULL);
+}
+
+IntegratorSparseSolver::IntegratorSparseSolver(const IntegratorSparseSolver * source, SparseMatrix * A_, int numThreads_): solver(source->solver), A(A_), positiveDefinite(source->positiveDefinite), numThreads(numThreads_), pcgEpsilon(source->pcgEpsilon), pcgMaxIterations(source->pcgMaxIterations), cgSolver(NULL), pcgPreconditionerType(source->pcgPreconditionerType), pcgPreconditioner(NULL), pcgPreconditionerIsComputed(0), pardisoSolver(NULL), spoolesSolver(NULL), spoolesSolverMT(NULL), choleskySolver(NULL)
+{
+  CreateSolver(source);
+}
+
+void IntegratorSparseSolver::CreateSolver(const IntegratorSparseSolver * source)
+{
+  if (!IsAvailable(solver))
+  {
+    printf("Error: the %s sparse solver has not been installed/compiled/enabled. After installation, enable it in \"sparseSolverAvailability.h\".\n", GetSolverName(solver));
+    exit(1);
+  }
+
+  ResetStatistics();
+
+  switch (solver)
+  {
+    case PCG:
+      cgSolver = new CGSolver(A);
+      pcgPreconditioner = CGPreconditioner::CreatePreconditioner(pcgPreconditionerType, A);
+    break;
+
+    case PARDISO:
+      printf("Creating Pardiso solver. Positive-definite solver: %d. Num threads: %d\n", positiveDefinite, numThreads);
+      pardisoSolver = new PardisoSolver(A, numThreads, positiveDefinite);
+    break;
+
+    case SPOOLES:
+      // created at the first factorization
+    break;
+
+    case CHOLESKY:
+      if ((source != NULL) && (source->choleskySolver != NULL))
+        choleskySolver = new SparseCholeskySolver(source->choleskySolver, (numThreads > 1) ? numThreads : 1);
+      else
+      {
+        printf("Creating the sparse Cholesky solver. Positive-definite solver: %d. Num threads: %d\n", positiveDefinite, numThreads);
+        choleskySolver = new SparseCholeskySolver(A, (numThreads > 1) ? numThreads : 1, positiveDefinite);
+      }
+    break;
+
+    default:
+      printf("Error: unknown sparse solver %d.\n", (int)solver);
+      exit(1);
+    break;
+  }
+}
+
+IntegratorSparseSolver::~IntegratorSparseSolver()
+{
+  delete(cgSolver);
+  delete(pcgPreconditioner);
+  delete(pardisoSolver);
+  delete(spoolesSolver);
+  delete(spoolesSolverMT);
+  delete(choleskySolver);
+}
+
+void IntegratorSparseSolver::SetPCGPreconditioner(CGPreconditioner::preconditionerType preconditioner)
+{
+  pcgPreconditionerType = preconditioner;
+  if (solver != PCG)
+    return;
+
+  delete(pcgPreconditioner);
+  pcgPreconditioner = CGPreconditioner::CreatePreconditioner(pcgPreconditionerType, A);
+  if (pcgPreconditioner == NULL)
+    exit(1);
+  pcgPreconditionerIsComputed = 0;
+}
+
+int IntegratorSparseSolver::Factor()
+{
+  PerformanceCounter counter;
+
+  int info = 0;
+  switch (solver)
+  {
+    case PCG:
+      info = pcgPreconditioner->Update();
+      pcgPreconditionerIsComputed = 1;
+    break;
+
+    case PARDISO:
+      info = pardisoSolver->ComputeCholeskyDecomposition(A);
+    break;
+
+    case SPOOLES:
+      // the pattern of A does not change: after the first decomposition, only re-compute the numerical factorization
+      if (numThreads > 1)
+      {
+        if (spoolesSolverMT == NULL)
+          spoolesSolverMT = new SPOOLESSolverMT(A, numThreads);
+        else
+          info = spoolesSolverMT->ComputeCholeskyDecomposition(A);
+      }
+      else
+      {
+        if (spoolesSolver == NULL)
+          spoolesSolver = new SPOOLESSolver(A);
+        else
+          info = spoolesSolver->ComputeCholeskyDecomposition(A);
+      }
+    break;
+
+    case CHOLESKY:
+      info = choleskySolver->ComputeCholeskyDecomposition(A);
+    break;
+
+    default:
+    break;
+  }
+
+  counter.StopCounter();
+  lastFactorTime = counter.GetElapsedTime();
+  totalFactorTime += lastFactorTime;
+  numFactorizations++;
+
+  return info;
+}
+
+int IntegratorSparseSolver::Solve(double * x, const double * rhs)
+{
+  return DoSolve(x, rhs, pcgEpsilon, CGSolver::RELATIVE_TO_INITIAL_RESIDUAL);
+}
+
+int IntegratorSparseSolver::SolveInexact(double * x, const double * rhs, double forcingTerm)
+{
+  return DoSolve(x, rhs, forcingTerm, CGSolver::RELATIVE_TO_RHS);
+}
+
+int IntegratorSparseSolver::DoSolve(double * x, const double * rhs, double pcgTolerance, CGSolver::convergenceCriterionType pcgConvergenceCriterion)
+{
+  PerformanceCounter counter;
+
+  int info = 0;
+  lastNumIterations = 0;
+  switch (solver)
+  {
+    case PCG:
+      if (!pcgPreconditionerIsComputed)
+      {
+        // the preconditioner was (re-)created after the last factorization
+        pcgPreconditioner->Update();
+        pcgPreconditionerIsComputed = 1;
+      }
+      // the return value is the number of iterations (negative if the solver did not converge)
+      cgSolver->SetConvergenceCriterion(pcgConvergenceCriterion);
+      info = cgSolver->SolveLinearSystemWithPreconditioner(pcgPreconditioner, x, rhs, pcgTolerance, pcgMaxIterations);
+      lastNumIterations = (info >= 0) ? info : -info;
+      if (info > 0)
+        info = 0;
+    break;
+
+    case PARDISO:
+      info = pardisoSolver->SolveLinearSystem(x, rhs);
+    break;
+
+    case SPOOLES:
+      if (numThreads > 1)
+        info = spoolesSolverMT->SolveLinearSystem(x, rhs);
+      else
+        info = spoolesSolver->SolveLinearSystem(x, rhs);
+    break;
+
+    case CHOLESKY:
+      info = choleskySolver->SolveLinearSystem(x, rhs);
+    break;
+
+    default:
+    break;
+  }
+
+  counter.StopCounter();
+  lastSolveTime = counter.GetElapsedTime();
+  totalSolveTime += lastSolveTime;
+  totalNumIterations += lastNumIterations;
+  numSolves++;
+
+  return info;
+}
+
+int IntegratorSparseSolver::FactorAndSolve(double * x, const double * rhs)
+{
+  int info = Factor();
+  if (info == 0)
+    info = Solve(x, rhs);
+  return info;
+}
+
+void IntegratorSparseSolver::ResetStatistics()
+{
+  numSolves = 0;
+  numFactorizations = 0;
+  lastNumIterations = 0;
+  totalNumIterations = 0;
+  lastFactorTime = 0.0;
+  lastSolveTime = 0.0;
+  totalFactorTime = 0.0;
+  totalSolveTime = 0.0;
+}
+
+void IntegratorSparseSolver::PrintStatistics() const
+{
+  if (solver == PCG)
+    printf("Solver %s (preconditioner: %s): %d factorizations, %d solves, %lld CG iterations (%.1f per solve). Factorization time: %G s. Solve time: %G s.\n",
+      GetSolverName(), CGPreconditioner::GetPreconditionerName(pcgPreconditionerType), numFactorizations, numSolves, totalNumIterations,
+      (numSolves > 0) ? 1.0 * totalNumIterations / numSolves : 0.0, totalFactorTime, totalSolveTime);
+  else
+    printf("Solver %s: %d factorizations, %d solves. Factorization time: %G s. Solve time: %G s.\n",
+      GetSolverName(), numFactorizations, numSolves, totalFactorTime, totalSolveTime);
+}
+
+const char * IntegratorSparseSolver::GetSolverName(solverType solver)
+{
+  switch (solver)
+  {
+    case PCG:
+      return "PCG";
+    case PARDISO:
+      return "PARDISO";
+    case SPOOLES:
+      return "SPOOLES";
+    case CHOLESKY:
+      return "CHOLESKY";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+int IntegratorSparseSolver::GetSolverType(const char * solverName, solverType * solver)
+{
+  for(int i=0; i<NUM_SOLVER_TYPES; i++)
+  {
+    if (strcmp(solverName, GetSolverName((solverType)i)) == 0)
+    {
+      *solver = (solverType)i;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int IntegratorSparseSolver::IsAvailable(solverType solver)
+{
+  switch (solver)
+  {
+    case PCG:
+    case CHOLESKY:
+      return 1;
+
+    case PARDISO:
+      #ifdef PARDISO_SOLVER_IS_AVAILABLE
+        return 1;
+      #else
+        return 0;
+      #endif
+
+    case SPOOLES:
+      #ifdef SPOOLES_SOLVER_IS_AVAILABLE
+        return 1;
+      #else
+        return 0;
+      #endif
+
+    default:
+      return 0;
+  }
+}
+
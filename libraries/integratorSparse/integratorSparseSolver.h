@@ -0,0 +1,152 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "integrator" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC     *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+/*
+  The sparse linear solver used by the sparse integrators
+  (ImplicitNewmarkSparse, ImplicitBackwardEulerSparse, CentralDifferencesSparse, EulerSparse).
+
+  The solver is selected at runtime, by passing one of the following to the integrator's constructor:
+  PCG: preconditioned Conjugate Gradients (CGSolver.h); included with Vega, always available;
+    the preconditioner (Jacobi, 3x3 block Jacobi, SSOR or IC0; see CGPreconditioner.h) is selected with SetPCGPreconditioner (default: Jacobi)
+  PARDISO: the PARDISO direct solver (PardisoSolver.h), e.g., from Intel MKL
+  SPOOLES: the SPOOLES direct solver (SPOOLESSolver.h, SPOOLESSolverMT.h), http://www.netlib.org/linalg/spooles/spooles.2.2.html
+  CHOLESKY: the built-in supernodal sparse direct solver (SparseCholeskySolver.h); included with Vega, always available
+
+  PARDISO and SPOOLES must be installed, and their availability must be set in
+  libraries/sparseSolver/sparseSolverAvailability.h . Use IsAvailable to query which solvers were compiled in.
+
+  The class solves systems with a matrix A whose topology never changes, but whose entries may change
+  (e.g., the system matrix of an implicit integrator). A is not copied: Factor uses the current entries of A.
+  The direct solvers compute the fill-reducing ordering and the symbolic factorization only once,
+  and re-compute only the numerical factorization at each call to Factor.
+  Likewise, the PCG preconditioner analyzes the pattern of A once, and is re-computed numerically at each call to Factor.
+
+  The class records solver statistics (number of solves, PCG iterations, factorization and solve times),
+  to compare the solvers and preconditioners.
+*/
+
+#ifndef _INTEGRATORSPARSESOLVER_H_
+#define _INTEGRATORSPARSESOLVER_H_
+
+#include "sparseMatrix.h"
+#include "sparseSolvers.h"
+#include "CGPreconditioner.h"
+
+class IntegratorSparseSolver
+{
+public:
+  typedef enum { PCG, PARDISO, SPOOLES, CHOLESKY, NUM_SOLVER_TYPES } solverType;
+
+  // positiveDefinite: whether A is positive-definite (direct solvers can then use the Cholesky factorization)
+  // numThreads: PARDISO: number of threads (0 = default); SPOOLES and CHOLESKY: if numThreads > 1, factorization and solves are multi-threaded
+  // exits with an error if the selected solver is not available
+  IntegratorSparseSolver(solverType solver, SparseMatrix * A, int positiveDefinite=0, int numThreads=0);
+  // creates a solver of the same type, with the same parameters as "source", for a matrix A with the same topology as the matrix of "source"
+  // (e.g., the system matrix of another copy of the same object); CHOLESKY shares the ordering and the symbolic factorization
+  // with "source", which must then not be deleted before this solver; the other solvers analyze A on their own
+  IntegratorSparseSolver(const IntegratorSparseSolver * source, SparseMatrix * A, int numThreads=0);
+  virtual ~IntegratorSparseSolver();
+
+  // computes the factorization of the current entries of A (PCG: updates the preconditioner)
+  // returns 0 on success
+  int Factor();
+
+  // solves A * x = rhs, using the last factorization (PCG: using the current entries of A, and x as the initial guess)
+  // returns 0 on success
+  int Solve(double * x, const double * rhs);
+
+  // Factor, followed by Solve
+  int FactorAndSolve(double * x, const double * rhs);
+
+  // inexact solve (e.g., for an inexact Newton method):
+  // PCG: stops as soon as the M^{-1}-weighted residual norm |rhs - A x| is less than forcingTerm * |rhs|,
+  //   so that a good initial guess in x reduces the number of iterations; the PCG epsilon is not used
+  // direct solvers: same as Solve
+  int SolveInexact(double * x, const double * rhs, double forcingTerm);
+
+  // PCG parameters (default: epsilon=1E-6, maxIterations=10000)
+  inline void SetPCGParameters(double epsilon, int maxIterations) { pcgEpsilon = epsilon; pcgMaxIterations = maxIterations; }
+  // selects the PCG preconditioner (default: JACOBI); the preconditioner is computed at the next call to Factor or Solve
+  // (no effect for the direct solvers)
+  void SetPCGPreconditioner(CGPreconditioner::preconditionerType preconditioner);
+  inline CGPreconditioner::preconditionerType GetPCGPreconditioner() const { return pcgPreconditionerType; }
+
+  // solver statistics (accumulated since construction, or since the last call to ResetStatistics)
+  inline int GetNumSolves() const { return numSolves; }
+  inline int GetNumFactorizations() const { return numFactorizations; }
+  inline int GetLastNumIterations() const { return lastNumIterations; } // number of PCG iterations in the last solve (0 for the direct solvers)
+  inline long long GetTotalNumIterations() const { return totalNumIterations; }
+  inline double GetLastFactorTime() const { return lastFactorTime; } // in seconds
+  inline double GetLastSolveTime() const { return lastSolveTime; } // in seconds
+  inline double GetTotalFactorTime() const { return totalFactorTime; }
+  inline double GetTotalSolveTime() const { return totalSolveTime; }
+  void ResetStatistics();
+  void PrintStatistics() const;
+
+  inline solverType GetSolverType() const { return solver; }
+  inline const char * GetSolverName() const { return GetSolverName(solver); }
+
+  // returns "PCG", "PARDISO", "SPOOLES" or "CHOLESKY"
+  static const char * GetSolverName(solverType solver);
+  // converts a solver name (see GetSolverName) to the solver type; returns 0 on success, and 1 if the name is unknown
+  static int GetSolverType(const char * solverName, solverType * solver);
+  // returns 1 if the solver has been compiled into the library, and 0 otherwise
+  static int IsAvailable(solverType solver);
+
+protected:
+  solverType solver;
+  SparseMatrix * A;
+  int positiveDefinite;
+  int numThreads;
+
+  double pcgEpsilon;
+  int pcgMaxIterations;
+
+  CGSolver * cgSolver;
+  CGPreconditioner::preconditionerType pcgPreconditionerType;
+  CGPreconditioner * pcgPreconditioner;
+  int pcgPreconditionerIsComputed;
+  PardisoSolver * pardisoSolver;
+  // the SPOOLES solvers are created at the first factorization (SPOOLES computes the ordering from the entries of A)
+  SPOOLESSolver * spoolesSolver;
+  SPOOLESSolverMT * spoolesSolverMT; // used instead of spoolesSolver if numThreads > 1
+  SparseCholeskySolver * choleskySolver;
+
+  int numSolves;
+  int numFactorizations;
+  int lastNumIterations;
+  long long totalNumIterations;
+  double lastFactorTime, lastSolveTime;
+  double totalFactorTime, totalSolveTime;
+
+  void CreateSolver(const IntegratorSparseSolver * source);
+  int DoSolve(double * x, const double * rhs, double pcgTolerance, CGSolver::convergenceCriterionType pcgConvergenceCriterion);
+};
+
+#endif
+
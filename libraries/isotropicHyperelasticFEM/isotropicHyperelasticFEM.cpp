@@ -393,6 +393,7 @@ void IsotropicHyperelasticFEM::GetEnergyAndForceAndTangentStiffnessMatrixHelperP
 /*
   This is the workhorse of the IFEM class. It computes strain energy,
   internal forces, and/or the tangent stiffness matrix for a subset of the elements, startEl <= el < endEl
+  (or, if elementList is not NULL, for the elements elementList[startEl], ..., elementList[endEl-1])
 
   The strain energy is computed based on the user-specified material (e.g. StVK, neo-Hookean, Mooney-Rivlin)
 
@@ -400,7 +401,7 @@ void IsotropicHyperelasticFEM::GetEnergyAndForceAndTangentStiffnessMatrixHelperP
   and the stiffness matrix computation is based on 
   section 6 & 7 of [Teran 05].
 */
-int IsotropicHyperelasticFEM::GetEnergyAndForceAndTangentStiffnessMatrixHelperWorkhorse(int startEl, int endEl, double * u, double * energy, double * internalForces, SparseMatrix * tangentStiffnessMatrix, int computationMode)
+int IsotropicHyperelasticFEM::GetEnergyAndForceAndTangentStiffnessMatrixHelperWorkhorse(int startEl, int endEl, double * u, double * energy, double * internalForces, SparseMatrix * tangentStiffnessMatrix, int computationMode, const int * elementList)
 {
   //printf("Entering IsotropicHyperelasticFEM::GetEnergyAndForceAndTangentStiffnessMatrixHelperWorkhorse\n"); 
   //printf("inversionThreshold=%G\n", inversionThreshold);
@@ -411,8 +412,10 @@ int IsotropicHyperelasticFEM::GetEnergyAndForceAndTangentStiffnessMatrixHelperWo
   
   // traverse the elements and assemble strain energy, internal forces and tangent stiffness matrix
   int exitCode = 0;
-  for (int el=startEl; el<endEl; el++)
+  for (int elementIndex=startEl; elementIndex<endEl; elementIndex++)
   {
+    int el = (elementList != NULL) ? elementList[elementIndex] : elementIndex;
+
     /*
       Compute the deformation gradient F.
       F = Ds * inv(Dm), where Ds is a 3x3 matrix where
@@ -30,8 +30,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <pthread.h>
 #include "isotropicHyperelasticFEMMT.h"
+#include "generateElementColoring.h"
+#include "threadPool.h"
 
 IsotropicHyperelasticFEMMT::IsotropicHyperelasticFEMMT(TetMesh * tetMesh_, IsotropicMaterial * isotropicMaterial_, double principalStretchThreshold_, bool addGravity_, double g_, int numThreads_) :
   IsotropicHyperelasticFEM(tetMesh_, isotropicMaterial_, principalStretchThreshold_, addGravity_, g_),
@@ -45,153 +46,151 @@ IsotropicHyperelasticFEMMT::~IsotropicHyperelasticFEMMT()
   free(startElement);
   free(endElement);
   free(energyBuffer);
-  free(internalForceBuffer);
-  for(int i=0; i<numThreads; i++)
-    delete(tangentStiffnessMatrixBuffer[i]);
-  free(tangentStiffnessMatrixBuffer);
+  free(exitCodeBuffer);
+  free(colorStarts);
+  free(coloredElements);
+  free(colorStartElement);
+  free(colorEndElement);
 }
 
+// shared by all the tasks of one computation
 struct IsotropicHyperelasticFEMMT_threadArg
 {
   IsotropicHyperelasticFEMMT * isotropicHyperelasticFEMMT;
   double * u;
-  double * energy;
-  double * internalForces;
-  SparseMatrix *  tangentStiffnessMatrix;
+  double * energy; // one entry per thread
+  double * internalForces; // the global vector; only used when color >= 0
+  SparseMatrix * tangentStiffnessMatrix; // the global matrix; only used when color >= 0
   int computationMode;
-  int rank;
-  int exitCode;
+  int * exitCode; // one entry per thread
+  int color; // -1: process the elements of the static partition (energy only); otherwise, process the elements of the given color
 };
 
-void * IsotropicHyperelasticFEMMT_WorkerThread(void * arg)
+void IsotropicHyperelasticFEMMT_WorkerThread(void * arg, int rank)
 {
   struct IsotropicHyperelasticFEMMT_threadArg * threadArgp = (struct IsotropicHyperelasticFEMMT_threadArg*) arg;
   IsotropicHyperelasticFEMMT * isotropicHyperelasticFEMMT = threadArgp->isotropicHyperelasticFEMMT;
   double * u = threadArgp->u;
-  double * energy = threadArgp->energy;
-  double * internalForces = threadArgp->internalForces;
-  SparseMatrix * tangentStiffnessMatrix = threadArgp->tangentStiffnessMatrix;
   int computationMode = threadArgp->computationMode;
-  int rank = threadArgp->rank;
-  int startElement = isotropicHyperelasticFEMMT->GetStartElement(rank);
-  int endElement = isotropicHyperelasticFEMMT->GetEndElement(rank);
+  int color = threadArgp->color;
 
-  //printf("%d %d\n", startElement, endElement);
-  int code = isotropicHyperelasticFEMMT->GetEnergyAndForceAndTangentStiffnessMatrixHelperWorkhorse(startElement, endElement, u, energy, internalForces, tangentStiffnessMatrix, computationMode); 
-  threadArgp->exitCode = code;
+  int code;
+  if (color < 0)
+  {
+    double * energy = &threadArgp->energy[rank];
+    int startElement = isotropicHyperelasticFEMMT->GetStartElement(rank);
+    int endElement = isotropicHyperelasticFEMMT->GetEndElement(rank);
 
-  return NULL;
+    //printf("%d %d\n", startElement, endElement);
+    code = isotropicHyperelasticFEMMT->GetEnergyAndForceAndTangentStiffnessMatrixHelperWorkhorse(startElement, endElement, u, energy, NULL, NULL, computationMode); 
+  }
+  else
+  {
+    // elements of one color share no vertices: write directly into the global force vector and stiffness matrix
+    int startElement = isotropicHyperelasticFEMMT->GetStartElement(color, rank);
+    int endElement = isotropicHyperelasticFEMMT->GetEndElement(color, rank);
+    if (startElement == endElement)
+      return;
+
+    double energy = 0.0;
+    code = isotropicHyperelasticFEMMT->GetEnergyAndForceAndTangentStiffnessMatrixHelperWorkhorse(startElement, endElement, u, &energy, threadArgp->internalForces, threadArgp->tangentStiffnessMatrix, computationMode, isotropicHyperelasticFEMMT->GetColoredElements()); 
+    threadArgp->energy[rank] += energy;
+  }
+
+  if (code != 0)
+    threadArgp->exitCode[rank] = code;
 }
 
-void IsotropicHyperelasticFEMMT::Initialize()
+// splits numJobs jobs among numThreads threads, in contiguous ranges
+static void IsotropicHyperelasticFEMMT_SplitWorkload(int numJobs, int numThreads, int * start, int * end)
 {
-  energyBuffer = (double*) malloc (sizeof(double) * numThreads);
-  internalForceBuffer = (double*) malloc (sizeof(double) * numThreads * 3 * tetMesh->getNumVertices());
-
-  // generate skeleton matrices
-  tangentStiffnessMatrixBuffer = (SparseMatrix**) malloc (sizeof(SparseMatrix*) * numThreads);
-
-  SparseMatrix * sparseMatrix;
-  GetStiffnessMatrixTopology(&sparseMatrix);
-  for(int i=0; i<numThreads; i++)
-    tangentStiffnessMatrixBuffer[i] = new SparseMatrix(*sparseMatrix);
-
-  // split the workload
-  int numElements = tetMesh->getNumElements();
-  startElement = (int*) malloc (sizeof(int) * numThreads);
-  endElement = (int*) malloc (sizeof(int) * numThreads);
-
-  int remainder = numElements % numThreads;
-  // the first 'remainder' nodes will process one edge more
-  int jobSize = numElements / numThreads;
+  int remainder = numJobs % numThreads;
+  // the first 'remainder' nodes will process one element more
+  int jobSize = numJobs / numThreads;
 
   for(int rank=0; rank < numThreads; rank++)
   {
     if (rank < remainder)
     {
-      startElement[rank] = rank * (jobSize+1);
-      endElement[rank] = (rank+1) * (jobSize+1);
+      start[rank] = rank * (jobSize+1);
+      end[rank] = (rank+1) * (jobSize+1);
     }
     else
     {
-      startElement[rank] = remainder * (jobSize+1) + (rank-remainder) * jobSize;
-      endElement[rank] = remainder * (jobSize+1) + ((rank-remainder)+1) * jobSize;
+      start[rank] = remainder * (jobSize+1) + (rank-remainder) * jobSize;
+      end[rank] = remainder * (jobSize+1) + ((rank-remainder)+1) * jobSize;
     }
   }
+}
+
+void IsotropicHyperelasticFEMMT::Initialize()
+{
+  energyBuffer = (double*) malloc (sizeof(double) * numThreads);
+  exitCodeBuffer = (int*) malloc (sizeof(int) * numThreads);
+
+  // split the workload
+  int numElements = tetMesh->getNumElements();
+  startElement = (int*) malloc (sizeof(int) * numThreads);
+  endElement = (int*) malloc (sizeof(int) * numThreads);
+  IsotropicHyperelasticFEMMT_SplitWorkload(numElements, numThreads, startElement, endElement);
+
+  // color the elements (for the internal forces and the stiffness matrix), and split the workload of each color
+  numColors = GenerateElementColoring::Generate(tetMesh, &colorStarts, &coloredElements);
+  GenerateElementColoring::PartitionColors(numColors, colorStarts, numThreads, &colorStartElement, &colorEndElement);
 
   printf("Total elements: %d \n", numElements);
   printf("Num threads: %d \n", numThreads);
-  printf("Canonical job size: %d \n", jobSize);
-  printf("Num threads with job size augmented by one edge: %d \n", remainder);
+  printf("Canonical job size: %d \n", numElements / numThreads);
+  printf("Num threads with job size augmented by one edge: %d \n", numElements % numThreads);
 }
 
 int IsotropicHyperelasticFEMMT::GetEnergyAndForceAndTangentStiffnessMatrixHelper(double * u, double * energy, double * internalForces, SparseMatrix * tangentStiffnessMatrix, int computationMode)
 {
   GetEnergyAndForceAndTangentStiffnessMatrixHelperPrologue(u, energy, internalForces, tangentStiffnessMatrix, computationMode);
 
-  // launch threads
-  struct IsotropicHyperelasticFEMMT_threadArg * threadArgv = (struct IsotropicHyperelasticFEMMT_threadArg*) malloc (sizeof(struct IsotropicHyperelasticFEMMT_threadArg) * numThreads);
-
-  pthread_t * tid = (pthread_t*) malloc (sizeof(pthread_t) * numThreads);
-
-  int numVertices3 = 3 * tetMesh->getNumVertices();
-  for(int i=0; i<numThreads; i++)
-  {
-    threadArgv[i].isotropicHyperelasticFEMMT = this;
-    threadArgv[i].u = u;
-    threadArgv[i].energy = &energyBuffer[i];
-    threadArgv[i].internalForces = &internalForceBuffer[i * numVertices3];
-    threadArgv[i].tangentStiffnessMatrix = tangentStiffnessMatrixBuffer[i];
-    threadArgv[i].computationMode = computationMode;
-    threadArgv[i].rank = i;
-  }
+  // run the tasks on the persistent thread pool
+  struct IsotropicHyperelasticFEMMT_threadArg threadArg;
+  threadArg.isotropicHyperelasticFEMMT = this;
+  threadArg.u = u;
+  threadArg.energy = energyBuffer;
+  threadArg.computationMode = computationMode;
+  threadArg.exitCode = exitCodeBuffer;
 
   // clear internal buffers
   memset(energyBuffer, 0, sizeof(double) * numThreads);
-  memset(internalForceBuffer, 0, sizeof(double) * numThreads * numVertices3);
-  for(int i=0; i<numThreads; i++)  
-    tangentStiffnessMatrixBuffer[i]->ResetToZero();
+  memset(exitCodeBuffer, 0, sizeof(int) * numThreads);
 
-  for(int i=0; i<numThreads; i++)  
+  if (computationMode & (COMPUTE_INTERNALFORCES | COMPUTE_TANGENTSTIFFNESSMATRIX))
   {
-    if (pthread_create(&tid[i], NULL, IsotropicHyperelasticFEMMT_WorkerThread, &threadArgv[i]) != 0)
+    // assemble directly into the global force vector and stiffness matrix, one color at a time
+    threadArg.internalForces = internalForces;
+    threadArg.tangentStiffnessMatrix = tangentStiffnessMatrix;
+    for(int color=0; color<numColors; color++)
     {
-      printf("Error: unable to launch thread %d.\n", i);
-      return 1;
+      threadArg.color = color;
+      ThreadPool::GetGlobalThreadPool()->Execute(numThreads, IsotropicHyperelasticFEMMT_WorkerThread, &threadArg);
     }
   }
+  else
+  {
+    // energy only
+    threadArg.internalForces = NULL;
+    threadArg.tangentStiffnessMatrix = NULL;
+    threadArg.color = -1;
+    ThreadPool::GetGlobalThreadPool()->Execute(numThreads, IsotropicHyperelasticFEMMT_WorkerThread, &threadArg);
+  }
 
   int code = 0;
   for(int i=0; i<numThreads; i++)
   {
-    if (pthread_join(tid[i], NULL) != 0)
-    {
-      printf("Error: unable to join thread %d.\n", i);
-      exit(1);
-    }
-    if (threadArgv[i].exitCode != 0)
+    if (exitCodeBuffer[i] != 0)
       code = 1;
   }
 
-  free(threadArgv);
-  free(tid);
-
-  for(int i=0; i<numThreads; i++)
+  if (computationMode & COMPUTE_ENERGY)
   {
-    if (computationMode & COMPUTE_ENERGY)
+    for(int i=0; i<numThreads; i++)
       *energy += energyBuffer[i];
-
-    if (computationMode & COMPUTE_INTERNALFORCES)
-    {
-      double * source = &internalForceBuffer[i * numVertices3];
-      for(int j=0; j<numVertices3; j++)
-        internalForces[j] += source[j];
-    }
-
-    if (computationMode & COMPUTE_TANGENTSTIFFNESSMATRIX)
-    {
-      *tangentStiffnessMatrix += *(tangentStiffnessMatrixBuffer[i]);
-    }
   }
 
   return code;
@@ -207,3 +206,12 @@ int IsotropicHyperelasticFEMMT::GetEndElement(int rank)
   return endElement[rank];
 }
 
+int IsotropicHyperelasticFEMMT::GetStartElement(int color, int rank)
+{
+  return colorStartElement[color * numThreads + rank];
+}
+
+int IsotropicHyperelasticFEMMT::GetEndElement(int color, int rank)
+{
+  return colorEndElement[color * numThreads + rank];
+}
@@ -33,9 +33,12 @@
 
 /*
   This class is a multi-threaded version of the class "IsotropicHyperelasticFEM".
-  It uses POSIX threads ("pthreads") as the threading API.
-  Each thread assembles the internal force with respect to a subset of all the mesh elements. 
-  At the end, the individual results are added into a global internal force vector.
+  It uses POSIX threads ("pthreads") as the threading API, via the process-wide thread pool (see threadPool.h).
+  If the internal forces and/or the tangent stiffness matrix are requested, the mesh elements are processed by colors,
+  such that no two elements of the same color share a vertex (see generateElementColoring.h). Within each color,
+  each thread assembles the internal forces and the stiffness matrix of a subset of the color's elements directly
+  into the global force vector and the global stiffness matrix (no per-thread force or matrix copies are needed).
+  If only the energy is requested, each thread processes a contiguous subset of all the mesh elements.
 
   See also "isotropicHyperelasticFEM.h".
 */
@@ -55,12 +58,24 @@ public:
   int GetStartElement(int rank);
   int GetEndElement(int rank);
 
+  // the element coloring used for the stiffness matrix assembly
+  inline int GetNumColors() { return numColors; }
+  inline const int * GetColoredElements() { return coloredElements; } // all elements, sorted by color
+  // the elements processed by thread "rank" during color "color" are
+  // GetColoredElements()[GetStartElement(color, rank)], ..., GetColoredElements()[GetEndElement(color, rank)-1]
+  int GetStartElement(int color, int rank);
+  int GetEndElement(int color, int rank);
+
 protected:
   int numThreads;
   int * startElement, * endElement;
   double * energyBuffer;
-  double * internalForceBuffer;
-  SparseMatrix ** tangentStiffnessMatrixBuffer;
+  int * exitCodeBuffer;
+
+  int numColors;
+  int * colorStarts;
+  int * coloredElements;
+  int * colorStartElement, * colorEndElement; // numColors x numThreads
 
   void Initialize();
 };
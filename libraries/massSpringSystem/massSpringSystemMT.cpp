@@ -31,11 +31,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <pthread.h>
 #include <vector>
 #include <set>
 #include "macros.h"
 #include "massSpringSystemMT.h"
+#include "threadPool.h"
 using namespace std;
 
 //#include "performanceCounter.h"
@@ -70,22 +70,22 @@ MassSpringSystemMT::~MassSpringSystemMT()
   free(sparseMatrixBuffer);
 }
 
+// shared by all the tasks of one computation
 struct MassSpringSystemMT_threadArg
 {
   MassSpringSystemMT * massSpringSystemMT;
   double * u;
   double * uSecondary;
-  void * targetBuffer;
-  int rank;
+  double * forceBuffer; // per-thread sub-buffers of length 3 * numParticles
+  SparseMatrix ** matrixBuffer; // one matrix per thread
   enum MassSpringSystemMT_computationTargetType computationTarget;
 };
 
-void * MassSpringSystemMT_WorkerThread(void * arg)
+void MassSpringSystemMT_WorkerThread(void * arg, int rank)
 {
   struct MassSpringSystemMT_threadArg * threadArgp = (struct MassSpringSystemMT_threadArg*) arg;
   MassSpringSystemMT * massSpringSystemMT = threadArgp->massSpringSystemMT;
   double * u = threadArgp->u;
-  int rank = threadArgp->rank;
   int startEdge = massSpringSystemMT->GetStartEdge(rank);
   int endEdge = massSpringSystemMT->GetEndEdge(rank);
 
@@ -93,7 +93,7 @@ void * MassSpringSystemMT_WorkerThread(void * arg)
   {
     case FORCE: 
     {
-      double * targetBuffer = (double*)(threadArgp->targetBuffer);
+      double * targetBuffer = &threadArgp->forceBuffer[rank * 3 * massSpringSystemMT->GetNumParticles()];
       massSpringSystemMT->AddForce(u, targetBuffer, startEdge, endEdge);
     }
     break;
@@ -101,21 +101,21 @@ void * MassSpringSystemMT_WorkerThread(void * arg)
     case DAMPINGFORCE:
     {
       double * uvel = u;
-      double * targetBuffer = (double*)(threadArgp->targetBuffer);
+      double * targetBuffer = &threadArgp->forceBuffer[rank * 3 * massSpringSystemMT->GetNumParticles()];
       massSpringSystemMT->AddDampingForce(uvel, targetBuffer, startEdge, endEdge);
     }
     break;
 
     case STIFFNESSMATRIX:
     {
-      SparseMatrix * targetBuffer = (SparseMatrix*)(threadArgp->targetBuffer);
+      SparseMatrix * targetBuffer = threadArgp->matrixBuffer[rank];
       massSpringSystemMT->AddStiffnessMatrix(u, targetBuffer, startEdge, endEdge);
     }
     break;
 
     case HESSIANAPPROXIMATION:
     {
-      SparseMatrix * targetBuffer = (SparseMatrix*)(threadArgp->targetBuffer);
+      SparseMatrix * targetBuffer = threadArgp->matrixBuffer[rank];
       double * uSecondary = threadArgp->uSecondary;
       massSpringSystemMT->AddHessianApproximation(u, uSecondary, targetBuffer, startEdge, endEdge);
     }
@@ -126,8 +126,6 @@ void * MassSpringSystemMT_WorkerThread(void * arg)
       exit(1);
     break;
   }
-
-  return NULL;
 }
 
 void MassSpringSystemMT::Initialize()
@@ -173,27 +171,21 @@ void MassSpringSystemMT::Initialize()
 
 void MassSpringSystemMT::ComputeHelper(enum MassSpringSystemMT_computationTargetType computationTarget, double * u, double * uSecondary, void * target, bool addQuantity)
 {
-  // launch threads
+  // run the tasks on the persistent thread pool
   int numParticles3 = 3*numParticles;
-  struct MassSpringSystemMT_threadArg * threadArgv = (struct MassSpringSystemMT_threadArg*) malloc (sizeof(struct MassSpringSystemMT_threadArg) * numThreads);
-
-  pthread_t * tid = (pthread_t*) malloc (sizeof(pthread_t) * numThreads);
-
-  for(int i=0; i<numThreads; i++)
-  {
-    threadArgv[i].massSpringSystemMT = this;
-    threadArgv[i].u = u;
-    threadArgv[i].rank = i;
-    threadArgv[i].computationTarget = computationTarget;
-  }
+  struct MassSpringSystemMT_threadArg threadArg;
+  threadArg.massSpringSystemMT = this;
+  threadArg.u = u;
+  threadArg.uSecondary = uSecondary;
+  threadArg.forceBuffer = internalForceBuffer;
+  threadArg.matrixBuffer = sparseMatrixBuffer;
+  threadArg.computationTarget = computationTarget;
 
   switch(computationTarget)
   {
     case FORCE:
     case DAMPINGFORCE:
     {
-      for(int i=0; i<numThreads; i++)
-        threadArgv[i].targetBuffer = (void*)(&internalForceBuffer[i * numParticles3]);
       memset(internalForceBuffer, 0, sizeof(double) * numParticles3 * numThreads);
     }
     break;
@@ -202,10 +194,7 @@ void MassSpringSystemMT::ComputeHelper(enum MassSpringSystemMT_computationTarget
     case HESSIANAPPROXIMATION:
     {
       for(int i=0; i<numThreads; i++)
-      {
-        threadArgv[i].targetBuffer = (void*)(sparseMatrixBuffer[i]);
         sparseMatrixBuffer[i]->ResetToZero();
-      }
     }
     break;
 
@@ -215,26 +204,7 @@ void MassSpringSystemMT::ComputeHelper(enum MassSpringSystemMT_computationTarget
     break;
   }
   
-  for(int i=0; i<numThreads; i++)  
-  {
-    if (pthread_create(&tid[i], NULL, MassSpringSystemMT_WorkerThread, &threadArgv[i]) != 0)
-    {
-      printf("Error: unable to launch thread %d.\n", i);
-      exit(1);
-    }
-  }
-
-  for(int i=0; i<numThreads; i++)
-  {
-    if (pthread_join(tid[i], NULL) != 0)
-    {
-      printf("Error: unable to join thread %d.\n", i);
-      exit(1);
-    }
-  }
-
-  free(threadArgv);
-  free(tid);
+  ThreadPool::GetGlobalThreadPool()->Execute(numThreads, MassSpringSystemMT_WorkerThread, &threadArg);
 
   // assemble results
   switch(computationTarget)
@@ -34,7 +34,7 @@
 
 /*
    Multi-threaded version of the MassSpringSystem class. 
-   It uses the POSIX threads ("pthreads").
+   It uses the POSIX threads ("pthreads"), via the process-wide thread pool (see threadPool.h).
    See also massSpringSystem.h
 */
 
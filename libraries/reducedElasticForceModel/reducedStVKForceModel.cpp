@@ -32,17 +32,14 @@
 ReducedStVKForceModel::ReducedStVKForceModel(StVKReducedInternalForces * stVKReducedInternalForces_, StVKReducedStiffnessMatrix * stVKStiffnessMatrix_): stVKReducedInternalForces(stVKReducedInternalForces_), stVKStiffnessMatrix(stVKStiffnessMatrix_), own_stVKStiffnessMatrix(false)
 {
   r = stVKReducedInternalForces->Getr();
-  if (stVKStiffnessMatrix == NULL)
-  {
-    own_stVKStiffnessMatrix = true;
-    stVKStiffnessMatrix = new StVKReducedStiffnessMatrix(stVKReducedInternalForces);
-  }
+  internalForceBuffer = (double*) malloc (sizeof(double) * r);
 }
 
 ReducedStVKForceModel::~ReducedStVKForceModel()
 {
   if (own_stVKStiffnessMatrix)
-    free(stVKStiffnessMatrix);
+    delete(stVKStiffnessMatrix);
+  free(internalForceBuffer);
 }
 
 void ReducedStVKForceModel::GetInternalForce(double * q, double * internalForces)
@@ -52,6 +49,20 @@ void ReducedStVKForceModel::GetInternalForce(double * q, double * internalForces
 
 void ReducedStVKForceModel::GetTangentStiffnessMatrix(double * q, double * tangentStiffnessMatrix)
 {
-  stVKStiffnessMatrix->Evaluate(q,tangentStiffnessMatrix);
+  if (stVKStiffnessMatrix != NULL)
+    stVKStiffnessMatrix->Evaluate(q,tangentStiffnessMatrix);
+  else
+    stVKReducedInternalForces->EvaluateForceAndMatrix(q,internalForceBuffer,tangentStiffnessMatrix);
+}
+
+void ReducedStVKForceModel::GetForceAndMatrix(double * q, double * internalForces, double * tangentStiffnessMatrix)
+{
+  if (stVKStiffnessMatrix != NULL)
+  {
+    stVKReducedInternalForces->Evaluate(q,internalForces);
+    stVKStiffnessMatrix->Evaluate(q,tangentStiffnessMatrix);
+  }
+  else
+    stVKReducedInternalForces->EvaluateForceAndMatrix(q,internalForces,tangentStiffnessMatrix);
 }
 
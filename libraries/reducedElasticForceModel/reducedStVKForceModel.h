@@ -44,16 +44,17 @@ class ReducedStVKForceModel : public virtual ReducedForceModel
 {
 public:
   
-  // if you pass NULL for the stiffness matrix, the class will internally 
-  // build it from the cubic polynomial; this is the most convenient option
-  // (ability to pass stVKStiffnessMatrix was provided to save some 
-  //  precomputation time; however, generating the matrix from the cubic 
-  //  polynomial is actually very fast, so the speed-up is marginal)
+  // if you pass NULL for the stiffness matrix (default), the tangent stiffness matrix
+  // is evaluated directly from the cubic polynomial (see StVKReducedInternalForces::EvaluateForceAndMatrix);
+  // no stiffness matrix polynomial is precomputed or stored, so the model is ready immediately
+  // if you pass a stiffness matrix, it is used to evaluate the tangent stiffness matrix
+  // (for small r, this is somewhat faster, at the cost of the precomputation and of the memory)
   ReducedStVKForceModel(StVKReducedInternalForces * stVKReducedInternalForces, 
                     StVKReducedStiffnessMatrix * stVKStiffnessMatrix = NULL);
   virtual ~ReducedStVKForceModel();
   virtual void GetInternalForce(double * q, double * internalForces); 
   virtual void GetTangentStiffnessMatrix(double * q, double * tangentStiffnessMatrix);
+  virtual void GetForceAndMatrix(double * q, double * internalForces, double * tangentStiffnessMatrix); 
 
   virtual void * GetReducedInternalForceClass() { return (void*)stVKReducedInternalForces; }
   virtual void * GetReducedStiffnessMatrixClass() { return (void*)stVKStiffnessMatrix; }
@@ -63,6 +64,7 @@ protected:
   StVKReducedStiffnessMatrix * stVKStiffnessMatrix;
 
   bool own_stVKStiffnessMatrix;
+  double * internalForceBuffer; // used by GetTangentStiffnessMatrix if there is no stiffness matrix polynomial
 };
 
 #endif
@@ -31,6 +31,9 @@
 
 ReducedStVKForceModelWithHessian::ReducedStVKForceModelWithHessian(StVKReducedInternalForces * stVKReducedInternalForces): ReducedStVKForceModel(stVKReducedInternalForces), ReducedForceModelWithHessian()
 {
+  // the Hessian tensor is built from the stiffness matrix polynomial
+  stVKStiffnessMatrix = new StVKReducedStiffnessMatrix(stVKReducedInternalForces);
+  own_stVKStiffnessMatrix = true;
   stVKReducedHessianTensor = new StVKReducedHessianTensor(stVKStiffnessMatrix);
 }
 
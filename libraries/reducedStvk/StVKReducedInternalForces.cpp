@@ -102,6 +102,12 @@ int StVKReducedInternalForces::LoadFromStream(FILE * fin, int rTarget, int bigEn
     r = buffer;
   }
 
+  if (r < 0)
+  {
+    printf("Error: the input cubic polynomial file is in the compressed format (load it with StVKReducedInternalForcesCompressed).\n");
+    throw 1;
+  }
+
   if (rTarget > r)
   {
     printf("Error: the input cubic polynomial file has r=%d, but you requested %d > %d.\n", r, rTarget, r);
@@ -764,6 +770,13 @@ int StVKReducedInternalForces::GetrFromFile(const char * filename)
     return -1;
   }
 
+  // compressed polynomial files (see StVKReducedInternalForcesCompressed.h) start with a negative tag, followed by r
+  if ((r < 0) && ((int)(fread(&r,sizeof(int),1,fin)) < 1))
+  {
+    printf("Error: couldn't read from input cubic polynomial file.\n");
+    return -1;
+  }
+
   fclose(fin);
 
   return r;
@@ -904,6 +917,246 @@ void StVKReducedInternalForces::Evaluate(double * q, double * fq)
   }
 }
 
+// number of configurations processed together by EvaluateBatch (bounds the size of the monomial buffers)
+#define STVKREDUCEDINTERNALFORCES_BATCH_BLOCK 64
+
+void StVKReducedInternalForces::EvaluateBatch(int numQ, double * Q, double * FQ)
+{
+  if (useSingleThread)
+  {
+    #if defined(WIN32) || defined(linux)
+      mkl_max_threads = mkl_get_max_threads();
+      mkl_dynamic = mkl_get_dynamic();
+      mkl_set_num_threads(1);
+      mkl_set_dynamic(0);
+    #elif defined(__APPLE__)
+      //setenv("VECLIB_MAXIMUM_THREADS", "1", true);
+    #endif
+  }
+
+  int blockSize = (numQ < STVKREDUCEDINTERNALFORCES_BATCH_BLOCK) ? numQ : STVKREDUCEDINTERNALFORCES_BATCH_BLOCK;
+  // the buffers are local, so that EvaluateBatch can be called in parallel on shallow clones
+  double * QQ = (double*) malloc (sizeof(double) * quadraticSize * blockSize); // quadraticSize x blockSize
+  double * QQQ = (double*) malloc (sizeof(double) * cubicSize * blockSize); // cubicSize x blockSize
+
+  for(int blockStart=0; blockStart<numQ; blockStart+=blockSize)
+  {
+    int numColumns = (numQ - blockStart < blockSize) ? numQ - blockStart : blockSize;
+    double * Qblock = Q + (size_t)r * blockStart;
+    double * FQblock = FQ + (size_t)r * blockStart;
+
+    // build the monomials, one column per configuration
+    // (in the order of the coefficients: q_i q_j for i <= j; q_i q_j q_k for i <= j <= k)
+    for(int column=0; column<numColumns; column++)
+    {
+      double * q = Qblock + r * column;
+      double * qiqjColumn = QQ + quadraticSize * column;
+      int index = 0;
+      for(int output=0; output<r; output++)
+        for(int i=output; i<r; i++)
+        {
+          qiqjColumn[index] = q[output] * q[i];
+          index++;
+        }
+
+      double * qiqjqkColumn = QQQ + cubicSize * column;
+      int size = quadraticSize;
+      double * qiqjPos = qiqjColumn;
+      for(int i=0; i<r; i++)
+      {
+        for(int j=0; j<size; j++)
+          qiqjqkColumn[j] = q[i] * qiqjPos[j];
+        qiqjqkColumn += size;
+
+        int param = r-i;
+        size -= param;
+        qiqjPos += param;
+      }
+    }
+
+    // linear terms: linearCoef_ is an r x r matrix (each column gives the coefficients of one force component)
+    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans,
+         r, numColumns, r,
+         1.0,
+         linearCoef_, r,
+         Qblock, r,
+         0.0,
+         FQblock, r);
+
+    // quadratic terms: quadraticCoef_ is a quadraticSize x r matrix
+    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans,
+         r, numColumns, quadraticSize,
+         1.0,
+         quadraticCoef_, quadraticSize,
+         QQ, quadraticSize,
+         1.0,
+         FQblock, r);
+
+    // cubic terms: cubicCoef_ is a cubicSize x r matrix
+    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans,
+         r, numColumns, cubicSize,
+         1.0,
+         cubicCoef_, cubicSize,
+         QQQ, cubicSize,
+         1.0,
+         FQblock, r);
+
+    if (addGravity)
+    {
+      for(int column=0; column<numColumns; column++)
+        for(int i=0; i<r; i++)
+          FQblock[r * column + i] -= reducedGravityForce[i];
+    }
+  }
+
+  free(QQQ);
+  free(QQ);
+
+  if (useSingleThread)
+  {
+    #if defined(WIN32) || defined(linux)
+      mkl_set_num_threads(mkl_max_threads);
+      mkl_set_dynamic(mkl_dynamic);
+    #elif defined(__APPLE__)
+      //unsetenv("VECLIB_MAXIMUM_THREADS");
+    #endif
+  }
+}
+
+void StVKReducedInternalForces::EvaluateForceAndMatrix(double * q, double * fq, double * Kq)
+{
+  /*
+    The cubic terms are grouped by their first (smallest) index i:
+      f_cubic(q) = sum_i q_i C_i^T qiqj_i,
+    where C_i holds the coefficients of the monomials q_i q_j q_k, i <= j <= k, and qiqj_i is the tail of qiqj starting at q_i q_i.
+    Differentiating with respect to q_s gives two kinds of terms:
+    1. s = i: column s of K receives v_s = C_s^T qiqj_s (the same quantity as in Evaluate, without the factor q_s)
+    2. s = j or s = k: these are the derivatives of the quadratic polynomial with coefficients q_i C_i, with q_i held constant
+    Therefore, we form the "effective" quadratic coefficients W = quadraticCoef_ + sum_i q_i C_i (C_i is aligned with the tail of qiqj),
+    in the same pass over the cubic coefficients as the vectors v_i. Then,
+      fq = linear terms + W^T qiqj,  
+      Kq = linear coefficients + [v_0 ... v_{r-1}] + derivative of (W^T qiqj) with W held constant.
+    The pass over the cubic coefficients costs about twice an Evaluate; the rest is O(r^3).
+  */
+
+  if (useSingleThread)
+  {
+    #if defined(WIN32) || defined(linux)
+      mkl_max_threads = mkl_get_max_threads();
+      mkl_dynamic = mkl_get_dynamic();
+      mkl_set_num_threads(1);
+      mkl_set_dynamic(0);
+    #elif defined(__APPLE__)
+      //setenv("VECLIB_MAXIMUM_THREADS", "1", true);
+    #endif
+  }
+
+  if (forceAndMatrixBuffer == NULL)
+    forceAndMatrixBuffer = (double*) malloc (sizeof(double) * (r * quadraticSize + r * r));
+  double * W = forceAndMatrixBuffer; // quadraticSize x r matrix, same layout as quadraticCoef_
+  double * V = forceAndMatrixBuffer + r * quadraticSize; // r x r matrix, column i is v_i
+
+  // compute qiqj
+  int index = 0;
+  for(int output=0; output<r; output++)
+    for(int i=output; i<r; i++)
+    {
+      qiqj[index] = q[output] * q[i];
+      index++;
+    }
+
+  // one pass over the cubic coefficients: W = quadraticCoef_ + sum_i q_i C_i, and V
+  memcpy(W, quadraticCoef_, sizeof(double) * r * quadraticSize);
+  int size = quadraticSize;
+  int offset = 0;
+  double * cubicCoefPos = cubicCoef_;
+  for(int i=0; i<r; i++)
+  {
+    // v_i = C_i^T qiqj_i 
+    cblas_dgemv(CblasColMajor, CblasTrans,
+        size, r,
+        1.0,
+        cubicCoefPos, cubicSize,
+        qiqj + offset, 1,
+        0.0,
+        V + r * i, 1);
+
+    // W += q_i C_i (C_i is still in cache)
+    for(int output=0; output<r; output++)
+      cblas_daxpy(size, q[i], cubicCoefPos + (size_t)cubicSize * output, 1, W + quadraticSize * output + offset, 1);
+
+    int param = r-i;
+    size -= param;
+    offset += param;
+    cubicCoefPos += param * (param+1) / 2;
+  }
+
+  // forces: linear terms, and W^T qiqj (which contains the quadratic and cubic terms)
+  cblas_dgemv(CblasColMajor, CblasTrans,
+       r, r,
+       1.0,
+       linearCoef_, r,
+       q, 1,
+       0.0,
+       fq, 1);
+
+  cblas_dgemv(CblasColMajor, CblasTrans,
+       quadraticSize, r,
+       1.0,
+       W, quadraticSize,
+       qiqj, 1,
+       1.0,
+       fq, 1);
+
+  if (addGravity)
+  {
+    for(int i=0; i<r; i++)
+      fq[i] -= reducedGravityForce[i];
+  }
+
+  // stiffness matrix: row "output" of the Jacobian is assembled into column "output" of Kq, and then Kq is symmetrized
+  for(int output=0; output<r; output++)
+  {
+    double * KColumn = Kq + r * output;
+    for(int s=0; s<r; s++)
+      KColumn[s] = linearCoef_[linearCoefPos(output, s)] + V[ELT(r,output,s)];
+
+    // derivative of sum_{a <= b} W_ab q_a q_b
+    double * WColumn = W + quadraticSize * output;
+    index = 0;
+    for(int a=0; a<r; a++)
+    {
+      double qa = q[a];
+      double derivative = 0.0;
+      for(int b=a; b<r; b++)
+      {
+        derivative += WColumn[index] * q[b];
+        KColumn[b] += WColumn[index] * qa;
+        index++;
+      }
+      KColumn[a] += derivative;
+    }
+  }
+
+  for(int i=0; i<r; i++)
+    for(int j=i+1; j<r; j++)
+    {
+      double value = 0.5 * (Kq[ELT(r,i,j)] + Kq[ELT(r,j,i)]);
+      Kq[ELT(r,i,j)] = value;
+      Kq[ELT(r,j,i)] = value;
+    }
+
+  if (useSingleThread)
+  {
+    #if defined(WIN32) || defined(linux)
+      mkl_set_num_threads(mkl_max_threads);
+      mkl_set_dynamic(mkl_dynamic);
+    #elif defined(__APPLE__)
+      //unsetenv("VECLIB_MAXIMUM_THREADS");
+    #endif
+  }
+}
+
 double StVKReducedInternalForces::EvaluateComponent(double * q, int componentIndex)
 {
   // add linear terms
@@ -1281,11 +1534,13 @@ void StVKReducedInternalForces::UseSingleThread(int useSingleThread_)
 void StVKReducedInternalForces::InitBuffers()
 {
   qiqj = (double*) malloc (sizeof(double) * quadraticSize);
+  forceAndMatrixBuffer = NULL;
 }
 
 void StVKReducedInternalForces::FreeBuffers()
 {
   free(qiqj);
+  free(forceAndMatrixBuffer);
 }
 
 void StVKReducedInternalForces::Scale(double scalingFactor)
@@ -78,11 +78,26 @@ public:
   double EvaluateComponent(double * q, int componentIndex); // evaluates just one force component (a scalar)
   void EvaluateLinear(double * q, double * fq); // evaluates just the linear terms (constant terms are zero in all polynomials as reduced internal force is zero at the origin)
 
+  // evaluates the reduced internal forces for numQ configurations at once
+  // Q is an r x numQ matrix (column-major; column s is the s-th configuration), FQ is the r x numQ output matrix (must be pre-allocated)
+  // the monomials q_i q_j and q_i q_j q_k of (a block of) the configurations are formed explicitly, so that the linear, quadratic and cubic terms
+  // are each evaluated with one matrix-matrix multiplication (BLAS Level 3) per block; much faster than calling Evaluate numQ times
+  // the result equals Evaluate of each column, up to round-off
+  void EvaluateBatch(int numQ, double * Q, double * FQ);
+
+  // evaluates the reduced internal forces fq (length r) and the reduced tangent stiffness matrix Kq (r x r, all entries) at q, in one pass over the coefficients
+  // the stiffness matrix is the derivative of the cubic polynomial, computed directly from the force coefficients; 
+  // no StVKReducedStiffnessMatrix (and no precomputation) is needed; the result equals Evaluate and StVKReducedStiffnessMatrix::Evaluate up to round-off
+  // the cubic terms are contracted with q into an "effective" quadratic polynomial, whose coefficients are then differentiated (see the .cpp file)
+  void EvaluateForceAndMatrix(double * q, double * fq, double * Kq);
+
   // enables or disables the gravity (note: you can also set this in the constructor; use this routine to turn the gravity on/off during the simulation)
   void SetGravity(bool addGravity, double g, VolumetricMesh * volumetricMesh_=NULL, double * U_=NULL) { this->addGravity = addGravity; this->g=g; InitGravity(volumetricMesh_, U_); } // if AddGravity is enabled, Evaluate will subtract the gravity force from the reduced internal forces (note: subtraction, not addition, is used; see the comment in StVKInternalForces.h, which also applies here) 
 
+  inline bool GetAddGravity() { return addGravity; }
+
   inline int Getr() { return r; }
-  // report r from the given polynomial binary file 
+  // report r from the given polynomial binary file (dense or compressed; see StVKReducedInternalForcesCompressed.h)
   static int GetrFromFile(const char * filename);
 
   void Scale(double scalingFactor); // scales all coefficients with the given scaling factor; i.e., linearly and uniformly scale the stiffness of the model; frequency spectrum will scale linearly by sqrt(scalingFactor)
@@ -233,6 +248,7 @@ protected:
   // acceleration data
   //double * qij;
   double * qiqj;
+  double * forceAndMatrixBuffer; // allocated on the first call to EvaluateForceAndMatrix
   void InitBuffers();
   void FreeBuffers();
 
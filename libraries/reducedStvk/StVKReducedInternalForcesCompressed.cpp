@@ -0,0 +1,499 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "reducedStvk" library , Copyright (C) 2007 CMU, 2009 MIT              *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "lapack-headers.h"
+#include "StVKReducedInternalForcesCompressed.h"
+
+StVKReducedInternalForcesCompressed::StVKReducedInternalForcesCompressed(StVKReducedInternalForces * stVKReducedInternalForces, double relativeThreshold_, int singlePrecision_, int verbose_): singlePrecision(singlePrecision_), relativeThreshold(relativeThreshold_), verbose(verbose_)
+{
+  r = stVKReducedInternalForces->Getr();
+  if (r > 65536)
+  {
+    printf("Error: StVKReducedInternalForcesCompressed: r=%d is too large (the maximum is 65536).\n", r);
+    throw 1;
+  }
+
+  if (stVKReducedInternalForces->GetAddGravity())
+    printf("Warning: StVKReducedInternalForcesCompressed: the source polynomial has gravity enabled, but the compressed polynomial does not support gravity. The gravity force will not be included in the compressed internal forces.\n");
+
+  linearSize = StVKReducedInternalForces::GetLinearSize(r);
+  quadraticSize = StVKReducedInternalForces::GetQuadraticSize(r);
+  cubicSize = StVKReducedInternalForces::GetCubicSize(r);
+
+  linearCoef_ = (double*) malloc (sizeof(double) * r * linearSize);
+  memcpy(linearCoef_, stVKReducedInternalForces->GetLinearTermsBuffer(), sizeof(double) * r * linearSize);
+  quadraticCoef_ = (double*) malloc (sizeof(double) * r * quadraticSize);
+  memcpy(quadraticCoef_, stVKReducedInternalForces->GetQuadraticTermsBuffer(), sizeof(double) * r * quadraticSize);
+
+  // dense cubic terms: cubicSize x r matrix, each column gives the coefficients of one force component
+  double * cubicCoef_ = stVKReducedInternalForces->GetCubicTermsBuffer();
+
+  // the dropping threshold of each force component
+  double * componentThreshold = (double*) malloc (sizeof(double) * r);
+  for(int output=0; output<r; output++)
+  {
+    double maxAbs = 0.0;
+    double * column = cubicCoef_ + (size_t)cubicSize * output;
+    for(int i=0; i<cubicSize; i++)
+      if (fabs(column[i]) > maxAbs)
+        maxAbs = fabs(column[i]);
+    componentThreshold[output] = relativeThreshold * maxAbs;
+  }
+
+  // count the retained coefficients of each monomial
+  cubicRowStart = (int*) malloc (sizeof(int) * (cubicSize + 1));
+  numCubicEntries = 0;
+  for(int monomial=0; monomial<cubicSize; monomial++)
+  {
+    cubicRowStart[monomial] = numCubicEntries;
+    for(int output=0; output<r; output++)
+    {
+      double value = cubicCoef_[(size_t)cubicSize * output + monomial];
+      if ((value != 0.0) && (fabs(value) > componentThreshold[output]))
+        numCubicEntries++;
+    }
+  }
+  cubicRowStart[cubicSize] = numCubicEntries;
+
+  // fill the compressed rows
+  BuildIndexStart();
+  cubicComponentIndex = (unsigned short*) malloc (sizeof(unsigned short) * numCubicIndices);
+  cubicValuesFloat = NULL;
+  cubicValuesDouble = NULL;
+  if (singlePrecision)
+    cubicValuesFloat = (float*) malloc (sizeof(float) * numCubicEntries);
+  else
+    cubicValuesDouble = (double*) malloc (sizeof(double) * numCubicEntries);
+
+  int entry = 0;
+  int indexEntry = 0;
+  for(int monomial=0; monomial<cubicSize; monomial++)
+  {
+    bool denseRow = (cubicRowStart[monomial+1] - cubicRowStart[monomial] == r);
+    for(int output=0; output<r; output++)
+    {
+      double value = cubicCoef_[(size_t)cubicSize * output + monomial];
+      if ((value != 0.0) && (fabs(value) > componentThreshold[output]))
+      {
+        if (!denseRow)
+        {
+          cubicComponentIndex[indexEntry] = (unsigned short) output;
+          indexEntry++;
+        }
+        if (singlePrecision)
+          cubicValuesFloat[entry] = (float) value;
+        else
+          cubicValuesDouble[entry] = value;
+        entry++;
+      }
+    }
+  }
+
+  free(componentThreshold);
+
+  InitBuffers();
+
+  if (verbose >= 1)
+    printf("Compressed the cubic coefficients: r=%d, retained %d out of %d coefficients (%.1f%%), %s precision, %.2f Mb (dense: %.2f Mb).\n", 
+      r, numCubicEntries, r * cubicSize, (r * cubicSize > 0) ? 100.0 * numCubicEntries / (r * cubicSize) : 0.0, 
+      singlePrecision ? "single" : "double", 1.0 * GetCubicStorageSize() / 1024 / 1024, 1.0 * sizeof(double) * r * cubicSize / 1024 / 1024);
+}
+
+StVKReducedInternalForcesCompressed::StVKReducedInternalForcesCompressed(const char * filename, int verbose_) : verbose(verbose_)
+{
+  FILE * fin = fopen(filename, "rb");
+  if (!fin)
+  {
+    printf("Error: could not read from the input cubic polynomial file.\n");
+    throw 1;
+  }
+
+  LoadFromStream(fin);
+  fclose(fin);
+}
+
+StVKReducedInternalForcesCompressed::StVKReducedInternalForcesCompressed(FILE * fin, int verbose_) : verbose(verbose_)
+{
+  LoadFromStream(fin);
+}
+
+int StVKReducedInternalForcesCompressed::LoadFromStream(FILE * fin)
+{
+  int header[4];
+  if ((int)(fread(header, sizeof(int), 4, fin)) < 4)
+  {
+    printf("Error: couldn't read from input cubic polynomial file.\n");
+    throw 1;
+  }
+
+  if (header[0] != STVKREDUCEDINTERNALFORCESCOMPRESSED_FILE_TAG)
+  {
+    printf("Error: the input cubic polynomial file is not in the compressed format.\n");
+    throw 1;
+  }
+
+  r = header[1];
+  singlePrecision = header[2];
+  numCubicEntries = header[3];
+
+  if ((int)(fread(&relativeThreshold, sizeof(double), 1, fin)) < 1)
+  {
+    printf("Error: couldn't read from input cubic polynomial file.\n");
+    throw 1;
+  }
+
+  if (verbose)
+    printf("Loading compressed polynomials: r=%d, %d cubic coefficients in %s precision.\n", r, numCubicEntries, singlePrecision ? "single" : "double");
+
+  linearSize = StVKReducedInternalForces::GetLinearSize(r);
+  quadraticSize = StVKReducedInternalForces::GetQuadraticSize(r);
+  cubicSize = StVKReducedInternalForces::GetCubicSize(r);
+
+  linearCoef_ = (double*) malloc (sizeof(double) * r * linearSize);
+  quadraticCoef_ = (double*) malloc (sizeof(double) * r * quadraticSize);
+  cubicRowStart = (int*) malloc (sizeof(int) * (cubicSize + 1));
+  cubicIndexStart = NULL;
+  cubicComponentIndex = NULL;
+  cubicValuesFloat = NULL;
+  cubicValuesDouble = NULL;
+
+  if (((int)(fread(linearCoef_, sizeof(double), r * linearSize, fin)) < r * linearSize) ||
+      ((int)(fread(quadraticCoef_, sizeof(double), r * quadraticSize, fin)) < r * quadraticSize) ||
+      ((int)(fread(cubicRowStart, sizeof(int), cubicSize + 1, fin)) < cubicSize + 1))
+  {
+    printf("Error: couldn't read from input cubic polynomial file.\n");
+    throw 1;
+  }
+
+  BuildIndexStart();
+  cubicComponentIndex = (unsigned short*) malloc (sizeof(unsigned short) * numCubicIndices);
+  if ((int)(fread(cubicComponentIndex, sizeof(unsigned short), numCubicIndices, fin)) < numCubicIndices)
+  {
+    printf("Error: couldn't read from input cubic polynomial file.\n");
+    throw 1;
+  }
+
+  int code;
+  if (singlePrecision)
+  {
+    cubicValuesFloat = (float*) malloc (sizeof(float) * numCubicEntries);
+    code = ((int)(fread(cubicValuesFloat, sizeof(float), numCubicEntries, fin)) < numCubicEntries);
+  }
+  else
+  {
+    cubicValuesDouble = (double*) malloc (sizeof(double) * numCubicEntries);
+    code = ((int)(fread(cubicValuesDouble, sizeof(double), numCubicEntries, fin)) < numCubicEntries);
+  }
+
+  if (code)
+  {
+    printf("Error: couldn't read from input cubic polynomial file.\n");
+    throw 1;
+  }
+
+  InitBuffers();
+
+  return 0;
+}
+
+StVKReducedInternalForcesCompressed::~StVKReducedInternalForcesCompressed()
+{
+  free(linearCoef_);
+  free(quadraticCoef_);
+  free(cubicRowStart);
+  free(cubicIndexStart);
+  free(cubicComponentIndex);
+  free(cubicValuesFloat);
+  free(cubicValuesDouble);
+  free(qiqj);
+  free(cubicAccumulator);
+}
+
+int StVKReducedInternalForcesCompressed::Save(const char * filename)
+{
+  FILE * fout = fopen(filename,"wb");
+  if (!fout)
+    return 1;
+
+  int code = Save(fout);
+
+  fclose(fout);
+
+  return code;
+}
+
+int StVKReducedInternalForcesCompressed::Save(FILE * fout)
+{
+  int header[4] = { STVKREDUCEDINTERNALFORCESCOMPRESSED_FILE_TAG, r, singlePrecision, numCubicEntries };
+  if ((int)(fwrite(header,sizeof(int),4,fout)) < 4)
+    return 1;
+
+  if ((int)(fwrite(&relativeThreshold,sizeof(double),1,fout)) < 1)
+    return 1;
+
+  if ((int)(fwrite(linearCoef_,sizeof(double),r*linearSize,fout)) < r*linearSize)
+    return 1;
+
+  if ((int)(fwrite(quadraticCoef_,sizeof(double),r*quadraticSize,fout)) < r*quadraticSize)
+    return 1;
+
+  if ((int)(fwrite(cubicRowStart,sizeof(int),cubicSize+1,fout)) < cubicSize+1)
+    return 1;
+
+  if ((int)(fwrite(cubicComponentIndex,sizeof(unsigned short),numCubicIndices,fout)) < numCubicIndices)
+    return 1;
+
+  if (singlePrecision)
+  {
+    if ((int)(fwrite(cubicValuesFloat,sizeof(float),numCubicEntries,fout)) < numCubicEntries)
+      return 1;
+  }
+  else
+  {
+    if ((int)(fwrite(cubicValuesDouble,sizeof(double),numCubicEntries,fout)) < numCubicEntries)
+      return 1;
+  }
+
+  return 0;
+}
+
+int StVKReducedInternalForcesCompressed::GetCubicStorageSize()
+{
+  return (int)(2 * sizeof(int) * (cubicSize + 1) + sizeof(unsigned short) * numCubicIndices + (singlePrecision ? sizeof(float) : sizeof(double)) * numCubicEntries);
+}
+
+void StVKReducedInternalForcesCompressed::BuildIndexStart()
+{
+  cubicIndexStart = (int*) malloc (sizeof(int) * (cubicSize + 1));
+  numCubicIndices = 0;
+  for(int monomial=0; monomial<cubicSize; monomial++)
+  {
+    cubicIndexStart[monomial] = numCubicIndices;
+    int rowLength = cubicRowStart[monomial+1] - cubicRowStart[monomial];
+    if (rowLength < r)
+      numCubicIndices += rowLength;
+  }
+  cubicIndexStart[cubicSize] = numCubicIndices;
+}
+
+void StVKReducedInternalForcesCompressed::InitBuffers()
+{
+  qiqj = (double*) malloc (sizeof(double) * quadraticSize);
+  cubicAccumulator = (double*) malloc (sizeof(double) * r);
+}
+
+void StVKReducedInternalForcesCompressed::EvaluateLinearAndQuadratic(double * q, double * fq)
+{
+  // linear terms (linearCoef_ is an r x r array)
+  cblas_dgemv(CblasColMajor, CblasTrans,
+       r, r,
+       1.0,
+       linearCoef_, r,
+       q, 1,
+       0.0,
+       fq, 1);
+
+  // compute qiqj
+  int index = 0;
+  for(int output=0; output<r; output++)
+    for(int i=output; i<r; i++)
+    {
+      qiqj[index] = q[output] * q[i];
+      index++;
+    }
+
+  // quadratic terms (quadraticCoef_ is a quadraticSize x r matrix)
+  cblas_dgemv(CblasColMajor, CblasTrans,
+       quadraticSize, r,
+       1.0,
+       quadraticCoef_, quadraticSize,
+       qiqj, 1,
+       1.0,
+       fq, 1);
+}
+
+template<class real>
+void StVKReducedInternalForcesCompressed::AddCubicTerms(const real * cubicValues, double * q, double * fq)
+{
+  // the monomials q_i q_j q_k (i <= j <= k) come in blocks of constant i;
+  // within block i, the monomials are q_i * qiqj[p], for p running over the tail of qiqj that starts at q_i q_i
+  int size = quadraticSize;
+  double * qiqjPos = qiqj;
+  int monomial = 0;
+  double * accumulator = cubicAccumulator;
+  for(int i=0; i<r; i++)
+  {
+    memset(accumulator, 0, sizeof(double) * r);
+    int p = 0;
+    while (p < size)
+    {
+      const real * rowValues = cubicValues + cubicRowStart[monomial];
+      int rowLength = cubicRowStart[monomial+1] - cubicRowStart[monomial];
+      if ((rowLength == r) && (p + 4 <= size) && (cubicRowStart[monomial+4] - cubicRowStart[monomial] == 4 * r))
+      {
+        // four consecutive dense rows (their values are contiguous): one pass over the accumulator
+        double qjqk0 = qiqjPos[p];
+        double qjqk1 = qiqjPos[p+1];
+        double qjqk2 = qiqjPos[p+2];
+        double qjqk3 = qiqjPos[p+3];
+        for(int output=0; output<r; output++)
+          accumulator[output] += qjqk0 * rowValues[output] + qjqk1 * rowValues[r + output] 
+                               + qjqk2 * rowValues[2 * r + output] + qjqk3 * rowValues[3 * r + output];
+        p += 4;
+        monomial += 4;
+        continue;
+      }
+
+      double qjqk = qiqjPos[p];
+      if (rowLength == r)
+      {
+        for(int output=0; output<r; output++)
+          accumulator[output] += qjqk * rowValues[output];
+      }
+      else
+      {
+        const unsigned short * rowIndices = cubicComponentIndex + cubicIndexStart[monomial];
+        for(int entry=0; entry<rowLength; entry++)
+          accumulator[rowIndices[entry]] += qjqk * rowValues[entry];
+      }
+      p++;
+      monomial++;
+    }
+
+    double qi = q[i];
+    for(int output=0; output<r; output++)
+      fq[output] += qi * accumulator[output];
+
+    int param = r-i;
+    size -= param;
+    qiqjPos += param;
+  }
+}
+
+void StVKReducedInternalForcesCompressed::AddCubicTerms(double * q, double * fq)
+{
+  if (singlePrecision)
+    AddCubicTerms(cubicValuesFloat, q, fq);
+  else
+    AddCubicTerms(cubicValuesDouble, q, fq);
+}
+
+void StVKReducedInternalForcesCompressed::Evaluate(double * q, double * fq)
+{
+  EvaluateLinearAndQuadratic(q, fq);
+  AddCubicTerms(q, fq);
+}
+
+void StVKReducedInternalForcesCompressed::PrintAccuracyReport(StVKReducedInternalForces * stVKReducedInternalForces, int numConfigurations, double amplitude, double * maxRelativeError, double * avgRelativeError)
+{
+  if (stVKReducedInternalForces->Getr() != r)
+  {
+    printf("Error: PrintAccuracyReport: mismatch in r: %d (compressed) vs %d (dense).\n", r, stVKReducedInternalForces->Getr());
+    return;
+  }
+
+  // count the nonzero dense coefficients
+  double * cubicCoef_ = stVKReducedInternalForces->GetCubicTermsBuffer();
+  int numNonZero = 0;
+  for(int i=0; i<r*cubicSize; i++)
+    if (cubicCoef_[i] != 0.0)
+      numNonZero++;
+
+  double * q = (double*) calloc (r, sizeof(double));
+  double * fqDense0 = (double*) malloc (sizeof(double) * r);
+  double * fqDense = (double*) malloc (sizeof(double) * r);
+  double * fqCompressed = (double*) malloc (sizeof(double) * r);
+  double * fqLinearQuadratic = (double*) malloc (sizeof(double) * r);
+
+  // the dense polynomial may include gravity (a constant term); remove it from the comparison
+  stVKReducedInternalForces->Evaluate(q, fqDense0);
+
+  double maxError = 0.0, avgError = 0.0;
+  double maxCubicError = 0.0, avgCubicError = 0.0;
+  for(int sample=0; sample<numConfigurations; sample++)
+  {
+    for(int i=0; i<r; i++)
+      q[i] = amplitude * (2.0 * rand() / RAND_MAX - 1.0);
+
+    stVKReducedInternalForces->Evaluate(q, fqDense);
+    for(int i=0; i<r; i++)
+      fqDense[i] -= fqDense0[i];
+
+    EvaluateLinearAndQuadratic(q, fqLinearQuadratic);
+    memcpy(fqCompressed, fqLinearQuadratic, sizeof(double) * r);
+    AddCubicTerms(q, fqCompressed);
+
+    double normDense = 0.0, normDifference = 0.0, normCubic = 0.0;
+    for(int i=0; i<r; i++)
+    {
+      normDense += fqDense[i] * fqDense[i];
+      normDifference += (fqDense[i] - fqCompressed[i]) * (fqDense[i] - fqCompressed[i]);
+      normCubic += (fqDense[i] - fqLinearQuadratic[i]) * (fqDense[i] - fqLinearQuadratic[i]);
+    }
+
+    double error = (normDense > 0) ? sqrt(normDifference / normDense) : 0.0;
+    double cubicError = (normCubic > 0) ? sqrt(normDifference / normCubic) : 0.0;
+
+    if (error > maxError)
+      maxError = error;
+    avgError += error;
+    if (cubicError > maxCubicError)
+      maxCubicError = cubicError;
+    avgCubicError += cubicError;
+  }
+
+  if (numConfigurations > 0)
+  {
+    avgError /= numConfigurations;
+    avgCubicError /= numConfigurations;
+  }
+
+  printf("Compressed cubic polynomial accuracy report:\n");
+  printf("  r: %d, relative threshold: %G, cubic coefficients stored in %s precision\n", r, relativeThreshold, singlePrecision ? "single" : "double");
+  printf("  cubic coefficients: %d dense (%d nonzero), %d retained, %d dropped\n", r * cubicSize, numNonZero, numCubicEntries, numNonZero - numCubicEntries);
+  printf("  cubic storage: %.3f Mb dense, %.3f Mb compressed (ratio: %.2f)\n", 1.0 * sizeof(double) * r * cubicSize / 1024 / 1024, 1.0 * GetCubicStorageSize() / 1024 / 1024, 
+    (GetCubicStorageSize() > 0) ? 1.0 * sizeof(double) * r * cubicSize / GetCubicStorageSize() : 0.0);
+  printf("  %d random configurations, |q_i| <= %G:\n", numConfigurations, amplitude);
+  printf("  relative error of the internal forces: max %G, avg %G\n", maxError, avgError);
+  printf("  relative error of the cubic terms: max %G, avg %G\n", maxCubicError, avgCubicError);
+
+  if (maxRelativeError != NULL)
+    *maxRelativeError = maxError;
+  if (avgRelativeError != NULL)
+    *avgRelativeError = avgError;
+
+  free(fqLinearQuadratic);
+  free(fqCompressed);
+  free(fqDense);
+  free(fqDense0);
+  free(q);
+}
+
@@ -0,0 +1,137 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "reducedStvk" library , Copyright (C) 2007 CMU, 2009 MIT              *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+/*
+  A compressed representation of the reduced StVK internal force polynomial (see StVKReducedInternalForces.h).
+
+  The cubic coefficients dominate the storage and the evaluation time of the polynomial
+  (r*r*(r+1)*(r+2)/6 coefficients, versus r*r*(r+1)/2 quadratic and r*r linear coefficients).
+  This class keeps the linear and quadratic coefficients as they are, and compresses the cubic ones:
+
+  1. Symmetry: as in StVKReducedInternalForces, only monomials q_i q_j q_k with i <= j <= k are stored.
+  2. Sparsity: coefficients with a small magnitude (relative to the largest cubic coefficient of the same 
+     force component) can be dropped; the remaining ones are stored in a sparse layout.
+  3. Precision: the cubic coefficients can be stored in single precision (the evaluation is still performed in double precision).
+
+  The compressed cubic coefficients are stored "monomial-major": for each monomial q_i q_j q_k, 
+  the retained coefficients for all the force components are stored contiguously. If all r coefficients 
+  of a monomial are retained, they are stored densely; otherwise, they are stored together with the 
+  (16-bit) indices of their force components. The monomials are grouped into blocks of constant i;
+  the evaluation loop accumulates each block into a small buffer of length r, and then scales it by q_i.
+  This way, the coefficients are streamed through memory exactly once, and the monomials are formed on the fly.
+
+  Use PrintAccuracyReport to measure the error of the compressed polynomial versus the dense polynomial.
+  The compressed polynomial can be saved to and loaded from a binary file (the convention is to use the .cub file extension,
+  as with the dense polynomials; StVKReducedInternalForces::GetrFromFile works on both file types).
+  Gravity is not supported; Evaluate returns the reduced internal forces only. If the source dense polynomial
+  has gravity enabled, the constructor prints a warning; the (constant) reduced gravity force is then not included.
+*/
+
+#ifndef _STVKREDUCEDINTERNALFORCESCOMPRESSED_H_
+#define _STVKREDUCEDINTERNALFORCESCOMPRESSED_H_
+
+#include "StVKReducedInternalForces.h"
+
+// first integer of a compressed polynomial file (the first integer of a dense file is r >= 0)
+#define STVKREDUCEDINTERNALFORCESCOMPRESSED_FILE_TAG -1
+
+class StVKReducedInternalForcesCompressed
+{
+public:
+
+  // compresses the given dense polynomial (the dense polynomial is not modified and can be deleted afterwards)
+  // relativeThreshold: cubic coefficients with |c| <= relativeThreshold * (max abs cubic coefficient of the same force component) are dropped; 
+  //   0.0 (default) keeps all (nonzero) coefficients, i.e., the only approximation is due to single precision
+  // singlePrecision: 0: store the cubic coefficients in double precision; 1 (default): single precision
+  StVKReducedInternalForcesCompressed(StVKReducedInternalForces * stVKReducedInternalForces, double relativeThreshold=0.0, int singlePrecision=1, int verbose=1);
+
+  // loads a compressed polynomial from a file (saved previously with Save)
+  // all modes are loaded; little endian data is assumed
+  StVKReducedInternalForcesCompressed(const char * filename, int verbose=1);
+  StVKReducedInternalForcesCompressed(FILE * fin, int verbose=1); // read from binary stream
+
+  ~StVKReducedInternalForcesCompressed();
+
+  // saves the compressed polynomial to a disk file (binary format)
+  int Save(const char * filename);
+  int Save(FILE * fout); // saves to stream
+
+  // evaluates the reduced internal forces for the given configuration q, result is written into fq (which must be a pre-allocated vector of length r)
+  void Evaluate(double * q, double * fq);
+
+  // compares the compressed polynomial to the dense polynomial (from which it was compressed), 
+  // at numConfigurations random configurations, with each entry of q drawn uniformly from [-amplitude, amplitude]
+  // prints the storage sizes, the number of dropped coefficients, and the relative errors of the internal forces 
+  // (of the entire force vector, and of the cubic terms alone)
+  // the maximal relative error of the force vectors is returned in maxRelativeError, and the average one in avgRelativeError (if non-NULL)
+  void PrintAccuracyReport(StVKReducedInternalForces * stVKReducedInternalForces, int numConfigurations=100, double amplitude=1.0, double * maxRelativeError=NULL, double * avgRelativeError=NULL);
+
+  inline int Getr() { return r; }
+  inline int GetSinglePrecision() { return singlePrecision; }
+  inline double GetRelativeThreshold() { return relativeThreshold; }
+  inline int GetNumCubicEntries() { return numCubicEntries; } // number of stored cubic coefficients
+  int GetCubicStorageSize(); // in bytes (coefficients and indices)
+
+protected:
+  int r;
+  int linearSize, quadraticSize, cubicSize;
+  int singlePrecision;
+  double relativeThreshold;
+
+  double * linearCoef_; // same layout as in StVKReducedInternalForces
+  double * quadraticCoef_; // same layout as in StVKReducedInternalForces
+
+  // compressed cubic terms (compressed sparse rows, one row per monomial, in the order of the monomials in StVKReducedInternalForces)
+  // a row with r entries is dense, and has no component indices
+  int numCubicEntries;
+  int numCubicIndices; // number of entries in the sparse rows
+  int * cubicRowStart; // cubicSize + 1 entries; the entries of row "monomial" are cubicRowStart[monomial], ..., cubicRowStart[monomial+1]-1
+  int * cubicIndexStart; // cubicSize + 1 entries; the component indices of a sparse row start at cubicComponentIndex[cubicIndexStart[monomial]]
+  unsigned short * cubicComponentIndex; // numCubicIndices entries
+  float * cubicValuesFloat; // numCubicEntries entries (if singlePrecision), NULL otherwise
+  double * cubicValuesDouble; // numCubicEntries entries (if !singlePrecision), NULL otherwise
+
+  int verbose;
+
+  // acceleration data
+  double * qiqj;
+  double * cubicAccumulator;
+  void InitBuffers();
+
+  // fq += cubic terms of q (assumes qiqj has been computed)
+  template<class real>
+  void AddCubicTerms(const real * cubicValues, double * q, double * fq);
+  void AddCubicTerms(double * q, double * fq);
+  void EvaluateLinearAndQuadratic(double * q, double * fq); // also computes qiqj
+
+  void BuildIndexStart();
+  int LoadFromStream(FILE * fin);
+};
+
+#endif
+
@@ -0,0 +1,354 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "reducedStvk" library , Copyright (C) 2007 CMU, 2009 MIT              *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "StVKReducedInternalForcesResumableMT.h"
+
+// first integer of a checkpoint file, and the checkpoint format version
+#define STVKREDUCEDINTERNALFORCESRESUMABLEMT_CHECKPOINT_TAG -2
+#define STVKREDUCEDINTERNALFORCESRESUMABLEMT_CHECKPOINT_VERSION 1
+
+static void * StVKReducedInternalForcesResumableMT_WorkerThread(void * arg)
+{
+  StVKReducedInternalForcesResumableMT * stVKReducedInternalForcesResumableMT = (StVKReducedInternalForcesResumableMT*) arg;
+  stVKReducedInternalForcesResumableMT->ProcessChunks();
+  return NULL;
+}
+
+StVKReducedInternalForcesResumableMT::StVKReducedInternalForcesResumableMT(int r, double * U, VolumetricMesh * volumetricMesh, StVKElementABCD * precomputedABCDIntegrals, bool addGravity_, double g_, int numThreads_, 
+  const char * checkpointFilename_, double checkpointInterval_, int chunkSize_, int initOnly, int verbose_): 
+  StVKReducedInternalForces(r, U, volumetricMesh, precomputedABCDIntegrals, 1, addGravity_, g_, verbose_), numThreads(numThreads_), chunkSize(chunkSize_), stopRequested(0), status(1), checkpointInterval(checkpointInterval_), checkpointError(0)
+{
+  // ProcessElements prints per-element progress if verbose; with many chunks in flight, report per chunk instead
+  progressVerbose = verbose;
+  verbose = 0;
+
+  if (numThreads < 1)
+    numThreads = 1;
+
+  numElements = volumetricMesh->getNumElements();
+  if (chunkSize <= 0)
+  {
+    // enough chunks to balance the load, but large enough to amortize the per-chunk overhead (packing, accumulation)
+    chunkSize = numElements / (16 * numThreads);
+    if (chunkSize > 256)
+      chunkSize = 256;
+    if (chunkSize < 1)
+      chunkSize = 1;
+  }
+  numChunks = (numElements + chunkSize - 1) / chunkSize;
+  chunkFinished = (char*) calloc (numChunks, sizeof(char));
+  nextChunk = 0;
+  numFinishedChunks = 0;
+
+  checkpointFilename = NULL;
+  if (checkpointFilename_ != NULL)
+  {
+    checkpointFilename = (char*) malloc (sizeof(char) * (strlen(checkpointFilename_) + 1));
+    strcpy(checkpointFilename, checkpointFilename_);
+  }
+  lastCheckpointTime = GetTime();
+
+  inputHash = ComputeInputHash(U);
+
+  pthread_mutex_init(&mutex, NULL);
+
+  // the coefficients are the global accumulators (InitComputation set them to zero)
+  if (checkpointFilename != NULL)
+    LoadCheckpoint();
+  numCheckpointedChunks = numFinishedChunks;
+
+  if (progressVerbose)
+  {
+    printf("Reduced StVK coefficients computation info:\n");
+    printf("Total elements: %d \n", numElements);
+    printf("Num threads: %d \n", numThreads);
+    printf("Chunk size: %d elements, %d chunks (%d already finished)\n", chunkSize, numChunks, numFinishedChunks);
+    if (checkpointFilename != NULL)
+      printf("Checkpoint file: %s (interval: %G sec)\n", checkpointFilename, checkpointInterval);
+  }
+
+  if (!initOnly)
+    Compute();
+}
+
+int StVKReducedInternalForcesResumableMT::Compute()
+{
+  // launch threads 
+  pthread_t * tid = (pthread_t*) malloc (sizeof(pthread_t) * numThreads);
+
+  for(int i=0; i<numThreads; i++)
+  {
+    if (pthread_create(&tid[i], NULL, StVKReducedInternalForcesResumableMT_WorkerThread, this) != 0)
+    {
+      printf("Error: unable to launch thread %d.\n", i);
+      exit(1);
+    }
+  }
+
+  for(int i=0; i<numThreads; i++)
+  {
+    if (pthread_join(tid[i], NULL) != 0)
+    {
+      printf("Error: unable to join thread %d.\n", i);
+      exit(1);
+    } 
+  }
+
+  free(tid);
+
+  return Finish();
+}
+
+StVKReducedInternalForcesResumableMT::~StVKReducedInternalForcesResumableMT()
+{
+  pthread_mutex_destroy(&mutex);
+  free(chunkFinished);
+  free(checkpointFilename);
+}
+
+double StVKReducedInternalForcesResumableMT::GetTime()
+{
+  return (double) time(NULL);
+}
+
+void StVKReducedInternalForcesResumableMT::ProcessChunks()
+{
+  int coefSize = r * (linearSize + quadraticSize + cubicSize);
+  double * chunkBuffer = (double*) malloc (sizeof(double) * coefSize);
+  double * target[3] = { chunkBuffer, chunkBuffer + r * linearSize, chunkBuffer + r * (linearSize + quadraticSize) };
+
+  while (!stopRequested)
+  {
+    // fetch the next unfinished chunk
+    pthread_mutex_lock(&mutex);
+    while ((nextChunk < numChunks) && chunkFinished[nextChunk])
+      nextChunk++;
+    int chunk = nextChunk;
+    nextChunk++;
+    pthread_mutex_unlock(&mutex);
+
+    if (chunk >= numChunks)
+      break;
+
+    int startElement = chunk * chunkSize;
+    int endElement = startElement + chunkSize;
+    if (endElement > numElements)
+      endElement = numElements;
+
+    // ProcessElements accumulates the linear terms, and overwrites the quadratic and cubic terms
+    memset(chunkBuffer, 0, sizeof(double) * r * linearSize);
+    ProcessElements(startElement, endElement, target);
+
+    // add into the global coefficients
+    pthread_mutex_lock(&mutex);
+
+    for(int i=0; i<r*linearSize; i++)
+      linearCoef_[i] += target[0][i];
+    for(int i=0; i<r*quadraticSize; i++)
+      quadraticCoef_[i] += target[1][i];
+    for(int i=0; i<r*cubicSize; i++)
+      cubicCoef_[i] += target[2][i];
+
+    chunkFinished[chunk] = 1;
+    numFinishedChunks++;
+
+    if (progressVerbose)
+    {
+      printf("Finished chunk %d (elements %d to %d): %d / %d chunks done.\n", chunk, startElement, endElement-1, numFinishedChunks, numChunks);
+      fflush(NULL);
+    }
+
+    if ((checkpointFilename != NULL) && (numFinishedChunks < numChunks) && (GetTime() - lastCheckpointTime >= checkpointInterval))
+      SaveCheckpointLocked();
+
+    pthread_mutex_unlock(&mutex);
+  }
+
+  free(chunkBuffer);
+}
+
+int StVKReducedInternalForcesResumableMT::Finish()
+{
+  if (IsComplete())
+  {
+    if (checkpointFilename != NULL)
+      remove(checkpointFilename);
+    status = 0;
+  }
+  else
+  {
+    if ((checkpointFilename != NULL) && (numFinishedChunks > numCheckpointedChunks))
+      SaveCheckpoint();
+    status = checkpointError ? 2 : 1;
+    if (progressVerbose)
+      printf("Computation stopped: %d / %d chunks done.\n", numFinishedChunks, numChunks);
+  }
+
+  return status;
+}
+
+int StVKReducedInternalForcesResumableMT::SaveCheckpoint()
+{
+  pthread_mutex_lock(&mutex);
+  int code = SaveCheckpointLocked();
+  pthread_mutex_unlock(&mutex);
+  return code;
+}
+
+int StVKReducedInternalForcesResumableMT::SaveCheckpointLocked()
+{
+  if (checkpointFilename == NULL)
+    return 1;
+
+  // write to a temporary file, then rename it, so that an interruption during the write leaves the previous checkpoint intact
+  char * tempFilename = (char*) malloc (sizeof(char) * (strlen(checkpointFilename) + 5));
+  sprintf(tempFilename, "%s.tmp", checkpointFilename);
+
+  int code = 1;
+  FILE * fout = fopen(tempFilename, "wb");
+  if (fout)
+  {
+    int header[8] = { STVKREDUCEDINTERNALFORCESRESUMABLEMT_CHECKPOINT_TAG, STVKREDUCEDINTERNALFORCESRESUMABLEMT_CHECKPOINT_VERSION, 
+                      r, numElements, n, chunkSize, numChunks, numFinishedChunks };
+    code = 0;
+    if ((int)(fwrite(header, sizeof(int), 8, fout)) < 8)
+      code = 1;
+    if ((code == 0) && ((int)(fwrite(&inputHash, sizeof(unsigned int), 1, fout)) < 1))
+      code = 1;
+    if ((code == 0) && ((int)(fwrite(chunkFinished, sizeof(char), numChunks, fout)) < numChunks))
+      code = 1;
+    if ((code == 0) && ((int)(fwrite(linearCoef_, sizeof(double), r * linearSize, fout)) < r * linearSize))
+      code = 1;
+    if ((code == 0) && ((int)(fwrite(quadraticCoef_, sizeof(double), r * quadraticSize, fout)) < r * quadraticSize))
+      code = 1;
+    if ((code == 0) && ((int)(fwrite(cubicCoef_, sizeof(double), r * cubicSize, fout)) < r * cubicSize))
+      code = 1;
+    if (fclose(fout) != 0)
+      code = 1;
+  }
+
+  if ((code == 0) && (rename(tempFilename, checkpointFilename) != 0))
+    code = 1;
+
+  if (code != 0)
+  {
+    printf("Error: unable to write the checkpoint file %s.\n", checkpointFilename);
+    remove(tempFilename);
+    checkpointError = 1;
+  }
+  else
+  {
+    numCheckpointedChunks = numFinishedChunks;
+    if (progressVerbose)
+      printf("Saved checkpoint %s: %d / %d chunks done.\n", checkpointFilename, numFinishedChunks, numChunks);
+  }
+
+  free(tempFilename);
+  lastCheckpointTime = GetTime();
+
+  return code;
+}
+
+int StVKReducedInternalForcesResumableMT::LoadCheckpoint()
+{
+  FILE * fin = fopen(checkpointFilename, "rb");
+  if (!fin)
+    return 1; // no checkpoint; start from scratch
+
+  int header[8];
+  unsigned int hash;
+  if (((int)(fread(header, sizeof(int), 8, fin)) < 8) || ((int)(fread(&hash, sizeof(unsigned int), 1, fin)) < 1))
+  {
+    printf("Warning: unable to read the checkpoint file %s. Starting from scratch.\n", checkpointFilename);
+    fclose(fin);
+    return 1;
+  }
+
+  if ((header[0] != STVKREDUCEDINTERNALFORCESRESUMABLEMT_CHECKPOINT_TAG) || (header[1] != STVKREDUCEDINTERNALFORCESRESUMABLEMT_CHECKPOINT_VERSION) || 
+      (header[2] != r) || (header[3] != numElements) || (header[4] != n) || (header[5] != chunkSize) || (header[6] != numChunks) || (hash != inputHash))
+  {
+    printf("Warning: checkpoint file %s does not match the current computation (r, mesh, chunk size, basis or materials differ). Starting from scratch.\n", checkpointFilename);
+    fclose(fin);
+    return 1;
+  }
+
+  if (((int)(fread(chunkFinished, sizeof(char), numChunks, fin)) < numChunks) ||
+      ((int)(fread(linearCoef_, sizeof(double), r * linearSize, fin)) < r * linearSize) ||
+      ((int)(fread(quadraticCoef_, sizeof(double), r * quadraticSize, fin)) < r * quadraticSize) ||
+      ((int)(fread(cubicCoef_, sizeof(double), r * cubicSize, fin)) < r * cubicSize))
+  {
+    printf("Warning: the checkpoint file %s is truncated. Starting from scratch.\n", checkpointFilename);
+    fclose(fin);
+    memset(chunkFinished, 0, sizeof(char) * numChunks);
+    memset(linearCoef_, 0, sizeof(double) * r * linearSize);
+    memset(quadraticCoef_, 0, sizeof(double) * r * quadraticSize);
+    memset(cubicCoef_, 0, sizeof(double) * r * cubicSize);
+    return 1;
+  }
+
+  fclose(fin);
+
+  numFinishedChunks = 0;
+  for(int i=0; i<numChunks; i++)
+    if (chunkFinished[i])
+      numFinishedChunks++;
+
+  if (progressVerbose)
+    printf("Resuming from checkpoint %s: %d / %d chunks already done.\n", checkpointFilename, numFinishedChunks, numChunks);
+
+  return 0;
+}
+
+unsigned int StVKReducedInternalForcesResumableMT::ComputeInputHash(double * U)
+{
+  // FNV-1a hash of the basis and the material parameters
+  unsigned int hash = 2166136261u;
+
+  #define STVKREDUCEDINTERNALFORCESRESUMABLEMT_HASH(data, numBytes)\
+  {\
+    unsigned char * bytes = (unsigned char*) (data);\
+    for(size_t byte=0; byte<(size_t)(numBytes); byte++)\
+    {\
+      hash ^= bytes[byte];\
+      hash *= 16777619u;\
+    }\
+  }
+
+  STVKREDUCEDINTERNALFORCESRESUMABLEMT_HASH(U, sizeof(double) * 3 * n * r);
+  STVKREDUCEDINTERNALFORCESRESUMABLEMT_HASH(lambdaLame, sizeof(double) * numElements);
+  STVKREDUCEDINTERNALFORCESRESUMABLEMT_HASH(muLame, sizeof(double) * numElements);
+
+  #undef STVKREDUCEDINTERNALFORCESRESUMABLEMT_HASH
+
+  return hash;
+}
+
@@ -0,0 +1,129 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "reducedStvk" library , Copyright (C) 2007 CMU, 2009 MIT              *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+/*
+  A multi-threaded, resumable version of the computation of the reduced StVK cubic polynomials 
+  (see StVKReducedInternalForces.h and StVKReducedInternalForcesMT.h). 
+  It uses POSIX threads ("pthreads") as the threading API.
+
+  The elements are split into chunks of consecutive elements. The threads fetch chunks
+  dynamically from a shared counter (as opposed to the static partition of StVKReducedInternalForcesMT), 
+  so that a thread that finishes early keeps working. Each finished chunk is immediately added 
+  into one global set of coefficients, so that the global coefficients always hold the sum over the 
+  finished chunks. Each thread holds one coefficient buffer for its current chunk, plus the 
+  per-element scratch space of ProcessElements; the memory is therefore independent of the 
+  number of elements and chunks.
+
+  If a checkpoint filename is given, the partial sums and the list of finished chunks are 
+  periodically saved to disk (every "checkpointInterval" seconds, and when the computation is stopped).
+  If the computation is interrupted, constructing the class again with the same parameters 
+  resumes from the checkpoint. The checkpoint is deleted once the computation completes.
+  The checkpoint records r, the mesh size, the chunk size and a hash of the basis and 
+  the materials; a checkpoint that does not match the current computation is ignored.
+
+  The computation can be run in three ways:
+  1. by the constructor, using "numThreads" POSIX threads (default)
+  2. by calling Compute() (initOnly=1); this allows the caller to keep a pointer to the class 
+     during the computation, e.g., to call RequestStop from a signal handler
+  3. by the caller (initOnly=1): call ProcessChunks() from any number of threads (of any threading API), 
+     and then call Finish(); this is used, e.g., by a GUI that runs its own threads and displays progress
+*/
+
+#ifndef _STVKREDUCEDINTERNALFORCESRESUMABLEMT_H_
+#define _STVKREDUCEDINTERNALFORCESRESUMABLEMT_H_
+
+#include <pthread.h>
+#include "StVKReducedInternalForces.h"
+
+class StVKReducedInternalForcesResumableMT : public StVKReducedInternalForces
+{
+public:
+  // creates the reduced coefficients
+  // checkpointFilename: file for the partial sums (NULL: no checkpointing)
+  // checkpointInterval: minimal time between two checkpoints, in seconds
+  // chunkSize: number of elements per chunk (0: automatic)
+  // initOnly: 0: compute in the constructor, 1: the caller must call Compute, or ProcessChunks and Finish (see above)
+  StVKReducedInternalForcesResumableMT(int r, double * U, VolumetricMesh * volumetricMesh, StVKElementABCD * precomputedABCDIntegrals, bool addGravity, double g, int numThreads, 
+    const char * checkpointFilename=NULL, double checkpointInterval=600.0, int chunkSize=0, int initOnly=0, int verbose=1);
+
+  ~StVKReducedInternalForcesResumableMT();
+
+  // computes the coefficients using numThreads POSIX threads; returns the same value as Finish
+  int Compute();
+
+  // processes chunks until all chunks are finished (or a stop was requested); can be called from several threads at once
+  void ProcessChunks();
+
+  // call after all ProcessChunks calls have returned
+  // returns 0 if all chunks are finished (the checkpoint file is then deleted), 
+  // 1 if the computation is incomplete (a checkpoint has been saved, if enabled), 2 on a checkpoint I/O error
+  int Finish();
+
+  // returns the value returned by the last call to Finish (1 if Finish has not been called yet)
+  inline int GetStatus() { return status; }
+
+  // asks the threads to stop after their current chunk (e.g., from a signal handler or a GUI "cancel" button)
+  inline void RequestStop() { stopRequested = 1; }
+
+  // progress
+  inline int GetNumChunks() { return numChunks; }
+  inline int GetNumFinishedChunks() { return numFinishedChunks; }
+  inline bool IsComplete() { return numFinishedChunks == numChunks; }
+
+  // writes the checkpoint now (returns 0 on success)
+  int SaveCheckpoint();
+
+protected:
+  int numThreads;
+  int numElements;
+  int chunkSize;
+  int numChunks;
+  char * chunkFinished;
+  int nextChunk;
+  int numFinishedChunks;
+  int numCheckpointedChunks;
+  volatile int stopRequested;
+  int status;
+  int progressVerbose;
+
+  char * checkpointFilename;
+  double checkpointInterval;
+  double lastCheckpointTime;
+  int checkpointError;
+  unsigned int inputHash;
+
+  pthread_mutex_t mutex;
+
+  unsigned int ComputeInputHash(double * U);
+  int LoadCheckpoint();
+  int SaveCheckpointLocked(); // assumes mutex is locked
+  static double GetTime();
+};
+
+#endif
+
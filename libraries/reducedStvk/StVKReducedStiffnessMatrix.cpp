@@ -307,6 +307,101 @@ void StVKReducedStiffnessMatrix::Evaluate(double * q, double * Rq)
   }
 }
 
+// number of configurations processed together by EvaluateBatch (bounds the size of the buffers)
+#define STVKREDUCEDSTIFFNESSMATRIX_BATCH_BLOCK 64
+
+void StVKReducedStiffnessMatrix::EvaluateBatch(int numQ, double * Q, double * KQ)
+{
+  if (useSingleThread)
+  {
+    #if defined(WIN32) || defined(linux)
+      mkl_max_threads = mkl_get_max_threads();
+      mkl_dynamic = mkl_get_dynamic();
+      mkl_set_num_threads(1);
+      mkl_set_dynamic(0);
+    #elif defined(__APPLE__)
+      //setenv("VECLIB_MAXIMUM_THREADS", "1", true);
+    #endif
+  }
+
+  int blockSize = (numQ < STVKREDUCEDSTIFFNESSMATRIX_BATCH_BLOCK) ? numQ : STVKREDUCEDSTIFFNESSMATRIX_BATCH_BLOCK;
+  // the buffers are local, so that EvaluateBatch can be called in parallel on shallow clones
+  double * QQ = (double*) malloc (sizeof(double) * quadraticSize * blockSize); // quadraticSize x blockSize
+  double * entries = (double*) malloc (sizeof(double) * quadraticSize * blockSize); // upper triangles, quadraticSize x blockSize
+
+  for(int blockStart=0; blockStart<numQ; blockStart+=blockSize)
+  {
+    int numColumns = (numQ - blockStart < blockSize) ? numQ - blockStart : blockSize;
+    double * Qblock = Q + (size_t)r * blockStart;
+
+    // free terms, and the monomials q_i q_j
+    for(int column=0; column<numColumns; column++)
+    {
+      memcpy(entries + quadraticSize * column, freeCoef_, sizeof(double) * quadraticSize);
+
+      double * q = Qblock + r * column;
+      double * qiqjColumn = QQ + quadraticSize * column;
+      int index = 0;
+      for(int output=0; output<r; output++)
+        for(int i=output; i<r; i++)
+        {
+          qiqjColumn[index] = q[output] * q[i];
+          index++;
+        }
+    }
+
+    // linear terms: linearCoef_ is an r x quadraticSize matrix (each column gives the coefficients of one matrix entry)
+    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans,
+         quadraticSize, numColumns, r,
+         1.0,
+         linearCoef_, r,
+         Qblock, r,
+         1.0,
+         entries, quadraticSize);
+
+    // quadratic terms: quadraticCoef_ is a quadraticSize x quadraticSize matrix
+    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans,
+         quadraticSize, numColumns, quadraticSize,
+         1.0,
+         quadraticCoef_, quadraticSize,
+         QQ, quadraticSize,
+         1.0,
+         entries, quadraticSize);
+
+    // unpack into symmetric matrices
+    for(int column=0; column<numColumns; column++)
+    {
+      double * Rq = KQ + (size_t)r * r * (blockStart + column);
+      double * entriesColumn = entries + quadraticSize * column;
+      int i1=0,j1=0;
+      for(int i=0; i< quadraticSize; i++)
+      {
+        Rq[ELT(r,i1,j1)] = entriesColumn[i];
+        Rq[ELT(r,j1,i1)] = entriesColumn[i];
+        j1++;
+        if(j1 == r)
+        {
+          i1++;
+          j1 = i1;
+        }
+      }
+    }
+  }
+
+  free(entries);
+  free(QQ);
+
+  if (useSingleThread)
+  {
+    #if defined(WIN32) || defined(linux)
+      mkl_set_num_threads(mkl_max_threads);
+      mkl_set_dynamic(mkl_dynamic);
+    #elif defined(__APPLE__)
+      //unsetenv("VECLIB_MAXIMUM_THREADS");
+    #endif
+  }
+}
+
 void StVKReducedStiffnessMatrix::EvaluateSubset
   (double * q, int start, int end, double * Rq)
 {
@@ -72,6 +72,13 @@ public:
   // note: parameter q does not affect the output in this case
   void EvaluateLinear(double * q, double * Kq); 
 
+  // evaluates the stiffness matrices for numQ configurations at once
+  // Q is an r x numQ matrix (column-major; column s is the s-th configuration)
+  // KQ must be pre-allocated to numQ * r * r entries; the s-th matrix (all r*r entries) is written to KQ + s * r * r
+  // the monomials q_i q_j are formed for (a block of) the configurations, and the linear and quadratic terms are each evaluated
+  // with one matrix-matrix multiplication (BLAS Level 3) per block; the result equals Evaluate of each column, up to round-off
+  void EvaluateBatch(int numQ, double * Q, double * KQ);
+
   inline int Getr() { return r; }
 
   // prints the matrix out to standard output, in Mathematica format
@@ -236,9 +236,11 @@ SparseMatrix::SparseMatrix(const char * filename)
   InitFromOutline(&sparseMatrixOutline);
 }
 
-SparseMatrix::SparseMatrix(SparseMatrixOutline * sparseMatrixOutline)
+SparseMatrix::SparseMatrix(SparseMatrixOutline * sparseMatrixOutline, int contiguousStorage)
 {
   InitFromOutline(sparseMatrixOutline);
+  if (contiguousStorage)
+    ConvertToContiguousStorage();
 }
 
 // construct matrix from the outline
@@ -282,15 +284,27 @@ void SparseMatrix::Allocate()
   superRows = NULL;
   diagonalIndices = NULL;
   transposedIndices = NULL;
+  rowPointers = NULL;
+  columnIndexArena = NULL;
+  entryArena = NULL;
 }
 
 // destructor
 SparseMatrix::~SparseMatrix()
 {
-  for(int i=0; i<numRows; i++)
+  if (entryArena != NULL)
   {
-    free(columnIndices[i]);
-    free(columnEntries[i]);
+    free(rowPointers);
+    free(columnIndexArena);
+    free(entryArena);
+  }
+  else
+  {
+    for(int i=0; i<numRows; i++)
+    {
+      free(columnIndices[i]);
+      free(columnEntries[i]);
+    }
   }
 
   if (subMatrixIndices != NULL)
@@ -325,16 +339,39 @@ SparseMatrix::SparseMatrix(const SparseMatrix & source)
   columnIndices = (int**) malloc(sizeof(int*) * numRows);
   columnEntries = (double**) malloc(sizeof(double*) * numRows);
 
-  for(int i=0; i<numRows; i++)
+  rowPointers = NULL;
+  columnIndexArena = NULL;
+  entryArena = NULL;
+  if (source.entryArena != NULL)
+  {
+    // copy the arena in bulk
+    int numEntries = source.rowPointers[numRows];
+    rowPointers = (int*) malloc (sizeof(int) * (numRows + 1));
+    memcpy(rowPointers, source.rowPointers, sizeof(int) * (numRows + 1));
+    columnIndexArena = (int*) malloc (sizeof(int) * (numEntries > 0 ? numEntries : 1));
+    memcpy(columnIndexArena, source.columnIndexArena, sizeof(int) * numEntries);
+    entryArena = (double*) malloc (sizeof(double) * (numEntries > 0 ? numEntries : 1));
+    memcpy(entryArena, source.entryArena, sizeof(double) * numEntries);
+    memcpy(rowLength, source.rowLength, sizeof(int) * numRows);
+    for(int i=0; i<numRows; i++)
+    {
+      columnIndices[i] = &columnIndexArena[rowPointers[i]];
+      columnEntries[i] = &entryArena[rowPointers[i]];
+    }
+  }
+  else
   {
-    rowLength[i] = source.rowLength[i];
-    columnIndices[i] = (int*) malloc (sizeof(int) * rowLength[i]);
-    columnEntries[i] = (double*) malloc (sizeof(double) * rowLength[i]);
-
-    for(int j=0; j < rowLength[i]; j++)
+    for(int i=0; i<numRows; i++)
     {
-      columnIndices[i][j] = source.columnIndices[i][j];
-      columnEntries[i][j] = source.columnEntries[i][j];
+      rowLength[i] = source.rowLength[i];
+      columnIndices[i] = (int*) malloc (sizeof(int) * rowLength[i]);
+      columnEntries[i] = (double*) malloc (sizeof(double) * rowLength[i]);
+
+      for(int j=0; j < rowLength[i]; j++)
+      {
+        columnIndices[i][j] = source.columnIndices[i][j];
+        columnEntries[i][j] = source.columnEntries[i][j];
+      }
     }
   }
 
@@ -411,6 +448,18 @@ SparseMatrix::SparseMatrix(const SparseMatrix & source)
 
 void SparseMatrix::MultiplyVector(int startRow, int endRow, const double * vector, double * result) const // result = A(startRow:endRow-1,:) * vector
 {
+  if (entryArena != NULL)
+  {
+    for(int i=startRow; i<endRow; i++)
+    {
+      double entry = 0;
+      for(int k=rowPointers[i]; k < rowPointers[i+1]; k++)
+        entry += vector[columnIndexArena[k]] * entryArena[k];
+      result[i-startRow] = entry;
+    }
+    return;
+  }
+
   for(int i=startRow; i<endRow; i++)
   {
     result[i-startRow] = 0;
@@ -421,6 +470,12 @@ void SparseMatrix::MultiplyVector(int startRow, int endRow, const double * vecto
 
 void SparseMatrix::MultiplyVector(const double * vector, double * result) const
 {
+  if (entryArena != NULL)
+  {
+    MultiplyVector(0, numRows, vector, result);
+    return;
+  }
+
   for(int i=0; i<numRows; i++)
   {
     result[i] = 0;
@@ -431,6 +486,18 @@ void SparseMatrix::MultiplyVector(const double * vector, double * result) const
 
 void SparseMatrix::MultiplyVectorAdd(const double * vector, double * result) const
 {
+  if (entryArena != NULL)
+  {
+    for(int i=0; i<numRows; i++)
+    {
+      double entry = 0;
+      for(int k=rowPointers[i]; k < rowPointers[i+1]; k++)
+        entry += vector[columnIndexArena[k]] * entryArena[k];
+      result[i] += entry;
+    }
+    return;
+  }
+
   for(int i=0; i<numRows; i++)
     for(int j=0; j < rowLength[i]; j++)
       result[i] += vector[columnIndices[i][j]] * columnEntries[i][j];
@@ -536,6 +603,14 @@ SparseMatrix operator* (const double alpha, const SparseMatrix & mat2)
 
 SparseMatrix & SparseMatrix::operator*=(const double alpha)
 {
+  if (entryArena != NULL)
+  {
+    int numEntries = rowPointers[numRows];
+    for(int k=0; k<numEntries; k++)
+      entryArena[k] *= alpha;
+    return *this;
+  }
+
   for(int i=0; i<numRows; i++)
     for(int j=0; j < rowLength[i]; j++)
       columnEntries[i][j] *= alpha;
@@ -544,6 +619,14 @@ SparseMatrix & SparseMatrix::operator*=(const double alpha)
 
 SparseMatrix & SparseMatrix::operator+=(const SparseMatrix & mat2)
 {   
+  if ((entryArena != NULL) && (mat2.entryArena != NULL))
+  {
+    int numEntries = rowPointers[numRows];
+    for(int k=0; k<numEntries; k++)
+      entryArena[k] += mat2.entryArena[k];
+    return *this;
+  }
+
   for(int i=0; i<numRows; i++)
     for(int j=0; j < rowLength[i]; j++)
       columnEntries[i][j] += mat2.columnEntries[i][j];
@@ -552,6 +635,14 @@ SparseMatrix & SparseMatrix::operator+=(const SparseMatrix & mat2)
 
 SparseMatrix & SparseMatrix::operator-=(const SparseMatrix & mat2)
 {  
+  if ((entryArena != NULL) && (mat2.entryArena != NULL))
+  {
+    int numEntries = rowPointers[numRows];
+    for(int k=0; k<numEntries; k++)
+      entryArena[k] -= mat2.entryArena[k];
+    return *this;
+  }
+
   for(int i=0; i<numRows; i++)
     for(int j=0; j < rowLength[i]; j++)
       columnEntries[i][j] -= mat2.columnEntries[i][j]; 
@@ -560,6 +651,12 @@ SparseMatrix & SparseMatrix::operator-=(const SparseMatrix & mat2)
 
 SparseMatrix & SparseMatrix::operator=(const SparseMatrix & source)
 {
+  if ((entryArena != NULL) && (source.entryArena != NULL))
+  {
+    memcpy(entryArena, source.entryArena, sizeof(double) * rowPointers[numRows]);
+    return *this;
+  }
+
   for(int i=0; i<numRows; i++)
   {
     for(int j=0; j < rowLength[i]; j++)
@@ -574,6 +671,14 @@ void SparseMatrix::ScalarMultiply(const double alpha, SparseMatrix * dest)
   if (dest == NULL)
     dest = this;
 
+  if ((entryArena != NULL) && (dest->entryArena != NULL))
+  {
+    int numEntries = rowPointers[numRows];
+    for(int k=0; k<numEntries; k++)
+      dest->entryArena[k] = entryArena[k] * alpha;
+    return;
+  }
+
   for(int i=0; i<numRows; i++)
     for(int j=0; j < rowLength[i]; j++)
       dest->columnEntries[i][j] = columnEntries[i][j] * alpha;
@@ -584,6 +689,14 @@ void SparseMatrix::ScalarMultiplyAdd(const double alpha, SparseMatrix * dest)
   if (dest == NULL)
     dest = this;
 
+  if ((entryArena != NULL) && (dest->entryArena != NULL))
+  {
+    int numEntries = rowPointers[numRows];
+    for(int k=0; k<numEntries; k++)
+      dest->entryArena[k] += entryArena[k] * alpha;
+    return;
+  }
+
   for(int i=0; i<numRows; i++)
     for(int j=0; j < rowLength[i]; j++)
       dest->columnEntries[i][j] += columnEntries[i][j] * alpha;
@@ -591,6 +704,12 @@ void SparseMatrix::ScalarMultiplyAdd(const double alpha, SparseMatrix * dest)
 
 void SparseMatrix::ResetToZero()
 {
+  if (entryArena != NULL)
+  {
+    memset(entryArena, 0, sizeof(double) * rowPointers[numRows]);
+    return;
+  }
+
   for(int i=0; i<numRows; i++)
     memset(columnEntries[i], 0, sizeof(double) * rowLength[i]);
 }
@@ -718,6 +837,9 @@ void SparseMatrix::AddDiagonalMatrix(double constDiagonalElement)
 
 int SparseMatrix::GetNumEntries() const
 {
+  if (entryArena != NULL)
+    return rowPointers[numRows];
+
   int num = 0;
   for(int i=0; i<numRows; i++)
     num += rowLength[i];
@@ -748,6 +870,12 @@ void SparseMatrix::SumRowEntries(double * rowSums) const
 
 void SparseMatrix::MakeLinearDataArray(double * data) const
 {
+  if (entryArena != NULL)
+  {
+    memcpy(data, entryArena, sizeof(double) * rowPointers[numRows]);
+    return;
+  }
+
   int count=0;
   for(int i=0; i<numRows; i++)
   {
@@ -1180,6 +1308,19 @@ int SparseMatrix::GenerateNAGFormat(double * a, int * irow, int * icol, int * is
 
 void SparseMatrix::GenerateCompressedRowMajorFormat(double * a, int * ia, int * ja, int upperTriangleOnly, int oneIndexed) const
 {
+  if ((entryArena != NULL) && (!upperTriangleOnly) && (!oneIndexed))
+  {
+    // the arena is already in this format
+    int numEntries = rowPointers[numRows];
+    if (a != NULL)
+      memcpy(a, entryArena, sizeof(double) * numEntries);
+    if (ia != NULL)
+      memcpy(ia, rowPointers, sizeof(int) * (numRows + 1));
+    if (ja != NULL)
+      memcpy(ja, columnIndexArena, sizeof(int) * numEntries);
+    return;
+  }
+
   int count = 0;
   for(int row=0; row<numRows; row++)
   {
@@ -1187,17 +1328,23 @@ void SparseMatrix::GenerateCompressedRowMajorFormat(double * a, int * ia, int *
       ia[row] = count + oneIndexed;
 
     int rowLength = GetRowLength(row);
-    for(int j=0; j< rowLength; j++)
+    // column indices are sorted, so the upper triangle is a suffix of the row
+    int jStart = 0;
+    if (upperTriangleOnly)
     {
-      if ((!upperTriangleOnly) || (columnIndices[row][j] >= row))
-      {
-        if (a != NULL)
-          a[count] = columnEntries[row][j];         
-        if (ja != NULL)
-          ja[count] = columnIndices[row][j] + oneIndexed; 
-        count++;
-      }
+      while ((jStart < rowLength) && (columnIndices[row][jStart] < row))
+        jStart++;
     }
+
+    int length = rowLength - jStart;
+    if (a != NULL)
+      memcpy(&a[count], &columnEntries[row][jStart], sizeof(double) * length);
+    if (ja != NULL)
+    {
+      for(int j=jStart; j<rowLength; j++)
+        ja[count + j - jStart] = columnIndices[row][j] + oneIndexed; 
+    }
+    count += length;
   }
 
   if (ia != NULL)
@@ -1273,6 +1420,8 @@ int SparseMatrix::SaveToMatlabFormat(const char * filename) const
 
 void SparseMatrix::RemoveRowColumn(int index)
 {
+  int contiguous = ConvertToRowStorage(); // pattern changes are performed in per-row storage
+
   // remove row 'index'
   free(columnEntries[index]);
   free(columnIndices[index]);
@@ -1315,16 +1464,26 @@ void SparseMatrix::RemoveRowColumn(int index)
   }
 
   numRows--;
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 void SparseMatrix::RemoveRowsColumnsSlow(int numRemovedRowsColumns, int * removedRowsColumns, int oneIndexed)
 {
+  int contiguous = ConvertToRowStorage();
+
   for(int i=0; i<numRemovedRowsColumns; i++)
     RemoveRowColumn(removedRowsColumns[i]-i-oneIndexed);
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 void SparseMatrix::RemoveRowsColumns(int numRemovedRowsColumns, int * removedRowsColumns, int oneIndexed)
 {
+  int contiguous = ConvertToRowStorage();
+
   // the removed dofs must be pre-sorted
   // build a map from old dofs to new ones
   vector<int> oldToNew(numRows);
@@ -1384,10 +1543,15 @@ void SparseMatrix::RemoveRowsColumns(int numRemovedRowsColumns, int * removedRow
   columnEntries = (double**) realloc(columnEntries, sizeof(double*) * numRows);
   columnIndices = (int**) realloc(columnIndices, sizeof(int*) * numRows);
   rowLength = (int*) realloc(rowLength, sizeof(int) * numRows);
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 void SparseMatrix::RemoveColumn(int index)
 {
+  int contiguous = ConvertToRowStorage();
+
   // remove column 'index'
   for(int i=0; i<numRows; i++)
   {
@@ -1417,10 +1581,15 @@ void SparseMatrix::RemoveColumn(int index)
       }
     }   
   }
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 void SparseMatrix::RemoveColumns(int numRemovedColumns, int * removedColumns, int oneIndexed)
 {
+  int contiguous = ConvertToRowStorage();
+
   // the removed dofs must be pre-sorted
   // build a map from old dofs to new ones
   int numColumns = GetNumColumns();
@@ -1474,16 +1643,26 @@ void SparseMatrix::RemoveColumns(int numRemovedColumns, int * removedColumns, in
     columnEntries[row] = (double*) realloc(columnEntries[row], sizeof(double) * targetIndex);
     rowLength[row] = targetIndex;
   }
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 void SparseMatrix::RemoveColumnsSlow(int numColumns, int * columns, int oneIndexed)
 {
+  int contiguous = ConvertToRowStorage();
+
   for(int i=0; i<numColumns; i++)
     RemoveColumn(columns[i]-i-oneIndexed);
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 void SparseMatrix::RemoveRow(int index)
 {
+  int contiguous = ConvertToRowStorage();
+
   // remove row 'index'
   free(columnEntries[index]);
   free(columnIndices[index]);
@@ -1496,16 +1675,26 @@ void SparseMatrix::RemoveRow(int index)
   }
 
   numRows--;
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 void SparseMatrix::RemoveRowsSlow(int numRows, int * rows, int oneIndexed)
 {
+  int contiguous = ConvertToRowStorage();
+
   for(int i=0; i<numRows; i++)
     RemoveRow(rows[i]-i-oneIndexed);
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 void SparseMatrix::RemoveRows(int numRemovedRows, int * removedRows, int oneIndexed)
 {
+  int contiguous = ConvertToRowStorage();
+
   // the removed dofs must be pre-sorted
   // build a map from old dofs to new ones
   vector<int> oldToNew(numRows);
@@ -1550,6 +1739,9 @@ void SparseMatrix::RemoveRows(int numRemovedRows, int * removedRows, int oneInde
   columnEntries = (double**) realloc(columnEntries, sizeof(double*) * numRows);
   columnIndices = (int**) realloc(columnIndices, sizeof(double*) * numRows);
   rowLength = (int*) realloc(rowLength, sizeof(int) * numRows);
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 double SparseMatrix::GetInfinityNorm() const
@@ -1673,6 +1865,8 @@ int SparseMatrix::GetNumColumns() const
 
 void SparseMatrix::IncreaseNumRows(int numAddedRows)
 {
+  int contiguous = ConvertToRowStorage();
+
   int newn = numRows + numAddedRows;
 
   rowLength = (int*) realloc (rowLength, sizeof(int) * newn);
@@ -1688,6 +1882,9 @@ void SparseMatrix::IncreaseNumRows(int numAddedRows)
     columnEntries[numRows + i] = NULL;
 
   numRows = newn;
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 SparseMatrix SparseMatrix::ConjugateMatrix(SparseMatrix & U, int verbose)
@@ -1847,11 +2044,13 @@ SparseMatrix * SparseMatrix::Transpose(int numColumns)
 
 void SparseMatrix::SetRows(SparseMatrix * source, int startRow, int startColumn) 
 {
+  int contiguous = ConvertToRowStorage();
+
   for(int i=0; i<source->GetNumRows(); i++)
   {
     int row = startRow + i;
     if (row >= numRows)
-      return;
+      break;
 
     rowLength[row] = source->GetRowLength(i);
     columnIndices[row] = (int*) realloc (columnIndices[row], sizeof(int) * rowLength[row]);
@@ -1862,10 +2061,15 @@ void SparseMatrix::SetRows(SparseMatrix * source, int startRow, int startColumn)
       columnEntries[row][j] = source->columnEntries[i][j];
     }
   }
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 void SparseMatrix::AppendRowsColumns(SparseMatrix * source)
 {
+  int contiguous = ConvertToRowStorage();
+
   int * oldRowLengths = (int*) malloc (sizeof(int) * numRows);
   for(int i=0; i<numRows; i++)
     oldRowLengths[i] = rowLength[i];
@@ -1919,6 +2123,9 @@ void SparseMatrix::AppendRowsColumns(SparseMatrix * source)
     columnIndices[oldNumRows + row][rowLength[oldNumRows + row] - 1] = oldNumRows + row;
     columnEntries[oldNumRows + row][rowLength[oldNumRows + row] - 1] = 0.0;
   }  
+
+  if (contiguous)
+    ConvertToContiguousStorage();
 }
 
 SparseMatrix * SparseMatrix::CreateIdentityMatrix(int numRows)
@@ -1931,3 +2138,53 @@ SparseMatrix * SparseMatrix::CreateIdentityMatrix(int numRows)
   return mat;
 }
 
+void SparseMatrix::ConvertToContiguousStorage()
+{
+  if (entryArena != NULL)
+    return;
+
+  rowPointers = (int*) malloc (sizeof(int) * (numRows + 1));
+  rowPointers[0] = 0;
+  for(int i=0; i<numRows; i++)
+    rowPointers[i+1] = rowPointers[i] + rowLength[i];
+
+  int numEntries = rowPointers[numRows];
+  columnIndexArena = (int*) malloc (sizeof(int) * (numEntries > 0 ? numEntries : 1));
+  entryArena = (double*) malloc (sizeof(double) * (numEntries > 0 ? numEntries : 1));
+
+  for(int i=0; i<numRows; i++)
+  {
+    memcpy(&columnIndexArena[rowPointers[i]], columnIndices[i], sizeof(int) * rowLength[i]);
+    memcpy(&entryArena[rowPointers[i]], columnEntries[i], sizeof(double) * rowLength[i]);
+    free(columnIndices[i]);
+    free(columnEntries[i]);
+    columnIndices[i] = &columnIndexArena[rowPointers[i]];
+    columnEntries[i] = &entryArena[rowPointers[i]];
+  }
+}
+
+int SparseMatrix::ConvertToRowStorage()
+{
+  if (entryArena == NULL)
+    return 0;
+
+  for(int i=0; i<numRows; i++)
+  {
+    int * indices = (int*) malloc (sizeof(int) * rowLength[i]);
+    double * entries = (double*) malloc (sizeof(double) * rowLength[i]);
+    memcpy(indices, columnIndices[i], sizeof(int) * rowLength[i]);
+    memcpy(entries, columnEntries[i], sizeof(double) * rowLength[i]);
+    columnIndices[i] = indices;
+    columnEntries[i] = entries;
+  }
+
+  free(rowPointers);
+  free(columnIndexArena);
+  free(entryArena);
+  rowPointers = NULL;
+  columnIndexArena = NULL;
+  entryArena = NULL;
+
+  return 1;
+}
+
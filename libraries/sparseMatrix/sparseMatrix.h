@@ -40,6 +40,8 @@
   For each matrix row, the class stores the integer
   indices of the columns containing non-zero entries, 
   together with the corresponding double precision values. 
+  Optionally, all rows can be kept in a single contiguous arena 
+  (see ConvertToContiguousStorage).
   All quantities (rows, columns, etc.) in this class are 0-indexed.
 
   Also included is a Conjugate Gradient iterative linear system solver 
@@ -154,7 +156,7 @@ class SparseMatrix
 public:
 
   SparseMatrix(const char * filename); // load from text file (same text file format as SparseMatrixOutline)
-  SparseMatrix(SparseMatrixOutline * sparseMatrixOutline); // create it from the outline
+  SparseMatrix(SparseMatrixOutline * sparseMatrixOutline, int contiguousStorage=0); // create it from the outline (optionally, directly in contiguous storage; see below)
   SparseMatrix(const SparseMatrix & source); // copy constructor
   ~SparseMatrix();
 
@@ -346,6 +348,23 @@ public:
   inline double ** GetDataHandle() const { return columnEntries; }
   inline double * GetRowHandle(int row) const { return columnEntries[row]; }
 
+  // === contiguous storage ===
+  // By default, each row is stored in its own heap block.
+  // ConvertToContiguousStorage moves all rows into a single row-pointer/column/value arena 
+  // (standard 0-indexed compressed row storage). The per-row accessors (GetEntries, GetColumnIndices, 
+  // GetDataHandle, GetRowHandle, etc.) then point into the arena, so existing code works unchanged, 
+  // while algebraic operations on same-pattern matrices and matrix-vector products traverse a single linear array.
+  // Routines that change the sparsity pattern (RemoveRowsColumns, IncreaseNumRows, etc.) preserve the storage mode.
+  void ConvertToContiguousStorage();
+  // returns to per-row storage; returns 1 if the matrix was previously contiguous, 0 otherwise
+  int ConvertToRowStorage();
+  inline bool IsContiguous() const { return (entryArena != NULL); }
+  // zero-copy access to the arena (NULL if the matrix is not contiguous)
+  // the entries of row i are stored at positions rowPointers[i], ..., rowPointers[i+1]-1
+  inline int * GetRowPointers() const { return rowPointers; }
+  inline int * GetColumnIndexArena() const { return columnIndexArena; }
+  inline double * GetEntryArena() const { return entryArena; }
+
   // create a nxn identity matrix
   static SparseMatrix * CreateIdentityMatrix(int n);
 
@@ -357,6 +376,11 @@ protected:
   int ** columnIndices; // indices of columns of non-zero entries in each row
   double ** columnEntries; // values of non-zero entries in each row
 
+  // contiguous storage (all NULL unless ConvertToContiguousStorage has been called)
+  int * rowPointers; // length numRows+1
+  int * columnIndexArena;
+  double * entryArena;
+
   int * diagonalIndices;
   int ** transposedIndices;
 
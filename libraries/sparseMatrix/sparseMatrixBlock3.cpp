@@ -0,0 +1,392 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseMatrix" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "sparseMatrixBlock3.h"
+using namespace std;
+
+SparseMatrixBlock3::SparseMatrixBlock3(SparseMatrix * sparseMatrix)
+{
+  int numRows = sparseMatrix->GetNumRows();
+  if (numRows % 3 != 0)
+  {
+    printf("Error: the number of rows (%d) of a SparseMatrixBlock3 must be a multiple of 3.\n", numRows);
+    throw 1;
+  }
+  numBlockRows = numRows / 3;
+
+  // gather the block pattern (union over the three scalar rows of each block row)
+  blockRowPointers = (int*) malloc (sizeof(int) * (numBlockRows + 1));
+  vector<int> blockColumns;
+  vector<int> rowBlocks;
+  blockRowPointers[0] = 0;
+  for(int blockRow=0; blockRow<numBlockRows; blockRow++)
+  {
+    rowBlocks.clear();
+    for(int k=0; k<3; k++)
+    {
+      int row = 3 * blockRow + k;
+      for(int j=0; j<sparseMatrix->GetRowLength(row); j++)
+        rowBlocks.push_back(sparseMatrix->GetColumnIndex(row, j) / 3);
+    }
+    sort(rowBlocks.begin(), rowBlocks.end());
+    rowBlocks.erase(unique(rowBlocks.begin(), rowBlocks.end()), rowBlocks.end());
+    blockColumns.insert(blockColumns.end(), rowBlocks.begin(), rowBlocks.end());
+    blockRowPointers[blockRow+1] = (int) blockColumns.size();
+  }
+
+  Allocate(blockRowPointers[numBlockRows]);
+  if (blockColumns.size() > 0)
+    memcpy(blockColumnIndices, &blockColumns[0], sizeof(int) * blockColumns.size());
+
+  AssignFromSparseMatrix(sparseMatrix);
+}
+
+SparseMatrixBlock3::SparseMatrixBlock3(const SparseMatrixBlock3 & source)
+{
+  numBlockRows = source.numBlockRows;
+  blockRowPointers = (int*) malloc (sizeof(int) * (numBlockRows + 1));
+  memcpy(blockRowPointers, source.blockRowPointers, sizeof(int) * (numBlockRows + 1));
+
+  int numBlocks = blockRowPointers[numBlockRows];
+  Allocate(numBlocks);
+  memcpy(blockColumnIndices, source.blockColumnIndices, sizeof(int) * numBlocks);
+  memcpy(entries, source.entries, sizeof(double) * 9 * numBlocks);
+}
+
+// allocates the block column indices and the entries (blockRowPointers must be already set)
+void SparseMatrixBlock3::Allocate(int numBlocks)
+{
+  // allocate at least one block, so that an empty matrix still has valid pointers
+  int numAllocatedBlocks = (numBlocks > 0) ? numBlocks : 1;
+  blockColumnIndices = (int*) malloc (sizeof(int) * numAllocatedBlocks);
+  entries = (double*) malloc (sizeof(double) * 9 * numAllocatedBlocks);
+
+  numSubMatrixIDs = 0;
+  subMatrixIndices = NULL;
+  subMatrixIndexLengths = NULL;
+}
+
+SparseMatrixBlock3::~SparseMatrixBlock3()
+{
+  for(int i=0; i<numSubMatrixIDs; i++)
+    free(subMatrixIndices[i]);
+  free(subMatrixIndices);
+  free(subMatrixIndexLengths);
+
+  free(blockRowPointers);
+  free(blockColumnIndices);
+  free(entries);
+}
+
+int SparseMatrixBlock3::GetInverseIndex(int blockRow, int blockColumn) const
+{
+  // binary search (block column indices are sorted)
+  int low = blockRowPointers[blockRow];
+  int high = blockRowPointers[blockRow+1] - 1;
+  while (low <= high)
+  {
+    int middle = (low + high) / 2;
+    int column = blockColumnIndices[middle];
+    if (column == blockColumn)
+      return middle - blockRowPointers[blockRow];
+    if (column < blockColumn)
+      low = middle + 1;
+    else
+      high = middle - 1;
+  }
+  return -1;
+}
+
+void SparseMatrixBlock3::ResetToZero()
+{
+  memset(entries, 0, sizeof(double) * 9 * blockRowPointers[numBlockRows]);
+}
+
+SparseMatrixBlock3 & SparseMatrixBlock3::operator=(const SparseMatrixBlock3 & source)
+{
+  memcpy(entries, source.entries, sizeof(double) * 9 * blockRowPointers[numBlockRows]);
+  return *this;
+}
+
+SparseMatrixBlock3 & SparseMatrixBlock3::operator*=(const double alpha)
+{
+  int numEntries = 9 * blockRowPointers[numBlockRows];
+  for(int i=0; i<numEntries; i++)
+    entries[i] *= alpha;
+  return *this;
+}
+
+SparseMatrixBlock3 & SparseMatrixBlock3::operator+=(const SparseMatrixBlock3 & mat2)
+{
+  int numEntries = 9 * blockRowPointers[numBlockRows];
+  for(int i=0; i<numEntries; i++)
+    entries[i] += mat2.entries[i];
+  return *this;
+}
+
+SparseMatrixBlock3 & SparseMatrixBlock3::operator-=(const SparseMatrixBlock3 & mat2)
+{
+  int numEntries = 9 * blockRowPointers[numBlockRows];
+  for(int i=0; i<numEntries; i++)
+    entries[i] -= mat2.entries[i];
+  return *this;
+}
+
+void SparseMatrixBlock3::ScalarMultiply(const double alpha, SparseMatrixBlock3 * dest)
+{
+  if (dest == NULL)
+    dest = this;
+
+  int numEntries = 9 * blockRowPointers[numBlockRows];
+  for(int i=0; i<numEntries; i++)
+    dest->entries[i] = alpha * entries[i];
+}
+
+void SparseMatrixBlock3::ScalarMultiplyAdd(const double alpha, SparseMatrixBlock3 * dest)
+{
+  if (dest == NULL)
+    dest = this;
+
+  int numEntries = 9 * blockRowPointers[numBlockRows];
+  for(int i=0; i<numEntries; i++)
+    dest->entries[i] += alpha * entries[i];
+}
+
+void SparseMatrixBlock3::MultiplyVector(int startBlockRow, int endBlockRow, const double * vector, double * result) const
+{
+  for(int blockRow=startBlockRow; blockRow<endBlockRow; blockRow++)
+  {
+    // accumulate the three result entries in registers; each block reads 3 consecutive vector entries
+    double r0 = 0.0, r1 = 0.0, r2 = 0.0;
+    const double * block = &entries[9 * blockRowPointers[blockRow]];
+    for(int j=blockRowPointers[blockRow]; j<blockRowPointers[blockRow+1]; j++, block += 9)
+    {
+      const double * x = &vector[3 * blockColumnIndices[j]];
+      r0 += block[0] * x[0] + block[1] * x[1] + block[2] * x[2];
+      r1 += block[3] * x[0] + block[4] * x[1] + block[5] * x[2];
+      r2 += block[6] * x[0] + block[7] * x[1] + block[8] * x[2];
+    }
+    result[3 * blockRow + 0] = r0;
+    result[3 * blockRow + 1] = r1;
+    result[3 * blockRow + 2] = r2;
+  }
+}
+
+void SparseMatrixBlock3::MultiplyVector(const double * vector, double * result) const
+{
+  MultiplyVector(0, numBlockRows, vector, result);
+}
+
+void SparseMatrixBlock3::MultiplyVectorAdd(const double * vector, double * result) const
+{
+  for(int blockRow=0; blockRow<numBlockRows; blockRow++)
+  {
+    double r0 = 0.0, r1 = 0.0, r2 = 0.0;
+    const double * block = &entries[9 * blockRowPointers[blockRow]];
+    for(int j=blockRowPointers[blockRow]; j<blockRowPointers[blockRow+1]; j++, block += 9)
+    {
+      const double * x = &vector[3 * blockColumnIndices[j]];
+      r0 += block[0] * x[0] + block[1] * x[1] + block[2] * x[2];
+      r1 += block[3] * x[0] + block[4] * x[1] + block[5] * x[2];
+      r2 += block[6] * x[0] + block[7] * x[1] + block[8] * x[2];
+    }
+    result[3 * blockRow + 0] += r0;
+    result[3 * blockRow + 1] += r1;
+    result[3 * blockRow + 2] += r2;
+  }
+}
+
+void SparseMatrixBlock3::GetDiagonal(double * diagonal) const
+{
+  for(int blockRow=0; blockRow<numBlockRows; blockRow++)
+  {
+    int j = GetInverseIndex(blockRow, blockRow);
+    if (j < 0)
+    {
+      diagonal[3 * blockRow + 0] = diagonal[3 * blockRow + 1] = diagonal[3 * blockRow + 2] = 0.0;
+      continue;
+    }
+    const double * block = &entries[9 * (blockRowPointers[blockRow] + j)];
+    diagonal[3 * blockRow + 0] = block[0];
+    diagonal[3 * blockRow + 1] = block[4];
+    diagonal[3 * blockRow + 2] = block[8];
+  }
+}
+
+void SparseMatrixBlock3::BuildSubMatrixIndices(SparseMatrixBlock3 & submatrix, int subMatrixID)
+{
+  if (subMatrixID >= numSubMatrixIDs)
+  {
+    subMatrixIndices = (int**) realloc (subMatrixIndices, sizeof(int*) * (subMatrixID + 1));
+    subMatrixIndexLengths = (int*) realloc (subMatrixIndexLengths, sizeof(int) * (subMatrixID + 1));
+    for(int i=numSubMatrixIDs; i <= subMatrixID; i++)
+    {
+      subMatrixIndices[i] = NULL;
+      subMatrixIndexLengths[i] = 0;
+    }
+    numSubMatrixIDs = subMatrixID + 1;
+  }
+
+  free(subMatrixIndices[subMatrixID]);
+
+  // for each block of the submatrix, store the (global) block index in this matrix
+  int numSubBlocks = submatrix.GetNumBlocks();
+  subMatrixIndices[subMatrixID] = (int*) malloc (sizeof(int) * numSubBlocks);
+  subMatrixIndexLengths[subMatrixID] = numSubBlocks;
+
+  for(int blockRow=0; blockRow<numBlockRows; blockRow++)
+  {
+    for(int j=submatrix.blockRowPointers[blockRow]; j<submatrix.blockRowPointers[blockRow+1]; j++)
+    {
+      int blockColumn = submatrix.blockColumnIndices[j];
+      int index = GetInverseIndex(blockRow, blockColumn);
+      if (index < 0)
+      {
+        printf("Error (BuildSubMatrixIndices): given matrix is not a submatrix of this matrix. The following block does not exist in this matrix: (%d,%d)\n", blockRow, blockColumn);
+        exit(1);
+      }
+      subMatrixIndices[subMatrixID][j] = blockRowPointers[blockRow] + index;
+    }
+  }
+}
+
+void SparseMatrixBlock3::FreeSubMatrixIndices(int subMatrixID)
+{
+  if (subMatrixID >= numSubMatrixIDs)
+  {
+    printf("Warning: attempted to free submatrix index that does not exist.\n");
+    return;
+  }
+
+  free(subMatrixIndices[subMatrixID]);
+  subMatrixIndices[subMatrixID] = NULL;
+  subMatrixIndexLengths[subMatrixID] = 0;
+}
+
+SparseMatrixBlock3 & SparseMatrixBlock3::AddSubMatrix(double factor, SparseMatrixBlock3 & submatrix, int subMatrixID)
+{
+  int * indices = subMatrixIndices[subMatrixID];
+  int numSubBlocks = subMatrixIndexLengths[subMatrixID];
+  const double * block = submatrix.entries;
+  for(int j=0; j<numSubBlocks; j++, block += 9)
+  {
+    double * dest = &entries[9 * indices[j]];
+    for(int k=0; k<9; k++)
+      dest[k] += factor * block[k];
+  }
+
+  return *this;
+}
+
+SparseMatrix * SparseMatrixBlock3::CreateSparseMatrix(int contiguousStorage) const
+{
+  SparseMatrixOutline outline(3 * numBlockRows);
+  for(int blockRow=0; blockRow<numBlockRows; blockRow++)
+    for(int j=blockRowPointers[blockRow]; j<blockRowPointers[blockRow+1]; j++)
+    {
+      const double * block = &entries[9 * j];
+      for(int k=0; k<3; k++)
+        for(int l=0; l<3; l++)
+          outline.AddEntry(3 * blockRow + k, 3 * blockColumnIndices[j] + l, block[3 * k + l]);
+    }
+
+  return new SparseMatrix(&outline, contiguousStorage);
+}
+
+void SparseMatrixBlock3::AssignToSparseMatrix(SparseMatrix * sparseMatrix) const
+{
+  double ** dataHandle = sparseMatrix->GetDataHandle();
+  for(int blockRow=0; blockRow<numBlockRows; blockRow++)
+  {
+    int blockRowLength = blockRowPointers[blockRow+1] - blockRowPointers[blockRow];
+    const double * rowBlocks = &entries[9 * blockRowPointers[blockRow]];
+    for(int k=0; k<3; k++)
+    {
+      int row = 3 * blockRow + k;
+      if (sparseMatrix->GetRowLength(row) == 3 * blockRowLength)
+      {
+        // the scalar row consists of full blocks: entry 3*j+l is entry (k,l) of the j-th block
+        for(int j=0; j<blockRowLength; j++)
+          for(int l=0; l<3; l++)
+            dataHandle[row][3 * j + l] = rowBlocks[9 * j + 3 * k + l];
+        continue;
+      }
+
+      for(int j=0; j<sparseMatrix->GetRowLength(row); j++)
+      {
+        int column = sparseMatrix->GetColumnIndex(row, j);
+        int index = GetInverseIndex(blockRow, column / 3);
+        if (index < 0)
+        {
+          printf("Error (AssignToSparseMatrix): entry (%d,%d) does not lie inside a block of the block matrix.\n", row, column);
+          exit(1);
+        }
+        dataHandle[row][j] = rowBlocks[9 * index + 3 * k + column % 3];
+      }
+    }
+  }
+}
+
+void SparseMatrixBlock3::AssignFromSparseMatrix(SparseMatrix * sparseMatrix)
+{
+  ResetToZero();
+  for(int blockRow=0; blockRow<numBlockRows; blockRow++)
+  {
+    int blockRowLength = blockRowPointers[blockRow+1] - blockRowPointers[blockRow];
+    double * rowBlocks = &entries[9 * blockRowPointers[blockRow]];
+    for(int k=0; k<3; k++)
+    {
+      int row = 3 * blockRow + k;
+      if (sparseMatrix->GetRowLength(row) == 3 * blockRowLength)
+      {
+        for(int j=0; j<blockRowLength; j++)
+          for(int l=0; l<3; l++)
+            rowBlocks[9 * j + 3 * k + l] = sparseMatrix->GetEntry(row, 3 * j + l);
+        continue;
+      }
+
+      for(int j=0; j<sparseMatrix->GetRowLength(row); j++)
+      {
+        int column = sparseMatrix->GetColumnIndex(row, j);
+        int index = GetInverseIndex(blockRow, column / 3);
+        if (index < 0)
+        {
+          printf("Error (AssignFromSparseMatrix): entry (%d,%d) does not lie inside a block of the block matrix.\n", row, column);
+          exit(1);
+        }
+        rowBlocks[9 * index + 3 * k + column % 3] = sparseMatrix->GetEntry(row, j);
+      }
+    }
+  }
+}
+
@@ -0,0 +1,137 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseMatrix" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef _SPARSE_MATRIX_BLOCK3_H_
+#define _SPARSE_MATRIX_BLOCK3_H_
+
+/*
+  A sparse matrix made of dense 3x3 blocks (block compressed sparse row format, BSR).
+
+  FEM stiffness and mass matrices couple all three degrees of freedom of one vertex
+  to all three degrees of freedom of another vertex. This class stores one column index
+  per 3x3 block (instead of one per scalar entry), and keeps all blocks in a single
+  contiguous array, 9 doubles per block, each block in row-major order.
+  Block rows and block columns correspond to mesh vertices; scalar row 3*i+k belongs to block row i.
+
+  Block column indices are sorted within each block row, so the j-th block in a block row
+  of this class corresponds to the scalar entry at position 3*j in each of the three scalar rows of
+  a SparseMatrix with the same (block) sparsity pattern (such as the matrices returned by
+  StVKStiffnessMatrix::GetStiffnessMatrixTopology). Consequently, the acceleration indices
+  computed by the force models for SparseMatrix can be used directly to address the blocks of this class.
+
+  A SparseMatrixBlock3 is created from a SparseMatrix (whose dimension must be a multiple of 3).
+  Any 3x3 block that contains at least one non-zero location of the SparseMatrix becomes a block
+  of the SparseMatrixBlock3; the missing entries of such blocks are stored explicitly as zeros.
+
+  See also sparseMatrix.h .
+*/
+
+#include "sparseMatrix.h"
+
+class SparseMatrixBlock3
+{
+public:
+
+  SparseMatrixBlock3(SparseMatrix * sparseMatrix); // creates the block matrix from a scalar matrix (number of rows must be a multiple of 3)
+  SparseMatrixBlock3(const SparseMatrixBlock3 & source); // copy constructor
+  ~SparseMatrixBlock3();
+
+  inline int GetNumRows() const { return 3 * numBlockRows; }
+  inline int GetNumBlockRows() const { return numBlockRows; }
+  inline int GetNumBlocks() const { return blockRowPointers[numBlockRows]; }
+  inline int GetNumEntries() const { return 9 * blockRowPointers[numBlockRows]; } // includes the explicitly stored zeros
+  inline int GetBlockRowLength(int blockRow) const { return blockRowPointers[blockRow+1] - blockRowPointers[blockRow]; }
+  // returns the block column index of the j-th block in the given block row
+  inline int GetBlockColumnIndex(int blockRow, int j) const { return blockColumnIndices[blockRowPointers[blockRow] + j]; }
+  // returns the 9 entries (row-major) of the j-th block in the given block row
+  inline double * GetBlock(int blockRow, int j) { return &entries[9 * (blockRowPointers[blockRow] + j)]; }
+
+  // finds the position of block column "blockColumn" in the given block row; returns -1 if the block does not exist
+  int GetInverseIndex(int blockRow, int blockColumn) const;
+
+  // direct access to the BSR arrays
+  inline int * GetBlockRowPointers() const { return blockRowPointers; } // length numBlockRows + 1
+  inline int * GetBlockColumnIndices() const { return blockColumnIndices; } // length GetNumBlocks()
+  inline double * GetEntries() const { return entries; } // length 9 * GetNumBlocks()
+
+  // adds factor * block (9 entries, row-major) to the j-th block in the given block row
+  inline void AddBlock(int blockRow, int j, const double * block, double factor=1.0);
+  void ResetToZero();
+
+  // matrix algebra (all involved matrices must have the same pattern of non-zero blocks)
+  SparseMatrixBlock3 & operator=(const SparseMatrixBlock3 & source);
+  SparseMatrixBlock3 & operator*=(const double alpha);
+  SparseMatrixBlock3 & operator+=(const SparseMatrixBlock3 & mat2);
+  SparseMatrixBlock3 & operator-=(const SparseMatrixBlock3 & mat2);
+  void ScalarMultiply(const double alpha, SparseMatrixBlock3 * dest=NULL); // dest = alpha * this (if dest=NULL, operation is applied to this object)
+  void ScalarMultiplyAdd(const double alpha, SparseMatrixBlock3 * dest=NULL); // dest += alpha * this (if dest=NULL, operation is applied to this object)
+
+  // multiplies the block matrix with the given vector (of length 3 * numBlockRows)
+  void MultiplyVector(const double * vector, double * result) const; // result = A * vector
+  void MultiplyVectorAdd(const double * vector, double * result) const; // result += A * vector
+  void MultiplyVector(int startBlockRow, int endBlockRow, const double * vector, double * result) const; // result = A(3*startBlockRow:3*endBlockRow-1,:) * vector
+
+  void GetDiagonal(double * diagonal) const; // diagonal has length 3 * numBlockRows; missing diagonal blocks give zero diagonal entries
+
+  // same semantics as the corresponding routines of SparseMatrix, except that they operate on blocks:
+  // the block pattern of "submatrix" must be a subset of the block pattern of this matrix
+  void BuildSubMatrixIndices(SparseMatrixBlock3 & submatrix, int subMatrixID=0);
+  void FreeSubMatrixIndices(int subMatrixID=0);
+  // += factor * submatrix ; returns *this
+  SparseMatrixBlock3 & AddSubMatrix(double factor, SparseMatrixBlock3 & submatrix, int subMatrixID=0);
+
+  // conversions to/from SparseMatrix
+  SparseMatrix * CreateSparseMatrix(int contiguousStorage=0) const; // returns a new scalar matrix containing all 9 entries of every block
+  // copies the entries into an existing scalar matrix; every non-zero location of sparseMatrix must lie inside a block of this matrix
+  // (this is the case, for example, for the matrix that this block matrix was created from)
+  void AssignToSparseMatrix(SparseMatrix * sparseMatrix) const;
+  // the reverse: overwrites the blocks with the entries of sparseMatrix (entries outside of sparseMatrix's pattern are set to zero)
+  void AssignFromSparseMatrix(SparseMatrix * sparseMatrix);
+
+protected:
+  int numBlockRows;
+  int * blockRowPointers;
+  int * blockColumnIndices;
+  double * entries;
+
+  int numSubMatrixIDs;
+  int ** subMatrixIndices;
+  int * subMatrixIndexLengths;
+
+  void Allocate(int numBlocks);
+};
+
+inline void SparseMatrixBlock3::AddBlock(int blockRow, int j, const double * block, double factor)
+{
+  double * dest = &entries[9 * (blockRowPointers[blockRow] + j)];
+  for(int k=0; k<9; k++)
+    dest[k] += factor * block[k];
+}
+
+#endif
+
@@ -0,0 +1,298 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseMatrix" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "sparseMatrixLinearCombination.h"
+
+SparseMatrixLinearCombination::SparseMatrixLinearCombination(SparseMatrix * pattern_): pattern(pattern_), numTerms(0), terms(NULL), numFixedRowColumns(NULL), fixedRowColumns(NULL), termRows(NULL), termRowOffsets(NULL), termOutputPositions(NULL), termEntryPositions(NULL), termHasPattern(NULL)
+{
+  numRows = pattern->GetNumRows();
+}
+
+SparseMatrixLinearCombination::~SparseMatrixLinearCombination()
+{
+  for(int term=0; term<numTerms; term++)
+  {
+    free(fixedRowColumns[term]);
+    free(termRows[term]);
+    free(termRowOffsets[term]);
+    free(termOutputPositions[term]);
+    free(termEntryPositions[term]);
+  }
+  free(terms);
+  free(numFixedRowColumns);
+  free(fixedRowColumns);
+  free(termRows);
+  free(termRowOffsets);
+  free(termOutputPositions);
+  free(termEntryPositions);
+  free(termHasPattern);
+}
+
+int SparseMatrixLinearCombination::AddTerm(SparseMatrix * matrix)
+{
+  return AddTerm(matrix, 0, NULL);
+}
+
+int SparseMatrixLinearCombination::AddTerm(SparseMatrix * matrix, int numFixedRowColumns_, int * fixedRowColumns_, int oneIndexed)
+{
+  int term = numTerms;
+  numTerms++;
+  terms = (SparseMatrix**) realloc (terms, sizeof(SparseMatrix*) * numTerms);
+  numFixedRowColumns = (int*) realloc (numFixedRowColumns, sizeof(int) * numTerms);
+  fixedRowColumns = (int**) realloc (fixedRowColumns, sizeof(int*) * numTerms);
+  termRows = (int**) realloc (termRows, sizeof(int*) * numTerms);
+  termRowOffsets = (int**) realloc (termRowOffsets, sizeof(int*) * numTerms);
+  termOutputPositions = (int**) realloc (termOutputPositions, sizeof(int*) * numTerms);
+  termEntryPositions = (int**) realloc (termEntryPositions, sizeof(int*) * numTerms);
+  termHasPattern = (int*) realloc (termHasPattern, sizeof(int) * numTerms);
+
+  terms[term] = matrix;
+  numFixedRowColumns[term] = numFixedRowColumns_;
+  fixedRowColumns[term] = NULL;
+  if (numFixedRowColumns_ > 0)
+  {
+    fixedRowColumns[term] = (int*) malloc (sizeof(int) * numFixedRowColumns_);
+    for(int i=0; i<numFixedRowColumns_; i++)
+      fixedRowColumns[term][i] = fixedRowColumns_[i] - oneIndexed;
+  }
+  termRows[term] = (int*) malloc (sizeof(int) * numRows);
+  termRowOffsets[term] = NULL;
+  termOutputPositions[term] = NULL;
+  termEntryPositions[term] = NULL;
+
+  BuildMaps(term);
+  return term;
+}
+
+void SparseMatrixLinearCombination::SetTerm(int term, SparseMatrix * matrix)
+{
+  terms[term] = matrix;
+  BuildMaps(term);
+}
+
+void SparseMatrixLinearCombination::BuildMaps(int term)
+{
+  SparseMatrix * matrix = terms[term];
+  int numFixed = numFixedRowColumns[term];
+  int * fixed = fixedRowColumns[term];
+  int numFullRows = matrix->GetNumRows();
+  if (numFullRows != numRows + numFixed)
+  {
+    printf("Error in SparseMatrixLinearCombination: term %d has %d rows, but the pattern has %d rows and %d rows are removed from the term.\n", term, numFullRows, numRows, numFixed);
+    exit(1);
+  }
+
+  // the term matrix is square (up to empty trailing columns), with the same DOFs removed from its rows and columns
+  int numFull = matrix->GetNumColumns();
+  if (numFull < numFullRows)
+    numFull = numFullRows;
+  int patternColumns = pattern->GetNumColumns();
+  if (numFull < patternColumns + numFixed)
+    numFull = patternColumns + numFixed;
+
+  // fullDOFs[i] is the DOF of the term matrix corresponding to the DOF i of the pattern; isFixed marks the removed DOFs
+  int * fullDOFs = (int*) malloc (sizeof(int) * (numFull - numFixed));
+  char * isFixed = (char*) calloc (numFull, sizeof(char));
+  for(int i=0; i<numFixed; i++)
+  {
+    if ((fixed[i] < 0) || (fixed[i] >= numFull) || ((i > 0) && (fixed[i] <= fixed[i-1])))
+    {
+      printf("Error in SparseMatrixLinearCombination: the removed rows/columns must be sorted, distinct, and in the range [0, %d).\n", numFull);
+      exit(1);
+    }
+    isFixed[fixed[i]] = 1;
+  }
+  int numReduced = 0;
+  for(int i=0; i<numFull; i++)
+    if (!isFixed[i])
+      fullDOFs[numReduced++] = i;
+
+  free(termRowOffsets[term]);
+  free(termOutputPositions[term]);
+  free(termEntryPositions[term]);
+  termRowOffsets[term] = (int*) malloc (sizeof(int) * (numRows + 1));
+  termOutputPositions[term] = (int*) malloc (sizeof(int) * pattern->GetNumEntries());
+  termEntryPositions[term] = (int*) malloc (sizeof(int) * pattern->GetNumEntries());
+
+  int * rows = termRows[term];
+  int * rowOffsets = termRowOffsets[term];
+  int * outputPositions = termOutputPositions[term];
+  int * entryPositions = termEntryPositions[term];
+
+  // for each row, scatter the positions of the term row into a dense array, and look up the pattern entries
+  int * denseRowPositions = (int*) malloc (sizeof(int) * numFull);
+  for(int i=0; i<numFull; i++)
+    denseRowPositions[i] = -1;
+
+  int ** patternColumnIndices = pattern->GetColumnIndices();
+  int ** termColumnIndices = matrix->GetColumnIndices();
+  int numMissedEntries = 0;
+  int hasPattern = 1;
+  rowOffsets[0] = 0;
+  for(int i=0; i<numRows; i++)
+  {
+    int fullRow = fullDOFs[i];
+    rows[i] = fullRow;
+    int termRowLength = matrix->GetRowLength(fullRow);
+    for(int j=0; j<termRowLength; j++)
+      denseRowPositions[termColumnIndices[fullRow][j]] = j;
+
+    int numEntries = rowOffsets[i];
+    int patternRowLength = pattern->GetRowLength(i);
+    for(int j=0; j<patternRowLength; j++)
+    {
+      int position = denseRowPositions[fullDOFs[patternColumnIndices[i][j]]];
+      if (position < 0)
+        continue;
+      outputPositions[numEntries] = j;
+      entryPositions[numEntries] = position;
+      numEntries++;
+      if (position != j)
+        hasPattern = 0;
+    }
+    rowOffsets[i+1] = numEntries;
+
+    if ((fullRow != i) || (termRowLength != patternRowLength) || (numEntries - rowOffsets[i] != patternRowLength))
+      hasPattern = 0;
+
+    // every entry of the term (outside the removed columns) must be in the pattern
+    int numTermEntries = 0;
+    for(int j=0; j<termRowLength; j++)
+    {
+      if (!isFixed[termColumnIndices[fullRow][j]])
+        numTermEntries++;
+      denseRowPositions[termColumnIndices[fullRow][j]] = -1;
+    }
+    numMissedEntries += numTermEntries - (numEntries - rowOffsets[i]);
+  }
+
+  free(denseRowPositions);
+  free(isFixed);
+  free(fullDOFs);
+
+  if (numMissedEntries > 0)
+  {
+    printf("Error in SparseMatrixLinearCombination: %d entries of term %d are not in the pattern.\n", numMissedEntries, term);
+    exit(1);
+  }
+
+  termHasPattern[term] = hasPattern;
+  if (hasPattern)
+  {
+    // the entry lists are not needed
+    free(termOutputPositions[term]);
+    free(termEntryPositions[term]);
+    termOutputPositions[term] = NULL;
+    termEntryPositions[term] = NULL;
+  }
+  else
+  {
+    termOutputPositions[term] = (int*) realloc (termOutputPositions[term], sizeof(int) * (rowOffsets[numRows] + 1));
+    termEntryPositions[term] = (int*) realloc (termEntryPositions[term], sizeof(int) * (rowOffsets[numRows] + 1));
+  }
+}
+
+void SparseMatrixLinearCombination::Evaluate(const double * factors, SparseMatrix * output) const
+{
+  double ** outputEntries = output->GetEntries();
+  int * rowLengths = pattern->GetRowLengths();
+
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
+  for(int i=0; i<numRows; i++)
+  {
+    double * outputRow = outputEntries[i];
+    int rowLength = rowLengths[i];
+    for(int j=0; j<rowLength; j++)
+      outputRow[j] = 0.0;
+
+    for(int term=0; term<numTerms; term++)
+    {
+      double factor = factors[term];
+      if (factor == 0.0)
+        continue;
+      const double * termRow = terms[term]->GetEntries()[termRows[term][i]];
+      if (termHasPattern[term])
+      {
+        for(int j=0; j<rowLength; j++)
+          outputRow[j] += factor * termRow[j];
+      }
+      else
+      {
+        const int * outputPositions = termOutputPositions[term];
+        const int * entryPositions = termEntryPositions[term];
+        for(int k=termRowOffsets[term][i]; k<termRowOffsets[term][i+1]; k++)
+          outputRow[outputPositions[k]] += factor * termRow[entryPositions[k]];
+      }
+    }
+  }
+}
+
+void SparseMatrixLinearCombination::MultiplyVector(const double * factors, const double * const * vectors, double * result) const
+{
+  int ** columnIndices = pattern->GetColumnIndices();
+  int * rowLengths = pattern->GetRowLengths();
+
+  #ifdef USE_OPENMP
+    #pragma omp parallel for
+  #endif
+  for(int i=0; i<numRows; i++)
+  {
+    const int * rowColumns = columnIndices[i];
+    double sum = 0.0;
+    for(int term=0; term<numTerms; term++)
+    {
+      double factor = factors[term];
+      const double * vector = vectors[term];
+      if ((factor == 0.0) || (vector == NULL))
+        continue;
+      const double * termRow = terms[term]->GetEntries()[termRows[term][i]];
+      double termSum = 0.0;
+      if (termHasPattern[term])
+      {
+        int rowLength = rowLengths[i];
+        for(int j=0; j<rowLength; j++)
+          termSum += termRow[j] * vector[rowColumns[j]];
+      }
+      else
+      {
+        const int * outputPositions = termOutputPositions[term];
+        const int * entryPositions = termEntryPositions[term];
+        for(int k=termRowOffsets[term][i]; k<termRowOffsets[term][i+1]; k++)
+          termSum += termRow[entryPositions[k]] * vector[rowColumns[outputPositions[k]]];
+      }
+      sum += factor * termSum;
+    }
+    result[i] = sum;
+  }
+}
+
@@ -0,0 +1,107 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseMatrix" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef _SPARSE_MATRIX_LINEAR_COMBINATION_H_
+#define _SPARSE_MATRIX_LINEAR_COMBINATION_H_
+
+/*
+  Evaluates linear combinations of sparse matrices whose non-zero patterns are subsets of a common pattern,
+  such as the effective stiffness matrix of an implicit integrator:
+    output = c_0 * K + c_1 * M + c_2 * C
+  where the patterns of M and C are subsets of the pattern of K.
+
+  The routines SparseMatrix::AddSubMatrix, ScalarMultiply etc. require one pass over the output matrix per term.
+  This class precomputes, once, for each term, the list of its non-zero entries and their locations in the common pattern,
+  and then evaluates all terms in a single pass over the output entries. Terms that have exactly the common pattern
+  (such as the stiffness matrix itself) are traversed directly, without any index lists.
+  The same precomputed maps are used to evaluate sums of matrix-vector products of the terms, 
+    result = c_0 * K * x_0 + c_1 * M * x_1 + c_2 * C * x_2
+  in a single traversal of the pattern.
+
+  A term may also be a matrix from which some rows and columns have been removed (fixed degrees of freedom),
+  i.e., the common pattern is the pattern of the term matrix after calling SparseMatrix::RemoveRowsColumns on it.
+  This makes it possible to assemble a linear combination of full matrices directly into a constrained matrix.
+
+  The term matrices are referenced, not copied, and must outlive this object. Their values can change freely
+  between evaluations; if the pattern (or storage) of a term matrix changes, call SetTerm to recompute the maps.
+  The loops run in parallel if the code is compiled with -fopenmp -DUSE_OPENMP (see the Makefile-header file).
+
+  See also sparseMatrix.h .
+*/
+
+#include "sparseMatrix.h"
+
+class SparseMatrixLinearCombination
+{
+public:
+
+  // "pattern" gives the non-zero pattern of the linear combination; it is referenced (not copied) and must outlive this object
+  SparseMatrixLinearCombination(SparseMatrix * pattern);
+  ~SparseMatrixLinearCombination();
+
+  // adds a term with the same dimensions as the pattern; the pattern of "matrix" must be a subset of the pattern
+  // returns the index of the new term
+  int AddTerm(SparseMatrix * matrix);
+  // adds a term with the rows and columns "fixedRowColumns" removed (sorted, and given with respect to "matrix");
+  // the pattern of "matrix", with these rows and columns removed, must be a subset of the pattern
+  int AddTerm(SparseMatrix * matrix, int numFixedRowColumns, int * fixedRowColumns, int oneIndexed=0);
+  // replaces the matrix of an existing term (keeping its fixed rows and columns), and recomputes the maps
+  void SetTerm(int term, SparseMatrix * matrix);
+
+  inline int GetNumTerms() const { return numTerms; }
+  inline SparseMatrix * GetTerm(int term) const { return terms[term]; }
+
+  // output = sum_t factors[t] * term_t
+  // "output" must have the same pattern as the pattern matrix given in the constructor (it may be the pattern matrix itself, but not a term)
+  // terms with a zero factor are skipped
+  void Evaluate(const double * factors, SparseMatrix * output) const;
+
+  // result = sum_t factors[t] * term_t * vectors[t]
+  // the vectors are indexed like the columns of the pattern; terms with a NULL vector or a zero factor are skipped
+  void MultiplyVector(const double * factors, const double * const * vectors, double * result) const;
+
+protected:
+  SparseMatrix * pattern;
+  int numRows;
+
+  int numTerms;
+  SparseMatrix ** terms;
+  int * numFixedRowColumns; // for each term
+  int ** fixedRowColumns; // for each term (0-indexed), NULL if none
+  int ** termRows; // for each term: row of the term matrix corresponding to each row of the pattern
+  // for each term, the entries of the term, row by row (not used if the term has exactly the common pattern, see below):
+  int ** termRowOffsets; // start of the entries of each pattern row; length numRows + 1
+  int ** termOutputPositions; // position of the entry in the pattern row
+  int ** termEntryPositions; // position of the entry in the term row
+  int * termHasPattern; // 1 if the term has exactly the common pattern (entry j of a pattern row is entry j of the term row), 0 otherwise
+
+  void BuildMaps(int term);
+};
+
+#endif
+
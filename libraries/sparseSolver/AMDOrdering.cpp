@@ -0,0 +1,350 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseSolver" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include "AMDOrdering.h"
+using namespace std;
+
+void AMDOrdering::ComputePermutation(const SparseMatrix * A, int * perm)
+{
+  int n = A->Getn();
+  if (n == 0)
+    return;
+
+  int ** columnIndices = A->GetColumnIndices();
+  int * rowLengths = A->GetRowLengths();
+
+  // compress consecutive rows with identical patterns into a single node
+  int * rowToNode = (int*) malloc (sizeof(int) * n);
+  int * nodeStart = (int*) malloc (sizeof(int) * (n+1)); // first row of each node
+  int numNodes = 0;
+  for(int row=0; row<n; row++)
+  {
+    int sameAsPrevious = (row > 0) && (rowLengths[row] == rowLengths[row-1]) &&
+      (memcmp(columnIndices[row], columnIndices[row-1], sizeof(int) * rowLengths[row]) == 0);
+    if (!sameAsPrevious)
+      nodeStart[numNodes++] = row;
+    rowToNode[row] = numNodes - 1;
+  }
+  nodeStart[numNodes] = n;
+
+  // build the node adjacency graph
+  int * nodeWeights = (int*) malloc (sizeof(int) * numNodes);
+  int * adjacencyStart = (int*) malloc (sizeof(int) * (numNodes+1));
+  int * mark = (int*) malloc (sizeof(int) * numNodes);
+  for(int node=0; node<numNodes; node++)
+    mark[node] = -1;
+  vector<int> adjacency;
+  adjacency.reserve(A->GetNumEntries() / 3 + numNodes);
+  for(int node=0; node<numNodes; node++)
+  {
+    nodeWeights[node] = nodeStart[node+1] - nodeStart[node];
+    adjacencyStart[node] = (int)adjacency.size();
+    mark[node] = node;
+    int row = nodeStart[node];
+    for(int j=0; j<rowLengths[row]; j++)
+    {
+      int neighbor = rowToNode[columnIndices[row][j]];
+      if (mark[neighbor] != node)
+      {
+        mark[neighbor] = node;
+        adjacency.push_back(neighbor);
+      }
+    }
+  }
+  adjacencyStart[numNodes] = (int)adjacency.size();
+
+  int * nodePerm = (int*) malloc (sizeof(int) * numNodes);
+  ComputePermutation(numNodes, adjacencyStart, adjacency.size() > 0 ? &adjacency[0] : NULL, nodeWeights, nodePerm);
+
+  // expand the nodes back into rows
+  int k = 0;
+  for(int i=0; i<numNodes; i++)
+  {
+    int node = nodePerm[i];
+    for(int row=nodeStart[node]; row<nodeStart[node+1]; row++)
+      perm[k++] = row;
+  }
+
+  free(nodePerm);
+  free(mark);
+  free(adjacencyStart);
+  free(nodeWeights);
+  free(nodeStart);
+  free(rowToNode);
+}
+
+void AMDOrdering::ComputePermutation(int n, const int * adjacencyStart, const int * adjacency, const int * nodeWeights, int * perm)
+{
+  // node status
+  enum { VARIABLE, ELEMENT, DEAD };
+
+  vector<int> status(n, VARIABLE);
+  vector<int> nv(n); // number of matrix rows represented by a (super)variable
+  vector<int> degree(n); // approximate external degree of a variable
+  vector<int> elementSize(n, 0); // number of matrix rows (sum of nv) of the variables in an element
+  vector<int> w(n, 0); // |Le \ Lp| during the current step
+  vector<int> mark(n, -1);
+  vector<int> wMark(n, -1);
+  vector< vector<int> > A(n); // variables adjacent to a variable
+  vector< vector<int> > E(n); // elements adjacent to a variable
+  vector< vector<int> > L(n); // variables of an element
+  vector< vector<int> > merged(n); // variables merged into a supervariable
+  set< pair<int,int> > queue; // (degree, variable)
+
+  int numLeft = 0;
+  for(int i=0; i<n; i++)
+  {
+    nv[i] = (nodeWeights == NULL) ? 1 : nodeWeights[i];
+    numLeft += nv[i];
+    A[i].assign(adjacency + adjacencyStart[i], adjacency + adjacencyStart[i+1]);
+  }
+
+  for(int i=0; i<n; i++)
+  {
+    degree[i] = 0;
+    for(size_t j=0; j<A[i].size(); j++)
+      degree[i] += nv[A[i][j]];
+    queue.insert(make_pair(degree[i], i));
+  }
+
+  vector<int> order;
+  order.reserve(n);
+  vector< pair<unsigned int, int> > hashes;
+
+  int step = 0;
+  while (!queue.empty())
+  {
+    // select the variable of minimum approximate degree
+    int p = queue.begin()->second;
+    queue.erase(queue.begin());
+    step++;
+
+    // form the new element Lp: the union of A_p and the variables of all elements adjacent to p
+    // the elements adjacent to p are absorbed into the new element
+    vector<int> & Lp = L[p];
+    Lp.clear();
+    mark[p] = step;
+    for(size_t k=0; k<E[p].size(); k++)
+    {
+      int e = E[p][k];
+      if (status[e] != ELEMENT)
+        continue;
+      for(size_t j=0; j<L[e].size(); j++)
+      {
+        int i = L[e][j];
+        if ((status[i] == VARIABLE) && (mark[i] != step))
+        {
+          mark[i] = step;
+          Lp.push_back(i);
+        }
+      }
+      status[e] = DEAD;
+      vector<int>().swap(L[e]);
+    }
+    for(size_t j=0; j<A[p].size(); j++)
+    {
+      int i = A[p][j];
+      if ((status[i] == VARIABLE) && (mark[i] != step))
+      {
+        mark[i] = step;
+        Lp.push_back(i);
+      }
+    }
+    vector<int>().swap(A[p]);
+    vector<int>().swap(E[p]);
+
+    status[p] = ELEMENT;
+    order.push_back(p);
+    numLeft -= nv[p];
+
+    elementSize[p] = 0;
+    for(size_t j=0; j<Lp.size(); j++)
+    {
+      int i = Lp[j];
+      elementSize[p] += nv[i];
+      queue.erase(make_pair(degree[i], i));
+    }
+
+    // update the adjacency lists of the variables in Lp:
+    // remove dead elements and add p; remove the variables now reachable via p
+    for(size_t j=0; j<Lp.size(); j++)
+    {
+      int i = Lp[j];
+      vector<int> & Ei = E[i];
+      size_t numKept = 0;
+      for(size_t k=0; k<Ei.size(); k++)
+        if (status[Ei[k]] == ELEMENT)
+          Ei[numKept++] = Ei[k];
+      Ei.resize(numKept);
+      Ei.push_back(p);
+
+      vector<int> & Ai = A[i];
+      numKept = 0;
+      for(size_t k=0; k<Ai.size(); k++)
+        if ((status[Ai[k]] == VARIABLE) && (mark[Ai[k]] != step))
+          Ai[numKept++] = Ai[k];
+      Ai.resize(numKept);
+    }
+
+    // supervariable detection: variables of Lp with identical A and E lists are indistinguishable
+    hashes.clear();
+    for(size_t j=0; j<Lp.size(); j++)
+    {
+      int i = Lp[j];
+      sort(A[i].begin(), A[i].end());
+      sort(E[i].begin(), E[i].end());
+      unsigned int hash = 0;
+      for(size_t k=0; k<A[i].size(); k++)
+        hash += (unsigned int)A[i][k];
+      for(size_t k=0; k<E[i].size(); k++)
+        hash += (unsigned int)E[i][k];
+      hashes.push_back(make_pair(hash, i));
+    }
+    sort(hashes.begin(), hashes.end());
+    for(size_t j=0; j<hashes.size(); j++)
+    {
+      int i = hashes[j].second;
+      if (status[i] != VARIABLE)
+        continue;
+      for(size_t k=j+1; (k<hashes.size()) && (hashes[k].first == hashes[j].first); k++)
+      {
+        int i2 = hashes[k].second;
+        if ((status[i2] != VARIABLE) || (A[i2] != A[i]) || (E[i2] != E[i]))
+          continue;
+        // merge i2 into i
+        nv[i] += nv[i2];
+        nv[i2] = 0;
+        status[i2] = DEAD;
+        merged[i].push_back(i2);
+        vector<int>().swap(A[i2]);
+        vector<int>().swap(E[i2]);
+      }
+    }
+
+    // compute w(e) = |Le \ Lp| for all elements e adjacent to the variables in Lp
+    for(size_t j=0; j<Lp.size(); j++)
+    {
+      int i = Lp[j];
+      if (status[i] != VARIABLE)
+        continue;
+      for(size_t k=0; k<E[i].size(); k++)
+      {
+        int e = E[i][k];
+        if (e == p)
+          continue;
+        if (wMark[e] != step)
+        {
+          wMark[e] = step;
+          w[e] = elementSize[e];
+        }
+        w[e] -= nv[i];
+      }
+    }
+
+    // element absorption (elements that are subsets of Lp) and mass elimination
+    // (variables only adjacent to p are eliminated together with p)
+    for(size_t j=0; j<Lp.size(); j++)
+    {
+      int i = Lp[j];
+      if (status[i] != VARIABLE)
+        continue;
+      vector<int> & Ei = E[i];
+      size_t numKept = 0;
+      for(size_t k=0; k<Ei.size(); k++)
+      {
+        int e = Ei[k];
+        if (status[e] != ELEMENT)
+          continue;
+        if ((e != p) && (w[e] <= 0))
+        {
+          status[e] = DEAD;
+          vector<int>().swap(L[e]);
+          continue;
+        }
+        Ei[numKept++] = e;
+      }
+      Ei.resize(numKept);
+
+      if ((Ei.size() == 1) && (A[i].size() == 0))
+      {
+        status[i] = DEAD;
+        order.push_back(i);
+        numLeft -= nv[i];
+        elementSize[p] -= nv[i];
+        vector<int>().swap(Ei);
+      }
+    }
+
+    // approximate external degrees
+    size_t numKept = 0;
+    for(size_t j=0; j<Lp.size(); j++)
+    {
+      int i = Lp[j];
+      if (status[i] != VARIABLE)
+        continue;
+      Lp[numKept++] = i;
+
+      int d = elementSize[p] - nv[i];
+      for(size_t k=0; k<E[i].size(); k++)
+      {
+        int e = E[i][k];
+        if ((e != p) && (status[e] == ELEMENT))
+          d += w[e];
+      }
+      for(size_t k=0; k<A[i].size(); k++)
+        d += nv[A[i][k]];
+      if (d > numLeft - nv[i])
+        d = numLeft - nv[i];
+      degree[i] = d;
+      queue.insert(make_pair(d, i));
+    }
+    Lp.resize(numKept);
+  }
+
+  // expand the supervariables
+  int numOrdered = 0;
+  vector<int> stack;
+  for(size_t k=0; k<order.size(); k++)
+  {
+    stack.push_back(order[k]);
+    while (!stack.empty())
+    {
+      int i = stack.back();
+      stack.pop_back();
+      perm[numOrdered++] = i;
+      for(size_t j=0; j<merged[i].size(); j++)
+        stack.push_back(merged[i][j]);
+    }
+  }
+}
+
@@ -0,0 +1,69 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseSolver" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef _AMDORDERING_H_
+#define _AMDORDERING_H_
+
+/*
+  Computes a fill-reducing ordering of a sparse symmetric matrix,
+  using the approximate minimum degree (AMD) algorithm:
+
+  P.R. Amestoy, T.A. Davis, I.S. Duff:
+  An Approximate Minimum Degree Ordering Algorithm,
+  SIAM Journal on Matrix Analysis and Applications 17(4), 1996
+
+  The elimination is simulated on a quotient graph (variables and elements),
+  using approximate external degrees, element absorption, mass elimination
+  and supervariable detection (indistinguishable variables are eliminated together).
+
+  Before the ordering, consecutive rows of the matrix with identical sparsity patterns
+  (such as the three rows of each vertex of an FEM matrix) are compressed into a single
+  weighted graph node. This reduces the size of the graph by a factor of 3 for FEM matrices.
+
+  Only the sparsity pattern of the matrix is used. The pattern must be structurally symmetric.
+
+  Output:
+    perm: array of length n; perm[k] is the (original) index of the row/column that is eliminated k-th,
+      i.e., the reordered matrix is PA(i,j) = A(perm[i], perm[j])
+*/
+
+#include "sparseMatrix.h"
+
+class AMDOrdering
+{
+public:
+  static void ComputePermutation(const SparseMatrix * A, int * perm);
+
+  // same, for a graph given in compressed adjacency format:
+  // the neighbors of node i are adjacency[adjacencyStart[i]], ..., adjacency[adjacencyStart[i+1]-1] (no self-loops, no duplicates)
+  // nodeWeights: number of matrix rows represented by each node (NULL = all 1)
+  static void ComputePermutation(int numNodes, const int * adjacencyStart, const int * adjacency, const int * nodeWeights, int * perm);
+};
+
+#endif
+
@@ -0,0 +1,456 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseSolver" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "CGPreconditioner.h"
+
+CGPreconditioner::CGPreconditioner(preconditionerType type_, SparseMatrix * A_): type(type_), A(A_)
+{
+  numRows = A->GetNumRows();
+  diagonalIndices = (int*) malloc (sizeof(int) * numRows);
+  BuildDiagonalIndices();
+}
+
+CGPreconditioner::~CGPreconditioner()
+{
+  free(diagonalIndices);
+}
+
+void CGPreconditioner::BuildDiagonalIndices()
+{
+  for(int i=0; i<numRows; i++)
+  {
+    diagonalIndices[i] = A->GetInverseIndex(i, i);
+    if (diagonalIndices[i] < 0)
+    {
+      printf("Error: CGPreconditioner: diagonal entry %d is missing from the sparse matrix.\n", i);
+      exit(1);
+    }
+  }
+}
+
+CGPreconditioner * CGPreconditioner::CreatePreconditioner(preconditionerType type, SparseMatrix * A)
+{
+  switch (type)
+  {
+    case JACOBI:
+      return new JacobiPreconditioner(A);
+    case BLOCK_JACOBI3:
+      return new BlockJacobi3Preconditioner(A);
+    case SSOR:
+      return new SSORPreconditioner(A);
+    case IC0:
+      return new IC0Preconditioner(A);
+    default:
+      printf("Error: unknown CG preconditioner %d.\n", (int)type);
+      return NULL;
+  }
+}
+
+const char * CGPreconditioner::GetPreconditionerName(preconditionerType type)
+{
+  switch (type)
+  {
+    case JACOBI:
+      return "JACOBI";
+    case BLOCK_JACOBI3:
+      return "BLOCK_JACOBI3";
+    case SSOR:
+      return "SSOR";
+    case IC0:
+      return "IC0";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+int CGPreconditioner::GetPreconditionerType(const char * preconditionerName, preconditionerType * type)
+{
+  for(int i=0; i<NUM_PRECONDITIONER_TYPES; i++)
+  {
+    if (strcmp(preconditionerName, GetPreconditionerName((preconditionerType)i)) == 0)
+    {
+      *type = (preconditionerType)i;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+  Jacobi
+*/
+
+JacobiPreconditioner::JacobiPreconditioner(SparseMatrix * A_): CGPreconditioner(JACOBI, A_)
+{
+  invDiagonal = (double*) malloc (sizeof(double) * numRows);
+}
+
+JacobiPreconditioner::~JacobiPreconditioner()
+{
+  free(invDiagonal);
+}
+
+int JacobiPreconditioner::Update()
+{
+  int code = 0;
+  for(int i=0; i<numRows; i++)
+  {
+    double diagonal = A->GetEntry(i, diagonalIndices[i]);
+    if (diagonal == 0.0)
+    {
+      invDiagonal[i] = 1.0;
+      code = 1;
+    }
+    else
+      invDiagonal[i] = 1.0 / diagonal;
+  }
+  return code;
+}
+
+void JacobiPreconditioner::Apply(const double * r, double * z)
+{
+  for(int i=0; i<numRows; i++)
+    z[i] = invDiagonal[i] * r[i];
+}
+
+/*
+  3x3 block Jacobi
+*/
+
+BlockJacobi3Preconditioner::BlockJacobi3Preconditioner(SparseMatrix * A_): CGPreconditioner(BLOCK_JACOBI3, A_)
+{
+  if (numRows % 3 != 0)
+  {
+    printf("Error: BlockJacobi3Preconditioner: matrix dimension %d is not a multiple of 3.\n", numRows);
+    exit(1);
+  }
+
+  numBlocks = numRows / 3;
+  blockIndices = (int*) malloc (sizeof(int) * 9 * numBlocks);
+  invBlocks = (double*) malloc (sizeof(double) * 9 * numBlocks);
+  for(int block=0; block<numBlocks; block++)
+    for(int k=0; k<3; k++)
+      for(int l=0; l<3; l++)
+        blockIndices[9 * block + 3 * k + l] = A->GetInverseIndex(3 * block + k, 3 * block + l);
+}
+
+BlockJacobi3Preconditioner::~BlockJacobi3Preconditioner()
+{
+  free(blockIndices);
+  free(invBlocks);
+}
+
+int BlockJacobi3Preconditioner::Update()
+{
+  int code = 0;
+  for(int block=0; block<numBlocks; block++)
+  {
+    double M[9];
+    for(int k=0; k<3; k++)
+      for(int l=0; l<3; l++)
+      {
+        int index = blockIndices[9 * block + 3 * k + l];
+        M[3 * k + l] = (index >= 0) ? A->GetEntry(3 * block + k, index) : 0.0;
+      }
+
+    double * inv = &invBlocks[9 * block];
+    // inverse via the adjugate
+    inv[0] = M[4] * M[8] - M[5] * M[7];
+    inv[1] = M[2] * M[7] - M[1] * M[8];
+    inv[2] = M[1] * M[5] - M[2] * M[4];
+    inv[3] = M[5] * M[6] - M[3] * M[8];
+    inv[4] = M[0] * M[8] - M[2] * M[6];
+    inv[5] = M[2] * M[3] - M[0] * M[5];
+    inv[6] = M[3] * M[7] - M[4] * M[6];
+    inv[7] = M[1] * M[6] - M[0] * M[7];
+    inv[8] = M[0] * M[4] - M[1] * M[3];
+    double det = M[0] * inv[0] + M[1] * inv[3] + M[2] * inv[6];
+
+    double scale = fabs(M[0]) + fabs(M[4]) + fabs(M[8]);
+    if (fabs(det) > 1E-14 * scale * scale * scale)
+    {
+      double invDet = 1.0 / det;
+      for(int k=0; k<9; k++)
+        inv[k] *= invDet;
+    }
+    else
+    {
+      // singular block: fall back to the diagonal
+      for(int k=0; k<9; k++)
+        inv[k] = 0.0;
+      for(int k=0; k<3; k++)
+      {
+        if (M[4 * k] == 0.0)
+        {
+          inv[4 * k] = 1.0;
+          code = 1;
+        }
+        else
+          inv[4 * k] = 1.0 / M[4 * k];
+      }
+    }
+  }
+  return code;
+}
+
+void BlockJacobi3Preconditioner::Apply(const double * r, double * z)
+{
+  for(int block=0; block<numBlocks; block++)
+  {
+    const double * inv = &invBlocks[9 * block];
+    double r0 = r[3 * block + 0];
+    double r1 = r[3 * block + 1];
+    double r2 = r[3 * block + 2];
+    z[3 * block + 0] = inv[0] * r0 + inv[1] * r1 + inv[2] * r2;
+    z[3 * block + 1] = inv[3] * r0 + inv[4] * r1 + inv[5] * r2;
+    z[3 * block + 2] = inv[6] * r0 + inv[7] * r1 + inv[8] * r2;
+  }
+}
+
+/*
+  SSOR
+*/
+
+SSORPreconditioner::SSORPreconditioner(SparseMatrix * A_, double omega_): CGPreconditioner(SSOR, A_), omega(omega_)
+{
+  if ((omega <= 0.0) || (omega >= 2.0))
+  {
+    printf("Error: SSORPreconditioner: omega must be in the interval (0, 2). Value given: %G.\n", omega);
+    exit(1);
+  }
+
+  scaledDiagonal = (double*) malloc (sizeof(double) * numRows);
+  invScaledDiagonal = (double*) malloc (sizeof(double) * numRows);
+}
+
+SSORPreconditioner::~SSORPreconditioner()
+{
+  free(scaledDiagonal);
+  free(invScaledDiagonal);
+}
+
+int SSORPreconditioner::Update()
+{
+  // the off-diagonal entries are read directly from A in Apply
+  int code = 0;
+  for(int i=0; i<numRows; i++)
+  {
+    double diagonal = A->GetEntry(i, diagonalIndices[i]);
+    if (diagonal == 0.0)
+    {
+      diagonal = 1.0;
+      code = 1;
+    }
+    scaledDiagonal[i] = diagonal / omega;
+    invScaledDiagonal[i] = omega / diagonal;
+  }
+  return code;
+}
+
+void SSORPreconditioner::Apply(const double * r, double * z)
+{
+  int ** columnIndices = A->GetColumnIndices();
+  double ** columnEntries = A->GetEntries();
+  int * rowLengths = A->GetRowLengths();
+
+  // forward substitution: (D / omega + L) * y = r
+  for(int i=0; i<numRows; i++)
+  {
+    double sum = r[i];
+    int * rowColumns = columnIndices[i];
+    double * rowEntries = columnEntries[i];
+    for(int j=0; j<rowLengths[i]; j++)
+    {
+      int column = rowColumns[j];
+      if (column < i)
+        sum -= rowEntries[j] * z[column];
+    }
+    z[i] = sum * invScaledDiagonal[i];
+  }
+
+  // y := (2 - omega) / omega * D * y = (2 - omega) * (D / omega) * y
+  for(int i=0; i<numRows; i++)
+    z[i] *= (2.0 - omega) * scaledDiagonal[i];
+
+  // backward substitution: (D / omega + L^T) * z = y ; L^T is the strictly upper triangle of the symmetric A
+  for(int i=numRows-1; i>=0; i--)
+  {
+    double sum = z[i];
+    int * rowColumns = columnIndices[i];
+    double * rowEntries = columnEntries[i];
+    for(int j=0; j<rowLengths[i]; j++)
+    {
+      int column = rowColumns[j];
+      if (column > i)
+        sum -= rowEntries[j] * z[column];
+    }
+    z[i] = sum * invScaledDiagonal[i];
+  }
+}
+
+/*
+  IC(0)
+*/
+
+IC0Preconditioner::IC0Preconditioner(SparseMatrix * A_): CGPreconditioner(IC0, A_), shift(0.0)
+{
+  // extract the pattern of the lower triangle of A, sorted by columns within each row
+  rowStarts = (int*) malloc (sizeof(int) * (numRows + 1));
+  rowStarts[0] = 0;
+  for(int i=0; i<numRows; i++)
+  {
+    int count = 0;
+    for(int j=0; j<A->GetRowLength(i); j++)
+      if (A->GetColumnIndex(i, j) <= i)
+        count++;
+    rowStarts[i+1] = rowStarts[i] + count;
+  }
+
+  int numEntries = rowStarts[numRows];
+  columns = (int*) malloc (sizeof(int) * numEntries);
+  entryIndices = (int*) malloc (sizeof(int) * numEntries);
+  values = (double*) malloc (sizeof(double) * numEntries);
+  rowPositions = (int*) malloc (sizeof(int) * numRows);
+
+  for(int i=0; i<numRows; i++)
+  {
+    rowPositions[i] = -1;
+    int pos = rowStarts[i];
+    for(int j=0; j<A->GetRowLength(i); j++)
+    {
+      int column = A->GetColumnIndex(i, j);
+      if (column > i)
+        continue;
+      // insertion sort (rows of A are normally already sorted)
+      int k = pos;
+      while ((k > rowStarts[i]) && (columns[k-1] > column))
+      {
+        columns[k] = columns[k-1];
+        entryIndices[k] = entryIndices[k-1];
+        k--;
+      }
+      columns[k] = column;
+      entryIndices[k] = j;
+      pos++;
+    }
+    // the diagonal entry is last (BuildDiagonalIndices has verified that it exists)
+  }
+}
+
+IC0Preconditioner::~IC0Preconditioner()
+{
+  free(rowStarts);
+  free(columns);
+  free(entryIndices);
+  free(values);
+  free(rowPositions);
+}
+
+int IC0Preconditioner::Update()
+{
+  // shifted incomplete Cholesky: on breakdown, factor A + shift * diag(A) instead
+  shift = 0.0;
+  const int maxShiftAttempts = 20;
+  for(int attempt=0; attempt<maxShiftAttempts; attempt++)
+  {
+    if (Factor(shift) == 0)
+      return 0;
+    shift = (shift == 0.0) ? 1E-3 : 2.0 * shift;
+  }
+
+  printf("Warning: IC0Preconditioner: incomplete Cholesky factorization failed (last diagonal shift: %G).\n", shift);
+  return 1;
+}
+
+int IC0Preconditioner::Factor(double shift)
+{
+  double ** columnEntries = A->GetEntries();
+  for(int i=0; i<numRows; i++)
+  {
+    int rowStart = rowStarts[i];
+    int diagonal = rowStarts[i+1] - 1;
+    for(int p=rowStart; p<diagonal; p++)
+      rowPositions[columns[p]] = p;
+
+    // l_ik = (a_ik - sum_{m<k} l_im * l_km) / l_kk , restricted to the pattern of A
+    for(int p=rowStart; p<diagonal; p++)
+    {
+      int k = columns[p];
+      double sum = columnEntries[i][entryIndices[p]];
+      for(int q=rowStarts[k]; q<rowStarts[k+1]-1; q++)
+      {
+        int position = rowPositions[columns[q]];
+        if (position >= 0)
+          sum -= values[position] * values[q];
+      }
+      values[p] = sum / values[rowStarts[k+1]-1];
+    }
+
+    // l_ii = sqrt(a_ii - sum_{m<i} l_im^2)
+    double sum = (1.0 + shift) * columnEntries[i][entryIndices[diagonal]];
+    for(int p=rowStart; p<diagonal; p++)
+      sum -= values[p] * values[p];
+
+    for(int p=rowStart; p<diagonal; p++)
+      rowPositions[columns[p]] = -1;
+
+    if (!(sum > 0.0))
+      return 1;
+    values[diagonal] = sqrt(sum);
+  }
+
+  return 0;
+}
+
+void IC0Preconditioner::Apply(const double * r, double * z)
+{
+  // forward substitution: L * y = r
+  for(int i=0; i<numRows; i++)
+  {
+    double sum = r[i];
+    int diagonal = rowStarts[i+1] - 1;
+    for(int p=rowStarts[i]; p<diagonal; p++)
+      sum -= values[p] * z[columns[p]];
+    z[i] = sum / values[diagonal];
+  }
+
+  // backward substitution: L^T * z = y (column-oriented traversal of the rows of L)
+  for(int i=numRows-1; i>=0; i--)
+  {
+    int diagonal = rowStarts[i+1] - 1;
+    z[i] /= values[diagonal];
+    double zi = z[i];
+    for(int p=rowStarts[i]; p<diagonal; p++)
+      z[columns[p]] -= values[p] * zi;
+  }
+}
+
@@ -0,0 +1,171 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseSolver" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+/*
+  Preconditioners for the conjugate gradient solver (CGSolver.h).
+
+  Each preconditioner approximates M ~= A, for a symmetric positive-definite sparse matrix A,
+  and applies z = M^{-1} * r. The preconditioner is set up in two phases:
+  - the constructor analyzes the sparsity pattern of A (done only once per matrix pattern),
+  - "Update" recomputes the preconditioner numerically from the current entries of A.
+  Call "Update" before the first call to "Apply", and each time the entries of A change
+  (e.g., once per Newton iteration of an implicit integrator).
+
+  Available preconditioners:
+  JACOBI: M = diag(A)
+  BLOCK_JACOBI3: M = block-diagonal part of A, with 3x3 blocks (one block per simulation vertex);
+    the dimension of A must be a multiple of 3
+  SSOR: symmetric successive over-relaxation,
+    M = omega / (2 - omega) * (D / omega + L) * D^{-1} * (D / omega + L^T), where A = L + D + L^T, 0 < omega < 2;
+    omega=1 gives the symmetric Gauss-Seidel preconditioner
+  IC0: incomplete Cholesky factorization with zero fill-in, M = L * L^T, where L has the same sparsity pattern as the lower triangle of A;
+    if the factorization breaks down (non-positive pivot), the diagonal of A is increased and the factorization is repeated
+    (Manteuffel's shifted incomplete Cholesky)
+
+  The stronger preconditioners are more expensive per CG iteration, but usually converge in far fewer iterations.
+  IC0 and SSOR are applied with sequential triangular solves.
+  The matrix A is not copied: the preconditioner keeps a pointer to it.
+
+  See also CGSolver.h, sparseMatrix.h .
+*/
+
+#ifndef _CGPRECONDITIONER_H_
+#define _CGPRECONDITIONER_H_
+
+#include "sparseMatrix.h"
+
+class CGPreconditioner
+{
+public:
+  typedef enum { JACOBI, BLOCK_JACOBI3, SSOR, IC0, NUM_PRECONDITIONER_TYPES } preconditionerType;
+
+  virtual ~CGPreconditioner();
+
+  // creates a preconditioner of the given type for matrix A (SSOR uses omega=1)
+  static CGPreconditioner * CreatePreconditioner(preconditionerType type, SparseMatrix * A);
+
+  // recomputes the preconditioner from the current entries of A (the pattern of A must not have changed)
+  // returns 0 on success, and non-zero on failure
+  virtual int Update() = 0;
+
+  // computes z = M^{-1} * r ; z and r may be the same array
+  virtual void Apply(const double * r, double * z) = 0;
+
+  inline preconditionerType GetPreconditionerType() const { return type; }
+  inline const char * GetPreconditionerName() const { return GetPreconditionerName(type); }
+  inline int GetNumRows() const { return numRows; }
+
+  // returns "JACOBI", "BLOCK_JACOBI3", "SSOR" or "IC0"
+  static const char * GetPreconditionerName(preconditionerType type);
+  // converts a preconditioner name (see GetPreconditionerName) to the preconditioner type; returns 0 on success, and 1 if the name is unknown
+  static int GetPreconditionerType(const char * preconditionerName, preconditionerType * type);
+
+protected:
+  CGPreconditioner(preconditionerType type, SparseMatrix * A);
+
+  preconditionerType type;
+  SparseMatrix * A;
+  int numRows;
+  int * diagonalIndices; // position of the diagonal entry in each row of A
+
+  void BuildDiagonalIndices(); // exits if a diagonal entry is missing
+};
+
+class JacobiPreconditioner : public CGPreconditioner
+{
+public:
+  JacobiPreconditioner(SparseMatrix * A);
+  virtual ~JacobiPreconditioner();
+
+  virtual int Update();
+  virtual void Apply(const double * r, double * z);
+
+protected:
+  double * invDiagonal;
+};
+
+class BlockJacobi3Preconditioner : public CGPreconditioner
+{
+public:
+  BlockJacobi3Preconditioner(SparseMatrix * A);
+  virtual ~BlockJacobi3Preconditioner();
+
+  // singular diagonal blocks are replaced by their diagonal
+  virtual int Update();
+  virtual void Apply(const double * r, double * z);
+
+protected:
+  int numBlocks;
+  int * blockIndices; // 9 per block: position of each block entry in its row of A, or -1 if the entry is not in the pattern of A
+  double * invBlocks; // 9 per block, row-major
+};
+
+class SSORPreconditioner : public CGPreconditioner
+{
+public:
+  SSORPreconditioner(SparseMatrix * A, double omega=1.0);
+  virtual ~SSORPreconditioner();
+
+  virtual int Update();
+  virtual void Apply(const double * r, double * z);
+
+  inline double GetOmega() const { return omega; }
+
+protected:
+  double omega;
+  double * scaledDiagonal; // diag(A) / omega
+  double * invScaledDiagonal;
+};
+
+class IC0Preconditioner : public CGPreconditioner
+{
+public:
+  IC0Preconditioner(SparseMatrix * A);
+  virtual ~IC0Preconditioner();
+
+  // returns 1 if the factorization failed even after shifting the diagonal
+  virtual int Update();
+  virtual void Apply(const double * r, double * z);
+
+  // the relative diagonal shift used in the last Update (0 if the unshifted factorization succeeded)
+  inline double GetShift() const { return shift; }
+
+protected:
+  // the lower-triangular factor L, stored by rows (the diagonal entry is the last entry in each row)
+  int * rowStarts;
+  int * columns;
+  int * entryIndices; // position of each entry of L in its row of A
+  double * values;
+  int * rowPositions; // workspace: position of each column in the current row of L, or -1
+  double shift;
+
+  int Factor(double shift); // returns 0 on success, 1 on a non-positive pivot
+};
+
+#endif
+
@@ -31,7 +31,7 @@
 #include <stdio.h>
 #include "CGSolver.h"
 
-CGSolver::CGSolver(SparseMatrix * A_): A(A_) 
+CGSolver::CGSolver(SparseMatrix * A_): A(A_), blockA(NULL)
 {
   numRows = A->GetNumRows();
   InitBuffers();
@@ -40,7 +40,16 @@ CGSolver::CGSolver(SparseMatrix * A_): A(A_)
   invDiagonal = NULL;
 }
 
-CGSolver::CGSolver(int numRows_, blackBoxProductType callBackFunction_, void * data_, double * diagonal): numRows(numRows_), multiplicator(callBackFunction_), multiplicatorData(data_), A(NULL)
+CGSolver::CGSolver(SparseMatrixBlock3 * A_): A(NULL), blockA(A_)
+{
+  numRows = blockA->GetNumRows();
+  InitBuffers();
+  multiplicator = CGSolver::Block3Multiplicator;
+  multiplicatorData = (void*)blockA;
+  invDiagonal = NULL;
+}
+
+CGSolver::CGSolver(int numRows_, blackBoxProductType callBackFunction_, void * data_, double * diagonal): numRows(numRows_), multiplicator(callBackFunction_), multiplicatorData(data_), A(NULL), blockA(NULL)
 {
   InitBuffers();
   invDiagonal = (double*) malloc (sizeof(double) * numRows);
@@ -61,6 +70,7 @@ CGSolver::~CGSolver()
   free(r);
   free(d);
   free(q);
+  free(s);
   free(invDiagonal);
 }
 
@@ -70,11 +80,25 @@ void CGSolver::DefaultMultiplicator(const void * data, const double * x, double
   A->MultiplyVector(x, Ax);
 }
 
+void CGSolver::Block3Multiplicator(const void * data, const double * x, double * Ax)
+{
+  SparseMatrixBlock3 * A = (SparseMatrixBlock3*)data;
+  A->MultiplyVector(x, Ax);
+}
+
 void CGSolver::InitBuffers()
 {
   r = (double*) malloc (sizeof(double) * numRows);
   d = (double*) malloc (sizeof(double) * numRows);
   q = (double*) malloc (sizeof(double) * numRows);
+  s = (double*) malloc (sizeof(double) * numRows);
+  convergenceCriterion = RELATIVE_TO_INITIAL_RESIDUAL;
+}
+
+double CGSolver::GetRhsNorm2(double rhsNorm2, double initialResidualNorm2)
+{
+  // for a zero right-hand side, fall back to the initial residual
+  return (rhsNorm2 > 0) ? rhsNorm2 : initialResidualNorm2;
 }
 
 // implements the virtual method from LinearSolver by calling "SolveLinearSystem" with default parameters
@@ -95,6 +119,8 @@ int CGSolver::SolveLinearSystemWithoutPreconditioner(double * x, const double *
 
   double residualNorm2 = ComputeDotProduct(r, r);
   double initialResidualNorm2 = residualNorm2;
+  if (convergenceCriterion == RELATIVE_TO_RHS)
+    initialResidualNorm2 = GetRhsNorm2(ComputeDotProduct((double*)b, (double*)b), initialResidualNorm2);
 
   while ((residualNorm2 > eps * eps * initialResidualNorm2) && (iteration <= maxIterations))
   {
@@ -139,14 +165,18 @@ int CGSolver::SolveLinearSystemWithJacobiPreconditioner(double * x, const double
 {
   if (invDiagonal == NULL)
   {
-    // This code will only execute when the class was constructed via the "SparseMatrix * A_" constructor (and only once).
+    // This code will only execute when the class was constructed via the "SparseMatrix * A_" or "SparseMatrixBlock3 * A_" constructor (and only once).
     // In the "blackBoxProductType callBackFunction_" constructor, invDiagonal would have already been set to non-NULL.
 
     // extract diagonal entries
-    A->BuildDiagonalIndices(); // note: if indices are already built, this call will do nothing (you can therefore also call BuildDiagonalIndices() once and for all before calling SolveLinearSystemWithJacobiPreconditioner); in any case, BuildDiagonalIndices() is fast (a single linear traversal of all matrix elements)
-
     invDiagonal = (double*) malloc (sizeof(double) * numRows);
-    A->GetDiagonal(invDiagonal);
+    if (blockA != NULL)
+      blockA->GetDiagonal(invDiagonal);
+    else
+    {
+      A->BuildDiagonalIndices(); // note: if indices are already built, this call will do nothing (you can therefore also call BuildDiagonalIndices() once and for all before calling SolveLinearSystemWithJacobiPreconditioner); in any case, BuildDiagonalIndices() is fast (a single linear traversal of all matrix elements)
+      A->GetDiagonal(invDiagonal);
+    }
     for(int i=0; i<numRows; i++)
       invDiagonal[i] = 1.0 / invDiagonal[i]; // potential division by zero here (uncommon in practice)
   }
@@ -161,6 +191,8 @@ int CGSolver::SolveLinearSystemWithJacobiPreconditioner(double * x, const double
 
   double residualNorm2 = ComputeTriDotProduct(r, r, invDiagonal);
   double initialResidualNorm2 = residualNorm2;
+  if (convergenceCriterion == RELATIVE_TO_RHS)
+    initialResidualNorm2 = GetRhsNorm2(ComputeTriDotProduct((double*)b, (double*)b, invDiagonal), initialResidualNorm2);
 
   while ((residualNorm2 > eps * eps * initialResidualNorm2) && (iteration <= maxIterations))
   {
@@ -205,6 +237,72 @@ int CGSolver::SolveLinearSystemWithJacobiPreconditioner(double * x, const double
   return (iteration-1) * ((residualNorm2 > eps * eps * initialResidualNorm2) ? -1 : 1);
 }
 
+int CGSolver::SolveLinearSystemWithPreconditioner(CGPreconditioner * preconditioner, double * x, const double * b, double eps, int maxIterations, int verbose)
+{
+  if (preconditioner->GetNumRows() != numRows)
+  {
+    printf("Error: preconditioner dimension (%d) does not match the matrix dimension (%d).\n", preconditioner->GetNumRows(), numRows);
+    return 0;
+  }
+
+  int iteration=1;
+  multiplicator(multiplicatorData, x, r); //A->MultiplyVector(x,r);
+  for (int i=0; i<numRows; i++)
+    r[i] = b[i] - r[i];
+  preconditioner->Apply(r, d); // d = M^{-1} * r
+
+  double residualNorm2 = ComputeDotProduct(r, d);
+  double initialResidualNorm2 = residualNorm2;
+  if (convergenceCriterion == RELATIVE_TO_RHS)
+  {
+    preconditioner->Apply(b, s);
+    initialResidualNorm2 = GetRhsNorm2(ComputeDotProduct((double*)b, s), initialResidualNorm2);
+  }
+
+  while ((residualNorm2 > eps * eps * initialResidualNorm2) && (iteration <= maxIterations))
+  {
+    if (verbose)
+      printf("CG iteration %d: current M^{-1}-L2 error vs initial error=%G\n", iteration, sqrt(residualNorm2 / initialResidualNorm2));
+
+    multiplicator(multiplicatorData, d, q); //A->MultiplyVector(d,q); // q = A * d
+    double dDotq = ComputeDotProduct(d, q);
+    double alpha = residualNorm2 / dDotq;
+
+    for(int i=0; i<numRows; i++)
+      x[i] += alpha * d[i];
+
+    if (iteration % 30 == 0)
+    {
+      // periodically compute the exact residual (Shewchuk, page 8)
+      multiplicator(multiplicatorData, x, r); //A->MultiplyVector(x,r);
+      for (int i=0; i<numRows; i++)
+        r[i] = b[i] - r[i];
+    }
+    else
+    {
+      for (int i=0; i<numRows; i++)
+        r[i] = r[i] - alpha * q[i];
+    }
+
+    preconditioner->Apply(r, s); // s = M^{-1} * r
+    double oldResidualNorm2 = residualNorm2;
+    residualNorm2 = ComputeDotProduct(r, s);
+    double beta = residualNorm2 / oldResidualNorm2;
+
+    for (int i=0; i<numRows; i++)
+      d[i] = s[i] + beta * d[i];
+
+    iteration++;
+  }
+
+  if (residualNorm2 < 0)
+  {
+    printf("Warning: residualNorm2=%G is negative. Input matrix or preconditioner might not be SPD. Solution could be incorrect.\n", residualNorm2);
+  }
+
+  return (iteration-1) * ((residualNorm2 > eps * eps * initialResidualNorm2) ? -1 : 1);
+}
+
 double CGSolver::ComputeDotProduct(double * v1, double * v2)
 {
   double result = 0;
@@ -28,11 +28,12 @@
 
 /*
   A conjugate gradient solver built on top of the sparse matrix class.
-  There are two solver versions: without preconditioning, and with 
-  Jacobi preconditioning.
+  There are three solver versions: without preconditioning, with 
+  Jacobi preconditioning, and with a user-supplied preconditioner
+  (Jacobi, 3x3 block Jacobi, SSOR or incomplete Cholesky; see CGPreconditioner.h).
 
-  You can either provide a sparse matrix, or a callback function to
-  multiply x |--> A * x .
+  You can either provide a sparse matrix (scalar, or made of 3x3 blocks), 
+  or a callback function to multiply x |--> A * x .
 
   The sparse matrix must be symmetric and positive-definite.
 
@@ -48,6 +49,8 @@
 
 #include "linearSolver.h"
 #include "sparseMatrix.h"
+#include "sparseMatrixBlock3.h"
+#include "CGPreconditioner.h"
 
 class CGSolver : public LinearSolver
 {
@@ -56,6 +59,9 @@ public:
   // standard constructor
   CGSolver(SparseMatrix * A);
 
+  // same as above, for a matrix stored in 3x3 blocks (uses the block matrix-vector product)
+  CGSolver(SparseMatrixBlock3 * A);
+
   // This constructor makes it possible to only provide a
   // "black-box" matrix-vector multiplication routine 
   // (no need to explicitly give the matrix):
@@ -68,11 +74,19 @@ public:
 
   ~CGSolver();
 
+  // selects what the residual error is compared to in the convergence test (see "eps" below):
+  // RELATIVE_TO_INITIAL_RESIDUAL (default): the residual error of the initial guess
+  // RELATIVE_TO_RHS: the norm of b (i.e., the residual error of the zero initial guess); with this criterion, a good
+  //   initial guess reduces the number of iterations (e.g., the forcing term of an inexact Newton method)
+  typedef enum { RELATIVE_TO_INITIAL_RESIDUAL, RELATIVE_TO_RHS } convergenceCriterionType;
+  inline void SetConvergenceCriterion(convergenceCriterionType criterion) { convergenceCriterion = criterion; }
+  inline convergenceCriterionType GetConvergenceCriterion() const { return convergenceCriterion; }
+
   // solves A * x = b (without preconditioner)
   // A must be symmetric positive-definite
   // input: initial guess (in x)
   // output: solution (in x)
-  // "eps" is the convergence criterium: solver converges when the L2 residual errors is less than eps times the initial L2 residual error, must have 0 < eps < 1
+  // "eps" is the convergence criterium: solver converges when the L2 residual errors is less than eps times the initial L2 residual error (or the L2 norm of b; see SetConvergenceCriterion), must have 0 < eps < 1
   // maximum number of conjugate-gradient iterations is set by "maxIterations"
   // return value is the number of iterations performed 
   // if solver did not converge, the return value will have a negative sign
@@ -82,6 +96,11 @@ public:
   // the employed error metric is M^{-1}-weighted L2 residual error (see Shewchuk)
   int SolveLinearSystemWithJacobiPreconditioner(double * x, const double * b, double eps=1e-6, int maxIterations=1000, int verbose=0);
 
+  // same as above, except it uses the given preconditioner (which must have the same dimension as the matrix)
+  // the employed error metric is the M^{-1}-weighted L2 residual error
+  // the preconditioner is not updated: call preconditioner->Update() after the entries of the matrix change
+  int SolveLinearSystemWithPreconditioner(CGPreconditioner * preconditioner, double * x, const double * b, double eps=1e-6, int maxIterations=1000, int verbose=0);
+
   virtual int SolveLinearSystem(double * x, const double * b); // implements the virtual method from LinearSolver by calling "SolveLinearSystemWithJacobiPreconditioner" with default parameters
 
   // computes the dot product of two vectors
@@ -92,12 +111,16 @@ protected:
   blackBoxProductType multiplicator;
   void * multiplicatorData;
   SparseMatrix * A; 
-  double * r, * d, * q; // terminology from Shewchuk's work
+  SparseMatrixBlock3 * blockA;
+  double * r, * d, * q, * s; // terminology from Shewchuk's work
   double * invDiagonal;
+  convergenceCriterionType convergenceCriterion;
 
   double ComputeTriDotProduct(double * x, double * y, double * z); // sum_i x[i] * y[i] * z[i]
   static void DefaultMultiplicator(const void * data, const double * x, double * Ax);
+  static void Block3Multiplicator(const void * data, const double * x, double * Ax);
   void InitBuffers();
+  static double GetRhsNorm2(double rhsNorm2, double initialResidualNorm2);
 };
 
 #endif
@@ -54,32 +54,44 @@ extern "C" {
   #include "LinSol/Bridge.h"
 }
 
-SPOOLESSolver::SPOOLESSolver(const SparseMatrix * A, int verbose)
+// converts the upper triangle of A into a SPOOLES input matrix
+static InpMtx * SPOOLESSolver_CreateInputMatrix(const SparseMatrix * A)
 {
-  n = A->Getn();
-  this->verbose = verbose;
-
-  msgFile = fopen("SPOOLES.message","w");
-
-  // prepare SPOOLES input matrix
-  if (verbose >= 1)
-    printf("Converting matrix to SPOOLES format...\n");
-
+  int n = A->Getn();
   InpMtx * mtxA = InpMtx_new();
   InpMtx_init(mtxA, INPMTX_BY_ROWS, SPOOLES_REAL, A->GetNumEntries(), n);
 
+  // the upper triangle of each row is a suffix of the row (column indices are sorted);
+  // it is passed to SPOOLES directly from the matrix storage, without per-entry calls
+  int ** columnIndices = A->GetColumnIndices();
+  double ** columnEntries = A->GetEntries();
   for(int row=0; row<n; row++)
   {
     int rowLength = A->GetRowLength(row);
+    int j = 0;
+    while ((j < rowLength) && (columnIndices[row][j] < row))
+      j++;
 
-    for(int j=0; j< rowLength; j++)
-    {
-      if (A->GetColumnIndex(row,j) >= row)
-        InpMtx_inputRealEntry(mtxA, row, A->GetColumnIndex(row, j), A->GetEntry(row, j) );
-    }
+    if (j < rowLength)
+      InpMtx_inputRealRow(mtxA, row, rowLength - j, &columnIndices[row][j], &columnEntries[row][j]);
   }
 
   InpMtx_changeStorageMode(mtxA, INPMTX_BY_VECTORS);
+  return mtxA;
+}
+
+SPOOLESSolver::SPOOLESSolver(const SparseMatrix * A, int verbose)
+{
+  n = A->Getn();
+  this->verbose = verbose;
+
+  msgFile = fopen("SPOOLES.message","w");
+
+  // prepare SPOOLES input matrix
+  if (verbose >= 1)
+    printf("Converting matrix to SPOOLES format...\n");
+
+  InpMtx * mtxA = SPOOLESSolver_CreateInputMatrix(A);
   //InpMtx_writeForHumanEye(mtxA, msgFile);
 
   // compute the factorization
@@ -133,6 +145,39 @@ SPOOLESSolver::~SPOOLESSolver()
 
 void SPOOLESSolver::DisabledSolverError() {}
 
+int SPOOLESSolver::ComputeCholeskyDecomposition(const SparseMatrix * A)
+{
+  if (A->Getn() != n)
+  {
+    printf("Error: matrix size mismatch in SPOOLESSolver::ComputeCholeskyDecomposition. Expected: %d. Received: %d.\n", n, A->Getn());
+    return 1;
+  }
+
+  if (verbose >= 1)
+    printf("Re-factoring the %d x %d matrix...\n",n,n);
+
+  // the previous input matrix was permuted in place by Bridge_factor; replace it
+  InpMtx_free((InpMtx *) APointer);
+  InpMtx * mtxA = SPOOLESSolver_CreateInputMatrix(A);
+  APointer = (void*) mtxA;
+
+  // Bridge_factor re-uses the ordering and the symbolic factorization from Bridge_setup
+  int permuteFlag = 1;
+  int error;
+  int rc = Bridge_factor((Bridge*) bridgePointer, mtxA, permuteFlag, &error);
+
+  if (rc != 1)
+  {
+    printf("Error: matrix factorization failed. Bridge_factor exit code: %d. Error code: %d\n", rc, error);
+    return (rc == 0) ? 1 : rc;
+  }
+
+  if (verbose >= 1)
+    printf("Factorization completed.\n");
+
+  return 0;
+}
+
 int SPOOLESSolver::SolveLinearSystem(double * x, const double * rhs)
 {
   Bridge * bridge = (Bridge*) bridgePointer;
@@ -202,6 +247,12 @@ void SPOOLESSolver::DisabledSolverError()
   throw 1;
 }
 
+int SPOOLESSolver::ComputeCholeskyDecomposition(const SparseMatrix * A)
+{
+  DisabledSolverError();
+  return 1;
+}
+
 int SPOOLESSolver::SolveLinearSystem(double * x, const double * rhs)
 {
   DisabledSolverError();
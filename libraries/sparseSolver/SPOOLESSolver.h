@@ -60,8 +60,14 @@ public:
   SPOOLESSolver(const SparseMatrix * A, int verbose=0);
   virtual ~SPOOLESSolver();
 
+  // re-computes the Cholesky factorization, for a matrix A with the same pattern of non-zero entries as the matrix passed to the constructor
+  // (e.g., the system matrix of the next Newton iteration or timestep)
+  // the fill-reducing ordering and the symbolic factorization computed in the constructor are reused; only the numerical factorization is performed
+  // A is not modified; returns 0 on success, and non-zero on failure
+  int ComputeCholeskyDecomposition(const SparseMatrix * A);
+
   // solve: A * x = rhs, using SPOOLES
-  // uses the Cholesky factors obtained in the constructor
+  // uses the most recently computed Cholesky factors
   // rhs is not modified
   virtual int SolveLinearSystem(double * x, const double * rhs);
 
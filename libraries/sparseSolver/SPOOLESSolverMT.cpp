@@ -38,32 +38,44 @@ extern "C" {
   #include "LinSol/BridgeMT.h"
 }
 
-SPOOLESSolverMT::SPOOLESSolverMT(const SparseMatrix * A, int numThreads, int verbose)
+// converts the upper triangle of A into a SPOOLES input matrix
+static InpMtx * SPOOLESSolverMT_CreateInputMatrix(const SparseMatrix * A)
 {
-  n = A->Getn();
-  this->verbose = verbose;
-
-  msgFile = fopen("SPOOLES.message","w");
-
-  // prepare SPOOLES input matrix
-  if (verbose >= 1)
-    printf("Converting matrix to SPOOLES format...\n");
-
+  int n = A->Getn();
   InpMtx * mtxA = InpMtx_new();
   InpMtx_init(mtxA, INPMTX_BY_ROWS, SPOOLES_REAL, A->GetNumEntries(), n);
 
+  // the upper triangle of each row is a suffix of the row (column indices are sorted);
+  // it is passed to SPOOLES directly from the matrix storage, without per-entry calls
+  int ** columnIndices = A->GetColumnIndices();
+  double ** columnEntries = A->GetEntries();
   for(int row=0; row<n; row++)
   {
     int rowLength = A->GetRowLength(row);
+    int j = 0;
+    while ((j < rowLength) && (columnIndices[row][j] < row))
+      j++;
 
-    for(int j=0; j< rowLength; j++)
-    {
-      if (A->GetColumnIndex(row,j) >= row)
-        InpMtx_inputRealEntry(mtxA, row, A->GetColumnIndex(row, j), A->GetEntry(row, j) );
-    }
+    if (j < rowLength)
+      InpMtx_inputRealRow(mtxA, row, rowLength - j, &columnIndices[row][j], &columnEntries[row][j]);
   }
 
   InpMtx_changeStorageMode(mtxA, INPMTX_BY_VECTORS);
+  return mtxA;
+}
+
+SPOOLESSolverMT::SPOOLESSolverMT(const SparseMatrix * A, int numThreads, int verbose)
+{
+  n = A->Getn();
+  this->verbose = verbose;
+
+  msgFile = fopen("SPOOLES.message","w");
+
+  // prepare SPOOLES input matrix
+  if (verbose >= 1)
+    printf("Converting matrix to SPOOLES format...\n");
+
+  InpMtx * mtxA = SPOOLESSolverMT_CreateInputMatrix(A);
   //InpMtx_writeForHumanEye(mtxA, msgFile);
 
   // compute the factorization
@@ -179,6 +191,38 @@ SPOOLESSolverMT::~SPOOLESSolverMT()
 
 void SPOOLESSolverMT::DisabledSolverError() {}
 
+int SPOOLESSolverMT::ComputeCholeskyDecomposition(const SparseMatrix * A)
+{
+  if (A->Getn() != n)
+  {
+    printf("Error: matrix size mismatch in SPOOLESSolverMT::ComputeCholeskyDecomposition. Expected: %d. Received: %d.\n", n, A->Getn());
+    return 1;
+  }
+
+  if (verbose >= 1)
+    printf("Re-factoring the %d x %d matrix...\n",n,n);
+
+  // the previous input matrix was permuted in place by BridgeMT_factor; replace it
+  InpMtx_free((InpMtx *) APointer);
+  InpMtx * mtxA = SPOOLESSolverMT_CreateInputMatrix(A);
+  APointer = (void*) mtxA;
+
+  // BridgeMT_factor re-uses the ordering, the symbolic factorization and the parallel factor setup from the constructor
+  int permuteflag = 1;
+  int error;
+  int rc = BridgeMT_factor((BridgeMT*) bridgeMTPointer, mtxA, permuteflag, &error);
+  if (rc != 1)
+  {
+    printf("Error: factorization returned exit code %d (error %d).\n", rc, error);
+    return (rc == 0) ? 1 : rc;
+  }
+
+  if (verbose >= 1)
+    printf("Factorization completed.\n");
+
+  return 0;
+}
+
 int SPOOLESSolverMT::SolveLinearSystem(double * x, const double * rhs)
 {
   BridgeMT * bridgeMT = (BridgeMT*) bridgeMTPointer;
@@ -269,6 +313,12 @@ void SPOOLESSolverMT::DisabledSolverError()
   throw 1;
 }
 
+int SPOOLESSolverMT::ComputeCholeskyDecomposition(const SparseMatrix * A)
+{
+  DisabledSolverError();
+  return 1;
+}
+
 int SPOOLESSolverMT::SolveLinearSystem(double * x, const double * rhs)
 {
   DisabledSolverError();
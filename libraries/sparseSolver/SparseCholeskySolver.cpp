@@ -0,0 +1,912 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseSolver" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <algorithm>
+#include "SparseCholeskySolver.h"
+#include "AMDOrdering.h"
+#include "threadPool.h"
+using namespace std;
+
+// maximum number of columns in a supernode
+#define SPARSECHOLESKYSOLVER_MAX_SUPERNODE_SIZE 256
+
+// the supernodal update C = L_{d,*} * (D) * L_{s,*}^T is computed in strips of this many columns
+#define SPARSECHOLESKYSOLVER_STRIP 4
+
+#define SPARSECHOLESKYSOLVER_NO_ENTRY ((size_t)-1)
+
+SparseCholeskySolver::SparseCholeskySolver(const SparseMatrix * A, int numThreads_, int positiveDefinite_, int verbose_) : numThreads(numThreads_), positiveDefinite(positiveDefinite_), verbose(verbose_), factored(0), ownsSymbolicFactorization(1)
+{
+  n = A->Getn();
+  if (numThreads < 1)
+    numThreads = 1;
+
+  if (verbose >= 1)
+    printf("SparseCholeskySolver: computing the ordering (n=%d)...\n", n);
+
+  perm = (int*) malloc (sizeof(int) * n);
+  invPerm = (int*) malloc (sizeof(int) * n);
+  AMDOrdering::ComputePermutation(A, perm);
+
+  ComputeSymbolicFactorization(A);
+  AllocateNumericalFactorization();
+
+  if (verbose >= 1)
+    printf("SparseCholeskySolver: %d supernodes, %d levels, %.3f million factor entries.\n", numSupernodes, numLevels, 1.0e-6 * GetNumFactorEntries());
+}
+
+SparseCholeskySolver::SparseCholeskySolver(const SparseCholeskySolver * source, int numThreads_) : numThreads(numThreads_), positiveDefinite(source->positiveDefinite), verbose(source->verbose), factored(0), ownsSymbolicFactorization(0)
+{
+  if (numThreads < 1)
+    numThreads = 1;
+
+  // share the ordering and the symbolic factorization
+  n = source->n;
+  perm = source->perm;
+  invPerm = source->invPerm;
+  numSupernodes = source->numSupernodes;
+  supernodeStart = source->supernodeStart;
+  supernodeRowStart = source->supernodeRowStart;
+  supernodeRows = source->supernodeRows;
+  supernodeValueStart = source->supernodeValueStart;
+  updateStart = source->updateStart;
+  updateSource = source->updateSource;
+  firstUpdateRow = source->firstUpdateRow;
+  lastUpdateRow = source->lastUpdateRow;
+  numLevels = source->numLevels;
+  levelStart = source->levelStart;
+  levelSupernodes = source->levelSupernodes;
+  entryStart = source->entryStart;
+  entryMap = source->entryMap;
+  numEntries = source->numEntries;
+  maxUpdateRows = source->maxUpdateRows;
+  maxUpdateEntries = source->maxUpdateEntries;
+
+  AllocateNumericalFactorization();
+}
+
+void SparseCholeskySolver::AllocateNumericalFactorization()
+{
+  values = (double*) malloc (sizeof(double) * (supernodeValueStart[numSupernodes] + 1));
+  diagonal = positiveDefinite ? NULL : (double*) malloc (sizeof(double) * n);
+
+  relativeMap = (int**) malloc (sizeof(int*) * numThreads);
+  updateBuffer = (double**) malloc (sizeof(double*) * numThreads);
+  for(int i=0; i<numThreads; i++)
+  {
+    relativeMap[i] = (int*) malloc (sizeof(int) * n);
+    updateBuffer[i] = (double*) malloc (sizeof(double) * (SPARSECHOLESKYSOLVER_STRIP * maxUpdateRows + (positiveDefinite ? 0 : maxUpdateEntries) + 1));
+  }
+  solution = (double*) malloc (sizeof(double) * n);
+}
+
+SparseCholeskySolver::~SparseCholeskySolver()
+{
+  for(int i=0; i<numThreads; i++)
+  {
+    free(relativeMap[i]);
+    free(updateBuffer[i]);
+  }
+  free(relativeMap);
+  free(updateBuffer);
+  free(solution);
+  free(diagonal);
+  free(values);
+
+  if (!ownsSymbolicFactorization)
+    return;
+
+  free(entryMap);
+  free(entryStart);
+  free(levelSupernodes);
+  free(levelStart);
+  free(lastUpdateRow);
+  free(firstUpdateRow);
+  free(updateSource);
+  free(updateStart);
+  free(supernodeValueStart);
+  free(supernodeRows);
+  free(supernodeRowStart);
+  free(supernodeStart);
+  free(invPerm);
+  free(perm);
+}
+
+// computes the elimination tree of the reordered matrix A(perm, perm) (Liu's algorithm, with path compression)
+void SparseCholeskySolver::ComputeEliminationTree(int n, const SparseMatrix * A, const int * perm, const int * invPerm, int * parent)
+{
+  int ** columnIndices = A->GetColumnIndices();
+  int * rowLengths = A->GetRowLengths();
+
+  int * ancestor = (int*) malloc (sizeof(int) * n);
+  for(int k=0; k<n; k++)
+  {
+    parent[k] = -1;
+    ancestor[k] = -1;
+    int row = perm[k];
+    for(int j=0; j<rowLengths[row]; j++)
+    {
+      int i = invPerm[columnIndices[row][j]];
+      if (i >= k)
+        continue;
+      // walk from i up to the root of its current subtree, and attach that root to k
+      while ((ancestor[i] != -1) && (ancestor[i] != k))
+      {
+        int next = ancestor[i];
+        ancestor[i] = k;
+        i = next;
+      }
+      if (ancestor[i] == -1)
+      {
+        ancestor[i] = k;
+        parent[i] = k;
+      }
+    }
+  }
+  free(ancestor);
+}
+
+void SparseCholeskySolver::ComputeSymbolicFactorization(const SparseMatrix * A)
+{
+  int ** columnIndices = A->GetColumnIndices();
+  int * rowLengths = A->GetRowLengths();
+
+  for(int k=0; k<n; k++)
+    invPerm[perm[k]] = k;
+
+  int * parent = (int*) malloc (sizeof(int) * n);
+  ComputeEliminationTree(n, A, perm, invPerm, parent);
+
+  // postorder the elimination tree (so that the columns of each subtree, and of each supernode, are consecutive)
+  int * firstChild = (int*) malloc (sizeof(int) * n);
+  int * nextSibling = (int*) malloc (sizeof(int) * n);
+  int * postorder = (int*) malloc (sizeof(int) * n);
+  for(int j=0; j<n; j++)
+    firstChild[j] = -1;
+  for(int j=n-1; j>=0; j--)
+  {
+    if (parent[j] != -1)
+    {
+      nextSibling[j] = firstChild[parent[j]];
+      firstChild[parent[j]] = j;
+    }
+  }
+  int * stack = (int*) malloc (sizeof(int) * n);
+  int numOrdered = 0;
+  for(int root=0; root<n; root++)
+  {
+    if (parent[root] != -1)
+      continue;
+    int stackSize = 0;
+    stack[stackSize++] = root;
+    while (stackSize > 0)
+    {
+      int j = stack[stackSize-1];
+      int child = firstChild[j];
+      if (child != -1)
+      {
+        firstChild[j] = nextSibling[child];
+        stack[stackSize++] = child;
+      }
+      else
+      {
+        stackSize--;
+        postorder[numOrdered++] = j;
+      }
+    }
+  }
+  free(stack);
+
+  for(int k=0; k<n; k++)
+    postorder[k] = perm[postorder[k]];
+  memcpy(perm, postorder, sizeof(int) * n);
+  for(int k=0; k<n; k++)
+    invPerm[perm[k]] = k;
+  free(postorder);
+  free(nextSibling);
+  free(firstChild);
+
+  ComputeEliminationTree(n, A, perm, invPerm, parent);
+
+  // column counts of L (the row subtree of row k marks the non-zeros of row k of L)
+  int * columnCount = (int*) malloc (sizeof(int) * n);
+  int * mark = (int*) malloc (sizeof(int) * n);
+  for(int j=0; j<n; j++)
+  {
+    columnCount[j] = 1;
+    mark[j] = -1;
+  }
+  for(int k=0; k<n; k++)
+  {
+    mark[k] = k;
+    int row = perm[k];
+    for(int e=0; e<rowLengths[row]; e++)
+    {
+      int j = invPerm[columnIndices[row][e]];
+      if (j >= k)
+        continue;
+      while (mark[j] != k)
+      {
+        columnCount[j]++;
+        mark[j] = k;
+        j = parent[j];
+      }
+    }
+  }
+
+  // supernodes: chains of columns j-1 -> j in the elimination tree, where the structure of column j is
+  // the structure of column j-1 without j-1
+  supernodeStart = (int*) malloc (sizeof(int) * (n+1));
+  int * columnToSupernode = (int*) malloc (sizeof(int) * n);
+  numSupernodes = 0;
+  for(int j=0; j<n; j++)
+  {
+    int extendsSupernode = (j > 0) && (parent[j-1] == j) && (columnCount[j] == columnCount[j-1] - 1) &&
+      (j - supernodeStart[numSupernodes-1] < SPARSECHOLESKYSOLVER_MAX_SUPERNODE_SIZE);
+    if (!extendsSupernode)
+      supernodeStart[numSupernodes++] = j;
+    columnToSupernode[j] = numSupernodes - 1;
+  }
+  supernodeStart[numSupernodes] = n;
+  supernodeStart = (int*) realloc (supernodeStart, sizeof(int) * (numSupernodes+1));
+
+  int * supernodeParent = (int*) malloc (sizeof(int) * numSupernodes);
+  int * firstChildSupernode = (int*) malloc (sizeof(int) * numSupernodes);
+  int * nextSiblingSupernode = (int*) malloc (sizeof(int) * numSupernodes);
+  for(int s=0; s<numSupernodes; s++)
+    firstChildSupernode[s] = -1;
+  for(int s=numSupernodes-1; s>=0; s--)
+  {
+    int lastColumn = supernodeStart[s+1] - 1;
+    supernodeParent[s] = (parent[lastColumn] == -1) ? -1 : columnToSupernode[parent[lastColumn]];
+    if (supernodeParent[s] != -1)
+    {
+      nextSiblingSupernode[s] = firstChildSupernode[supernodeParent[s]];
+      firstChildSupernode[supernodeParent[s]] = s;
+    }
+  }
+
+  // row structures: the union of the structure of A in the supernode's columns, and the structures of the children
+  supernodeRowStart = (int*) malloc (sizeof(int) * (numSupernodes+1));
+  supernodeValueStart = (size_t*) malloc (sizeof(size_t) * (numSupernodes+1));
+  supernodeRowStart[0] = 0;
+  supernodeValueStart[0] = 0;
+  for(int s=0; s<numSupernodes; s++)
+  {
+    int numRows = columnCount[supernodeStart[s]];
+    int numColumns = supernodeStart[s+1] - supernodeStart[s];
+    supernodeRowStart[s+1] = supernodeRowStart[s] + numRows;
+    supernodeValueStart[s+1] = supernodeValueStart[s] + (size_t)numRows * numColumns;
+  }
+
+  supernodeRows = (int*) malloc (sizeof(int) * supernodeRowStart[numSupernodes]);
+  for(int j=0; j<n; j++)
+    mark[j] = -1;
+  for(int s=0; s<numSupernodes; s++)
+  {
+    int first = supernodeStart[s];
+    int last = supernodeStart[s+1] - 1;
+    int * rows = &supernodeRows[supernodeRowStart[s]];
+    int numRows = 0;
+    for(int j=first; j<=last; j++)
+    {
+      rows[numRows++] = j;
+      mark[j] = s;
+    }
+
+    for(int j=first; j<=last; j++)
+    {
+      int row = perm[j];
+      for(int e=0; e<rowLengths[row]; e++)
+      {
+        int i = invPerm[columnIndices[row][e]];
+        if ((i > last) && (mark[i] != s))
+        {
+          mark[i] = s;
+          rows[numRows++] = i;
+        }
+      }
+    }
+
+    for(int child=firstChildSupernode[s]; child != -1; child = nextSiblingSupernode[child])
+    {
+      int childNumColumns = supernodeStart[child+1] - supernodeStart[child];
+      for(int p=supernodeRowStart[child]+childNumColumns; p<supernodeRowStart[child+1]; p++)
+      {
+        int i = supernodeRows[p];
+        if ((i > last) && (mark[i] != s))
+        {
+          mark[i] = s;
+          rows[numRows++] = i;
+        }
+      }
+    }
+
+    if (numRows != supernodeRowStart[s+1] - supernodeRowStart[s])
+    {
+      printf("Error: SparseCholeskySolver: inconsistent symbolic factorization (supernode %d). Is the matrix structurally symmetric?\n", s);
+      exit(1);
+    }
+    sort(&rows[last - first + 1], &rows[numRows]);
+  }
+
+  // update lists: supernode d updates supernode s with the rows of d that lie in the columns of s
+  updateStart = (int*) calloc (numSupernodes+1, sizeof(int));
+  for(int pass=0; pass<2; pass++)
+  {
+    if (pass == 1)
+    {
+      for(int s=0; s<numSupernodes; s++)
+        updateStart[s+1] += updateStart[s];
+      updateSource = (int*) malloc (sizeof(int) * (updateStart[numSupernodes] + 1));
+      firstUpdateRow = (int*) malloc (sizeof(int) * (updateStart[numSupernodes] + 1));
+      lastUpdateRow = (int*) malloc (sizeof(int) * (updateStart[numSupernodes] + 1));
+      for(int s=0; s<numSupernodes; s++)
+        mark[s] = updateStart[s];
+    }
+
+    for(int d=0; d<numSupernodes; d++)
+    {
+      int numColumns = supernodeStart[d+1] - supernodeStart[d];
+      int * rows = &supernodeRows[supernodeRowStart[d]];
+      int numRows = supernodeRowStart[d+1] - supernodeRowStart[d];
+      int p = numColumns;
+      while (p < numRows)
+      {
+        int s = columnToSupernode[rows[p]];
+        int p2 = p;
+        while ((p2 < numRows) && (rows[p2] < supernodeStart[s+1]))
+          p2++;
+        if (pass == 0)
+          updateStart[s+1]++;
+        else
+        {
+          updateSource[mark[s]] = d;
+          firstUpdateRow[mark[s]] = p;
+          lastUpdateRow[mark[s]] = p2;
+          mark[s]++;
+        }
+        p = p2;
+      }
+    }
+  }
+
+  // workspace sizes
+  maxUpdateRows = 1;
+  maxUpdateEntries = 1;
+  for(int s=0; s<numSupernodes; s++)
+  {
+    // the scaled strip of a supernode (dense factorization of the supernode)
+    size_t numStripEntries = (size_t)SPARSECHOLESKYSOLVER_STRIP * (supernodeStart[s+1] - supernodeStart[s]);
+    if (numStripEntries > maxUpdateEntries)
+      maxUpdateEntries = numStripEntries;
+    for(int u=updateStart[s]; u<updateStart[s+1]; u++)
+    {
+      int d = updateSource[u];
+      int numRows = supernodeRowStart[d+1] - supernodeRowStart[d] - firstUpdateRow[u];
+      if (numRows > maxUpdateRows)
+        maxUpdateRows = numRows;
+      size_t numScaledEntries = (size_t)(lastUpdateRow[u] - firstUpdateRow[u]) * (supernodeStart[d+1] - supernodeStart[d]);
+      if (numScaledEntries > maxUpdateEntries)
+        maxUpdateEntries = numScaledEntries;
+    }
+  }
+
+  // levels of the supernodal elimination tree (children have smaller indices than their parents)
+  int * level = (int*) calloc (numSupernodes, sizeof(int));
+  numLevels = 0;
+  for(int s=0; s<numSupernodes; s++)
+  {
+    if ((supernodeParent[s] != -1) && (level[supernodeParent[s]] < level[s] + 1))
+      level[supernodeParent[s]] = level[s] + 1;
+    if (level[s] + 1 > numLevels)
+      numLevels = level[s] + 1;
+  }
+  levelStart = (int*) calloc (numLevels+1, sizeof(int));
+  levelSupernodes = (int*) malloc (sizeof(int) * (numSupernodes + 1));
+  for(int s=0; s<numSupernodes; s++)
+    levelStart[level[s]+1]++;
+  for(int l=0; l<numLevels; l++)
+    levelStart[l+1] += levelStart[l];
+  for(int l=0; l<numLevels; l++)
+    mark[l] = levelStart[l];
+  for(int s=0; s<numSupernodes; s++)
+    levelSupernodes[mark[level[s]]++] = s;
+  free(level);
+
+  // locations of the entries of A inside the factor
+  numEntries = A->GetNumEntries();
+  entryStart = (int*) malloc (sizeof(int) * (n+1));
+  entryStart[0] = 0;
+  for(int row=0; row<n; row++)
+    entryStart[row+1] = entryStart[row] + rowLengths[row];
+  entryMap = (size_t*) malloc (sizeof(size_t) * (numEntries + 1));
+  for(int s=0; s<numSupernodes; s++)
+  {
+    int first = supernodeStart[s];
+    int numRows = supernodeRowStart[s+1] - supernodeRowStart[s];
+    int * rows = &supernodeRows[supernodeRowStart[s]];
+    for(int p=0; p<numRows; p++)
+      mark[rows[p]] = p;
+    for(int j=first; j<supernodeStart[s+1]; j++)
+    {
+      int row = perm[j];
+      for(int e=0; e<rowLengths[row]; e++)
+      {
+        int i = invPerm[columnIndices[row][e]];
+        if (i < j)
+          entryMap[entryStart[row] + e] = SPARSECHOLESKYSOLVER_NO_ENTRY;
+        else
+          entryMap[entryStart[row] + e] = supernodeValueStart[s] + (size_t)(j - first) * numRows + mark[i];
+      }
+    }
+  }
+
+  free(nextSiblingSupernode);
+  free(firstChildSupernode);
+  free(supernodeParent);
+  free(columnToSupernode);
+  free(mark);
+  free(columnCount);
+  free(parent);
+}
+
+// c(ii, jj) -= sum_k a(ii, k) * b(jj, k), for ii = iStart, ..., m-1, jj = 0, ..., width-1 (width <= SPARSECHOLESKYSOLVER_STRIP), k = 0, ..., K-1
+// all matrices are column-major; the loop over k is unrolled 4 times, so that each entry of c is loaded and stored once per 4 products
+static void SparseCholeskySolver_SubtractProductStrip(int iStart, int m, int width, int K, const double * a, int lda, const double * b, int ldb, double * c, int ldc)
+{
+  int k = 0;
+  if (width == SPARSECHOLESKYSOLVER_STRIP)
+  {
+    double * c0 = c;
+    double * c1 = c + ldc;
+    double * c2 = c + 2 * (size_t)ldc;
+    double * c3 = c + 3 * (size_t)ldc;
+    for(; k+4<=K; k+=4)
+    {
+      const double * a0 = &a[(size_t)k * lda];
+      const double * a1 = a0 + lda;
+      const double * a2 = a1 + lda;
+      const double * a3 = a2 + lda;
+      const double * bk = &b[(size_t)k * ldb];
+      double b00 = bk[0], b01 = bk[ldb], b02 = bk[2*ldb], b03 = bk[3*ldb];
+      double b10 = bk[1], b11 = bk[ldb+1], b12 = bk[2*ldb+1], b13 = bk[3*ldb+1];
+      double b20 = bk[2], b21 = bk[ldb+2], b22 = bk[2*ldb+2], b23 = bk[3*ldb+2];
+      double b30 = bk[3], b31 = bk[ldb+3], b32 = bk[2*ldb+3], b33 = bk[3*ldb+3];
+      for(int ii=iStart; ii<m; ii++)
+      {
+        double x0 = a0[ii], x1 = a1[ii], x2 = a2[ii], x3 = a3[ii];
+        c0[ii] -= x0 * b00 + x1 * b01 + x2 * b02 + x3 * b03;
+        c1[ii] -= x0 * b10 + x1 * b11 + x2 * b12 + x3 * b13;
+        c2[ii] -= x0 * b20 + x1 * b21 + x2 * b22 + x3 * b23;
+        c3[ii] -= x0 * b30 + x1 * b31 + x2 * b32 + x3 * b33;
+      }
+    }
+    for(; k<K; k++)
+    {
+      const double * ak = &a[(size_t)k * lda];
+      const double * bk = &b[(size_t)k * ldb];
+      double b0 = bk[0], b1 = bk[1], b2 = bk[2], b3 = bk[3];
+      for(int ii=iStart; ii<m; ii++)
+      {
+        double x = ak[ii];
+        c0[ii] -= x * b0;
+        c1[ii] -= x * b1;
+        c2[ii] -= x * b2;
+        c3[ii] -= x * b3;
+      }
+    }
+  }
+  else
+  {
+    for(int jj=0; jj<width; jj++)
+    {
+      double * cj = &c[(size_t)jj * ldc];
+      for(k=0; k<K; k++)
+      {
+        const double * ak = &a[(size_t)k * lda];
+        double bjk = b[(size_t)k * ldb + jj];
+        for(int ii=iStart; ii<m; ii++)
+          cj[ii] -= ak[ii] * bjk;
+      }
+    }
+  }
+}
+
+int SparseCholeskySolver::FactorSupernode(int supernode, const SparseMatrix * A, int threadIndex)
+{
+  int first = supernodeStart[supernode];
+  int numColumns = supernodeStart[supernode+1] - first;
+  int numRows = supernodeRowStart[supernode+1] - supernodeRowStart[supernode];
+  const int * rows = &supernodeRows[supernodeRowStart[supernode]];
+  double * Ls = &values[supernodeValueStart[supernode]];
+
+  // scatter the entries of A
+  memset(Ls, 0, sizeof(double) * (size_t)numRows * numColumns);
+  double ** entries = A->GetEntries();
+  int * rowLengths = A->GetRowLengths();
+  for(int j=first; j<first+numColumns; j++)
+  {
+    int row = perm[j];
+    const size_t * map = &entryMap[entryStart[row]];
+    for(int e=0; e<rowLengths[row]; e++)
+      if (map[e] != SPARSECHOLESKYSOLVER_NO_ENTRY)
+        values[map[e]] = entries[row][e];
+  }
+
+  // apply the updates from the descendants: Ls -= L_d(p1:end,:) * D_d * L_d(p1:p2-1,:)^T
+  int * map = relativeMap[threadIndex];
+  for(int p=0; p<numRows; p++)
+    map[rows[p]] = p;
+  double * C = updateBuffer[threadIndex];
+  double * W = &C[SPARSECHOLESKYSOLVER_STRIP * maxUpdateRows];
+
+  for(int u=updateStart[supernode]; u<updateStart[supernode+1]; u++)
+  {
+    int d = updateSource[u];
+    int p1 = firstUpdateRow[u];
+    int p2 = lastUpdateRow[u];
+    int firstD = supernodeStart[d];
+    int numColumnsD = supernodeStart[d+1] - firstD;
+    int numRowsD = supernodeRowStart[d+1] - supernodeRowStart[d];
+    const int * rowsD = &supernodeRows[supernodeRowStart[d]];
+    const double * Ld = &values[supernodeValueStart[d]];
+    int m = numRowsD - p1;
+    int q = p2 - p1;
+
+    // B = L_d(p1:p2-1,:) * D_d
+    const double * B;
+    int ldB;
+    if (positiveDefinite)
+    {
+      B = &Ld[p1];
+      ldB = numRowsD;
+    }
+    else
+    {
+      for(int k=0; k<numColumnsD; k++)
+      {
+        double dk = diagonal[firstD + k];
+        for(int jj=0; jj<q; jj++)
+          W[k * q + jj] = Ld[(size_t)k * numRowsD + p1 + jj] * dk;
+      }
+      B = W;
+      ldB = q;
+    }
+
+    for(int jj0=0; jj0<q; jj0+=SPARSECHOLESKYSOLVER_STRIP)
+    {
+      int stripWidth = min(SPARSECHOLESKYSOLVER_STRIP, q - jj0);
+      // C(ii, jj) = -sum_k L_d(p1+ii, k) * B(jj0+jj, k), for ii >= jj0
+      for(int jj=0; jj<stripWidth; jj++)
+        memset(&C[jj * maxUpdateRows + jj0], 0, sizeof(double) * (m - jj0));
+      SparseCholeskySolver_SubtractProductStrip(jj0, m, stripWidth, numColumnsD, &Ld[p1], numRowsD, &B[jj0], ldB, C, maxUpdateRows);
+
+      // scatter-add into the supernode
+      for(int jj=0; jj<stripWidth; jj++)
+      {
+        double * target = &Ls[(size_t)(rowsD[p1 + jj0 + jj] - first) * numRows];
+        const double * Cjj = &C[jj * maxUpdateRows];
+        for(int ii=jj0+jj; ii<m; ii++)
+          target[map[rowsD[p1 + ii]]] += Cjj[ii];
+      }
+    }
+  }
+
+  // dense factorization of the supernode (diagonal block, and the rows below it), left-looking in strips of columns
+  for(int j0=0; j0<numColumns; j0+=SPARSECHOLESKYSOLVER_STRIP)
+  {
+    int stripWidth = min(SPARSECHOLESKYSOLVER_STRIP, numColumns - j0);
+
+    // update the strip with the columns to its left
+    if (j0 > 0)
+    {
+      const double * B;
+      int ldB;
+      if (positiveDefinite)
+      {
+        B = &Ls[j0];
+        ldB = numRows;
+      }
+      else
+      {
+        for(int k=0; k<j0; k++)
+        {
+          double dk = diagonal[first + k];
+          for(int jj=0; jj<stripWidth; jj++)
+            W[k * SPARSECHOLESKYSOLVER_STRIP + jj] = Ls[(size_t)k * numRows + j0 + jj] * dk;
+        }
+        B = W;
+        ldB = SPARSECHOLESKYSOLVER_STRIP;
+      }
+      SparseCholeskySolver_SubtractProductStrip(j0, numRows, stripWidth, j0, Ls, numRows, B, ldB, &Ls[(size_t)j0 * numRows], numRows);
+    }
+
+    // factor the strip
+    for(int j=j0; j<j0+stripWidth; j++)
+    {
+      double * Lj = &Ls[(size_t)j * numRows];
+      double pivot = Lj[j];
+      if (positiveDefinite)
+      {
+        if (pivot <= 0.0)
+          return first + j + 1;
+        pivot = sqrt(pivot);
+        Lj[j] = pivot;
+        double invPivot = 1.0 / pivot;
+        for(int i=j+1; i<numRows; i++)
+          Lj[i] *= invPivot;
+        for(int k=j+1; k<j0+stripWidth; k++)
+        {
+          double Lkj = Lj[k];
+          double * Lk = &Ls[(size_t)k * numRows];
+          for(int i=k; i<numRows; i++)
+            Lk[i] -= Lj[i] * Lkj;
+        }
+      }
+      else
+      {
+        if (pivot == 0.0)
+          return first + j + 1;
+        diagonal[first + j] = pivot;
+        double invPivot = 1.0 / pivot;
+        // column j is not scaled yet: Lk -= (Lj / pivot) * Lkj
+        for(int k=j+1; k<j0+stripWidth; k++)
+        {
+          double Lkj = Lj[k] * invPivot;
+          double * Lk = &Ls[(size_t)k * numRows];
+          for(int i=k; i<numRows; i++)
+            Lk[i] -= Lj[i] * Lkj;
+        }
+        Lj[j] = 1.0;
+        for(int i=j+1; i<numRows; i++)
+          Lj[i] *= invPivot;
+      }
+    }
+  }
+
+  return 0;
+}
+
+void SparseCholeskySolver::ForwardSubstitutionSupernode(int supernode, double * y)
+{
+  // updates from the descendants
+  for(int u=updateStart[supernode]; u<updateStart[supernode+1]; u++)
+  {
+    int d = updateSource[u];
+    int p1 = firstUpdateRow[u];
+    int p2 = lastUpdateRow[u];
+    int firstD = supernodeStart[d];
+    int numColumnsD = supernodeStart[d+1] - firstD;
+    int numRowsD = supernodeRowStart[d+1] - supernodeRowStart[d];
+    const int * rowsD = &supernodeRows[supernodeRowStart[d]];
+    const double * Ld = &values[supernodeValueStart[d]];
+    for(int k=0; k<numColumnsD; k++)
+    {
+      double yk = y[firstD + k];
+      if (yk == 0.0)
+        continue;
+      const double * Lk = &Ld[(size_t)k * numRowsD];
+      for(int p=p1; p<p2; p++)
+        y[rowsD[p]] -= Lk[p] * yk;
+    }
+  }
+
+  // dense triangular solve with the diagonal block
+  int first = supernodeStart[supernode];
+  int numColumns = supernodeStart[supernode+1] - first;
+  int numRows = supernodeRowStart[supernode+1] - supernodeRowStart[supernode];
+  const double * Ls = &values[supernodeValueStart[supernode]];
+  double * ys = &y[first];
+  for(int j=0; j<numColumns; j++)
+  {
+    const double * Lj = &Ls[(size_t)j * numRows];
+    if (positiveDefinite)
+      ys[j] /= Lj[j];
+    double yj = ys[j];
+    for(int i=j+1; i<numColumns; i++)
+      ys[i] -= Lj[i] * yj;
+  }
+}
+
+void SparseCholeskySolver::BackwardSubstitutionSupernode(int supernode, double * y)
+{
+  int first = supernodeStart[supernode];
+  int numColumns = supernodeStart[supernode+1] - first;
+  int numRows = supernodeRowStart[supernode+1] - supernodeRowStart[supernode];
+  const int * rows = &supernodeRows[supernodeRowStart[supernode]];
+  const double * Ls = &values[supernodeValueStart[supernode]];
+  double * ys = &y[first];
+
+  // contributions of the (already computed) rows below the diagonal block
+  for(int j=0; j<numColumns; j++)
+  {
+    const double * Lj = &Ls[(size_t)j * numRows];
+    double sum = 0.0;
+    for(int i=numColumns; i<numRows; i++)
+      sum += Lj[i] * y[rows[i]];
+    ys[j] -= sum;
+  }
+
+  // dense transposed triangular solve with the diagonal block
+  for(int j=numColumns-1; j>=0; j--)
+  {
+    const double * Lj = &Ls[(size_t)j * numRows];
+    double yj = ys[j];
+    for(int i=j+1; i<numColumns; i++)
+      yj -= Lj[i] * ys[i];
+    if (positiveDefinite)
+      yj /= Lj[j];
+    ys[j] = yj;
+  }
+}
+
+struct SparseCholeskySolver_LevelTaskData
+{
+  SparseCholeskySolver * solver;
+  const SparseMatrix * A;
+  int phase;
+  int next; // next supernode to be processed (index into levelSupernodes)
+  int last;
+  int error;
+  pthread_mutex_t mutex;
+};
+
+void SparseCholeskySolver::LevelTask(void * data, int rank)
+{
+  SparseCholeskySolver_LevelTaskData * taskData = (SparseCholeskySolver_LevelTaskData*) data;
+  SparseCholeskySolver * solver = taskData->solver;
+  // supernodes are handed out dynamically; "rank" selects the workspace
+  while (1)
+  {
+    pthread_mutex_lock(&taskData->mutex);
+    int index = taskData->next++;
+    pthread_mutex_unlock(&taskData->mutex);
+    if (index >= taskData->last)
+      break;
+
+    int supernode = solver->levelSupernodes[index];
+    switch (taskData->phase)
+    {
+      case FACTOR:
+      {
+        int code = solver->FactorSupernode(supernode, taskData->A, rank);
+        if (code != 0)
+        {
+          pthread_mutex_lock(&taskData->mutex);
+          if ((taskData->error == 0) || (code < taskData->error))
+            taskData->error = code;
+          pthread_mutex_unlock(&taskData->mutex);
+        }
+      }
+      break;
+
+      case FORWARD_SUBSTITUTION:
+        solver->ForwardSubstitutionSupernode(supernode, solver->solution);
+      break;
+
+      case BACKWARD_SUBSTITUTION:
+        solver->BackwardSubstitutionSupernode(supernode, solver->solution);
+      break;
+    }
+  }
+}
+
+int SparseCholeskySolver::ProcessLevel(phaseType phase, int level, const SparseMatrix * A)
+{
+  int numLevelSupernodes = levelStart[level+1] - levelStart[level];
+  if ((numThreads == 1) || (numLevelSupernodes == 1))
+  {
+    for(int i=levelStart[level]; i<levelStart[level+1]; i++)
+    {
+      int supernode = levelSupernodes[i];
+      if (phase == FACTOR)
+      {
+        int code = FactorSupernode(supernode, A, 0);
+        if (code != 0)
+          return code;
+      }
+      else if (phase == FORWARD_SUBSTITUTION)
+        ForwardSubstitutionSupernode(supernode, solution);
+      else
+        BackwardSubstitutionSupernode(supernode, solution);
+    }
+    return 0;
+  }
+
+  SparseCholeskySolver_LevelTaskData taskData;
+  taskData.solver = this;
+  taskData.A = A;
+  taskData.phase = phase;
+  taskData.last = levelStart[level+1];
+  taskData.next = levelStart[level];
+  taskData.error = 0;
+  pthread_mutex_init(&taskData.mutex, NULL);
+  ThreadPool::GetGlobalThreadPool()->Execute(min(numThreads, numLevelSupernodes), LevelTask, &taskData);
+  pthread_mutex_destroy(&taskData.mutex);
+  return taskData.error;
+}
+
+int SparseCholeskySolver::ComputeCholeskyDecomposition(const SparseMatrix * A)
+{
+  if ((A->Getn() != n) || (A->GetNumEntries() != numEntries))
+  {
+    printf("Error: SparseCholeskySolver: the topology of the matrix does not match the topology given to the constructor.\n");
+    return -1;
+  }
+
+  factored = 0;
+  for(int level=0; level<numLevels; level++)
+  {
+    int code = ProcessLevel(FACTOR, level, A);
+    if (code != 0)
+    {
+      if (verbose >= 1)
+        printf("Error: SparseCholeskySolver: the factorization failed at pivot %d.\n", code);
+      return code;
+    }
+  }
+  factored = 1;
+
+  return 0;
+}
+
+int SparseCholeskySolver::SolveLinearSystem(double * x, const double * rhs)
+{
+  if (!factored)
+  {
+    printf("Error: SparseCholeskySolver: the matrix has not been factored.\n");
+    return 1;
+  }
+
+  for(int k=0; k<n; k++)
+    solution[k] = rhs[perm[k]];
+
+  for(int level=0; level<numLevels; level++)
+    ProcessLevel(FORWARD_SUBSTITUTION, level, NULL);
+
+  if (!positiveDefinite)
+  {
+    for(int k=0; k<n; k++)
+      solution[k] /= diagonal[k];
+  }
+
+  for(int level=numLevels-1; level>=0; level--)
+    ProcessLevel(BACKWARD_SUBSTITUTION, level, NULL);
+
+  for(int k=0; k<n; k++)
+    x[perm[k]] = solution[k];
+
+  return 0;
+}
+
@@ -0,0 +1,160 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "sparseSolver" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC   *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef _SPARSECHOLESKYSOLVER_H_
+#define _SPARSECHOLESKYSOLVER_H_
+
+/*
+  Solves A * x = rhs, where A is sparse, symmetric, and usually large,
+  using a built-in direct solver (no external libraries are needed).
+
+  If A is positive-definite, the solver computes the Cholesky factorization P A P^T = L L^T.
+  Otherwise, it computes the factorization P A P^T = L D L^T, where L is unit lower-triangular
+  and D is diagonal. The LDL^T factorization does not pivot, so it requires that all the leading minors
+  of the reordered matrix are non-singular (true, for example, for symmetric positive-definite and
+  symmetric negative-definite matrices).
+
+  The permutation P is computed using the approximate minimum degree ordering (see AMDOrdering.h),
+  followed by a postorder of the elimination tree.
+
+  The factorization is supernodal: columns of L with the same sparsity structure
+  are grouped into supernodes, and each supernode is stored as a dense column-major block.
+  The numerical factorization (left-looking) and the triangular solves therefore mostly operate on
+  dense blocks, using cache-friendly dense kernels.
+
+  Supernodes at the same level of the supernodal elimination tree are independent.
+  With numThreads > 1, the numerical factorization and the forward/backward substitutions process
+  each level in parallel, using the global thread pool (see threadPool.h).
+
+  Usage:
+  1. Construct the solver with the matrix A: this computes the ordering and the symbolic factorization
+     (only the sparsity pattern of A matters for this step).
+  2. Call ComputeCholeskyDecomposition(A) to compute the numerical factorization.
+     If the entries of A change (but not the pattern), simply call ComputeCholeskyDecomposition again;
+     the ordering and the symbolic factorization are re-used.
+  3. Call SolveLinearSystem, any number of times.
+*/
+
+#include <stddef.h>
+#include "linearSolver.h"
+#include "sparseMatrix.h"
+
+class SparseCholeskySolver : public LinearSolver
+{
+public:
+
+  // the constructor computes the ordering and the symbolic factorization
+  // only the topology of A matters for this step; A is not modified
+  // A must be structurally symmetric, with all diagonal entries present in the pattern
+  // positiveDefinite: 1: use L L^T; 0: use L D L^T
+  SparseCholeskySolver(const SparseMatrix * A, int numThreads=1, int positiveDefinite=0, int verbose=0);
+  // creates a solver that shares the ordering and the symbolic factorization of "source" (no ordering or symbolic analysis is performed);
+  // use this to factor several matrices with the same topology (e.g., the system matrices of several copies of the same object);
+  // only the numerical factorization and the workspace are allocated; "source" must not be deleted before this solver
+  SparseCholeskySolver(const SparseCholeskySolver * source, int numThreads=1);
+  virtual ~SparseCholeskySolver();
+
+  // computes the numerical factorization; A must have the same topology as the matrix passed to the constructor
+  // returns 0 on success, and k > 0 if the k-th pivot (of the reordered matrix) is non-positive (L L^T) or zero (L D L^T)
+  int ComputeCholeskyDecomposition(const SparseMatrix * A);
+
+  // solve: A * x = rhs, using the previously computed factorization
+  // rhs is not modified
+  virtual int SolveLinearSystem(double * x, const double * rhs);
+
+  inline int Getn() const { return n; }
+  inline int GetNumSupernodes() const { return numSupernodes; }
+  inline int GetNumLevels() const { return numLevels; }
+  inline size_t GetNumFactorEntries() const { return supernodeValueStart[numSupernodes]; } // including the explicit zeros inside the dense supernodal blocks
+  inline const int * GetPermutation() const { return perm; } // perm[k] is the row/column of A that is eliminated k-th
+
+protected:
+  int n;
+  int numThreads;
+  int positiveDefinite;
+  int verbose;
+  int factored;
+  int ownsSymbolicFactorization; // 0 if the arrays of the symbolic factorization belong to another solver
+
+  int * perm; // fill-reducing permutation
+  int * invPerm;
+
+  // supernodes: columns supernodeStart[s], ..., supernodeStart[s+1]-1 of L
+  int numSupernodes;
+  int * supernodeStart;
+  // row structure of each supernode: supernodeRows[supernodeRowStart[s]], ..., supernodeRows[supernodeRowStart[s+1]-1]
+  // (sorted; begins with the supernode's own columns)
+  int * supernodeRowStart;
+  int * supernodeRows;
+  // values of L: each supernode is a dense column-major block (numRows x numColumns), starting at values[supernodeValueStart[s]]
+  size_t * supernodeValueStart;
+  double * values;
+  double * diagonal; // D (only for L D L^T)
+
+  // supernode s is updated by the rows firstUpdateRow, ..., lastUpdateRow-1 (positions within the row structure) of each
+  // supernode updateSource[j], for j = updateStart[s], ..., updateStart[s+1]-1
+  int * updateStart;
+  int * updateSource;
+  int * firstUpdateRow;
+  int * lastUpdateRow;
+
+  // supernodes grouped by their level in the supernodal elimination tree (level 0 = leaves)
+  int numLevels;
+  int * levelStart;
+  int * levelSupernodes;
+
+  // location of each lower-triangular entry of A inside "values"
+  // (entries of row i of A start at entryMap[entryStart[i]]; entries in the upper triangle of the reordered matrix are marked with (size_t)-1)
+  int * entryStart;
+  size_t * entryMap;
+  int numEntries;
+
+  // workspace, one per thread
+  int ** relativeMap;
+  double ** updateBuffer;
+  int maxUpdateRows; // max number of rows of an update
+  size_t maxUpdateEntries; // max size of the scaled block L_d(p1:p2-1,:) * D_d (only for L D L^T)
+  double * solution; // the permuted solution vector
+
+  void ComputeSymbolicFactorization(const SparseMatrix * A);
+  void AllocateNumericalFactorization(); // values, diagonal, and the workspace
+  static void ComputeEliminationTree(int n, const SparseMatrix * A, const int * perm, const int * invPerm, int * parent);
+
+  // numerical factorization of one supernode; returns 0 on success, or the (1-indexed) failed pivot
+  int FactorSupernode(int supernode, const SparseMatrix * A, int threadIndex);
+  void ForwardSubstitutionSupernode(int supernode, double * y);
+  void BackwardSubstitutionSupernode(int supernode, double * y);
+
+  // processes all the supernodes of one level (in parallel, if numThreads > 1)
+  typedef enum { FACTOR, FORWARD_SUBSTITUTION, BACKWARD_SUBSTITUTION } phaseType;
+  int ProcessLevel(phaseType phase, int level, const SparseMatrix * A);
+  static void LevelTask(void * data, int rank);
+};
+
+#endif
+
@@ -33,6 +33,7 @@
 #include "CGSolver.h"
 #include "SPOOLESSolver.h"
 #include "SPOOLESSolverMT.h"
+#include "SparseCholeskySolver.h"
 
 #endif
 
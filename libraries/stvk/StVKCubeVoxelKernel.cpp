@@ -0,0 +1,329 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "StVK" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC           *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include "StVKCubeVoxelKernel.h"
+
+StVKCubeVoxelKernel::StVKCubeVoxelKernel(VolumetricMesh * volumetricMesh_, StVKCubeABCD * cubeABCD, const double * lambdaLame, const double * muLame): volumetricMesh(volumetricMesh_)
+{
+  // enumerate the pairs (a,b), a <= b
+  int pair = 0;
+  for(int a=0; a<8; a++)
+    for(int b=a; b<8; b++)
+    {
+      pairIndex[a][b] = pairIndex[b][a] = pair;
+      pairFirst[pair] = a;
+      pairSecond[pair] = b;
+      pair++;
+    }
+
+  // group the elements by their Lame parameters
+  int numElements = volumetricMesh->getNumElements();
+  elementGroup = (int*) malloc (sizeof(int) * numElements);
+  double * groupLambda = (double*) malloc (sizeof(double) * numElements);
+  double * groupMu = (double*) malloc (sizeof(double) * numElements);
+  numLameGroups = 0;
+  for(int el=0; el<numElements; el++)
+  {
+    int group = 0;
+    while ((group < numLameGroups) && ((groupLambda[group] != lambdaLame[el]) || (groupMu[group] != muLame[el])))
+      group++;
+
+    if (group == numLameGroups)
+    {
+      groupLambda[numLameGroups] = lambdaLame[el];
+      groupMu[numLameGroups] = muLame[el];
+      numLameGroups++;
+    }
+    elementGroup[el] = group;
+  }
+
+  linearTable = (double*) malloc (sizeof(double) * numLameGroups * 24 * 24);
+  quadraticDotTable = (double*) malloc (sizeof(double) * numLameGroups * 24 * numPairs);
+  quadraticVectorTable = (double*) malloc (sizeof(double) * numLameGroups * 64 * 24);
+  cubicTable = (double*) malloc (sizeof(double) * numLameGroups * numPairs * numPairs);
+
+  for(int group=0; group<numLameGroups; group++)
+    BuildTables(cubeABCD, groupLambda[group], groupMu[group], &linearTable[group * 24 * 24], &quadraticDotTable[group * 24 * numPairs], &quadraticVectorTable[group * 64 * 24], &cubicTable[group * numPairs * numPairs]);
+
+  free(groupLambda);
+  free(groupMu);
+}
+
+StVKCubeVoxelKernel::~StVKCubeVoxelKernel()
+{
+  free(elementGroup);
+  free(linearTable);
+  free(quadraticDotTable);
+  free(quadraticVectorTable);
+  free(cubicTable);
+}
+
+int StVKCubeVoxelKernel::CountLameGroups(int numElements, const double * lambdaLame, const double * muLame, int maxNumGroups)
+{
+  double * groupLambda = (double*) malloc (sizeof(double) * (maxNumGroups + 1));
+  double * groupMu = (double*) malloc (sizeof(double) * (maxNumGroups + 1));
+  int numGroups = 0;
+  for(int el=0; (el<numElements) && (numGroups <= maxNumGroups); el++)
+  {
+    int group = 0;
+    while ((group < numGroups) && ((groupLambda[group] != lambdaLame[el]) || (groupMu[group] != muLame[el])))
+      group++;
+
+    if (group == numGroups)
+    {
+      groupLambda[numGroups] = lambdaLame[el];
+      groupMu[numGroups] = muLame[el];
+      numGroups++;
+    }
+  }
+  free(groupLambda);
+  free(groupMu);
+  return numGroups;
+}
+
+void StVKCubeVoxelKernel::BuildTables(StVKCubeABCD * cubeABCD, double lambda, double mu, double * linear, double * quadraticDot, double * quadraticVector, double * cubic)
+{
+  void * elIter;
+  cubeABCD->AllocateElementIterator(&elIter);
+  cubeABCD->PrepareElement(0, elIter); // all the cubes have the same coefficients
+
+  // linear terms: force on c is sum_a (lambda * A_ca + mu * A_ac + mu * B_ac * I) q_a
+  for(int c=0; c<8; c++)
+    for(int a=0; a<8; a++)
+    {
+      Mat3d Aca = cubeABCD->A(elIter, c, a);
+      Mat3d Aac = cubeABCD->A(elIter, a, c);
+      double Bac = cubeABCD->B(elIter, a, c);
+      for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+          linear[24 * (3*c+i) + 3*a+j] = lambda * Aca[i][j] + mu * Aac[i][j] + ((i == j) ? mu * Bac : 0.0);
+    }
+
+  // quadratic terms: force on c is sum_{a,b} (q_a . q_b) (lambda/2 * C_cab + mu * C_abc) + (Cmix_abc . q_a) q_b,
+  // where Cmix_abc = lambda * C_abc + mu * (C_cab + C_bac)
+  for(int c=0; c<8; c++)
+    for(int pair=0; pair<numPairs; pair++)
+    {
+      int a = pairFirst[pair];
+      int b = pairSecond[pair];
+      Vec3d h = 0.5 * lambda * cubeABCD->C(elIter, c, a, b) + mu * cubeABCD->C(elIter, a, b, c);
+      if (a != b)
+        h += 0.5 * lambda * cubeABCD->C(elIter, c, b, a) + mu * cubeABCD->C(elIter, b, a, c);
+      for(int k=0; k<3; k++)
+        quadraticDot[numPairs * (3*c+k) + pair] = h[k];
+    }
+
+  for(int c=0; c<8; c++)
+    for(int b=0; b<8; b++)
+      for(int a=0; a<8; a++)
+      {
+        Vec3d Cmix = lambda * cubeABCD->C(elIter, a, b, c) + mu * (cubeABCD->C(elIter, c, a, b) + cubeABCD->C(elIter, b, a, c));
+        for(int k=0; k<3; k++)
+          quadraticVector[24 * (8*c+b) + 3*a+k] = Cmix[k];
+      }
+
+  // cubic terms: force on c is sum_d T_cd q_d, with T_cd = sum_{a,b} (q_a . q_b) (lambda/2 * D_abcd + mu * D_acbd);
+  // by the symmetries of D, T is symmetric, so only the entries c <= d are tabulated (averaging T_cd and T_dc)
+  for(int pairCD=0; pairCD<numPairs; pairCD++)
+  {
+    int c = pairFirst[pairCD];
+    int d = pairSecond[pairCD];
+    for(int pairAB=0; pairAB<numPairs; pairAB++)
+    {
+      int a = pairFirst[pairAB];
+      int b = pairSecond[pairAB];
+      double entry = 0.5 * lambda * (cubeABCD->D(elIter, a, b, c, d) + cubeABCD->D(elIter, a, b, d, c)) + 
+                     mu * (cubeABCD->D(elIter, a, c, b, d) + cubeABCD->D(elIter, a, d, b, c));
+      if (a != b)
+        entry += 0.5 * lambda * (cubeABCD->D(elIter, b, a, c, d) + cubeABCD->D(elIter, b, a, d, c)) + 
+                 mu * (cubeABCD->D(elIter, b, c, a, d) + cubeABCD->D(elIter, b, d, a, c));
+      cubic[numPairs * pairCD + pairAB] = 0.5 * entry;
+    }
+  }
+
+  cubeABCD->ReleaseElementIterator(elIter);
+}
+
+void StVKCubeVoxelKernel::ComputeBatch(int order, int group, double q[24][batchSize], double f[24][batchSize])
+{
+  for(int i=0; i<24; i++)
+    for(int l=0; l<batchSize; l++)
+      f[i][l] = 0.0;
+
+  if (order == 1)
+  {
+    const double * linear = &linearTable[group * 24 * 24];
+    for(int i=0; i<24; i++)
+      for(int j=0; j<24; j++)
+      {
+        double entry = linear[24 * i + j];
+        for(int l=0; l<batchSize; l++)
+          f[i][l] += entry * q[j][l];
+      }
+    return;
+  }
+
+  // the dot products q_a . q_b, a <= b
+  double dots[numPairs][batchSize];
+  for(int pair=0; pair<numPairs; pair++)
+  {
+    int a = pairFirst[pair];
+    int b = pairSecond[pair];
+    for(int l=0; l<batchSize; l++)
+      dots[pair][l] = q[3*a+0][l] * q[3*b+0][l] + q[3*a+1][l] * q[3*b+1][l] + q[3*a+2][l] * q[3*b+2][l];
+  }
+
+  if (order == 2)
+  {
+    const double * quadraticDot = &quadraticDotTable[group * 24 * numPairs];
+    for(int i=0; i<24; i++)
+      for(int pair=0; pair<numPairs; pair++)
+      {
+        double entry = quadraticDot[numPairs * i + pair];
+        for(int l=0; l<batchSize; l++)
+          f[i][l] += entry * dots[pair][l];
+      }
+
+    const double * quadraticVector = &quadraticVectorTable[group * 64 * 24];
+    for(int c=0; c<8; c++)
+      for(int b=0; b<8; b++)
+      {
+        double s[batchSize];
+        for(int l=0; l<batchSize; l++)
+          s[l] = 0.0;
+        const double * row = &quadraticVector[24 * (8*c+b)];
+        for(int j=0; j<24; j++)
+          for(int l=0; l<batchSize; l++)
+            s[l] += row[j] * q[j][l];
+
+        for(int k=0; k<3; k++)
+          for(int l=0; l<batchSize; l++)
+            f[3*c+k][l] += s[l] * q[3*b+k][l];
+      }
+    return;
+  }
+
+  // order == 3
+  const double * cubic = &cubicTable[group * numPairs * numPairs];
+  double T[numPairs][batchSize];
+  for(int pairCD=0; pairCD<numPairs; pairCD++)
+  {
+    for(int l=0; l<batchSize; l++)
+      T[pairCD][l] = 0.0;
+    for(int pairAB=0; pairAB<numPairs; pairAB++)
+    {
+      double entry = cubic[numPairs * pairCD + pairAB];
+      for(int l=0; l<batchSize; l++)
+        T[pairCD][l] += entry * dots[pairAB][l];
+    }
+  }
+
+  for(int c=0; c<8; c++)
+    for(int d=0; d<8; d++)
+    {
+      int pair = pairIndex[c][d];
+      for(int k=0; k<3; k++)
+        for(int l=0; l<batchSize; l++)
+          f[3*c+k][l] += T[pair][l] * q[3*d+k][l];
+    }
+}
+
+void StVKCubeVoxelKernel::AddTermsContribution(int order, double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
+{
+  if (elementLow < 0)
+    elementLow = 0;
+  if (elementHigh < 0)
+    elementHigh = volumetricMesh->getNumElements();
+
+  double q[24][batchSize]; // displacements of the batch voxels; voxel l is stored in column l
+  double f[24][batchSize]; // forces on the batch voxels
+  int batchVertices[batchSize][8];
+  int batchGroup = -1;
+  int batchCount = 0;
+
+  for(int i=elementLow; i <= elementHigh; i++)
+  {
+    int el = -1;
+    int group = -1;
+    if (i < elementHigh)
+    {
+      el = (elementList != NULL) ? elementList[i] : i;
+      group = elementGroup[el];
+    }
+
+    // process the batch when it is full, when the next voxel has different Lame parameters, or at the end
+    if ((batchCount == batchSize) || ((batchCount > 0) && (group != batchGroup)))
+    {
+      for(int j=0; j<24; j++)
+        for(int l=batchCount; l<batchSize; l++)
+          q[j][l] = 0.0;
+
+      ComputeBatch(order, batchGroup, q, f);
+
+      for(int l=0; l<batchCount; l++)
+        for(int c=0; c<8; c++)
+        {
+          double * force = &forces[3 * batchVertices[l][c]];
+          force[0] += f[3*c+0][l];
+          force[1] += f[3*c+1][l];
+          force[2] += f[3*c+2][l];
+        }
+      batchCount = 0;
+    }
+
+    if (i == elementHigh)
+      break;
+
+    batchGroup = group;
+    for(int a=0; a<8; a++)
+    {
+      int vertex = volumetricMesh->getVertexIndex(el, a);
+      batchVertices[batchCount][a] = vertex;
+      q[3*a+0][batchCount] = vertexDisplacements[3*vertex+0];
+      q[3*a+1][batchCount] = vertexDisplacements[3*vertex+1];
+      q[3*a+2][batchCount] = vertexDisplacements[3*vertex+2];
+    }
+    batchCount++;
+  }
+}
+
+void StVKCubeVoxelKernel::AddLinearTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
+{
+  AddTermsContribution(1, vertexDisplacements, forces, elementList, elementLow, elementHigh);
+}
+
+void StVKCubeVoxelKernel::AddQuadraticTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
+{
+  AddTermsContribution(2, vertexDisplacements, forces, elementList, elementLow, elementHigh);
+}
+
+void StVKCubeVoxelKernel::AddCubicTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
+{
+  AddTermsContribution(3, vertexDisplacements, forces, elementList, elementLow, elementHigh);
+}
+
@@ -0,0 +1,103 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "StVK" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC           *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef _STVKCUBEVOXELKERNEL_H_
+#define _STVKCUBEVOXELKERNEL_H_
+
+/*
+  Evaluates the linear, quadratic and cubic StVK internal force terms of a voxel (cubic) mesh,
+  using the fact that all the cubes share the same A,B,C,D coefficients (StVKCubeABCD).
+
+  For each distinct pair of Lame parameters (lambda, mu), the coefficients are combined once 
+  (in the constructor) into dense tables that act directly on the 24 displacements of a voxel.
+  The quadratic and cubic terms only depend on the displacements via the dot products q_a . q_b 
+  of the voxel vertex displacements, which are symmetric in (a,b); the tables are folded accordingly 
+  (36 instead of 64 pairs). Per voxel, the cubic term then costs about 1600 multiply-adds 
+  (instead of the 8x8x8x8 loop of StVKInternalForces), and the quadratic term about 2600.
+
+  Voxels with the same Lame parameters are processed in batches of "batchSize" voxels, 
+  stored in the innermost array dimension, so that each table entry is loaded once per batch, 
+  and the compiler can map the batch onto SIMD lanes.
+
+  StVKInternalForces uses this class automatically if the precomputed integrals are of class StVKCubeABCD
+  (and there are at most maxNumLameGroups distinct Lame parameter pairs). 
+  The results agree with the generic element loops up to round-off.
+
+  See also StVKInternalForces.h .
+*/
+
+#include "volumetricMesh.h"
+#include "StVKCubeABCD.h"
+
+class StVKCubeVoxelKernel
+{
+public:
+
+  // lambdaLame, muLame give the Lame parameters of each element of the cubic mesh
+  StVKCubeVoxelKernel(VolumetricMesh * volumetricMesh, StVKCubeABCD * cubeABCD, const double * lambdaLame, const double * muLame);
+  virtual ~StVKCubeVoxelKernel();
+
+  // same semantics as the corresponding routines in StVKInternalForces: 
+  // add the contributions of elements elementList[elementLow], ..., elementList[elementHigh-1] (or elementLow, ..., elementHigh-1, if elementList is NULL)
+  void AddLinearTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
+  void AddQuadraticTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
+  void AddCubicTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
+
+  inline int GetNumLameGroups() { return numLameGroups; }
+
+  // returns the number of distinct (lambda, mu) pairs, or maxNumGroups + 1 if there are more than maxNumGroups of them
+  static int CountLameGroups(int numElements, const double * lambdaLame, const double * muLame, int maxNumGroups);
+
+  static const int maxNumLameGroups = 256; // each group needs about 34 Kb of tables
+  static const int batchSize = 4; // number of voxels processed together
+
+protected:
+  VolumetricMesh * volumetricMesh;
+
+  int numLameGroups;
+  int * elementGroup; // Lame group of each element
+
+  // per Lame group:
+  double * linearTable; // 24 x 24: stiffness matrix at the rest configuration
+  double * quadraticDotTable; // 24 x 36: force due to the dot products q_a . q_b (a <= b)
+  double * quadraticVectorTable; // 64 x 24: row 8*c+b gives the coefficient of q_b in the force on vertex c
+  double * cubicTable; // 36 x 36: maps the dot products q_a . q_b (a <= b) to the symmetric 8 x 8 matrix T, where the force on vertex c is sum_d T_cd q_d
+
+  static const int numPairs = 36;
+  int pairIndex[8][8]; // index of the pair (min(a,b), max(a,b)) 
+  int pairFirst[numPairs], pairSecond[numPairs]; // the vertices of each pair
+
+  void BuildTables(StVKCubeABCD * cubeABCD, double lambda, double mu, double * linear, double * quadraticDot, double * quadraticVector, double * cubic);
+
+  // order = 1, 2, 3 (linear, quadratic, cubic terms)
+  void AddTermsContribution(int order, double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
+  void ComputeBatch(int order, int group, double q[24][batchSize], double f[24][batchSize]);
+};
+
+#endif
+
@@ -0,0 +1,93 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "StVK" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC           *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef _STVKELEMENTABCDDISPATCH_H_
+#define _STVKELEMENTABCDDISPATCH_H_
+
+/*
+  Static dispatch of the StVK element loops (StVKInternalForces, StVKStiffnessMatrix, StVKHessianTensor).
+
+  The element loops are templated on the ABCD class and on the number of element vertices. 
+  They access the coefficients via qualified calls (e.g., abcd->ABCD::D(...)), which are not virtual,
+  and can therefore be inlined; with the number of element vertices known at compile time, 
+  the compiler can also unroll (and vectorize) the loops over the element vertices.
+  The ABCD class is identified once per call (not once per coefficient), by its exact dynamic type:
+  StVKTetABCD, StVKTetHighMemoryABCD and StVKCubeABCD use the specialized loops; 
+  any other class (including classes derived from these three) uses StVKElementABCDVirtual, 
+  i.e., virtual calls, as before.
+*/
+
+#include <typeinfo>
+#include "StVKElementABCD.h"
+#include "StVKTetABCD.h"
+#include "StVKTetHighMemoryABCD.h"
+#include "StVKCubeABCD.h"
+
+// forwards the (non-virtual) calls of the element loops to the virtual functions of StVKElementABCD
+class StVKElementABCDVirtual
+{
+public:
+  StVKElementABCDVirtual(StVKElementABCD * elementABCD_) : elementABCD(elementABCD_) {}
+
+  inline Mat3d A(void * elementIterator, int i, int j) { return elementABCD->A(elementIterator, i, j); }
+  inline double B(void * elementIterator, int i, int j) { return elementABCD->B(elementIterator, i, j); }
+  inline Vec3d C(void * elementIterator, int i, int j, int k) { return elementABCD->C(elementIterator, i, j, k); }
+  inline double D(void * elementIterator, int i, int j, int k, int l) { return elementABCD->D(elementIterator, i, j, k, l); }
+
+  inline void AllocateElementIterator(void ** elementIterator) { elementABCD->AllocateElementIterator(elementIterator); }
+  inline void ReleaseElementIterator(void * elementIterator) { elementABCD->ReleaseElementIterator(elementIterator); }
+  inline void PrepareElement(int el, void * elementIterator) { elementABCD->PrepareElement(el, elementIterator); }
+
+protected:
+  StVKElementABCD * elementABCD;
+};
+
+// calls kernel<ABCD, numElementVertices>(abcd, ...), where ABCD is the exact class of "elementABCD"
+#define STVK_ELEMENT_ABCD_DISPATCH(elementABCD, numElementVertices, kernel, ...)\
+  if (typeid(*(elementABCD)) == typeid(StVKTetABCD))\
+    kernel<StVKTetABCD, 4>((StVKTetABCD*)(elementABCD), __VA_ARGS__);\
+  else if (typeid(*(elementABCD)) == typeid(StVKTetHighMemoryABCD))\
+    kernel<StVKTetHighMemoryABCD, 4>((StVKTetHighMemoryABCD*)(elementABCD), __VA_ARGS__);\
+  else if (typeid(*(elementABCD)) == typeid(StVKCubeABCD))\
+    kernel<StVKCubeABCD, 8>((StVKCubeABCD*)(elementABCD), __VA_ARGS__);\
+  else\
+  {\
+    StVKElementABCDVirtual elementABCDVirtual(elementABCD);\
+    if ((numElementVertices) == 4)\
+      kernel<StVKElementABCDVirtual, 4>(&elementABCDVirtual, __VA_ARGS__);\
+    else if ((numElementVertices) == 8)\
+      kernel<StVKElementABCDVirtual, 8>(&elementABCDVirtual, __VA_ARGS__);\
+    else\
+    {\
+      printf("Error: unsupported number of element vertices: %d.\n", (int)(numElementVertices));\
+      throw 1;\
+    }\
+  }
+
+#endif
+
@@ -27,6 +27,7 @@
  *************************************************************************/
 
 #include "StVKHessianTensor.h"
+#include "StVKElementABCDDispatch.h"
 #include "volumetricMeshENuMaterial.h"
 
 #define QUADRATICFORM(m,x,y)\
@@ -301,7 +302,8 @@ int StVKHessianTensor::SaveHessianAtZeroToFile(const char * filename)
   return 0;
 }
 
-void StVKHessianTensor::EvaluateHessianQuadraticFormDirect(double * phir, double * phis, double * result)
+template<class ABCD, int N>
+void StVKHessianTensor::EvaluateHessianQuadraticFormDirectKernel(ABCD * abcd, double * phir, double * phis, double * result)
 {
   double entry[27];
   double * hijk0 = &entry[0];
@@ -318,34 +320,34 @@ void StVKHessianTensor::EvaluateHessianQuadraticFormDirect(double * phir, double
   // reset result to zero
   memset(result,0,sizeof(double)*3*numVertices_);
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
+  int vertices[N];
 
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
   printf("Evaluating Hessian Quadratic Form (rhs matrix)... Total num elements: %d \n",numElements_);
 
   for(int el=0; el < numElements_; el++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
+    abcd->ABCD::PrepareElement(el, elIter);
     if (el % 500 == 1)
       printf("%d ",el);
 
-    for(int ver=0; ver<numElementVertices; ver++)
+    for(int ver=0; ver<N; ver++)
       vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel, computing force on vertex c
+    for (int c=0; c<N; c++) // over all vertices of the voxel, computing force on vertex c
     {
       // quadratic terms
       int a,b;
-      for (a=0; a<numElementVertices; a++) // over all vertices
-        for(b=0; b<numElementVertices; b++)
+      for (a=0; a<N; a++) // over all vertices
+        for(b=0; b<N; b++)
         {
-          Vec3d D = 0.5 * lambda * precomputedIntegrals->C(elIter,c,a,b) +
-                    mu * precomputedIntegrals->C(elIter,a,b,c);
+          Vec3d D = 0.5 * lambda * abcd->ABCD::C(elIter,c,a,b) +
+                    mu * abcd->ABCD::C(elIter,a,b,c);
 
           // tensorProduct(D,qb);
           //AddTensor3x3x3BlockContributionToQuadraticForm(vertices[c], vertices[a], vertices[b], D, 1, phir, phis, result);
@@ -363,8 +365,8 @@ void StVKHessianTensor::EvaluateHessianQuadraticFormDirect(double * phir, double
 
           //-------
 
-          Vec3d C = lambda * precomputedIntegrals->C(elIter,a,b,c) +
-                    mu * (precomputedIntegrals->C(elIter,c,a,b) + precomputedIntegrals->C(elIter,b,a,c)); 
+          Vec3d C = lambda * abcd->ABCD::C(elIter,a,b,c) +
+                    mu * (abcd->ABCD::C(elIter,c,a,b) + abcd->ABCD::C(elIter,b,a,c)); 
 
           // tensorProduct(qb,C);
           //AddTensor3x3x3BlockContributionToQuadraticForm(vertices[c], vertices[a], vertices[b], C, 2, phir, phis, result);
@@ -391,14 +393,18 @@ void StVKHessianTensor::EvaluateHessianQuadraticFormDirect(double * phir, double
     }
   }
 
-  free(vertices);
-
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+  abcd->ABCD::ReleaseElementIterator(elIter);
 
   printf("\n");
 }
 
-void StVKHessianTensor::EvaluateHessianQuadraticFormDirectAll(double * Ulin, int k, double * result, int numRigidModes, int verbose)
+void StVKHessianTensor::EvaluateHessianQuadraticFormDirect(double * phir, double * phis, double * result)
+{
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, EvaluateHessianQuadraticFormDirectKernel, phir, phis, result);
+}
+
+template<class ABCD, int N>
+void StVKHessianTensor::EvaluateHessianQuadraticFormDirectAllKernel(ABCD * abcd, double * Ulin, int k, double * result, int numRigidModes, int verbose)
 {
   double entry[27];
   double * hijk0 = &entry[0];
@@ -416,10 +422,10 @@ void StVKHessianTensor::EvaluateHessianQuadraticFormDirectAll(double * Ulin, int
 
   memset(result,0,sizeof(double)*m3*numDeriv);
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
+  int vertices[N];
 
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
   if (verbose)
   {
@@ -433,26 +439,26 @@ void StVKHessianTensor::EvaluateHessianQuadraticFormDirectAll(double * Ulin, int
 
   for(int el=0; el < numElements_; el++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
+    abcd->ABCD::PrepareElement(el, elIter);
     if ((el % 200 == 0) && (verbose))
     {
       printf("%d ",el);
       fflush(NULL);
     }
-    for(int ver=0; ver<numElementVertices; ver++)
+    for(int ver=0; ver<N; ver++)
       vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel, computing force on vertex c
+    for (int c=0; c<N; c++) // over all vertices of the voxel, computing force on vertex c
     {
       // quadratic terms
-      for (int a=0; a<numElementVertices; a++) // over all vertices
-        for(int b=0; b<numElementVertices; b++)
+      for (int a=0; a<N; a++) // over all vertices
+        for(int b=0; b<N; b++)
         {
-          Vec3d D = lambda * precomputedIntegrals->C(elIter,c,a,b) + 
-                    mu * (precomputedIntegrals->C(elIter,a,b,c) + precomputedIntegrals->C(elIter,b,a,c));
+          Vec3d D = lambda * abcd->ABCD::C(elIter,c,a,b) + 
+                    mu * (abcd->ABCD::C(elIter,a,b,c) + abcd->ABCD::C(elIter,b,a,c));
 
           // tensorProduct(D,qb);
           //AddTensor3x3x3BlockContributionToQuadraticForm(vertices[c], vertices[a], vertices[b], D, 1, phir, phis, result);
@@ -469,9 +475,9 @@ void StVKHessianTensor::EvaluateHessianQuadraticFormDirectAll(double * Ulin, int
 
           //-------
 
-          Vec3d C = lambda * precomputedIntegrals->C(elIter,a,b,c) +
-                    mu * (precomputedIntegrals->C(elIter,c,a,b) + 
-                          precomputedIntegrals->C(elIter,b,a,c)); 
+          Vec3d C = lambda * abcd->ABCD::C(elIter,a,b,c) +
+                    mu * (abcd->ABCD::C(elIter,c,a,b) + 
+                          abcd->ABCD::C(elIter,b,a,c)); 
 
           // tensorProduct(qb,C);
           //AddTensor3x3x3BlockContributionToQuadraticForm(vertices[c], vertices[a], vertices[b], C, 2, phir, phis, result);
@@ -498,14 +504,17 @@ void StVKHessianTensor::EvaluateHessianQuadraticFormDirectAll(double * Ulin, int
     } 
   }
 
-  free(vertices);
-
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+  abcd->ABCD::ReleaseElementIterator(elIter);
 
   if (verbose)
     printf("\n");
 }
 
+void StVKHessianTensor::EvaluateHessianQuadraticFormDirectAll(double * Ulin, int k, double * result, int numRigidModes, int verbose)
+{
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, EvaluateHessianQuadraticFormDirectAllKernel, Ulin, k, result, numRigidModes, verbose);
+}
+
 void StVKHessianTensor::ComputeStiffnessMatrixCorrection(double * u, double * du, SparseMatrix * dK)
 {
   dK->ResetToZero();
@@ -520,7 +529,8 @@ void StVKHessianTensor::ComputeStiffnessMatrixCorrection(double * u, double * du
       dataHandle[rowc+k][3*column[c8+(where)]+l] += matrix[3*k+l];\
     }
 
-void StVKHessianTensor::AddQuadraticTermsContribution(double * u, double * du, SparseMatrix * dK, int elementLow, int elementHigh) 
+template<class ABCD, int N>
+void StVKHessianTensor::AddQuadraticTermsKernel(ABCD * abcd, double * u, double * du, SparseMatrix * dK, int elementLow, int elementHigh)
 {
   if (elementLow < 0)
     elementLow = 0;
@@ -530,38 +540,38 @@ void StVKHessianTensor::AddQuadraticTermsContribution(double * u, double * du, S
   int ** row_, ** column_;
   stVKStiffnessMatrix->GetMatrixAccelerationIndices(&row_, &column_);
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
+  int vertices[N];
 
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
   double ** dataHandle = dK->GetDataHandle();
 
   for(int el=elementLow; el < elementHigh; el++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
+    abcd->ABCD::PrepareElement(el, elIter);
     int * row = row_[el];
     int * column = column_[el];
 
-    for(int ver=0; ver<numElementVertices ;ver++)
+    for(int ver=0; ver<N ;ver++)
       vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel
+    for (int c=0; c<N; c++) // over all vertices of the voxel
     {
       int rowc = 3*row[c];
-      int c8 = numElementVertices*c;
-      for (int e=0; e<numElementVertices; e++) // compute contribution to block (c,e) of dK
+      int c8 = N*c;
+      for (int e=0; e<N; e++) // compute contribution to block (c,e) of dK
       {
         double matrix[9];
         memset(matrix, 0, sizeof(double) * 9);
-        for(int f=0; f<numElementVertices; f++)
+        for(int f=0; f<N; f++)
         {
           double qf[3] = { du[3*vertices[f]+0], du[3*vertices[f]+1], du[3*vertices[f]+2] };
           
-          Vec3d C0v = lambda * precomputedIntegrals->C(elIter,c,f,e) + mu * (precomputedIntegrals->C(elIter,e,f,c) + precomputedIntegrals->C(elIter,f,e,c));
+          Vec3d C0v = lambda * abcd->ABCD::C(elIter,c,f,e) + mu * (abcd->ABCD::C(elIter,e,f,c) + abcd->ABCD::C(elIter,f,e,c));
           double C0[3] = {C0v[0], C0v[1], C0v[2]};
 
           // C0 tensor qf
@@ -569,7 +579,7 @@ void StVKHessianTensor::AddQuadraticTermsContribution(double * u, double * du, S
           matrix[3] += C0[1] * qf[0]; matrix[4] += C0[1] * qf[1]; matrix[5] += C0[1] * qf[2];
           matrix[6] += C0[2] * qf[0]; matrix[7] += C0[2] * qf[1]; matrix[8] += C0[2] * qf[2];
 
-          Vec3d C1v = lambda * precomputedIntegrals->C(elIter,e,f,c) + mu * (precomputedIntegrals->C(elIter,c,e,f) + precomputedIntegrals->C(elIter,f,e,c));
+          Vec3d C1v = lambda * abcd->ABCD::C(elIter,e,f,c) + mu * (abcd->ABCD::C(elIter,c,e,f) + abcd->ABCD::C(elIter,f,e,c));
           double C1[3] = {C1v[0], C1v[1], C1v[2]};
 
           // qf tensor C1
@@ -577,7 +587,7 @@ void StVKHessianTensor::AddQuadraticTermsContribution(double * u, double * du, S
           matrix[3] += qf[1] * C1[0]; matrix[4] += qf[1] * C1[1]; matrix[5] += qf[1] * C1[2];
           matrix[6] += qf[2] * C1[0]; matrix[7] += qf[2] * C1[1]; matrix[8] += qf[2] * C1[2];
 
-          Vec3d C2v = lambda * precomputedIntegrals->C(elIter,f,e,c) + mu * (precomputedIntegrals->C(elIter,c,f,e) + precomputedIntegrals->C(elIter,e,f,c));
+          Vec3d C2v = lambda * abcd->ABCD::C(elIter,f,e,c) + mu * (abcd->ABCD::C(elIter,c,f,e) + abcd->ABCD::C(elIter,e,f,c));
           double C2[3] = {C2v[0], C2v[1], C2v[2]};
 
           // qf dot C2
@@ -592,12 +602,17 @@ void StVKHessianTensor::AddQuadraticTermsContribution(double * u, double * du, S
     }
   }
 
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+  abcd->ABCD::ReleaseElementIterator(elIter);
 
-  free(vertices);
 }
 
-void StVKHessianTensor::AddCubicTermsContribution(double * u, double * du, SparseMatrix * dK, int elementLow, int elementHigh)
+void StVKHessianTensor::AddQuadraticTermsContribution(double * u, double * du, SparseMatrix * dK, int elementLow, int elementHigh)
+{
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, AddQuadraticTermsKernel, u, du, dK, elementLow, elementHigh);
+}
+
+template<class ABCD, int N>
+void StVKHessianTensor::AddCubicTermsKernel(ABCD * abcd, double * u, double * du, SparseMatrix * dK, int elementLow, int elementHigh)
 {
   if (elementLow < 0)
     elementLow = 0;
@@ -607,37 +622,37 @@ void StVKHessianTensor::AddCubicTermsContribution(double * u, double * du, Spars
   int ** row_, ** column_;
   stVKStiffnessMatrix->GetMatrixAccelerationIndices(&row_, &column_);
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
+  int vertices[N];
 
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
   double ** dataHandle = dK->GetDataHandle();
 
   for(int el=elementLow; el < elementHigh; el++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
+    abcd->ABCD::PrepareElement(el, elIter);
     int * row = row_[el];
     int * column = column_[el];
 
-    for(int ver=0; ver<numElementVertices ;ver++)
+    for(int ver=0; ver<N ;ver++)
       vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel
+    for (int c=0; c<N; c++) // over all vertices of the voxel
     {
       int rowc = 3*row[c];
-      int c8 = numElementVertices*c;
-      for (int e=0; e<numElementVertices; e++) // compute contribution to block (c,e) of dK
+      int c8 = N*c;
+      for (int e=0; e<N; e++) // compute contribution to block (c,e) of dK
       {
         double matrix[9];
         memset(matrix, 0, sizeof(double) * 9);
-        for(int f=0; f<numElementVertices; f++)
+        for(int f=0; f<N; f++)
         {
           double qf[3] = { du[3*vertices[f]+0], du[3*vertices[f]+1], du[3*vertices[f]+2] };
-          for(int a=0; a<numElementVertices; a++)
+          for(int a=0; a<N; a++)
           {
             double qa[3] = { u[3*vertices[a]+0], u[3*vertices[a]+1], u[3*vertices[a]+2] };
 
@@ -647,19 +662,19 @@ void StVKHessianTensor::AddCubicTermsContribution(double * u, double * du, Spars
             qaqf[3] = qa[1] * qf[0]; qaqf[4] = qa[1] * qf[1]; qaqf[5] = qa[1] * qf[2];
             qaqf[6] = qa[2] * qf[0]; qaqf[7] = qa[2] * qf[1]; qaqf[8] = qa[2] * qf[2];
 
-            double D0 = lambda * precomputedIntegrals->D(elIter,f,c,a,e) + mu * (precomputedIntegrals->D(elIter,f,e,a,c) + precomputedIntegrals->D(elIter,f,a,c,e));
+            double D0 = lambda * abcd->ABCD::D(elIter,f,c,a,e) + mu * (abcd->ABCD::D(elIter,f,e,a,c) + abcd->ABCD::D(elIter,f,a,c,e));
 
             matrix[0] += D0 * qaqf[0]; matrix[1] += D0 * qaqf[3]; matrix[2] += D0 * qaqf[6];
             matrix[3] += D0 * qaqf[1]; matrix[4] += D0 * qaqf[4]; matrix[5] += D0 * qaqf[7];
             matrix[6] += D0 * qaqf[2]; matrix[7] += D0 * qaqf[5]; matrix[8] += D0 * qaqf[8];
 
-            double D1 = lambda * precomputedIntegrals->D(elIter,a,c,f,e) + mu * (precomputedIntegrals->D(elIter,a,e,f,c) + precomputedIntegrals->D(elIter,a,f,c,e));
+            double D1 = lambda * abcd->ABCD::D(elIter,a,c,f,e) + mu * (abcd->ABCD::D(elIter,a,e,f,c) + abcd->ABCD::D(elIter,a,f,c,e));
 
             matrix[0] += D1 * qaqf[0]; matrix[1] += D1 * qaqf[1]; matrix[2] += D1 * qaqf[2];
             matrix[3] += D1 * qaqf[3]; matrix[4] += D1 * qaqf[4]; matrix[5] += D1 * qaqf[5];
             matrix[6] += D1 * qaqf[6]; matrix[7] += D1 * qaqf[7]; matrix[8] += D1 * qaqf[8];
 
-            double D2 = lambda * precomputedIntegrals->D(elIter,f,a,c,e) + mu * (precomputedIntegrals->D(elIter,f,c,a,e) + precomputedIntegrals->D(elIter,a,c,f,e));
+            double D2 = lambda * abcd->ABCD::D(elIter,f,a,c,e) + mu * (abcd->ABCD::D(elIter,f,c,a,e) + abcd->ABCD::D(elIter,a,c,f,e));
 
             // qf dot qa
             double dotp = D2 * (qf[0]*qa[0] + qf[1]*qa[1] + qf[2]*qa[2]);
@@ -674,9 +689,12 @@ void StVKHessianTensor::AddCubicTermsContribution(double * u, double * du, Spars
     }
   }
 
-  free(vertices);
+  abcd->ABCD::ReleaseElementIterator(elIter);
+}
 
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+void StVKHessianTensor::AddCubicTermsContribution(double * u, double * du, SparseMatrix * dK, int elementLow, int elementHigh)
+{
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, AddCubicTermsKernel, u, du, dK, elementLow, elementHigh);
 }
 
 
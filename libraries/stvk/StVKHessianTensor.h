@@ -91,6 +91,12 @@ protected:
 
   double * lambdaLame;
   double * muLame;
+
+  // the element loops, specialized to the ABCD class and the number of element vertices N (see StVKElementABCDDispatch.h)
+  template<class ABCD, int N> void EvaluateHessianQuadraticFormDirectKernel(ABCD * abcd, double * phir, double * phis, double * result);
+  template<class ABCD, int N> void EvaluateHessianQuadraticFormDirectAllKernel(ABCD * abcd, double * Ulin, int k, double * result, int numRigidModes, int verbose);
+  template<class ABCD, int N> void AddQuadraticTermsKernel(ABCD * abcd, double * u, double * du, SparseMatrix * dK, int elementLow, int elementHigh);
+  template<class ABCD, int N> void AddCubicTermsKernel(ABCD * abcd, double * u, double * du, SparseMatrix * dK, int elementLow, int elementHigh);
 };
 
 #endif
@@ -27,6 +27,8 @@
  *************************************************************************/
 
 #include "StVKInternalForces.h"
+#include "StVKElementABCDDispatch.h"
+#include "StVKCubeVoxelKernel.h"
 #include "volumetricMeshENuMaterial.h"
 
 StVKInternalForces::StVKInternalForces(VolumetricMesh * volumetricMesh_, StVKElementABCD * precomputedABCDIntegrals_, bool addGravity_, double g_): volumetricMesh(volumetricMesh_), precomputedIntegrals(precomputedABCDIntegrals_), gravityForce(NULL), addGravity(addGravity_), g(g_) 
@@ -51,11 +53,19 @@ StVKInternalForces::StVKInternalForces(VolumetricMesh * volumetricMesh_, StVKEle
 
   buffer = (double*) malloc (sizeof(double) * 3 * volumetricMesh->getNumVertices());
   numElementVertices = volumetricMesh->getNumElementVertices();
+
+  // voxel meshes: all the cubes share the same ABCD coefficients
+  voxelKernel = NULL;
+  if ((precomputedIntegrals != NULL) && (typeid(*precomputedIntegrals) == typeid(StVKCubeABCD)) && 
+      (StVKCubeVoxelKernel::CountLameGroups(numElements, lambdaLame, muLame, StVKCubeVoxelKernel::maxNumLameGroups) <= StVKCubeVoxelKernel::maxNumLameGroups))
+    voxelKernel = new StVKCubeVoxelKernel(volumetricMesh, (StVKCubeABCD*) precomputedIntegrals, lambdaLame, muLame);
+
   InitGravity();
 }
 
 StVKInternalForces::~StVKInternalForces()
 {
+  delete(voxelKernel);
   free(gravityForce);
   free(buffer);
   free(lambdaLame);
@@ -128,38 +138,45 @@ void StVKInternalForces::ComputeForces(double * vertexDisplacements, double * fo
 }
 
 void StVKInternalForces::AddLinearTermsContribution(double * vertexDisplacements, double * forces, int elementLow, int elementHigh)
+{
+  AddLinearTermsContribution(vertexDisplacements, forces, NULL, elementLow, elementHigh);
+}
+
+template<class ABCD, int N>
+void StVKInternalForces::AddLinearTermsKernel(ABCD * abcd, double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
 {
   if (elementLow < 0)
     elementLow = 0;
   if (elementHigh < 0)
     elementHigh = volumetricMesh->getNumElements();
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
+  int vertices[N];
 
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
-  for(int el=elementLow; el < elementHigh; el++)
+  for(int i=elementLow; i < elementHigh; i++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
-    for(int ver=0; ver<numElementVertices; ver++)
+    int el = (elementList != NULL) ? elementList[i] : i;
+    abcd->ABCD::PrepareElement(el, elIter);
+    for(int ver=0; ver<N; ver++)
       vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel, computing force on vertex c
+    for (int c=0; c<N; c++) // over all vertices of the voxel, computing force on vertex c
     {
       // linear terms
-      for (int a=0; a<numElementVertices; a++) // over all vertices
+      for (int a=0; a<N; a++) // over all vertices
       {
         Vec3d qa(vertexDisplacements[3*vertices[a]+0],
                  vertexDisplacements[3*vertices[a]+1],
                  vertexDisplacements[3*vertices[a]+2]);
 
-        Vec3d force = lambda * (precomputedIntegrals->A(elIter,c,a) * qa) +
-                      (mu * precomputedIntegrals->B(elIter,a,c)) * qa +
-                      mu * (precomputedIntegrals->A(elIter,a,c) * qa);
+        Vec3d force = lambda * (abcd->ABCD::A(elIter,c,a) * qa) +
+                      (mu * abcd->ABCD::B(elIter,a,c)) * qa +
+                      mu * (abcd->ABCD::A(elIter,a,c) * qa);
 
         forces[3*vertices[c]+0] += force[0];
         forces[3*vertices[c]+1] += force[1];
@@ -168,37 +185,53 @@ void StVKInternalForces::AddLinearTermsContribution(double * vertexDisplacements
     }
   }
 
-  free(vertices);
+  abcd->ABCD::ReleaseElementIterator(elIter);
+}
 
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+void StVKInternalForces::AddLinearTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
+{
+  if (voxelKernel != NULL)
+  {
+    voxelKernel->AddLinearTermsContribution(vertexDisplacements, forces, elementList, elementLow, elementHigh);
+    return;
+  }
+
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, AddLinearTermsKernel, vertexDisplacements, forces, elementList, elementLow, elementHigh);
 }
 
 void StVKInternalForces::AddQuadraticTermsContribution(double * vertexDisplacements, double * forces, int elementLow, int elementHigh)
+{
+  AddQuadraticTermsContribution(vertexDisplacements, forces, NULL, elementLow, elementHigh);
+}
+
+template<class ABCD, int N>
+void StVKInternalForces::AddQuadraticTermsKernel(ABCD * abcd, double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
 {
   if (elementLow < 0)
     elementLow = 0;
   if (elementHigh < 0)
     elementHigh = volumetricMesh->getNumElements();
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
+  int vertices[N];
 
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
-  for(int el=elementLow; el < elementHigh; el++)
+  for(int i=elementLow; i < elementHigh; i++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
-    for(int ver=0; ver<numElementVertices; ver++)
+    int el = (elementList != NULL) ? elementList[i] : i;
+    abcd->ABCD::PrepareElement(el, elIter);
+    for(int ver=0; ver<N; ver++)
       vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel, computing force on vertex c
+    for (int c=0; c<N; c++) // over all vertices of the voxel, computing force on vertex c
     {
       // quadratic terms
-      for (int a=0; a<numElementVertices; a++) // over all vertices
-        for(int b=0; b<numElementVertices; b++)
+      for (int a=0; a<N; a++) // over all vertices
+        for(int b=0; b<N; b++)
         {
 /*
           Vec3d force(0,0,0);
@@ -212,11 +245,11 @@ void StVKInternalForces::AddQuadraticTermsContribution(double * vertexDisplaceme
 
           double dotp = dot(qa,qb);
 
-          force += 0.5 * lambda * dotp * precomputedIntegrals->C(el,c,a,b) +
-                   mu * dotp * precomputedIntegrals->C(el,a,b,c);
+          force += 0.5 * lambda * dotp * abcd->ABCD::C(el,c,a,b) +
+                   mu * dotp * abcd->ABCD::C(el,a,b,c);
 
-          Vec3d C = lambda * precomputedIntegrals->C(el,a,b,c) +
-                    mu * (precomputedIntegrals->C(el,c,a,b) + precomputedIntegrals->C(el,b,a,c)); 
+          Vec3d C = lambda * abcd->ABCD::C(el,a,b,c) +
+                    mu * (abcd->ABCD::C(el,c,a,b) + abcd->ABCD::C(el,b,a,c)); 
 
           force += dot(C,qa) * qb;
 
@@ -234,11 +267,11 @@ void StVKInternalForces::AddQuadraticTermsContribution(double * vertexDisplaceme
 
           double dotp = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2];
 
-          Vec3d forceTerm1 = 0.5 * lambda * dotp * precomputedIntegrals->C(elIter,c,a,b) +
-                             mu * dotp * precomputedIntegrals->C(elIter,a,b,c);
+          Vec3d forceTerm1 = 0.5 * lambda * dotp * abcd->ABCD::C(elIter,c,a,b) +
+                             mu * dotp * abcd->ABCD::C(elIter,a,b,c);
 
-          Vec3d C = lambda * precomputedIntegrals->C(elIter,a,b,c) +
-                    mu * (precomputedIntegrals->C(elIter,c,a,b) + precomputedIntegrals->C(elIter,b,a,c)); 
+          Vec3d C = lambda * abcd->ABCD::C(elIter,a,b,c) +
+                    mu * (abcd->ABCD::C(elIter,c,a,b) + abcd->ABCD::C(elIter,b,a,c)); 
 
           double dotCqa = C[0] * qa[0] + C[1] * qa[1] + C[2] * qa[2];
 
@@ -249,44 +282,60 @@ void StVKInternalForces::AddQuadraticTermsContribution(double * vertexDisplaceme
     }
   }
 
-  free(vertices);
+  abcd->ABCD::ReleaseElementIterator(elIter);
+}
 
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+void StVKInternalForces::AddQuadraticTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
+{
+  if (voxelKernel != NULL)
+  {
+    voxelKernel->AddQuadraticTermsContribution(vertexDisplacements, forces, elementList, elementLow, elementHigh);
+    return;
+  }
+
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, AddQuadraticTermsKernel, vertexDisplacements, forces, elementList, elementLow, elementHigh);
 }
 
 void StVKInternalForces::AddCubicTermsContribution(double * vertexDisplacements, double * forces, int elementLow, int elementHigh)
+{
+  AddCubicTermsContribution(vertexDisplacements, forces, NULL, elementLow, elementHigh);
+}
+
+template<class ABCD, int N>
+void StVKInternalForces::AddCubicTermsKernel(ABCD * abcd, double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
 {
   if (elementLow < 0)
     elementLow = 0;
   if (elementHigh < 0)
     elementHigh = volumetricMesh->getNumElements();
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
+  int vertices[N];
 
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
-  for(int el=elementLow; el < elementHigh; el++)
+  for(int i=elementLow; i < elementHigh; i++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
+    int el = (elementList != NULL) ? elementList[i] : i;
+    abcd->ABCD::PrepareElement(el, elIter);
 
-    for(int ver=0; ver<numElementVertices; ver++)
+    for(int ver=0; ver<N; ver++)
       vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel, computing force on vertex c
+    for (int c=0; c<N; c++) // over all vertices of the voxel, computing force on vertex c
     {
       int vc = vertices[c];
       // cubic terms
-      for(int a=0; a<numElementVertices; a++) // over all vertices
+      for(int a=0; a<N; a++) // over all vertices
       {
         int va = vertices[a];
-        for(int b=0; b<numElementVertices; b++)
+        for(int b=0; b<N; b++)
         {
           int vb = vertices[b];
-          for(int d=0; d<numElementVertices; d++)
+          for(int d=0; d<N; d++)
           {
             int vd = vertices[d];
 /*
@@ -317,7 +366,7 @@ void StVKInternalForces::AddCubicTermsContribution(double * vertexDisplacements,
             double * force = &(forces[3*vc]);
 
             double dotp = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2]; 
-            double scalar = dotp * (0.5 * lambda * precomputedIntegrals->D(elIter,a,b,c,d) + mu * precomputedIntegrals->D(elIter,a,c,b,d) );
+            double scalar = dotp * (0.5 * lambda * abcd->ABCD::D(elIter,a,b,c,d) + mu * abcd->ABCD::D(elIter,a,c,b,d) );
 
             force[0] += scalar * qd[0];
             force[1] += scalar * qd[1];
@@ -328,9 +377,18 @@ void StVKInternalForces::AddCubicTermsContribution(double * vertexDisplacements,
     }
   }
 
-  free(vertices);
+  abcd->ABCD::ReleaseElementIterator(elIter);
+}
+
+void StVKInternalForces::AddCubicTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh)
+{
+  if (voxelKernel != NULL)
+  {
+    voxelKernel->AddCubicTermsContribution(vertexDisplacements, forces, elementList, elementLow, elementHigh);
+    return;
+  }
 
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, AddCubicTermsKernel, vertexDisplacements, forces, elementList, elementLow, elementHigh);
 }
 
 void StVKInternalForces::ResetVector(double * vec)
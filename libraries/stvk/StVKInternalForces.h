@@ -70,6 +70,9 @@ high-memory implementation. With a few thousand tetrahedra (depending on the
 size and availability of your memory), you can gain a small speedup (e.g. 1.5x) 
 by using a high-memory version (see StVKTetHighMemoryABCD.h).
 
+With cube meshes, all the cubes share the same coefficients, and the internal forces
+are evaluated with dense per-material tables (see StVKCubeVoxelKernel.h).
+
 Note: all matrices are stored in the column-major order (same format as in LAPACK).
 
 */
@@ -77,6 +80,8 @@ Note: all matrices are stored in the column-major order (same format as in LAPAC
 #include "volumetricMesh.h"
 #include "StVKElementABCD.h"
 
+class StVKCubeVoxelKernel;
+
 class StVKInternalForces
 {
 public:
@@ -105,6 +110,10 @@ public:
   void AddLinearTermsContribution(double * vertexDisplacements, double * forces, int elementLow=-1, int elementHigh=-1);
   void AddQuadraticTermsContribution(double * vertexDisplacements, double * forces, int elementLow=-1, int elementHigh=-1);
   void AddCubicTermsContribution(double * vertexDisplacements, double * forces, int elementLow=-1, int elementHigh=-1);
+  // same as above, except that they traverse the elements elementList[elementLow], ..., elementList[elementHigh-1]
+  void AddLinearTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
+  void AddQuadraticTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
+  void AddCubicTermsContribution(double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
   
 protected:
   VolumetricMesh * volumetricMesh;
@@ -122,6 +131,13 @@ protected:
 
   double * lambdaLame;
   double * muLame;
+
+  StVKCubeVoxelKernel * voxelKernel; // used for voxel meshes (StVKCubeABCD), instead of the element loops below; NULL otherwise
+
+  // the element loops of the Add*TermsContribution routines, specialized to the ABCD class and the number of element vertices N (see StVKElementABCDDispatch.h)
+  template<class ABCD, int N> void AddLinearTermsKernel(ABCD * abcd, double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
+  template<class ABCD, int N> void AddQuadraticTermsKernel(ABCD * abcd, double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
+  template<class ABCD, int N> void AddCubicTermsKernel(ABCD * abcd, double * vertexDisplacements, double * forces, const int * elementList, int elementLow, int elementHigh);
 };
 
 #endif
@@ -26,96 +26,139 @@
  *                                                                       *
  *************************************************************************/
 
-#include <pthread.h>
 #include "StVKInternalForcesMT.h"
+#include "generateElementColoring.h"
+#include "threadPool.h"
 
 StVKInternalForcesMT::StVKInternalForcesMT(VolumetricMesh * volumetricMesh, StVKElementABCD * precomputedABCDIntegrals, bool addGravity_, double g_, int numThreads_): StVKInternalForces(volumetricMesh, precomputedABCDIntegrals, addGravity_, g_), numThreads(numThreads_) 
 {
-  internalForceBuffer = (double*) malloc (sizeof(double) * numThreads * 3 * volumetricMesh->getNumVertices());
   energyBuffer = (double*) malloc (sizeof(double) * numThreads);
-  energyAuxBuffer = (double*) malloc (sizeof(double) * numThreads * 3 * volumetricMesh->getNumVertices());
+  energyAuxBuffer = (double*) malloc (sizeof(double) * 3 * 3 * volumetricMesh->getNumVertices());
 
-  // split the workload
-  int numElements = volumetricMesh->getNumElements();
-  startElement = (int*) malloc (sizeof(int) * numThreads);
-  endElement = (int*) malloc (sizeof(int) * numThreads);
+  // color the elements; elements of the same color do not share any vertices
+  numColors = GenerateElementColoring::Generate(volumetricMesh, &colorStarts, &coloredElements);
 
-  int remainder = numElements % numThreads;
-  // the first 'remainder' nodes will process one element more
-  int jobSize = numElements / numThreads;
-
-  for(int rank=0; rank < numThreads; rank++)
-  {
-    if (rank < remainder)
-    { 
-      startElement[rank] = rank * (jobSize+1);
-      endElement[rank] = (rank+1) * (jobSize+1);
-    }      
-    else      
-    { 
-      startElement[rank] = remainder * (jobSize+1) + (rank-remainder) * jobSize;
-      endElement[rank] = remainder * (jobSize+1) + ((rank-remainder)+1) * jobSize;
-    }
-  }
+  // split the workload of each color
+  GenerateElementColoring::PartitionColors(numColors, colorStarts, numThreads, &startElement, &endElement);
       
-  printf("Total elements: %d \n",numElements);
-  printf("Num threads: %d \n",numThreads);
-  printf("Canonical job size: %d \n",jobSize);      
-  printf("Num threads with job size augmented by one element: %d \n",remainder);
+  printf("Total elements: %d \n", volumetricMesh->getNumElements());
+  printf("Num threads: %d \n", numThreads);
 }
 
 StVKInternalForcesMT::~StVKInternalForcesMT() 
 {
   free(startElement);
   free(endElement);
+  free(colorStarts);
+  free(coloredElements);
   free(energyBuffer);
   free(energyAuxBuffer);
-  free(internalForceBuffer);
 }
 
-int StVKInternalForcesMT::GetStartElement(int rank)
+int StVKInternalForcesMT::GetStartElement(int color, int rank)
 {
-  return startElement[rank];
+  return startElement[color * numThreads + rank];
 }
 
-int StVKInternalForcesMT::GetEndElement(int rank)
+int StVKInternalForcesMT::GetEndElement(int color, int rank)
 {
-  return endElement[rank];
+  return endElement[color * numThreads + rank];
 }
 
+// shared by all the tasks of one computation
 struct StVKInternalForcesMT_threadArg
 {
   StVKInternalForcesMT * stVKInternalForcesMT;
   double * vertexDisplacements;
-  double * targetBuffer;
-  int rank;
   int computationTarget; // 0 = force, 1 = energy
-  double * auxBuffer; // for energy computations
+  double * forces; // force: the global internal force vector; energy: the linear, quadratic and cubic force terms (3 vectors)
+  double * gravityForce; // subtracted from the forces; NULL if gravity is disabled
+  double * energy; // one entry per thread
+  int numVertices;
+  int color;
 };
 
-void * StVKInternalForcesMT_WorkerThread(void * arg)
+// the range of vertices processed by thread "rank" in the vector operations
+static inline void StVKInternalForcesMT_GetVertexRange(struct StVKInternalForcesMT_threadArg * threadArgp, int numThreads, int rank, int * startVertex, int * endVertex)
+{
+  *startVertex = (int)(((long long)threadArgp->numVertices * rank) / numThreads);
+  *endVertex = (int)(((long long)threadArgp->numVertices * (rank + 1)) / numThreads);
+}
+
+// initializes the force vector(s) to zero (or to minus gravity)
+void StVKInternalForcesMT_ResetThread(void * arg, int rank)
+{
+  struct StVKInternalForcesMT_threadArg * threadArgp = (struct StVKInternalForcesMT_threadArg*) arg;
+  int numThreads = threadArgp->stVKInternalForcesMT->GetNumThreads();
+  int startVertex, endVertex;
+  StVKInternalForcesMT_GetVertexRange(threadArgp, numThreads, rank, &startVertex, &endVertex);
+
+  int numVertices3 = 3 * threadArgp->numVertices;
+  int numVectors = (threadArgp->computationTarget == 0) ? 1 : 3;
+  for(int vec=0; vec<numVectors; vec++)
+  {
+    double * forces = &threadArgp->forces[vec * numVertices3];
+    if ((threadArgp->computationTarget == 0) && (threadArgp->gravityForce != NULL))
+    {
+      for(int j=3*startVertex; j<3*endVertex; j++)
+        forces[j] = -threadArgp->gravityForce[j];
+    }
+    else
+      memset(&forces[3*startVertex], 0, sizeof(double) * 3 * (endVertex - startVertex));
+  }
+}
+
+// adds the forces of the elements of one color
+void StVKInternalForcesMT_WorkerThread(void * arg, int rank)
 {
   struct StVKInternalForcesMT_threadArg * threadArgp = (struct StVKInternalForcesMT_threadArg*) arg;
   StVKInternalForcesMT * stVKInternalForcesMT = threadArgp->stVKInternalForcesMT;
   double * vertexDisplacements = threadArgp->vertexDisplacements;
-  double * targetBuffer = threadArgp->targetBuffer;
-  int rank = threadArgp->rank;
-  int startElement = stVKInternalForcesMT->GetStartElement(rank);
-  int endElement = stVKInternalForcesMT->GetEndElement(rank);
+  const int * elements = stVKInternalForcesMT->GetColoredElements();
+  int startElement = stVKInternalForcesMT->GetStartElement(threadArgp->color, rank);
+  int endElement = stVKInternalForcesMT->GetEndElement(threadArgp->color, rank);
+  if (startElement == endElement)
+    return;
 
   if (threadArgp->computationTarget == 0)
   {
-    stVKInternalForcesMT->AddLinearTermsContribution(vertexDisplacements, targetBuffer, startElement, endElement);
-    stVKInternalForcesMT->AddQuadraticTermsContribution(vertexDisplacements, targetBuffer, startElement, endElement);
-    stVKInternalForcesMT->AddCubicTermsContribution(vertexDisplacements, targetBuffer, startElement, endElement);
+    double * forces = threadArgp->forces;
+    stVKInternalForcesMT->AddLinearTermsContribution(vertexDisplacements, forces, elements, startElement, endElement);
+    stVKInternalForcesMT->AddQuadraticTermsContribution(vertexDisplacements, forces, elements, startElement, endElement);
+    stVKInternalForcesMT->AddCubicTermsContribution(vertexDisplacements, forces, elements, startElement, endElement);
   }
 
   if (threadArgp->computationTarget == 1)
   {
-    *targetBuffer = stVKInternalForcesMT->ComputeEnergyContribution(vertexDisplacements, startElement, endElement, threadArgp->auxBuffer);
+    // the three terms are kept apart, as they are weighted differently in the energy
+    int numVertices3 = 3 * threadArgp->numVertices;
+    stVKInternalForcesMT->AddLinearTermsContribution(vertexDisplacements, &threadArgp->forces[0], elements, startElement, endElement);
+    stVKInternalForcesMT->AddQuadraticTermsContribution(vertexDisplacements, &threadArgp->forces[numVertices3], elements, startElement, endElement);
+    stVKInternalForcesMT->AddCubicTermsContribution(vertexDisplacements, &threadArgp->forces[2 * numVertices3], elements, startElement, endElement);
   }
+}
 
-  return NULL;
+// energy = u^T (1/2 f_linear + 1/3 f_quadratic + 1/4 f_cubic), over a range of vertices
+void StVKInternalForcesMT_EnergyThread(void * arg, int rank)
+{
+  struct StVKInternalForcesMT_threadArg * threadArgp = (struct StVKInternalForcesMT_threadArg*) arg;
+  int numThreads = threadArgp->stVKInternalForcesMT->GetNumThreads();
+  int startVertex, endVertex;
+  StVKInternalForcesMT_GetVertexRange(threadArgp, numThreads, rank, &startVertex, &endVertex);
+
+  int numVertices3 = 3 * threadArgp->numVertices;
+  double * u = threadArgp->vertexDisplacements;
+  double * linear = &threadArgp->forces[0];
+  double * quadratic = &threadArgp->forces[numVertices3];
+  double * cubic = &threadArgp->forces[2 * numVertices3];
+
+  double oneThird = 1.0 / 3;
+  double oneQuarter = 1.0 / 4;
+  double energy = 0.0;
+  for(int j=3*startVertex; j<3*endVertex; j++)
+    energy += (0.5 * linear[j] + oneThird * quadratic[j] + oneQuarter * cubic[j]) * u[j];
+
+  threadArgp->energy[rank] = energy;
 }
 
 void StVKInternalForcesMT::ComputeForces(double * vertexDisplacements, double * internalForces)
@@ -136,78 +179,32 @@ double StVKInternalForcesMT::ComputeEnergy(double * vertexDisplacements)
 
 void StVKInternalForcesMT::Compute(int computationTarget, double * vertexDisplacements, double * target)
 {
-  int numVertices3 = 3 * volumetricMesh->getNumVertices();
-  struct StVKInternalForcesMT_threadArg * threadArgv = (struct StVKInternalForcesMT_threadArg*) malloc (sizeof(struct StVKInternalForcesMT_threadArg) * numThreads);
-
-  pthread_t * tid = (pthread_t*) malloc (sizeof(pthread_t) * numThreads);
-
-  for(int i=0; i<numThreads; i++)
-  {
-    threadArgv[i].stVKInternalForcesMT = this;
-    threadArgv[i].vertexDisplacements = vertexDisplacements;
-    if (computationTarget == 0)
-      threadArgv[i].targetBuffer = &internalForceBuffer[i * numVertices3];
-    if (computationTarget == 1)
-    {
-      threadArgv[i].targetBuffer = &energyBuffer[i];
-      threadArgv[i].auxBuffer = &energyAuxBuffer[i * numVertices3];
-    }
-    threadArgv[i].rank = i;
-    threadArgv[i].computationTarget = computationTarget;
-  }
-    
-  if (computationTarget == 0)
-    memset(internalForceBuffer, 0, sizeof(double) * numVertices3 * numThreads);
-  if (computationTarget == 1)
-    memset(energyBuffer, 0, sizeof(double) * numThreads);
-
-  for(int i=0; i<numThreads; i++)
-  {
-    if (pthread_create(&tid[i], NULL, StVKInternalForcesMT_WorkerThread, &threadArgv[i]) != 0)
-    {
-      printf("Error: unable to launch thread %d.\n", i);
-      exit(1);
-    }
-  }
-
-  for(int i=0; i<numThreads; i++)
-  {
-    if (pthread_join(tid[i], NULL) != 0)
-    {
-      printf("Error: unable to join thread %d.\n", i);
-      exit(1);
-    } 
-  }
-
-  free(threadArgv);
-  free(tid);
-
-  // assemble
-  if (computationTarget == 0)
+  struct StVKInternalForcesMT_threadArg threadArg;
+  threadArg.stVKInternalForcesMT = this;
+  threadArg.vertexDisplacements = vertexDisplacements;
+  threadArg.computationTarget = computationTarget;
+  threadArg.forces = (computationTarget == 0) ? target : energyAuxBuffer;
+  threadArg.gravityForce = addGravity ? gravityForce : NULL;
+  threadArg.energy = energyBuffer;
+  threadArg.numVertices = volumetricMesh->getNumVertices();
+  threadArg.color = 0;
+
+  // run the tasks on the persistent thread pool
+  ThreadPool * threadPool = ThreadPool::GetGlobalThreadPool();
+  threadPool->Execute(numThreads, StVKInternalForcesMT_ResetThread, &threadArg);
+
+  // assemble directly into the global vector(s), one color at a time
+  for(int color=0; color<numColors; color++)
   {
-    memset(target, 0, sizeof(double) * numVertices3);
-    for(int i=0; i<numThreads; i++)
-    {
-      double * source = &internalForceBuffer[i * numVertices3];
-      for(int j=0; j<numVertices3; j++)
-        target[j] += source[j];
-    }
-
-    if (addGravity)
-    {
-      int n = volumetricMesh->getNumVertices();
-      for(int i=0; i<3*n; i++)
-      {
-        target[i] -= gravityForce[i];
-      }
-    }
+    threadArg.color = color;
+    threadPool->Execute(numThreads, StVKInternalForcesMT_WorkerThread, &threadArg);
   }
 
   if (computationTarget == 1)
   {
+    threadPool->Execute(numThreads, StVKInternalForcesMT_EnergyThread, &threadArg);
     *target = 0;
     for(int i=0; i<numThreads; i++)
       *target += energyBuffer[i];
   }
 }
-
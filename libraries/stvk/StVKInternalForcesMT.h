@@ -33,9 +33,12 @@
 
 /*
   This class is a multi-threaded version of the class "StVKInternalForces".
-  It uses POSIX threads ("pthreads") as the threading API.
-  Each thread assembles the internal force with respect to a subset of all the mesh elements. 
-  At the end, the individual results are added into a global internal force vector.
+  It uses POSIX threads ("pthreads") as the threading API, via the process-wide thread pool (see threadPool.h).
+  The mesh elements are partitioned into colors, such that no two elements of the same color share
+  a vertex (see generateElementColoring.h). The colors are processed one after another; within each color,
+  each thread adds the internal forces of a subset of the color's elements directly into the global
+  internal force vector. No per-thread force buffers (and no serial reduction) are needed;
+  the remaining vector operations (initialization, energy dot products) are split among the threads by vertex ranges.
 
   See also StVKInternalForces.h .
 */
@@ -51,16 +54,24 @@ public:
   virtual void ComputeForces(double * vertexDisplacements, double * internalForces);
   virtual double ComputeEnergy(double * vertexDisplacements); 
 
-  // advanced function (tells what range of volumetric mesh elements is assigned to each thread)
-  int GetStartElement(int rank);
-  int GetEndElement(int rank);
+  inline int GetNumThreads() { return numThreads; }
+
+  // advanced functions (tell what volumetric mesh elements are assigned to each thread):
+  // the elements processed by thread "rank" during color "color" are
+  // GetColoredElements()[GetStartElement(color, rank)], ..., GetColoredElements()[GetEndElement(color, rank)-1]
+  inline int GetNumColors() { return numColors; }
+  inline const int * GetColoredElements() { return coloredElements; } // all elements, sorted by color
+  int GetStartElement(int color, int rank);
+  int GetEndElement(int color, int rank);
 
 protected:
   int numThreads;
-  int * startElement, * endElement;
-  double * internalForceBuffer;
-  double * energyBuffer;
-  double * energyAuxBuffer;
+  int numColors;
+  int * colorStarts;
+  int * coloredElements;
+  int * startElement, * endElement; // numColors x numThreads
+  double * energyBuffer; // one entry per thread
+  double * energyAuxBuffer; // linear, quadratic and cubic force terms (3 x 3 * numVertices), for energy computations
 
   void Compute(int computationTarget, double * vertexDisplacements, double * internalForces);
 };
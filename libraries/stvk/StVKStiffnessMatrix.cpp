@@ -27,9 +27,10 @@
  *************************************************************************/
 
 #include "StVKStiffnessMatrix.h"
+#include "StVKElementABCDDispatch.h"
 #include "volumetricMeshENuMaterial.h"
 
-StVKStiffnessMatrix::StVKStiffnessMatrix(StVKInternalForces *  stVKInternalForces)
+StVKStiffnessMatrix::StVKStiffnessMatrix(StVKInternalForces *  stVKInternalForces_): stVKInternalForces(stVKInternalForces_)
 {
   precomputedIntegrals = stVKInternalForces->GetPrecomputedIntegrals();
   volumetricMesh = stVKInternalForces->GetVolumetricMesh();
@@ -146,94 +147,172 @@ void StVKStiffnessMatrix::ComputeStiffnessMatrix(double * vertexDisplacements, S
   //printf("Stiffness matrix: %G\n", stiffnessCounter.GetElapsedTime());
 }
 
+void StVKStiffnessMatrix::ComputeStiffnessMatrix(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix)
+{
+  blockMatrix->ResetToZero();
+
+  AddLinearTermsContribution(vertexDisplacements, blockMatrix);
+  AddQuadraticTermsContribution(vertexDisplacements, blockMatrix);
+  AddCubicTermsContribution(vertexDisplacements, blockMatrix);
+}
+
+void StVKStiffnessMatrix::ComputeForceAndStiffnessMatrix(double * vertexDisplacements, double * internalForces, SparseMatrix * sparseMatrix)
+{
+  stVKInternalForces->ComputeForces(vertexDisplacements, internalForces);
+  ComputeStiffnessMatrix(vertexDisplacements, sparseMatrix);
+}
+
 void StVKStiffnessMatrix::AddLinearTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, int elementLow, int elementHigh)
+{
+  AddLinearTerms(vertexDisplacements, sparseMatrix, NULL, NULL, elementLow, elementHigh);
+}
+
+void StVKStiffnessMatrix::AddLinearTermsContribution(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix, int elementLow, int elementHigh)
+{
+  AddLinearTerms(vertexDisplacements, NULL, blockMatrix, NULL, elementLow, elementHigh);
+}
+
+void StVKStiffnessMatrix::AddLinearTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, const int * elementList, int elementLow, int elementHigh)
+{
+  AddLinearTerms(vertexDisplacements, sparseMatrix, NULL, elementList, elementLow, elementHigh);
+}
+
+void StVKStiffnessMatrix::AddQuadraticTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, int elementLow, int elementHigh)
+{
+  AddQuadraticTerms(vertexDisplacements, sparseMatrix, NULL, NULL, elementLow, elementHigh);
+}
+
+void StVKStiffnessMatrix::AddQuadraticTermsContribution(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix, int elementLow, int elementHigh)
+{
+  AddQuadraticTerms(vertexDisplacements, NULL, blockMatrix, NULL, elementLow, elementHigh);
+}
+
+void StVKStiffnessMatrix::AddQuadraticTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, const int * elementList, int elementLow, int elementHigh)
+{
+  AddQuadraticTerms(vertexDisplacements, sparseMatrix, NULL, elementList, elementLow, elementHigh);
+}
+
+void StVKStiffnessMatrix::AddCubicTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, int elementLow, int elementHigh)
+{
+  AddCubicTerms(vertexDisplacements, sparseMatrix, NULL, NULL, elementLow, elementHigh);
+}
+
+void StVKStiffnessMatrix::AddCubicTermsContribution(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix, int elementLow, int elementHigh)
+{
+  AddCubicTerms(vertexDisplacements, NULL, blockMatrix, NULL, elementLow, elementHigh);
+}
+
+void StVKStiffnessMatrix::AddCubicTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, const int * elementList, int elementLow, int elementHigh)
+{
+  AddCubicTerms(vertexDisplacements, sparseMatrix, NULL, elementList, elementLow, elementHigh);
+}
+
+template<class ABCD, int N>
+void StVKStiffnessMatrix::AddLinearTermsKernel(ABCD * abcd, double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh)
 {
   if (elementLow < 0)
     elementLow = 0;
   if (elementHigh < 0)
     elementHigh = volumetricMesh->getNumElements();
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
-
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
-  for(int el=elementLow; el < elementHigh; el++)
+  for(int i=elementLow; i < elementHigh; i++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
-    for(int ver=0; ver<numElementVertices; ver++)
-      vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
+    int el = (elementList != NULL) ? elementList[i] : i;
+    abcd->ABCD::PrepareElement(el, elIter);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel, computing row of vertex c
+    for (int c=0; c<N; c++) // over all vertices of the voxel, computing row of vertex c
     {
       // linear terms
-      for (int a=0; a<numElementVertices; a++) // over all vertices
+      for (int a=0; a<N; a++) // over all vertices
       {
         Mat3d matrix(1.0);
-        matrix *= mu * precomputedIntegrals->B(elIter,a,c);
-        matrix += lambda * precomputedIntegrals->A(elIter,c,a) +
-                  mu * precomputedIntegrals->A(elIter,a,c);
-
-        AddMatrix3x3Block(c, a, el, matrix, sparseMatrix);
+        matrix *= mu * abcd->ABCD::B(elIter,a,c);
+        matrix += lambda * abcd->ABCD::A(elIter,c,a) +
+                  mu * abcd->ABCD::A(elIter,a,c);
+
+        if (blockMatrix != NULL)
+          AddMatrix3x3Block(c, a, el, matrix, blockMatrix);
+        else
+          AddMatrix3x3Block(c, a, el, matrix, sparseMatrix);
       }
     }
   }
 
-  free(vertices);
+  abcd->ABCD::ReleaseElementIterator(elIter);
+}
 
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+void StVKStiffnessMatrix::AddLinearTerms(double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh)
+{
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, AddLinearTermsKernel, vertexDisplacements, sparseMatrix, blockMatrix, elementList, elementLow, elementHigh);
 }
 
+// in block storage, column[c8+(where)] is the position of the block within block row row[c]
 #define ADD_MATRIX_BLOCK(where)\
-  for(k=0; k<3; k++)\
-    for(l=0; l<3; l++)\
-    {\
-      dataHandle[rowc+k][3*column[c8+(where)]+l] += matrix[3*k+l];\
-    }
+  if (blockEntries != NULL)\
+  {\
+    double * block = &blockEntries[9 * (blockRowPointers[row[c]] + column[c8+(where)])];\
+    for(k=0; k<9; k++)\
+      block[k] += matrix[k];\
+  }\
+  else\
+  {\
+    for(k=0; k<3; k++)\
+      for(l=0; l<3; l++)\
+      {\
+        dataHandle[rowc+k][3*column[c8+(where)]+l] += matrix[3*k+l];\
+      }\
+  }
 
-void StVKStiffnessMatrix::AddQuadraticTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, int elementLow, int elementHigh)
+template<class ABCD, int N>
+void StVKStiffnessMatrix::AddQuadraticTermsKernel(ABCD * abcd, double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh)
 {
   if (elementLow < 0)
     elementLow = 0;
   if (elementHigh < 0)
     elementHigh = volumetricMesh->getNumElements();
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
+  int vertices[N];
 
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
-  double ** dataHandle = sparseMatrix->GetDataHandle();
+  double ** dataHandle = (sparseMatrix != NULL) ? sparseMatrix->GetDataHandle() : NULL;
+  double * blockEntries = (blockMatrix != NULL) ? blockMatrix->GetEntries() : NULL;
+  int * blockRowPointers = (blockMatrix != NULL) ? blockMatrix->GetBlockRowPointers() : NULL;
 
-  for(int el=elementLow; el < elementHigh; el++)
+  for(int i=elementLow; i < elementHigh; i++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
+    int el = (elementList != NULL) ? elementList[i] : i;
+    abcd->ABCD::PrepareElement(el, elIter);
     int * row = row_[el];
     int * column = column_[el];
 
-    for(int ver=0; ver<numElementVertices; ver++)
+    for(int ver=0; ver<N; ver++)
       vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel, computing row of vertex c
+    for (int c=0; c<N; c++) // over all vertices of the voxel, computing row of vertex c
     {
       int rowc = 3*row[c];
-      int c8 = numElementVertices*c;
+      int c8 = N*c;
       // quadratic terms
-      for (int e=0; e<numElementVertices; e++) // compute contribution to block (c,e) of the stiffness matrix
+      for (int e=0; e<N; e++) // compute contribution to block (c,e) of the stiffness matrix
       {
         double matrix[9];
         memset(matrix, 0, sizeof(double) * 9);
-        for(int a=0; a<numElementVertices; a++)
+        for(int a=0; a<N; a++)
         {
           double qa[3] = { vertexDisplacements[3*vertices[a]+0], vertexDisplacements[3*vertices[a]+1], vertexDisplacements[3*vertices[a]+2] };
 
-          Vec3d C0v = lambda * precomputedIntegrals->C(elIter,c,a,e) + mu * (precomputedIntegrals->C(elIter,e,a,c) + precomputedIntegrals->C(elIter,a,e,c));
+          Vec3d C0v = lambda * abcd->ABCD::C(elIter,c,a,e) + mu * (abcd->ABCD::C(elIter,e,a,c) + abcd->ABCD::C(elIter,a,e,c));
           double C0[3] = {C0v[0], C0v[1], C0v[2]};
 
           // C0 tensor qa
@@ -241,7 +320,7 @@ void StVKStiffnessMatrix::AddQuadraticTermsContribution(double * vertexDisplacem
           matrix[3] += C0[1] * qa[0]; matrix[4] += C0[1] * qa[1]; matrix[5] += C0[1] * qa[2];
           matrix[6] += C0[2] * qa[0]; matrix[7] += C0[2] * qa[1]; matrix[8] += C0[2] * qa[2];
 
-          Vec3d C1v = lambda * precomputedIntegrals->C(elIter,e,a,c) + mu * (precomputedIntegrals->C(elIter,c,e,a) + precomputedIntegrals->C(elIter,a,e,c));
+          Vec3d C1v = lambda * abcd->ABCD::C(elIter,e,a,c) + mu * (abcd->ABCD::C(elIter,c,e,a) + abcd->ABCD::C(elIter,a,e,c));
           double C1[3] = {C1v[0], C1v[1], C1v[2]};
 
           // qa tensor C1
@@ -249,7 +328,7 @@ void StVKStiffnessMatrix::AddQuadraticTermsContribution(double * vertexDisplacem
           matrix[3] += qa[1] * C1[0]; matrix[4] += qa[1] * C1[1]; matrix[5] += qa[1] * C1[2];
           matrix[6] += qa[2] * C1[0]; matrix[7] += qa[2] * C1[1]; matrix[8] += qa[2] * C1[2];
 
-          Vec3d C2v = lambda * precomputedIntegrals->C(elIter,a,e,c) + mu * (precomputedIntegrals->C(elIter,c,a,e) + precomputedIntegrals->C(elIter,e,a,c));
+          Vec3d C2v = lambda * abcd->ABCD::C(elIter,a,e,c) + mu * (abcd->ABCD::C(elIter,c,a,e) + abcd->ABCD::C(elIter,e,a,c));
           double C2[3] = {C2v[0], C2v[1], C2v[2]};
 
           // qa dot C2
@@ -265,65 +344,72 @@ void StVKStiffnessMatrix::AddQuadraticTermsContribution(double * vertexDisplacem
     }
   }
 
-  free(vertices);
+  abcd->ABCD::ReleaseElementIterator(elIter);
+}
 
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+void StVKStiffnessMatrix::AddQuadraticTerms(double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh)
+{
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, AddQuadraticTermsKernel, vertexDisplacements, sparseMatrix, blockMatrix, elementList, elementLow, elementHigh);
 }
 
-void StVKStiffnessMatrix::AddCubicTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, int elementLow, int elementHigh)
+template<class ABCD, int N>
+void StVKStiffnessMatrix::AddCubicTermsKernel(ABCD * abcd, double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh)
 {
   if (elementLow < 0)
     elementLow = 0;
   if (elementHigh < 0)
     elementHigh = volumetricMesh->getNumElements();
 
-  int * vertices = (int*) malloc (sizeof(int) * numElementVertices);
+  int vertices[N];
 
   void * elIter;
-  precomputedIntegrals->AllocateElementIterator(&elIter);
+  abcd->ABCD::AllocateElementIterator(&elIter);
 
-  double ** dataHandle = sparseMatrix->GetDataHandle();
+  double ** dataHandle = (sparseMatrix != NULL) ? sparseMatrix->GetDataHandle() : NULL;
+  double * blockEntries = (blockMatrix != NULL) ? blockMatrix->GetEntries() : NULL;
+  int * blockRowPointers = (blockMatrix != NULL) ? blockMatrix->GetBlockRowPointers() : NULL;
 
-  for(int el=elementLow; el < elementHigh; el++)
+  for(int i=elementLow; i < elementHigh; i++)
   {
-    precomputedIntegrals->PrepareElement(el, elIter);
+    int el = (elementList != NULL) ? elementList[i] : i;
+    abcd->ABCD::PrepareElement(el, elIter);
     int * row = row_[el];
     int * column = column_[el];
 
-    for(int ver=0; ver<numElementVertices; ver++)
+    for(int ver=0; ver<N; ver++)
       vertices[ver] = volumetricMesh->getVertexIndex(el, ver);
 
     double lambda = lambdaLame[el]; 
     double mu = muLame[el];
 
-    for (int c=0; c<numElementVertices; c++) // over all vertices of the voxel, computing derivative on force on vertex c
+    for (int c=0; c<N; c++) // over all vertices of the voxel, computing derivative on force on vertex c
     {
       int rowc = 3*row[c];
-      int c8 = numElementVertices*c;
+      int c8 = N*c;
       // cubic terms
-      for (int e=0; e<numElementVertices; e++) // compute contribution to block (c,e) of the stiffness matrix
+      for (int e=0; e<N; e++) // compute contribution to block (c,e) of the stiffness matrix
       {
         double matrix[9];
         memset(matrix, 0, sizeof(double) * 9);
-        for(int a=0; a<numElementVertices; a++)
+        for(int a=0; a<N; a++)
         {
           int va = vertices[a];
           double * qa = &(vertexDisplacements[3*va]);
-          for(int b=0; b<numElementVertices; b++)
+          for(int b=0; b<N; b++)
           {
             int vb = vertices[b];
 
             double * qb = &(vertexDisplacements[3*vb]);
 
-            double D0 = lambda * precomputedIntegrals->D(elIter,a,c,b,e) +
-                        mu * ( precomputedIntegrals->D(elIter,a,e,b,c) + precomputedIntegrals->D(elIter,a,b,c,e) );
+            double D0 = lambda * abcd->ABCD::D(elIter,a,c,b,e) +
+                        mu * ( abcd->ABCD::D(elIter,a,e,b,c) + abcd->ABCD::D(elIter,a,b,c,e) );
 
             matrix[0] += D0 * qa[0] * qb[0]; matrix[1] += D0 * qa[0] * qb[1]; matrix[2] += D0 * qa[0] * qb[2];
             matrix[3] += D0 * qa[1] * qb[0]; matrix[4] += D0 * qa[1] * qb[1]; matrix[5] += D0 * qa[1] * qb[2];
             matrix[6] += D0 * qa[2] * qb[0]; matrix[7] += D0 * qa[2] * qb[1]; matrix[8] += D0 * qa[2] * qb[2];
 
-            double D1 = 0.5 * lambda * precomputedIntegrals->D(elIter,a,b,c,e) +
-                        mu * precomputedIntegrals->D(elIter,a,c,b,e);
+            double D1 = 0.5 * lambda * abcd->ABCD::D(elIter,a,b,c,e) +
+                        mu * abcd->ABCD::D(elIter,a,c,b,e);
 
             double dotpD = D1 * (qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2]);
 
@@ -338,8 +424,11 @@ void StVKStiffnessMatrix::AddCubicTermsContribution(double * vertexDisplacements
     }
   }
 
-  free(vertices);
+  abcd->ABCD::ReleaseElementIterator(elIter);
+}
 
-  precomputedIntegrals->ReleaseElementIterator(elIter);
+void StVKStiffnessMatrix::AddCubicTerms(double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh)
+{
+  STVK_ELEMENT_ABCD_DISPATCH(precomputedIntegrals, numElementVertices, AddCubicTermsKernel, vertexDisplacements, sparseMatrix, blockMatrix, elementList, elementLow, elementHigh);
 }
 
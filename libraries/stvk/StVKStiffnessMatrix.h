@@ -30,6 +30,7 @@
   Computes the tangent stiffness matrix of a StVK elastic deformable object.
   The tangent stiffness matrix depends on the deformable configuration.
   As a special case, the routine can compute the stiffness matrix in the rest configuration.
+  The matrix can be computed into a SparseMatrix, or into a SparseMatrixBlock3 (3x3 block storage).
   See also StVKInternalForces.h .
 */
 
@@ -37,6 +38,7 @@
 #define _STVKSTIFFNESSMATRIX_H_
 
 #include "sparseMatrix.h"
+#include "sparseMatrixBlock3.h"
 #include "StVKInternalForces.h"
 
 class StVKStiffnessMatrix
@@ -54,11 +56,19 @@ public:
   // evaluates the tangent stiffness matrix in the given deformation configuration
   // "vertexDisplacements" is an array of vertex deformations, of length 3*n, where n is the total number of mesh vertices
   virtual void ComputeStiffnessMatrix(double * vertexDisplacements, SparseMatrix * sparseMatrix);
+  // same as above, except that the element 3x3 blocks are written directly into the block matrix
+  // the block matrix must have been created from the matrix returned by GetStiffnessMatrixTopology
+  virtual void ComputeStiffnessMatrix(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix);
+
+  // computes both the internal forces (as in StVKInternalForces::ComputeForces) and the tangent stiffness matrix
+  // the default implementation calls ComputeForces and ComputeStiffnessMatrix; derived classes can do both in one pass (see StVKTetStiffnessMatrix.h)
+  virtual void ComputeForceAndStiffnessMatrix(double * vertexDisplacements, double * internalForces, SparseMatrix * sparseMatrix);
 
   inline void ResetStiffnessMatrix(SparseMatrix * sparseMatrix) {sparseMatrix->ResetToZero();}
 
   inline VolumetricMesh * GetVolumetricMesh() { return volumetricMesh; }
   inline StVKElementABCD * GetPrecomputedIntegrals() { return precomputedIntegrals; }
+  inline StVKInternalForces * GetInternalForces() { return stVKInternalForces; }
 
   // === the routines below are meant for advanced usage ===
 
@@ -66,6 +76,13 @@ public:
   void AddLinearTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, int elementLow=-1, int elementHigh=-1);
   void AddQuadraticTermsContribution(double * vertexDisplacements,SparseMatrix * sparseMatrix, int elementLow=-1, int elementHigh=-1);
   void AddCubicTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, int elementLow=-1, int elementHigh=-1);
+  void AddLinearTermsContribution(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix, int elementLow=-1, int elementHigh=-1);
+  void AddQuadraticTermsContribution(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix, int elementLow=-1, int elementHigh=-1);
+  void AddCubicTermsContribution(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix, int elementLow=-1, int elementHigh=-1);
+  // same as above, except that they traverse the elements elementList[elementLow], ..., elementList[elementHigh-1]
+  void AddLinearTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, const int * elementList, int elementLow, int elementHigh);
+  void AddQuadraticTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, const int * elementList, int elementLow, int elementHigh);
+  void AddCubicTermsContribution(double * vertexDisplacements, SparseMatrix * sparseMatrix, const int * elementList, int elementLow, int elementHigh);
 
   void GetMatrixAccelerationIndices(int *** row__, int *** column__) { *row__ = row_; *column__ = column_;}
 
@@ -88,6 +105,18 @@ protected:
   // c is 0..7
   // a is 0..7
   inline void AddMatrix3x3Block(int c, int a, int element, Mat3d & matrix, SparseMatrix * sparseMatrix);
+  inline void AddMatrix3x3Block(int c, int a, int element, Mat3d & matrix, SparseMatrixBlock3 * blockMatrix);
+
+  // the workers for the Add*TermsContribution routines; exactly one of sparseMatrix, blockMatrix is non-NULL
+  // if elementList is NULL, elements elementLow <= el < elementHigh are traversed, otherwise elements elementList[elementLow], ..., elementList[elementHigh-1]
+  void AddLinearTerms(double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh);
+  void AddQuadraticTerms(double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh);
+  void AddCubicTerms(double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh);
+
+  // the element loops of the above workers, specialized to the ABCD class and the number of element vertices N (see StVKElementABCDDispatch.h)
+  template<class ABCD, int N> void AddLinearTermsKernel(ABCD * abcd, double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh);
+  template<class ABCD, int N> void AddQuadraticTermsKernel(ABCD * abcd, double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh);
+  template<class ABCD, int N> void AddCubicTermsKernel(ABCD * abcd, double * vertexDisplacements, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, const int * elementList, int elementLow, int elementHigh);
 };
 
 inline void StVKStiffnessMatrix::AddMatrix3x3Block(int c, int a, int element, Mat3d & matrix, SparseMatrix * sparseMatrix)
@@ -100,5 +129,15 @@ inline void StVKStiffnessMatrix::AddMatrix3x3Block(int c, int a, int element, Ma
       sparseMatrix->AddEntry(3*row[c]+k, 3*column[numElementVertices*c+a]+l, matrix[k][l]);
 }
 
+inline void StVKStiffnessMatrix::AddMatrix3x3Block(int c, int a, int element, Mat3d & matrix, SparseMatrixBlock3 * blockMatrix)
+{
+  // the acceleration column index is the position of the block within the block row
+  double * block = blockMatrix->GetBlock(row_[element][c], column_[element][numElementVertices*c+a]);
+
+  for(int k=0; k<3; k++)
+    for(int l=0; l<3; l++)
+      block[3*k+l] += matrix[k][l];
+}
+
 #endif
 
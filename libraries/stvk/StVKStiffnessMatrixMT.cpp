@@ -26,138 +26,82 @@
  *                                                                       *
  *************************************************************************/
 
-#include <pthread.h>
 #include "StVKStiffnessMatrixMT.h"
+#include "generateElementColoring.h"
+#include "threadPool.h"
 
 StVKStiffnessMatrixMT::StVKStiffnessMatrixMT(StVKInternalForces *  stVKInternalForces, int numThreads_): StVKStiffnessMatrix(stVKInternalForces), numThreads(numThreads_) 
 {
-  SparseMatrix * stiffnessMatrixSkeleton;
-  GetStiffnessMatrixTopology(&stiffnessMatrixSkeleton);
+  // color the elements; elements of the same color do not share any vertices
+  numColors = GenerateElementColoring::Generate(volumetricMesh, &colorStarts, &coloredElements);
 
-  // generate skeleton matrices
-  sparseMatrixBuffer = (SparseMatrix**) malloc (sizeof(SparseMatrix*) * numThreads);
-  for(int i=0; i<numThreads; i++)
-    sparseMatrixBuffer[i] = new SparseMatrix(*stiffnessMatrixSkeleton);
+  // split the workload of each color
+  GenerateElementColoring::PartitionColors(numColors, colorStarts, numThreads, &startElement, &endElement);
 
-  // split the workload
-  int numElements = volumetricMesh->getNumElements();
-  startElement = (int*) malloc (sizeof(int) * numThreads);
-  endElement = (int*) malloc (sizeof(int) * numThreads);
-
-  int remainder = numElements % numThreads;
-  // the first 'remainder' nodes will process one elements more
-  int jobSize = numElements / numThreads;
-
-  for(int rank=0; rank < numThreads; rank++)
-  {
-    if (rank < remainder)
-    {
-      startElement[rank] = rank * (jobSize+1);
-      endElement[rank] = (rank+1) * (jobSize+1);
-    }
-    else
-    {
-      startElement[rank] = remainder * (jobSize+1) + (rank-remainder) * jobSize;
-      endElement[rank] = remainder * (jobSize+1) + ((rank-remainder)+1) * jobSize;
-    }
-  }
-
-  delete(stiffnessMatrixSkeleton);
-
-  printf("Total elements: %d \n",numElements);
-  printf("Num threads: %d \n",numThreads);
-  printf("Canonical job size: %d \n",jobSize);
-  printf("Num threads with job size augmented by one elements: %d \n",remainder);
+  printf("Total elements: %d \n", volumetricMesh->getNumElements());
+  printf("Num threads: %d \n", numThreads);
 }
 
 StVKStiffnessMatrixMT::~StVKStiffnessMatrixMT() 
 {
   free(startElement);
   free(endElement);
-  for(int i=0; i<numThreads; i++)
-    delete(sparseMatrixBuffer[i]);
-  free(sparseMatrixBuffer);
+  free(colorStarts);
+  free(coloredElements);
 }
 
-int StVKStiffnessMatrixMT::GetStartElement(int rank)
+int StVKStiffnessMatrixMT::GetStartElement(int color, int rank)
 {
-  return startElement[rank];
+  return startElement[color * numThreads + rank];
 }
 
-int StVKStiffnessMatrixMT::GetEndElement(int rank)
+int StVKStiffnessMatrixMT::GetEndElement(int color, int rank)
 {
-  return endElement[rank];
+  return endElement[color * numThreads + rank];
 }
 
+// shared by all the tasks of one color
 struct StVKStiffnessMatrixMT_threadArg
 {
   StVKStiffnessMatrixMT * stVKStiffnessMatrixMT;
   double * vertexDisplacements;
-  SparseMatrix * targetBuffer;
-  int rank;
+  SparseMatrix * sparseMatrix; // the global matrix; all threads write into it
+  int color;
 };
 
-void * StVKStiffnessMatrixMT_WorkerThread(void * arg)
+void StVKStiffnessMatrixMT_WorkerThread(void * arg, int rank)
 {
   struct StVKStiffnessMatrixMT_threadArg * threadArgp = (struct StVKStiffnessMatrixMT_threadArg*) arg;
   StVKStiffnessMatrixMT * stVKStiffnessMatrixMT = threadArgp->stVKStiffnessMatrixMT;
   double * vertexDisplacements = threadArgp->vertexDisplacements;
-  SparseMatrix * targetBuffer = threadArgp->targetBuffer;
-  int rank = threadArgp->rank;
-  int startElement = stVKStiffnessMatrixMT->GetStartElement(rank);
-  int endElement = stVKStiffnessMatrixMT->GetEndElement(rank);
-
-  stVKStiffnessMatrixMT->AddLinearTermsContribution(vertexDisplacements, targetBuffer, startElement, endElement);
-  stVKStiffnessMatrixMT->AddQuadraticTermsContribution(vertexDisplacements, targetBuffer, startElement, endElement);
-  stVKStiffnessMatrixMT->AddCubicTermsContribution(vertexDisplacements, targetBuffer, startElement, endElement);
-
-  return NULL;
+  SparseMatrix * sparseMatrix = threadArgp->sparseMatrix;
+  const int * elements = stVKStiffnessMatrixMT->GetColoredElements();
+  int startElement = stVKStiffnessMatrixMT->GetStartElement(threadArgp->color, rank);
+  int endElement = stVKStiffnessMatrixMT->GetEndElement(threadArgp->color, rank);
+  if (startElement == endElement)
+    return;
+
+  stVKStiffnessMatrixMT->AddLinearTermsContribution(vertexDisplacements, sparseMatrix, elements, startElement, endElement);
+  stVKStiffnessMatrixMT->AddQuadraticTermsContribution(vertexDisplacements, sparseMatrix, elements, startElement, endElement);
+  stVKStiffnessMatrixMT->AddCubicTermsContribution(vertexDisplacements, sparseMatrix, elements, startElement, endElement);
 }
 
 void StVKStiffnessMatrixMT::ComputeStiffnessMatrix(double * vertexDisplacements, SparseMatrix * sparseMatrix)
 {
   //PerformanceCounter stiffnessCounter;
-  // launch the threads
-  struct StVKStiffnessMatrixMT_threadArg * threadArgv = (struct StVKStiffnessMatrixMT_threadArg*) malloc (sizeof(struct StVKStiffnessMatrixMT_threadArg) * numThreads);
-
-  pthread_t * tid = (pthread_t*) malloc (sizeof(pthread_t) * numThreads);
-
-  for(int i=0; i<numThreads; i++)
-  {
-    threadArgv[i].stVKStiffnessMatrixMT = this;
-    threadArgv[i].vertexDisplacements = vertexDisplacements;
-    threadArgv[i].targetBuffer = sparseMatrixBuffer[i];
-    threadArgv[i].rank = i;
-    sparseMatrixBuffer[i]->ResetToZero();
-  }
-
-  for(int i=0; i<numThreads; i++)
-  {
-    if (pthread_create(&tid[i], NULL, StVKStiffnessMatrixMT_WorkerThread, &threadArgv[i]) != 0)
-    {
-      printf("Error: unable to launch thread %d.\n", i);
-      exit(1);
-    }
-  }
+  // run the tasks on the persistent thread pool, one color at a time
+  struct StVKStiffnessMatrixMT_threadArg threadArg;
+  threadArg.stVKStiffnessMatrixMT = this;
+  threadArg.vertexDisplacements = vertexDisplacements;
+  threadArg.sparseMatrix = sparseMatrix;
 
-  for(int i=0; i<numThreads; i++)
+  sparseMatrix->ResetToZero();
+  for(int color=0; color<numColors; color++)
   {
-    if (pthread_join(tid[i], NULL) != 0)
-    {
-      printf("Error: unable to join thread %d.\n", i);
-      exit(1);
-    }
+    threadArg.color = color;
+    ThreadPool::GetGlobalThreadPool()->Execute(numThreads, StVKStiffnessMatrixMT_WorkerThread, &threadArg);
   }
 
-  free(threadArgv);
-  free(tid);
-
-  // assemble results
-  sparseMatrix->ResetToZero();
-  for(int i=0; i<numThreads; i++)
-    *sparseMatrix += *(sparseMatrixBuffer[i]);
-
   //stiffnessCounter.StopCounter();
   //printf("Stiffness matrix: %G\n", stiffnessCounter.GetElapsedTime());
 }
-
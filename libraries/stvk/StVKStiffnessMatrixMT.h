@@ -28,9 +28,12 @@
 
 /*
   This class is a multi-threaded version of the class "StVKStiffnessMatrix".
-  It uses POSIX threads ("pthreads") as the threading API.
-  Each thread assembles the stiffness matrix with respect to a subset of all the mesh elements. 
-  At the end, the individual results are added into a global stiffness matrix.
+  It uses POSIX threads ("pthreads") as the threading API, via the process-wide thread pool (see threadPool.h).
+  The mesh elements are partitioned into colors, such that no two elements of the same color share
+  a vertex (see generateElementColoring.h). The colors are processed one after another; within each color,
+  each thread assembles the contributions of a subset of the color's elements directly into the
+  global stiffness matrix. Elements of the same color write into disjoint matrix rows,
+  so no per-thread matrix copies (and no final reduction) are needed.
 
   See also StVKStiffnessMatrix.h .
 */
@@ -49,14 +52,21 @@ public:
 
   // evaluates the stiffness matrix in the given deformation configuration
   virtual void ComputeStiffnessMatrix(double * vertexDisplacements, SparseMatrix * sparseMatrix);
+  using StVKStiffnessMatrix::ComputeStiffnessMatrix; // the (single-threaded) SparseMatrixBlock3 version
 
-  int GetStartElement(int rank);
-  int GetEndElement(int rank);
+  inline int GetNumColors() { return numColors; }
+  inline const int * GetColoredElements() { return coloredElements; } // all elements, sorted by color
+  // the elements processed by thread "rank" during color "color" are
+  // GetColoredElements()[GetStartElement(color, rank)], ..., GetColoredElements()[GetEndElement(color, rank)-1]
+  int GetStartElement(int color, int rank);
+  int GetEndElement(int color, int rank);
 
 protected:
   int numThreads;
-  int * startElement, * endElement;
-  SparseMatrix ** sparseMatrixBuffer;
+  int numColors;
+  int * colorStarts;
+  int * coloredElements;
+  int * startElement, * endElement; // numColors x numThreads
 };
 
 #endif
@@ -103,27 +103,3 @@ void StVKTetABCD::PrepareElement(int el, void * elementIterator)
       (cache->dots)[i][j] = dot(cache->elementPointer->Phig[i], cache->elementPointer->Phig[j]);
 }
 
-Mat3d StVKTetABCD::A(void * elementIterator, int i, int j)
-{
-  ElementCache * cache = (ElementCache *) elementIterator;
-  return cache->elementPointer->volume * tensorProduct(cache->elementPointer->Phig[i], cache->elementPointer->Phig[j]);
-}
-
-double StVKTetABCD::B(void * elementIterator, int i, int j)
-{
-  ElementCache * cache = (ElementCache *) elementIterator;
-  return cache->elementPointer->volume * cache->dots[i][j];
-}
-
-Vec3d StVKTetABCD::C(void * elementIterator, int i, int j, int k)
-{
-  ElementCache * cache = (ElementCache *) elementIterator;
-  return cache->elementPointer->volume * cache->dots[j][k] * cache->elementPointer->Phig[i];
-}
-
-double StVKTetABCD::D(void * elementIterator, int i, int j, int k, int l)
-{
-  ElementCache * cache = (ElementCache *) elementIterator;
-  return cache->elementPointer->volume * cache->dots[i][j] * cache->dots[k][l]; 
-}
-
@@ -45,10 +45,10 @@ public:
   // computes the ABCD coefficients 
   StVKTetABCD(TetMesh * tetMesh);
 
-  virtual Mat3d A(void * elementIterator, int i, int j);
-  virtual double B(void * elementIterator, int i, int j);
-  virtual Vec3d C(void * elementIterator, int i, int j, int k);
-  virtual double D(void * elementIterator, int i, int j, int k, int l);
+  inline virtual Mat3d A(void * elementIterator, int i, int j);
+  inline virtual double B(void * elementIterator, int i, int j);
+  inline virtual Vec3d C(void * elementIterator, int i, int j, int k);
+  inline virtual double D(void * elementIterator, int i, int j, int k, int l);
 
   typedef struct
   {
@@ -76,5 +76,29 @@ protected:
   void StVKSingleTetABCD(Vec3d vertices[4], elementData * target);
 };
 
+inline Mat3d StVKTetABCD::A(void * elementIterator, int i, int j)
+{
+  ElementCache * cache = (ElementCache *) elementIterator;
+  return cache->elementPointer->volume * tensorProduct(cache->elementPointer->Phig[i], cache->elementPointer->Phig[j]);
+}
+
+inline double StVKTetABCD::B(void * elementIterator, int i, int j)
+{
+  ElementCache * cache = (ElementCache *) elementIterator;
+  return cache->elementPointer->volume * cache->dots[i][j];
+}
+
+inline Vec3d StVKTetABCD::C(void * elementIterator, int i, int j, int k)
+{
+  ElementCache * cache = (ElementCache *) elementIterator;
+  return cache->elementPointer->volume * cache->dots[j][k] * cache->elementPointer->Phig[i];
+}
+
+inline double StVKTetABCD::D(void * elementIterator, int i, int j, int k, int l)
+{
+  ElementCache * cache = (ElementCache *) elementIterator;
+  return cache->elementPointer->volume * cache->dots[i][j] * cache->dots[k][l]; 
+}
+
 #endif
 
@@ -0,0 +1,232 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "StVK" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC           *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include "StVKTetInternalForces.h"
+
+StVKTetInternalForces::StVKTetInternalForces(TetMesh * tetMesh, bool addGravity_, double g_): StVKInternalForces(tetMesh, NULL, addGravity_, g_) 
+{
+  int numElements = tetMesh->getNumElements();
+  elementsData = (elementData*) malloc (sizeof(elementData) * numElements);
+
+  for(int el=0; el<numElements; el++)
+  {
+    Vec3d vtx[4];
+    for(int i=0; i<4; i++)
+      vtx[i] = *(tetMesh->getVertex(el, i));
+
+    double det = TetMesh::getTetDeterminant(&vtx[0], &vtx[1], &vtx[2], &vtx[3]);
+    elementsData[el].volume = fabs(det / 6);
+
+    // the rows of Dm are the edges x1-x0, x2-x0, x3-x0; 
+    // the gradients of phi_1, phi_2, phi_3 are the columns of Dm^{-1}, and the gradient of phi_0 is minus their sum
+    Mat3d Dm(vtx[1] - vtx[0], vtx[2] - vtx[0], vtx[3] - vtx[0]);
+    Mat3d DmInv = inv(Dm);
+    for(int j=0; j<3; j++)
+    {
+      elementsData[el].Phig[0][j] = 0.0;
+      for(int i=1; i<4; i++)
+      {
+        elementsData[el].Phig[i][j] = DmInv[j][i-1];
+        elementsData[el].Phig[0][j] -= DmInv[j][i-1];
+      }
+    }
+  }
+
+  printf("Total tet deformation gradient data size: %G Mb.\n", 1.0 * sizeof(elementData) * numElements / 1024 / 1024);
+}
+
+StVKTetInternalForces::~StVKTetInternalForces()
+{
+  free(elementsData);
+}
+
+void StVKTetInternalForces::ComputeForces(double * vertexDisplacements, double * internalForces)
+{
+  ComputeEnergyAndForceAndStiffnessMatrix(vertexDisplacements, NULL, internalForces, NULL, NULL, NULL);
+}
+
+double StVKTetInternalForces::ComputeEnergy(double * vertexDisplacements)
+{
+  double energy;
+  ComputeEnergyAndForceAndStiffnessMatrix(vertexDisplacements, &energy, NULL, NULL, NULL, NULL);
+  return energy;
+}
+
+void StVKTetInternalForces::ComputeEnergyAndForceAndStiffnessMatrix(double * vertexDisplacements, double * energy, double * internalForces, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, int ** column)
+{
+  if (energy != NULL)
+    *energy = 0.0;
+
+  if (internalForces != NULL)
+    ResetVector(internalForces);
+
+  if (sparseMatrix != NULL)
+    sparseMatrix->ResetToZero();
+
+  if (blockMatrix != NULL)
+    blockMatrix->ResetToZero();
+
+  AddEnergyAndForceAndStiffnessMatrixContribution(vertexDisplacements, energy, internalForces, sparseMatrix, blockMatrix, column, NULL, 0, volumetricMesh->getNumElements());
+
+  if ((internalForces != NULL) && addGravity)
+  {
+    int n = volumetricMesh->getNumVertices();
+    for(int i=0; i<3*n; i++)
+      internalForces[i] -= gravityForce[i];
+  }
+}
+
+void StVKTetInternalForces::AddEnergyAndForceAndStiffnessMatrixContribution(double * vertexDisplacements, double * energy, double * internalForces, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, int ** column, const int * elementList, int elementLow, int elementHigh)
+{
+  double elementEnergy = 0.0;
+
+  for(int elIndex=elementLow; elIndex<elementHigh; elIndex++)
+  {
+    int el = (elementList == NULL) ? elIndex : elementList[elIndex];
+    elementData * data = &elementsData[el];
+    double volume = data->volume;
+    double lambda = lambdaLame[el];
+    double mu = muLame[el];
+
+    int vertices[4];
+    for(int a=0; a<4; a++)
+      vertices[a] = volumetricMesh->getVertexIndex(el, a);
+
+    // deformation gradient F = I + sum_a u_a * Phig_a^T (row-major)
+    double F[9] = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+    for(int a=0; a<4; a++)
+    {
+      double * u = &vertexDisplacements[3*vertices[a]];
+      for(int k=0; k<3; k++)
+        for(int j=0; j<3; j++)
+          F[3*k+j] += u[k] * data->Phig[a][j];
+    }
+
+    // Green strain E = (F^T F - I) / 2
+    double E[9];
+    for(int i=0; i<3; i++)
+      for(int j=i; j<3; j++)
+      {
+        double value = F[i] * F[j] + F[3+i] * F[3+j] + F[6+i] * F[6+j];
+        E[3*i+j] = E[3*j+i] = 0.5 * (value - ((i == j) ? 1.0 : 0.0));
+      }
+    double trE = E[0] + E[4] + E[8];
+
+    // second Piola-Kirchhoff stress S = lambda * tr(E) * I + 2 * mu * E
+    double S[9];
+    for(int i=0; i<9; i++)
+      S[i] = 2.0 * mu * E[i];
+    S[0] += lambda * trE;
+    S[4] += lambda * trE;
+    S[8] += lambda * trE;
+
+    if (energy != NULL)
+    {
+      double EE = 0.0;
+      for(int i=0; i<9; i++)
+        EE += E[i] * E[i];
+      elementEnergy += volume * (mu * EE + 0.5 * lambda * trE * trE);
+    }
+
+    if (internalForces != NULL)
+    {
+      // first Piola-Kirchhoff stress P = F S; f_a = volume * P * Phig_a
+      double P[9];
+      for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+          P[3*i+j] = F[3*i+0] * S[j] + F[3*i+1] * S[3+j] + F[3*i+2] * S[6+j];
+
+      for(int a=0; a<4; a++)
+      {
+        double * f = &internalForces[3*vertices[a]];
+        double * phig = data->Phig[a];
+        for(int k=0; k<3; k++)
+          f[k] += volume * (P[3*k+0] * phig[0] + P[3*k+1] * phig[1] + P[3*k+2] * phig[2]);
+      }
+    }
+
+    if ((sparseMatrix != NULL) || (blockMatrix != NULL))
+    {
+      // K_ab = volume * ((Phig_a^T S Phig_b) I + lambda w_a w_b^T + mu (Phig_a^T Phig_b) F F^T + mu w_b w_a^T), where w_a = F Phig_a
+      double w[4][3];
+      double SPhig[4][3];
+      for(int a=0; a<4; a++)
+      {
+        double * phig = data->Phig[a];
+        for(int k=0; k<3; k++)
+        {
+          w[a][k] = F[3*k+0] * phig[0] + F[3*k+1] * phig[1] + F[3*k+2] * phig[2];
+          SPhig[a][k] = S[3*k+0] * phig[0] + S[3*k+1] * phig[1] + S[3*k+2] * phig[2];
+        }
+      }
+
+      double FFT[9];
+      for(int i=0; i<3; i++)
+        for(int j=i; j<3; j++)
+          FFT[3*i+j] = FFT[3*j+i] = F[3*i+0] * F[3*j+0] + F[3*i+1] * F[3*j+1] + F[3*i+2] * F[3*j+2];
+
+      int * columnEl = column[el];
+      for(int a=0; a<4; a++)
+      {
+        double * phiga = data->Phig[a];
+        for(int b=0; b<4; b++)
+        {
+          double * phigb = data->Phig[b];
+          double dotab = phiga[0] * phigb[0] + phiga[1] * phigb[1] + phiga[2] * phigb[2];
+          double sab = phiga[0] * SPhig[b][0] + phiga[1] * SPhig[b][1] + phiga[2] * SPhig[b][2];
+
+          double K[9];
+          for(int k=0; k<3; k++)
+            for(int l=0; l<3; l++)
+              K[3*k+l] = volume * (lambda * w[a][k] * w[b][l] + mu * (dotab * FFT[3*k+l] + w[b][k] * w[a][l]));
+          K[0] += volume * sab;
+          K[4] += volume * sab;
+          K[8] += volume * sab;
+
+          int columnIndex = columnEl[4*a+b];
+          if (sparseMatrix != NULL)
+          {
+            for(int k=0; k<3; k++)
+              for(int l=0; l<3; l++)
+                sparseMatrix->AddEntry(3*vertices[a]+k, 3*columnIndex+l, K[3*k+l]);
+          }
+          else
+          {
+            double * block = blockMatrix->GetBlock(vertices[a], columnIndex);
+            for(int i=0; i<9; i++)
+              block[i] += K[i];
+          }
+        }
+      }
+    }
+  }
+
+  if (energy != NULL)
+    *energy += elementEnergy;
+}
+
@@ -0,0 +1,96 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "StVK" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC           *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef _STVKTETINTERNALFORCES_H_
+#define _STVKTETINTERNALFORCES_H_
+
+/*
+  Computes the StVK internal forces, strain energy and tangent stiffness matrix 
+  of a tetrahedral mesh directly from the deformation gradient of each tet
+  (F = I + sum_a u_a * grad(phi_a)^T, Green strain E = (F^T F - I) / 2, 
+   second Piola-Kirchhoff stress S = lambda * tr(E) * I + 2 * mu * E).
+  For linear tets, this gives the same quantities as the ABCD integrals
+  (StVKTetABCD, StVKTetHighMemoryABCD), up to round-off, but with a constant amount 
+  of work per element, instead of the four nested loops over the element vertices. 
+  Only the rest volume and the gradients of the four shape functions are stored for each tet.
+
+  Energy, internal forces and the stiffness matrix can be evaluated together, in one pass 
+  over the elements (see StVKTetStiffnessMatrix::ComputeForceAndStiffnessMatrix). 
+  Usage with StVKForceModel:
+
+    StVKTetInternalForces * stVKInternalForces = new StVKTetInternalForces(tetMesh);
+    StVKForceModel * stVKForceModel = new StVKForceModel(stVKInternalForces); // creates a StVKTetStiffnessMatrix
+
+  Note: this class does not use ABCD integrals (GetPrecomputedIntegrals() returns NULL); 
+  therefore, the Add*TermsContribution routines of StVKInternalForces, the classes 
+  StVKInternalForcesMT, StVKStiffnessMatrixMT, StVKHessianTensor and LinearFEMForceModel, 
+  and the reduced StVK classes, cannot be used with it.
+
+  See also StVKInternalForces.h .
+*/
+
+#include "tetMesh.h"
+#include "sparseMatrix.h"
+#include "sparseMatrixBlock3.h"
+#include "StVKInternalForces.h"
+
+class StVKTetInternalForces : public StVKInternalForces
+{
+public:
+
+  StVKTetInternalForces(TetMesh * tetMesh, bool addGravity=false, double g=9.81);
+  virtual ~StVKTetInternalForces();
+
+  virtual void ComputeForces(double * vertexDisplacements, double * internalForces);
+  virtual double ComputeEnergy(double * vertexDisplacements);
+
+  // computes any subset of the strain energy, internal forces (gravity is subtracted, as in ComputeForces) and tangent stiffness matrix, in one pass over the elements
+  // pass NULL for the quantities that are not needed (at most one of sparseMatrix, blockMatrix may be non-NULL)
+  // the matrix must have the topology given by StVKStiffnessMatrix::GetStiffnessMatrixTopology;
+  // "column" are the acceleration indices of that topology (see StVKStiffnessMatrix::GetMatrixAccelerationIndices)
+  // StVKTetStiffnessMatrix provides a more convenient interface to this routine
+  void ComputeEnergyAndForceAndStiffnessMatrix(double * vertexDisplacements, double * energy, double * internalForces, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, int ** column);
+
+  // === advanced routines below === 
+
+  // adds the contributions of the elements elementLow <= el < elementHigh (or, if elementList is not NULL, of elements elementList[elementLow], ..., elementList[elementHigh-1])
+  void AddEnergyAndForceAndStiffnessMatrixContribution(double * vertexDisplacements, double * energy, double * internalForces, SparseMatrix * sparseMatrix, SparseMatrixBlock3 * blockMatrix, int ** column, const int * elementList, int elementLow, int elementHigh);
+
+protected:
+
+  typedef struct
+  {
+    double volume;
+    double Phig[4][3]; // gradient of a basis function
+  } elementData;
+
+  elementData * elementsData;
+};
+
+#endif
+
@@ -0,0 +1,58 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "StVK" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC           *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include "StVKTetStiffnessMatrix.h"
+
+StVKTetStiffnessMatrix::StVKTetStiffnessMatrix(StVKTetInternalForces * stVKTetInternalForces_): StVKStiffnessMatrix(stVKTetInternalForces_), stVKTetInternalForces(stVKTetInternalForces_)
+{
+}
+
+StVKTetStiffnessMatrix::~StVKTetStiffnessMatrix()
+{
+}
+
+void StVKTetStiffnessMatrix::ComputeStiffnessMatrix(double * vertexDisplacements, SparseMatrix * sparseMatrix)
+{
+  stVKTetInternalForces->ComputeEnergyAndForceAndStiffnessMatrix(vertexDisplacements, NULL, NULL, sparseMatrix, NULL, column_);
+}
+
+void StVKTetStiffnessMatrix::ComputeStiffnessMatrix(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix)
+{
+  stVKTetInternalForces->ComputeEnergyAndForceAndStiffnessMatrix(vertexDisplacements, NULL, NULL, NULL, blockMatrix, column_);
+}
+
+void StVKTetStiffnessMatrix::ComputeForceAndStiffnessMatrix(double * vertexDisplacements, double * internalForces, SparseMatrix * sparseMatrix)
+{
+  stVKTetInternalForces->ComputeEnergyAndForceAndStiffnessMatrix(vertexDisplacements, NULL, internalForces, sparseMatrix, NULL, column_);
+}
+
+void StVKTetStiffnessMatrix::ComputeEnergyAndForceAndStiffnessMatrix(double * vertexDisplacements, double * energy, double * internalForces, SparseMatrix * sparseMatrix)
+{
+  stVKTetInternalForces->ComputeEnergyAndForceAndStiffnessMatrix(vertexDisplacements, energy, internalForces, sparseMatrix, NULL, column_);
+}
+
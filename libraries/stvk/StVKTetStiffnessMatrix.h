@@ -2,7 +2,7 @@
  *                                                                       *
  * Vega FEM Simulation Library Version 2.1                               *
  *                                                                       *
- * "integrator" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC     *
+ * "StVK" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC           *
  * All rights reserved.                                                  *
  *                                                                       *
  * Code author: Jernej Barbic                                            *
@@ -26,14 +26,37 @@
  *                                                                       *
  *************************************************************************/
 
-// Selects which solver is used by the integrator library.
-// Exactly one of PARDISO, SPOOLES, PCG should be enabled.
-// Note: for PARDISO or SPOOLES, the selected solver must be installed and its
-//       availability also set in libraries/sparseSolvers/sparseSolverAvailability.h .
-//       The PCG solver (Jacobi-preconditioned Conjugate Gradients) is included 
-//       with Vega and therefore always available.
+/*
+  Computes the tangent stiffness matrix of a StVK tet mesh, using the deformation gradient
+  of each tet (see StVKTetInternalForces.h). The internal forces (and strain energy) can be 
+  computed together with the matrix, in one pass over the elements.
+  See also StVKStiffnessMatrix.h .
+*/
 
-//#define PARDISO
-//#define SPOOLES
-#define PCG
+#ifndef _STVKTETSTIFFNESSMATRIX_H_
+#define _STVKTETSTIFFNESSMATRIX_H_
+
+#include "StVKStiffnessMatrix.h"
+#include "StVKTetInternalForces.h"
+
+class StVKTetStiffnessMatrix : public StVKStiffnessMatrix
+{
+public:
+
+  StVKTetStiffnessMatrix(StVKTetInternalForces * stVKTetInternalForces);
+  virtual ~StVKTetStiffnessMatrix();
+
+  virtual void ComputeStiffnessMatrix(double * vertexDisplacements, SparseMatrix * sparseMatrix);
+  virtual void ComputeStiffnessMatrix(double * vertexDisplacements, SparseMatrixBlock3 * blockMatrix);
+
+  // one pass over the elements
+  virtual void ComputeForceAndStiffnessMatrix(double * vertexDisplacements, double * internalForces, SparseMatrix * sparseMatrix);
+  // same as above, also returns the strain energy
+  void ComputeEnergyAndForceAndStiffnessMatrix(double * vertexDisplacements, double * energy, double * internalForces, SparseMatrix * sparseMatrix);
+
+protected:
+  StVKTetInternalForces * stVKTetInternalForces;
+};
+
+#endif
 
@@ -0,0 +1,188 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "threadPool" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC     *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "threadPool.h"
+
+ThreadPool * ThreadPool::globalThreadPool = NULL;
+pthread_mutex_t ThreadPool::globalThreadPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+
+ThreadPool::ThreadPool(int numThreads): function(NULL), data(NULL), numTasks(0), nextTask(0), numCompletedTasks(0), generation(0), shutdown(0)
+{
+  if (numThreads < 1)
+    numThreads = 1;
+  numWorkers = numThreads - 1;
+
+  pthread_mutex_init(&executeMutex, NULL);
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&workAvailable, NULL);
+  pthread_cond_init(&workCompleted, NULL);
+
+  workers = (pthread_t*) malloc (sizeof(pthread_t) * (numWorkers + 1));
+  for(int i=0; i<numWorkers; i++)
+  {
+    if (pthread_create(&workers[i], NULL, ThreadPool::WorkerThread, this) != 0)
+    {
+      printf("Error: unable to launch thread %d.\n", i);
+      exit(1);
+    }
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  pthread_mutex_lock(&mutex);
+  shutdown = 1;
+  pthread_cond_broadcast(&workAvailable);
+  pthread_mutex_unlock(&mutex);
+
+  for(int i=0; i<numWorkers; i++)
+  {
+    if (pthread_join(workers[i], NULL) != 0)
+    {
+      printf("Error: unable to join thread %d.\n", i);
+      exit(1);
+    }
+  }
+  free(workers);
+
+  pthread_cond_destroy(&workCompleted);
+  pthread_cond_destroy(&workAvailable);
+  pthread_mutex_destroy(&mutex);
+  pthread_mutex_destroy(&executeMutex);
+}
+
+void ThreadPool::RunTasks()
+{
+  // must be called with "mutex" locked; returns with "mutex" locked
+  while (nextTask < numTasks)
+  {
+    int rank = nextTask;
+    nextTask++;
+    taskFunctionType taskFunction = function;
+    void * taskData = data;
+    pthread_mutex_unlock(&mutex);
+
+    taskFunction(taskData, rank);
+
+    pthread_mutex_lock(&mutex);
+    numCompletedTasks++;
+    if (numCompletedTasks == numTasks)
+      pthread_cond_signal(&workCompleted);
+  }
+}
+
+void * ThreadPool::WorkerThread(void * arg)
+{
+  ThreadPool * pool = (ThreadPool*) arg;
+
+  pthread_mutex_lock(&pool->mutex);
+  int lastGeneration = pool->generation;
+  while (1)
+  {
+    // park until new work is published (or the pool shuts down)
+    while ((pool->generation == lastGeneration) && (!pool->shutdown))
+      pthread_cond_wait(&pool->workAvailable, &pool->mutex);
+
+    if (pool->shutdown)
+      break;
+
+    lastGeneration = pool->generation;
+    pool->RunTasks();
+  }
+  pthread_mutex_unlock(&pool->mutex);
+
+  return NULL;
+}
+
+void ThreadPool::Execute(int numTasks_, taskFunctionType function_, void * data_)
+{
+  if (numTasks_ <= 0)
+    return;
+
+  // if the pool is busy (nested or concurrent call), or there is nothing to distribute, execute serially
+  if ((numWorkers == 0) || (numTasks_ == 1) || (pthread_mutex_trylock(&executeMutex) != 0))
+  {
+    for(int rank=0; rank<numTasks_; rank++)
+      function_(data_, rank);
+    return;
+  }
+
+  // fork
+  pthread_mutex_lock(&mutex);
+  function = function_;
+  data = data_;
+  numTasks = numTasks_;
+  nextTask = 0;
+  numCompletedTasks = 0;
+  generation++;
+  pthread_cond_broadcast(&workAvailable);
+
+  // the calling thread works too
+  RunTasks();
+
+  // join
+  while (numCompletedTasks < numTasks)
+    pthread_cond_wait(&workCompleted, &mutex);
+  pthread_mutex_unlock(&mutex);
+
+  pthread_mutex_unlock(&executeMutex);
+}
+
+int ThreadPool::GetNumProcessors()
+{
+  int numProcessors = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  return (numProcessors > 0) ? numProcessors : 1;
+}
+
+ThreadPool * ThreadPool::GetGlobalThreadPool()
+{
+  pthread_mutex_lock(&globalThreadPoolMutex);
+  if (globalThreadPool == NULL)
+    globalThreadPool = new ThreadPool(GetNumProcessors());
+  ThreadPool * pool = globalThreadPool;
+  pthread_mutex_unlock(&globalThreadPoolMutex);
+  return pool;
+}
+
+void ThreadPool::SetGlobalNumThreads(int numThreads)
+{
+  pthread_mutex_lock(&globalThreadPoolMutex);
+  if ((globalThreadPool != NULL) && (globalThreadPool->GetNumThreads() != numThreads))
+  {
+    delete(globalThreadPool);
+    globalThreadPool = NULL;
+  }
+  if (globalThreadPool == NULL)
+    globalThreadPool = new ThreadPool(numThreads);
+  pthread_mutex_unlock(&globalThreadPoolMutex);
+}
+
@@ -0,0 +1,106 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "threadPool" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC     *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+/*
+  A persistent pool of worker threads (POSIX threads), with fork/join semantics.
+
+  The multithreaded classes in Vega (StVKInternalForcesMT, StVKStiffnessMatrixMT, 
+  CorotationalLinearFEMMT, IsotropicHyperelasticFEMMT, MassSpringSystemMT, ClothBWMT, ...)
+  split their work into "numThreads" tasks. Instead of creating and joining 
+  new threads on every call, they hand these tasks to a process-wide pool, 
+  whose threads are created once, and park (sleep on a condition variable) between calls.
+
+  Execute(numTasks, function, data) calls function(data, rank) for rank = 0, 1, ..., numTasks-1,
+  and returns when all the calls have completed. The calling thread participates in 
+  the work. The number of tasks need not equal the number of pool threads 
+  (tasks are handed out to the threads as they become available); however, 
+  tasks must not wait for each other.
+
+  If the pool is already busy (e.g., Execute is called from within a task, 
+  or from two application threads at the same time), the tasks are executed
+  serially on the calling thread.
+
+  The global pool is created on first use. Its number of threads defaults to the 
+  number of online processors, and can be set once at startup via SetGlobalNumThreads.
+*/
+
+#include <pthread.h>
+
+class ThreadPool
+{
+public:
+
+  // creates a pool that executes tasks on "numThreads" threads (the calling thread, plus numThreads-1 workers)
+  ThreadPool(int numThreads);
+  ~ThreadPool();
+
+  typedef void (*taskFunctionType)(void * data, int rank);
+
+  // executes function(data, rank) for rank = 0 ... numTasks-1; returns when all tasks have completed
+  void Execute(int numTasks, taskFunctionType function, void * data);
+
+  inline int GetNumThreads() const { return numWorkers + 1; }
+
+  // the process-wide pool (created on first call)
+  static ThreadPool * GetGlobalThreadPool();
+  // sets the number of threads of the global pool; call once, before any multithreaded computation
+  // (if the global pool already exists with a different number of threads, it is re-created)
+  static void SetGlobalNumThreads(int numThreads);
+  // returns the number of online processors
+  static int GetNumProcessors();
+
+protected:
+  int numWorkers;
+  pthread_t * workers;
+
+  pthread_mutex_t executeMutex; // held by the thread that is currently executing tasks
+  pthread_mutex_t mutex; // protects the variables below
+  pthread_cond_t workAvailable;
+  pthread_cond_t workCompleted;
+
+  taskFunctionType function;
+  void * data;
+  int numTasks;
+  int nextTask;
+  int numCompletedTasks;
+  int generation; // incremented each time new work is published
+  int shutdown;
+
+  static void * WorkerThread(void * arg);
+  void RunTasks(); // grabs tasks until none are left
+
+  static ThreadPool * globalThreadPool;
+  static pthread_mutex_t globalThreadPoolMutex;
+};
+
+#endif
+
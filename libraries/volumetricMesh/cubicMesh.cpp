@@ -685,7 +685,7 @@ void CubicMesh::computeElementMassMatrix(int el, double * massMatrix) const
 void CubicMesh::subdivide()
 {
   int numNewElements = 8 * numElements; 
-  int ** newElements = (int**) malloc (sizeof(int*) * numNewElements);
+  int * newElements = (int*) malloc (sizeof(int) * 8 * numNewElements);
 
   int parentMask[8][3] = {
       { 0, 0, 0 },
@@ -714,8 +714,6 @@ void CubicMesh::subdivide()
     // create the 8 children cubes
     for(int child=0; child<8; child++)
     {
-      newElements[8 * el + child] = (int*) malloc (sizeof(int) * 8);
-
       int childVtx[8];
       for(int vtx=0; vtx<8; vtx++)
       {
@@ -740,7 +738,7 @@ void CubicMesh::subdivide()
         }
 
         childVtx[vtx] = found;
-        newElements[8 * el + child][vtx] = childVtx[vtx];
+        newElements[8 * (8 * el + child) + vtx] = childVtx[vtx];
       }
     }
   }
@@ -748,24 +746,21 @@ void CubicMesh::subdivide()
   cubeSize *= 0.5;
 
   // deallocate old vertices
-  for(int i=0; i<numVertices; i++)
-    delete(vertices[i]);
   free(vertices);
 
   // copy new vertices into place
   numVertices = (int)newVertices.size();
-  vertices = (Vec3d**) malloc (sizeof(Vec3d*) * numVertices);
+  vertices = (Vec3d*) malloc (sizeof(Vec3d) * numVertices);
   for(int i=0; i<numVertices; i++)
-    vertices[i] = new Vec3d(newVertices[i]);
+    vertices[i] = newVertices[i];
 
   // deallocate old elements
-  for(int i=0; i<numElements; i++)
-    free(elements[i]);
   free(elements);
 
   // copy new elements into place
   numElements = numNewElements;
   elements = newElements;
+  elementMaterial = (int*) realloc (elementMaterial, sizeof(int) * numElements); // re-set by propagateRegionsToElements below
 
   // update sets (expand each entry in each set into 8 new entries)
   for(int setIndex=0; setIndex<numSets; setIndex++)
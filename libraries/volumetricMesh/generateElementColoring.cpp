@@ -0,0 +1,145 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "volumetricMesh" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+using namespace std;
+#include "generateElementColoring.h"
+
+int GenerateElementColoring::Generate(VolumetricMesh * volumetricMesh, int ** colorStarts, int ** elements)
+{
+  int numVertices = volumetricMesh->getNumVertices();
+  int numElements = volumetricMesh->getNumElements();
+  int numElementVertices = volumetricMesh->getNumElementVertices();
+
+  // build the vertex-to-element incidence lists (compressed row format)
+  int * vertexElementStarts = (int*) calloc (numVertices + 1, sizeof(int));
+  for(int el=0; el<numElements; el++)
+    for(int j=0; j<numElementVertices; j++)
+      vertexElementStarts[volumetricMesh->getVertexIndex(el, j) + 1]++;
+  for(int v=0; v<numVertices; v++)
+    vertexElementStarts[v+1] += vertexElementStarts[v];
+
+  int * vertexElements = (int*) malloc (sizeof(int) * vertexElementStarts[numVertices]);
+  int * fillPosition = (int*) malloc (sizeof(int) * numVertices);
+  memcpy(fillPosition, vertexElementStarts, sizeof(int) * numVertices);
+  for(int el=0; el<numElements; el++)
+    for(int j=0; j<numElementVertices; j++)
+    {
+      int vertex = volumetricMesh->getVertexIndex(el, j);
+      vertexElements[fillPosition[vertex]++] = el;
+    }
+  free(fillPosition);
+
+  // greedy coloring
+  int * elementColors = (int*) malloc (sizeof(int) * numElements);
+  for(int el=0; el<numElements; el++)
+    elementColors[el] = -1;
+
+  vector<int> colorMarker; // colorMarker[c] == el means that color c is used by a neighbor of element el
+  vector<int> colorSizes;
+  for(int el=0; el<numElements; el++)
+  {
+    for(int j=0; j<numElementVertices; j++)
+    {
+      int vertex = volumetricMesh->getVertexIndex(el, j);
+      for(int k=vertexElementStarts[vertex]; k<vertexElementStarts[vertex+1]; k++)
+      {
+        int neighborColor = elementColors[vertexElements[k]];
+        if (neighborColor >= 0)
+          colorMarker[neighborColor] = el;
+      }
+    }
+
+    int color = 0;
+    while ((color < (int)colorMarker.size()) && (colorMarker[color] == el))
+      color++;
+
+    if (color == (int)colorMarker.size())
+    {
+      colorMarker.push_back(-1);
+      colorSizes.push_back(0);
+    }
+
+    elementColors[el] = color;
+    colorSizes[color]++;
+  }
+
+  free(vertexElements);
+  free(vertexElementStarts);
+
+  // sort the elements by color
+  int numColors = (int)colorSizes.size();
+  *colorStarts = (int*) malloc (sizeof(int) * (numColors + 1));
+  (*colorStarts)[0] = 0;
+  for(int c=0; c<numColors; c++)
+    (*colorStarts)[c+1] = (*colorStarts)[c] + colorSizes[c];
+
+  *elements = (int*) malloc (sizeof(int) * numElements);
+  for(int c=0; c<numColors; c++)
+    colorSizes[c] = (*colorStarts)[c];
+  for(int el=0; el<numElements; el++)
+    (*elements)[colorSizes[elementColors[el]]++] = el;
+
+  free(elementColors);
+
+  return numColors;
+}
+
+void GenerateElementColoring::PartitionColors(int numColors, const int * colorStarts, int numThreads, int ** startElement, int ** endElement)
+{
+  *startElement = (int*) malloc (sizeof(int) * numColors * numThreads);
+  *endElement = (int*) malloc (sizeof(int) * numColors * numThreads);
+
+  for(int color=0; color < numColors; color++)
+  {
+    int colorSize = colorStarts[color+1] - colorStarts[color];
+    int remainder = colorSize % numThreads;
+    // the first 'remainder' nodes will process one element more
+    int jobSize = colorSize / numThreads;
+
+    for(int rank=0; rank < numThreads; rank++)
+    {
+      int * start = &(*startElement)[color * numThreads + rank];
+      int * end = &(*endElement)[color * numThreads + rank];
+      if (rank < remainder)
+      {
+        *start = rank * (jobSize+1);
+        *end = (rank+1) * (jobSize+1);
+      }
+      else
+      {
+        *start = remainder * (jobSize+1) + (rank-remainder) * jobSize;
+        *end = remainder * (jobSize+1) + ((rank-remainder)+1) * jobSize;
+      }
+      *start += colorStarts[color];
+      *end += colorStarts[color];
+    }
+  }
+}
@@ -0,0 +1,68 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "volumetricMesh" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef _GENERATEELEMENTCOLORING_H_
+#define _GENERATEELEMENTCOLORING_H_
+
+#include "volumetricMesh.h"
+
+/*
+  Partitions the elements of a volumetric mesh into "colors", such that
+  no two elements of the same color share a vertex.
+
+  The stiffness matrix (and internal force) contributions of an element only touch the
+  rows (entries) of the element's vertices. Therefore, the elements of one color
+  can be assembled in parallel, directly into a single global matrix, without any write conflicts
+  (and without per-thread matrix copies).
+
+  The coloring is computed greedily (each element receives the smallest color not used by any
+  element sharing a vertex with it).
+
+  Output:
+    return value: number of colors (numColors)
+    colorStarts: array of length numColors+1; the elements of color c are
+      elements[colorStarts[c]], ..., elements[colorStarts[c+1]-1]
+    elements: array of length volumetricMesh->getNumElements(), listing all the elements, sorted by color
+      (within each color, elements are listed in increasing order)
+  Both arrays are allocated by this routine and must be released by the caller using free().
+
+  PartitionColors splits each color into numThreads contiguous ranges of (almost) equal size:
+  thread "rank" processes the elements elements[startElement[color * numThreads + rank]], ..., elements[endElement[color * numThreads + rank] - 1]
+  (the first colorSize % numThreads threads receive one element more).
+  The arrays startElement and endElement (of length numColors * numThreads) are allocated by this routine and must be released by the caller using free().
+*/
+
+class GenerateElementColoring
+{
+public:
+  static int Generate(VolumetricMesh * volumetricMesh, int ** colorStarts, int ** elements);
+  static void PartitionColors(int numColors, const int * colorStarts, int numThreads, int ** startElement, int ** endElement);
+};
+
+#endif
+
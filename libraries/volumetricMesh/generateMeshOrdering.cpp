@@ -0,0 +1,391 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "volumetricMesh" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#include "generateMeshOrdering.h"
+
+// breadth-first search from "root", over the vertices not yet ordered (ordered[v] == 0)
+// the visited vertices are returned in "queue" (level by level); vertices are marked by setting stamp[v] = stampValue
+// returns the number of visited vertices; *lastLevelStart is the position in queue where the last level starts, *numLevels is the number of levels
+static int GenerateMeshOrdering_BFS(int root, const int * neighborStarts, const int * neighbors, const char * ordered, int * stamp, int stampValue, int * queue, int * lastLevelStart, int * numLevels)
+{
+  int head = 0;
+  int tail = 0;
+  queue[tail++] = root;
+  stamp[root] = stampValue;
+  *numLevels = 0;
+  while (head < tail)
+  {
+    int levelEnd = tail;
+    *lastLevelStart = head;
+    (*numLevels)++;
+    for(; head < levelEnd; head++)
+    {
+      int vertex = queue[head];
+      for(int k=neighborStarts[vertex]; k<neighborStarts[vertex+1]; k++)
+      {
+        int neighbor = neighbors[k];
+        if (!ordered[neighbor] && (stamp[neighbor] != stampValue))
+        {
+          stamp[neighbor] = stampValue;
+          queue[tail++] = neighbor;
+        }
+      }
+    }
+  }
+  return tail;
+}
+
+// the vertex graph (vertices sharing an element are adjacent), in compressed row format
+static void GenerateMeshOrdering_VertexGraph(VolumetricMesh * volumetricMesh, int ** neighborStarts, int ** neighbors)
+{
+  int numVertices = volumetricMesh->getNumVertices();
+  int numElements = volumetricMesh->getNumElements();
+  int numElementVertices = volumetricMesh->getNumElementVertices();
+
+  // vertex-to-element incidence lists
+  int * vertexElementStarts = (int*) calloc (numVertices + 1, sizeof(int));
+  for(int el=0; el<numElements; el++)
+    for(int j=0; j<numElementVertices; j++)
+      vertexElementStarts[volumetricMesh->getVertexIndex(el, j) + 1]++;
+  for(int v=0; v<numVertices; v++)
+    vertexElementStarts[v+1] += vertexElementStarts[v];
+
+  int * vertexElements = (int*) malloc (sizeof(int) * vertexElementStarts[numVertices]);
+  int * fillPosition = (int*) malloc (sizeof(int) * numVertices);
+  memcpy(fillPosition, vertexElementStarts, sizeof(int) * numVertices);
+  for(int el=0; el<numElements; el++)
+    for(int j=0; j<numElementVertices; j++)
+    {
+      int vertex = volumetricMesh->getVertexIndex(el, j);
+      vertexElements[fillPosition[vertex]++] = el;
+    }
+
+  // two passes: count the neighbors, then fill them in
+  int * marker = (int*) malloc (sizeof(int) * numVertices);
+  *neighborStarts = (int*) calloc (numVertices + 1, sizeof(int));
+  *neighbors = NULL;
+  for(int pass=0; pass<2; pass++)
+  {
+    for(int v=0; v<numVertices; v++)
+      marker[v] = -1;
+
+    for(int v=0; v<numVertices; v++)
+    {
+      marker[v] = v;
+      int count = 0;
+      for(int k=vertexElementStarts[v]; k<vertexElementStarts[v+1]; k++)
+      {
+        int el = vertexElements[k];
+        for(int j=0; j<numElementVertices; j++)
+        {
+          int neighbor = volumetricMesh->getVertexIndex(el, j);
+          if (marker[neighbor] == v)
+            continue;
+          marker[neighbor] = v;
+          if (pass == 1)
+            (*neighbors)[(*neighborStarts)[v] + count] = neighbor;
+          count++;
+        }
+      }
+      if (pass == 0)
+        (*neighborStarts)[v+1] = count;
+    }
+
+    if (pass == 0)
+    {
+      for(int v=0; v<numVertices; v++)
+        (*neighborStarts)[v+1] += (*neighborStarts)[v];
+      *neighbors = (int*) malloc (sizeof(int) * ((*neighborStarts)[numVertices] + 1));
+    }
+  }
+
+  free(marker);
+  free(fillPosition);
+  free(vertexElements);
+  free(vertexElementStarts);
+}
+
+// order[k] is the vertex that is placed at position k
+static void GenerateMeshOrdering_ReverseCuthillMcKee(VolumetricMesh * volumetricMesh, int * order)
+{
+  int numVertices = volumetricMesh->getNumVertices();
+  int * neighborStarts;
+  int * neighbors;
+  GenerateMeshOrdering_VertexGraph(volumetricMesh, &neighborStarts, &neighbors);
+
+  // all vertices, sorted by degree (candidate starting vertices of the connected components)
+  vector<pair<int,int> > degreeVertex(numVertices);
+  for(int v=0; v<numVertices; v++)
+    degreeVertex[v] = make_pair(neighborStarts[v+1] - neighborStarts[v], v);
+  sort(degreeVertex.begin(), degreeVertex.end());
+
+  char * ordered = (char*) calloc (numVertices, sizeof(char));
+  int * stamp = (int*) malloc (sizeof(int) * numVertices);
+  for(int v=0; v<numVertices; v++)
+    stamp[v] = -1;
+  int * queue = (int*) malloc (sizeof(int) * numVertices);
+  int stampValue = 0;
+
+  vector<pair<int,int> > children;
+  int numOrdered = 0;
+  int candidate = 0;
+  while (numOrdered < numVertices)
+  {
+    while (ordered[degreeVertex[candidate].second])
+      candidate++;
+
+    // find a pseudo-peripheral vertex of the component (George and Liu), starting from the smallest-degree vertex
+    int root = degreeVertex[candidate].second;
+    int lastLevelStart, numLevels;
+    int componentSize = GenerateMeshOrdering_BFS(root, neighborStarts, neighbors, ordered, stamp, stampValue++, queue, &lastLevelStart, &numLevels);
+    while (1)
+    {
+      int next = queue[lastLevelStart];
+      for(int k=lastLevelStart+1; k<componentSize; k++)
+      {
+        int vertex = queue[k];
+        if (neighborStarts[vertex+1] - neighborStarts[vertex] < neighborStarts[next+1] - neighborStarts[next])
+          next = vertex;
+      }
+
+      int nextLastLevelStart, nextNumLevels;
+      GenerateMeshOrdering_BFS(next, neighborStarts, neighbors, ordered, stamp, stampValue++, queue, &nextLastLevelStart, &nextNumLevels);
+      if (nextNumLevels <= numLevels)
+        break;
+      root = next;
+      lastLevelStart = nextLastLevelStart;
+      numLevels = nextNumLevels;
+    }
+
+    // Cuthill-McKee: breadth-first search from the root, visiting the neighbors in the order of increasing degree
+    int head = numOrdered;
+    order[numOrdered++] = root;
+    ordered[root] = 1;
+    while (head < numOrdered)
+    {
+      int vertex = order[head++];
+      children.clear();
+      for(int k=neighborStarts[vertex]; k<neighborStarts[vertex+1]; k++)
+      {
+        int neighbor = neighbors[k];
+        if (!ordered[neighbor])
+        {
+          ordered[neighbor] = 1;
+          children.push_back(make_pair(neighborStarts[neighbor+1] - neighborStarts[neighbor], neighbor));
+        }
+      }
+      sort(children.begin(), children.end());
+      for(int k=0; k<(int)children.size(); k++)
+        order[numOrdered++] = children[k].second;
+    }
+  }
+
+  // reverse
+  for(int k=0; k<numVertices/2; k++)
+  {
+    int buffer = order[k];
+    order[k] = order[numVertices-1-k];
+    order[numVertices-1-k] = buffer;
+  }
+
+  free(queue);
+  free(stamp);
+  free(ordered);
+  free(neighbors);
+  free(neighborStarts);
+}
+
+// spreads the lowest 21 bits of x, so that there are two zero bits between any two consecutive bits
+static unsigned long long GenerateMeshOrdering_SpreadBits(unsigned long long x)
+{
+  x &= 0x1fffff;
+  x = (x | (x << 32)) & 0x1f00000000ffffULL;
+  x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+  x = (x | (x << 8)) & 0x100f00f00f00f00fULL;
+  x = (x | (x << 4)) & 0x10c30c30c30c30c3ULL;
+  x = (x | (x << 2)) & 0x1249249249249249ULL;
+  return x;
+}
+
+static void GenerateMeshOrdering_Morton(VolumetricMesh * volumetricMesh, int * order)
+{
+  int numVertices = volumetricMesh->getNumVertices();
+  if (numVertices == 0)
+    return;
+
+  Vec3d bmin(+DBL_MAX, +DBL_MAX, +DBL_MAX);
+  Vec3d bmax(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+  for(int v=0; v<numVertices; v++)
+  {
+    Vec3d pos = *(volumetricMesh->getVertex(v));
+    for(int dim=0; dim<3; dim++)
+    {
+      if (pos[dim] < bmin[dim])
+        bmin[dim] = pos[dim];
+      if (pos[dim] > bmax[dim])
+        bmax[dim] = pos[dim];
+    }
+  }
+
+  // the same grid spacing in all three dimensions
+  double extent = 0.0;
+  for(int dim=0; dim<3; dim++)
+    if (bmax[dim] - bmin[dim] > extent)
+      extent = bmax[dim] - bmin[dim];
+  double scale = (extent > 0) ? (double)0x1fffff / extent : 0.0;
+
+  vector<pair<unsigned long long, int> > keyVertex(numVertices);
+  for(int v=0; v<numVertices; v++)
+  {
+    Vec3d pos = *(volumetricMesh->getVertex(v));
+    unsigned long long key = 0;
+    for(int dim=0; dim<3; dim++)
+    {
+      unsigned long long cell = (unsigned long long)((pos[dim] - bmin[dim]) * scale);
+      key |= GenerateMeshOrdering_SpreadBits(cell) << dim;
+    }
+    keyVertex[v] = make_pair(key, v);
+  }
+  sort(keyVertex.begin(), keyVertex.end());
+
+  for(int k=0; k<numVertices; k++)
+    order[k] = keyVertex[k].second;
+}
+
+void GenerateMeshOrdering::Generate(VolumetricMesh * volumetricMesh, orderingType ordering, int ** vertexPermutation, int ** elementPermutation)
+{
+  int numVertices = volumetricMesh->getNumVertices();
+  int numElements = volumetricMesh->getNumElements();
+  int numElementVertices = volumetricMesh->getNumElementVertices();
+
+  int * order = (int*) malloc (sizeof(int) * numVertices);
+  if (ordering == REVERSE_CUTHILL_MCKEE)
+    GenerateMeshOrdering_ReverseCuthillMcKee(volumetricMesh, order);
+  else
+    GenerateMeshOrdering_Morton(volumetricMesh, order);
+
+  *vertexPermutation = (int*) malloc (sizeof(int) * numVertices);
+  for(int k=0; k<numVertices; k++)
+    (*vertexPermutation)[order[k]] = k;
+  free(order);
+
+  // sort the elements by their smallest new vertex index
+  vector<pair<int,int> > keyElement(numElements);
+  for(int el=0; el<numElements; el++)
+  {
+    int minVertex = numVertices;
+    for(int j=0; j<numElementVertices; j++)
+    {
+      int vertex = (*vertexPermutation)[volumetricMesh->getVertexIndex(el, j)];
+      if (vertex < minVertex)
+        minVertex = vertex;
+    }
+    keyElement[el] = make_pair(minVertex, el);
+  }
+  sort(keyElement.begin(), keyElement.end());
+
+  *elementPermutation = (int*) malloc (sizeof(int) * numElements);
+  for(int k=0; k<numElements; k++)
+    (*elementPermutation)[keyElement[k].second] = k;
+}
+
+void GenerateMeshOrdering::InvertPermutation(int n, const int * permutation, int * inversePermutation)
+{
+  for(int i=0; i<n; i++)
+    inversePermutation[permutation[i]] = i;
+}
+
+void GenerateMeshOrdering::RenumberIndices(int numIndices, int * indices, const int * permutation)
+{
+  for(int i=0; i<numIndices; i++)
+    if (indices[i] >= 0)
+      indices[i] = permutation[indices[i]];
+}
+
+void GenerateMeshOrdering::PermuteVertexData(int numVertices, int r, const double * input, double * output, const int * vertexPermutation, int toOldNumbering)
+{
+  for(int column=0; column<r; column++)
+  {
+    const double * in = &input[3 * numVertices * column];
+    double * out = &output[3 * numVertices * column];
+    for(int v=0; v<numVertices; v++)
+    {
+      int source = toOldNumbering ? vertexPermutation[v] : v;
+      int target = toOldNumbering ? v : vertexPermutation[v];
+      out[3*target+0] = in[3*source+0];
+      out[3*target+1] = in[3*source+1];
+      out[3*target+2] = in[3*source+2];
+    }
+  }
+}
+
+void GenerateMeshOrdering::GetBandwidth(VolumetricMesh * volumetricMesh, int * bandwidth, double * profile)
+{
+  int numVertices = volumetricMesh->getNumVertices();
+  int numElements = volumetricMesh->getNumElements();
+  int numElementVertices = volumetricMesh->getNumElementVertices();
+
+  int * firstNeighbor = (int*) malloc (sizeof(int) * numVertices);
+  for(int v=0; v<numVertices; v++)
+    firstNeighbor[v] = v;
+
+  *bandwidth = 0;
+  for(int el=0; el<numElements; el++)
+  {
+    int minVertex = numVertices;
+    int maxVertex = -1;
+    for(int j=0; j<numElementVertices; j++)
+    {
+      int vertex = volumetricMesh->getVertexIndex(el, j);
+      if (vertex < minVertex)
+        minVertex = vertex;
+      if (vertex > maxVertex)
+        maxVertex = vertex;
+    }
+    if (maxVertex - minVertex > *bandwidth)
+      *bandwidth = maxVertex - minVertex;
+    for(int j=0; j<numElementVertices; j++)
+    {
+      int vertex = volumetricMesh->getVertexIndex(el, j);
+      if (minVertex < firstNeighbor[vertex])
+        firstNeighbor[vertex] = minVertex;
+    }
+  }
+
+  *profile = 0.0;
+  for(int v=0; v<numVertices; v++)
+    *profile += v - firstNeighbor[v];
+  free(firstNeighbor);
+}
+
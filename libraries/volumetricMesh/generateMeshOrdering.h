@@ -0,0 +1,88 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "volumetricMesh" library , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This library is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this library in the file LICENSE.txt                    *
+ *                                                                       *
+ * This library is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+#ifndef _GENERATEMESHORDERING_H_
+#define _GENERATEMESHORDERING_H_
+
+#include "volumetricMesh.h"
+
+/*
+  Computes a renumbering of the vertices and elements of a volumetric mesh that improves 
+  memory locality: element loops (internal forces, stiffness matrices, mass matrices) then 
+  access nearby vertex data, and the sparse matrices have a smaller bandwidth 
+  (faster matrix-vector products, less fill-in in direct solvers).
+
+  Orderings:
+    REVERSE_CUTHILL_MCKEE: reverse Cuthill-McKee ordering of the vertex graph (two vertices are 
+      adjacent if they share an element, i.e., the sparsity pattern of the stiffness matrix); 
+      each connected component is started from a pseudo-peripheral vertex; this minimizes the matrix bandwidth
+    MORTON: vertices sorted along the Morton (Z-order) space-filling curve of their rest positions; 
+      cheaper to compute, and does not require the mesh connectivity
+  In both cases, the elements are then sorted by their smallest (new) vertex index.
+
+  Permutation convention: permutation[oldIndex] = newIndex. 
+  The mesh itself is renumbered with VolumetricMesh::renumber. Typical usage:
+
+    int * vertexPermutation, * elementPermutation;
+    GenerateMeshOrdering::Generate(mesh, GenerateMeshOrdering::REVERSE_CUTHILL_MCKEE, &vertexPermutation, &elementPermutation);
+    mesh->renumber(vertexPermutation, elementPermutation);
+    GenerateMeshOrdering::RenumberIndices(numFixedVertices, fixedVertices, vertexPermutation); // (then sort, if needed)
+    GenerateMeshOrdering::RenumberIndices(numInterpolationLocations * numElementVertices, interpolationVertices, vertexPermutation); // interpolation weights are unchanged
+    ... simulate ...
+    // report u in the original numbering:
+    GenerateMeshOrdering::PermuteVertexData(numVertices, 1, u, uOriginal, vertexPermutation, 1);
+
+  See also the "reorderMesh" utility, which renumbers a .veg file, together with its .bou and .interp files.
+*/
+
+class GenerateMeshOrdering
+{
+public:
+  typedef enum { REVERSE_CUTHILL_MCKEE, MORTON } orderingType;
+
+  // computes the vertex and element permutations (arrays of length numVertices and numElements, allocated by this routine; release with free())
+  static void Generate(VolumetricMesh * volumetricMesh, orderingType ordering, int ** vertexPermutation, int ** elementPermutation);
+
+  // inversePermutation[permutation[i]] = i; inversePermutation must be pre-allocated (length n)
+  static void InvertPermutation(int n, const int * permutation, int * inversePermutation);
+
+  // replaces each index i by permutation[i] (e.g., for lists of fixed vertices, or the vertices of an interpolant); negative indices are left unchanged
+  static void RenumberIndices(int numIndices, int * indices, const int * permutation);
+
+  // permutes vertex data with 3 values per vertex (a 3 numVertices x r matrix, stored column-major, e.g., displacements, forces, or a modal basis)
+  // toOldNumbering = 0: input is in the old numbering, output is in the new numbering
+  // toOldNumbering = 1: input is in the new numbering, output is in the old numbering (e.g., to report results in the numbering of the original files)
+  // input and output must not overlap
+  static void PermuteVertexData(int numVertices, int r, const double * input, double * output, const int * vertexPermutation, int toOldNumbering);
+
+  // the bandwidth (max |i-j| over all pairs of vertices i,j sharing an element) and the profile (sum over all vertices i of i - (the smallest vertex sharing an element with i)) of the vertex graph
+  static void GetBandwidth(VolumetricMesh * volumetricMesh, int * bandwidth, double * profile);
+};
+
+#endif
+
@@ -75,7 +75,7 @@ TetMesh::TetMesh(const char * filename, int specialFileType, int verbose): Volum
   if (dim != 3)
     throw 3;
 
-  vertices = (Vec3d**) malloc (sizeof(Vec3d*) * numVertices);
+  vertices = (Vec3d*) malloc (sizeof(Vec3d) * numVertices);
 
   for(int i=0; i<numVertices; i++)
   {
@@ -85,7 +85,7 @@ TetMesh::TetMesh(const char * filename, int specialFileType, int verbose): Volum
     sscanf(lineBuffer, "%d %lf %lf %lf", &index, &x, &y, &z);
     if (index != (i+1))
       throw 3;
-    vertices[i] = new Vec3d(x,y,z);
+    vertices[i] = Vec3d(x,y,z);
   }
   
   parser.close();
@@ -103,7 +103,7 @@ TetMesh::TetMesh(const char * filename, int specialFileType, int verbose): Volum
     throw 5;
   }
 
-  elements = (int**) malloc (sizeof(int*) * numElements);
+  elements = (int*) malloc (sizeof(int) * 4 * numElements);
   elementMaterial = (int*) malloc (sizeof(int) * numElements);
 
   for(int i=0; i<numElements; i++)
@@ -114,11 +114,10 @@ TetMesh::TetMesh(const char * filename, int specialFileType, int verbose): Volum
     sscanf(lineBuffer, "%d %d %d %d %d", &index, &v[0], &v[1], &v[2], &v[3]);
     if (index != (i+1))
       throw 6;
-    elements[i] = (int*) malloc (sizeof(int) * 4);
     for(int j=0; j<4; j++) // vertices are 1-indexed in .ele files
     {
       v[j]--;
-      elements[i][j] = v[j]; 
+      elements[4*i+j] = v[j]; 
     }
   }
   
@@ -427,7 +426,7 @@ void TetMesh::orient()
     if (det < 0)
     {
       // reverse tet
-      int * elementVertices = elements[el];
+      int * elementVertices = &elements[4*el];
       // swap 2 and 3
       int buff = elementVertices[2];
       elementVertices[2] = elementVertices[3];
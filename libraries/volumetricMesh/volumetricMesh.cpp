@@ -77,12 +77,7 @@ VolumetricMesh::VolumetricMesh(void * binaryInputStream, int numElementVertices_
 
 VolumetricMesh::~VolumetricMesh()
 {
-  for(int i=0; i<numVertices; i++)
-    delete(vertices[i]);
   free(vertices);
-
-  for(int i=0; i<numElements; i++)
-    free(elements[i]);
   free(elements);
 
   for(int i=0; i<numMaterials; i++)
@@ -186,7 +181,7 @@ void VolumetricMesh::loadFromAscii(const char * filename, elementType * elementT
       {
         // format is numVertices, 3, 0, 0
         sscanf(lineBuffer, "%d", &numVertices);  // ignore 3, 0, 0
-        vertices = (Vec3d**) malloc (sizeof(Vec3d*) * numVertices);
+        vertices = (Vec3d*) malloc (sizeof(Vec3d) * numVertices);
       }
       else
       {
@@ -231,7 +226,7 @@ void VolumetricMesh::loadFromAscii(const char * filename, elementType * elementT
       {
         // format is: numElements, numElementVertices, 0
         sscanf(lineBuffer, "%d", &numElements);  // only use numElements; ignore numElementVertices, 0
-        elements = (int**) malloc (sizeof(int*) * numElements);
+        elements = (int*) malloc (sizeof(int) * numElementVertices * numElements);
       }
       else
       {
@@ -293,7 +288,7 @@ void VolumetricMesh::loadFromAscii(const char * filename, elementType * elementT
           ch++;
       }
 
-      vertices[countNumVertices] = new Vec3d(pos);
+      vertices[countNumVertices] = Vec3d(pos);
       countNumVertices++;
     }
 
@@ -345,9 +340,8 @@ void VolumetricMesh::loadFromAscii(const char * filename, elementType * elementT
       for (int k=0; k<numElementVertices; k++)
         v[k] -= oneIndexedVertices;
 
-      elements[countNumElements] = (int*) malloc (sizeof(int) * numElementVertices);
       for(int j=0; j<numElementVertices; j++)
-        elements[countNumElements][j] = v[j];
+        elements[numElementVertices * countNumElements + j] = v[j];
 
       countNumElements++;
     }
@@ -765,34 +759,26 @@ VolumetricMesh::VolumetricMesh(int numVertices_, double * vertices_,
   numSets = 1;
   numRegions = 1;
 
-  vertices = (Vec3d**) malloc (sizeof(Vec3d*) * numVertices);
-  elements = (int**) malloc (sizeof(int*) * numElements);
+  vertices = (Vec3d*) malloc (sizeof(Vec3d) * numVertices);
+  elements = (int*) malloc (sizeof(int) * numElementVertices * numElements);
   elementMaterial = (int*) malloc (sizeof(int) * numElements);
   materials = (Material**) malloc (sizeof(Material*) * numMaterials);
   sets = (Set**) malloc (sizeof(Set*) * numSets);
   regions = (Region**) malloc (sizeof(Region*) * numRegions);
 
-  for(int i=0; i<numVertices; i++)
-    vertices[i] = new Vec3d(vertices_[3*i+0], vertices_[3*i+1], vertices_[3*i+2]);
+  memcpy((double*) vertices, vertices_, sizeof(double) * 3 * numVertices);
+  memcpy(elements, elements_, sizeof(int) * numElementVertices * numElements);
 
   Material * material = new ENuMaterial("defaultMaterial", density, E, nu);
   materials[0] = material;
 
   Set * set = new Set("allElements");
 
-  int * v = (int*) malloc (sizeof(int) * numElementVertices);
   for(int i=0; i<numElements; i++)
   {
     set->insert(i);
-    elements[i] = (int*) malloc (sizeof(int) * numElementVertices);
     elementMaterial[i] = 0;
-    for(int j=0; j<numElementVertices; j++)
-    {
-      v[j] = elements_[numElementVertices * i + j];
-      elements[i][j] = v[j];
-    }
   }
-  free(v);
 
   sets[0] = set;
   Region * region = new Region(0, 0);
@@ -812,27 +798,16 @@ VolumetricMesh::VolumetricMesh(int numVertices_, double * vertices_,
   numSets = numSets_;
   numRegions = numRegions_;
 
-  vertices = (Vec3d**) malloc (sizeof(Vec3d*) * numVertices);
-  elements = (int**) malloc (sizeof(int*) * numElements);
+  vertices = (Vec3d*) malloc (sizeof(Vec3d) * numVertices);
+  elements = (int*) malloc (sizeof(int) * numElementVertices * numElements);
   elementMaterial = (int*) malloc (sizeof(int) * numElements);
   materials = (Material**) malloc (sizeof(Material*) * numMaterials);
   sets = (Set**) malloc (sizeof(Set*) * numSets);
   regions = (Region**) malloc (sizeof(Region*) * numRegions);
 
-  for(int i=0; i<numVertices; i++)
-    vertices[i] = new Vec3d(vertices_[3*i+0], vertices_[3*i+1], vertices_[3*i+2]);
+  memcpy((double*) vertices, vertices_, sizeof(double) * 3 * numVertices);
+  memcpy(elements, elements_, sizeof(int) * numElementVertices * numElements);
 
-  int * v = (int*) malloc (sizeof(int) * numElementVertices);
-  for(int i=0; i<numElements; i++)
-  {
-    elements[i] = (int*) malloc (sizeof(int) * numElementVertices);
-    for(int j=0; j<numElementVertices; j++)
-    {
-      v[j] = elements_[numElementVertices * i + j];
-      elements[i][j] = v[j];
-    }
-  }
-  free(v);
 
   for(int i=0; i<numMaterials; i++)
     materials[i] = materials_[i]->clone();
@@ -916,22 +891,14 @@ void VolumetricMesh::loadFromBinaryGeneric(void * binaryInputStream_, elementTyp
     throw 3; 
   }
 
-  vertices = (Vec3d**) malloc (sizeof(Vec3d*) * numVertices);
-
-  // input all the vertices
-  double * doubleTempVec = (double *) malloc (sizeof(double) * 3 * numVertices);
-  if ((int)genericRead(doubleTempVec, sizeof(double), 3 * numVertices, binaryInputStream) != 3 * numVertices)
+  // input all the vertices, directly into place
+  vertices = (Vec3d*) malloc (sizeof(Vec3d) * numVertices);
+  if ((int)genericRead(vertices, sizeof(double), 3 * numVertices, binaryInputStream) != 3 * numVertices)
   {
     printf("Error in VolumetricMesh::loadFromBinaryGeneric: cannot read vertex coordinates.\n");
     throw 0;
   }
 
-  for(int vertexIndex=0; vertexIndex<numVertices; vertexIndex++)
-  {
-    vertices[vertexIndex] = new Vec3d(&doubleTempVec[vertexIndex*3]);
-  }
-  free(doubleTempVec);
-
   // input the number of elements
   if ((int)genericRead(&numElements, sizeof(int), 1, binaryInputStream) != 1)
   {
@@ -958,22 +925,14 @@ void VolumetricMesh::loadFromBinaryGeneric(void * binaryInputStream_, elementTyp
     throw 5;
   }
 
-  // input all elements
-  elements = (int**) malloc (sizeof(int*) * numElements);
-  int * intTempVec = (int *) malloc (sizeof(int) * numElementVertices * numElements);
-  if ((int)genericRead(intTempVec, sizeof(int), numElementVertices * numElements, binaryInputStream) != numElementVertices * numElements)
+  // input all elements, directly into place
+  elements = (int*) malloc (sizeof(int) * numElementVertices * numElements);
+  if ((int)genericRead(elements, sizeof(int), numElementVertices * numElements, binaryInputStream) != numElementVertices * numElements)
   {
     printf("Error in VolumetricMesh::loadFromBinaryGeneric: cannot read the elements.\n");
     throw 0;
   }
 
-  for(int elementIndex=0; elementIndex<numElements; elementIndex++)
-  {
-    elements[elementIndex] = (int*) malloc (sizeof(int) * numElementVertices);
-    memcpy(elements[elementIndex], &intTempVec[elementIndex * numElementVertices], sizeof(int) * numElementVertices);
-  }
-  free(intTempVec);
-
   // input number of materials
   if ((int)genericRead(&numMaterials, sizeof(int), 1, binaryInputStream) != 1)
   {
@@ -1133,7 +1092,7 @@ void VolumetricMesh::loadFromBinaryGeneric(void * binaryInputStream_, elementTyp
       printf("Error in VolumetricMesh::loadFromBinaryGeneric: cannot read the number of elements in current set.\n");
       throw 0;
     }
-    intTempVec = (int *) malloc (sizeof(int) * cardinality);
+    int * intTempVec = (int *) malloc (sizeof(int) * cardinality);
 
     // input all the elements in the current set
     if ((int)genericRead(intTempVec, sizeof(int), cardinality, binaryInputStream) != cardinality)
@@ -1180,19 +1139,13 @@ void VolumetricMesh::loadFromBinaryGeneric(void * binaryInputStream_, elementTyp
 VolumetricMesh::VolumetricMesh(const VolumetricMesh & volumetricMesh)
 {
   numVertices = volumetricMesh.numVertices;
-  vertices = (Vec3d**) malloc (sizeof(Vec3d*) * numVertices);
-  for(int i=0; i<numVertices; i++)
-    vertices[i] = new Vec3d(*(volumetricMesh.vertices[i]));
+  vertices = (Vec3d*) malloc (sizeof(Vec3d) * numVertices);
+  memcpy((double*) vertices, (double*) volumetricMesh.vertices, sizeof(double) * 3 * numVertices);
 
   numElementVertices = volumetricMesh.numElementVertices;
   numElements = volumetricMesh.numElements;
-  elements = (int**) malloc (sizeof(int*) * numElements);
-  for(int i=0; i<numElements; i++)
-  {
-    elements[i] = (int*) malloc (sizeof(int) * numElementVertices);
-    for(int j=0; j<numElementVertices; j++)
-      elements[i][j] = (volumetricMesh.elements)[i][j];
-  }
+  elements = (int*) malloc (sizeof(int) * numElementVertices * numElements);
+  memcpy(elements, volumetricMesh.elements, sizeof(int) * numElementVertices * numElements);
 
   numMaterials = volumetricMesh.numMaterials;
   numSets = volumetricMesh.numSets;
@@ -2022,7 +1975,7 @@ int VolumetricMesh::getClosestVertex(Vec3d pos) const
 
   for(int i=0; i<numVertices; i++)
   {
-    Vec3d * vertexPosition = vertices[i];
+    Vec3d * vertexPosition = &vertices[i];
     double dist = len(pos - *vertexPosition);
     if (dist < closestDist)
     {
@@ -2480,23 +2433,13 @@ void VolumetricMesh::exportMeshGeometry(int * numVertices_, double ** vertices_,
   if(vertices_ != NULL) 
   {
     *vertices_ = (double*) malloc (sizeof(double) * 3 * numVertices);
-    for(int i=0; i<numVertices; i++)
-    {
-      Vec3d v = *getVertex(i);
-      (*vertices_)[3*i+0] = v[0];
-      (*vertices_)[3*i+1] = v[1];
-      (*vertices_)[3*i+2] = v[2];
-    }
+    memcpy(*vertices_, vertices, sizeof(double) * 3 * numVertices);
   }
 
   if(elements_ != NULL) 
   {
     *elements_ = (int*) malloc (sizeof(int) * numElementVertices * numElements);
-    for(int i=0; i<numElements; i++)
-    {
-      for(int j=0; j<numElementVertices; j++)
-        (*elements_)[numElementVertices * i + j] = elements[i][j];
-    }
+    memcpy(*elements_, elements, sizeof(int) * numElementVertices * numElements);
   }
 }
 
@@ -2566,13 +2509,13 @@ VolumetricMesh::VolumetricMesh(const VolumetricMesh & volumetricMesh, int numEle
 
   // copy vertices into place and also into vertexMap
   numVertices = vertexSet.size();
-  vertices = (Vec3d**) malloc (sizeof(Vec3d*) * numVertices);
+  vertices = (Vec3d*) malloc (sizeof(Vec3d) * numVertices);
   set<int> :: iterator iter;
   int vertexNo = 0;
   map<int, int> vertexMap;
   for(iter = vertexSet.begin(); iter != vertexSet.end(); iter++)
   {
-    vertices[vertexNo] = new Vec3d(*(volumetricMesh.getVertex(*iter)));
+    vertices[vertexNo] = *(volumetricMesh.getVertex(*iter));
     vertexMap.insert(make_pair(*iter,vertexNo));
     vertexNo++;
   }
@@ -2582,21 +2525,20 @@ VolumetricMesh::VolumetricMesh(const VolumetricMesh & volumetricMesh, int numEle
 
   // copy elements
   numElements = numElements_;
-  elements = (int**) malloc (sizeof(int*) * numElements);
+  elements = (int*) malloc (sizeof(int) * numElementVertices * numElements);
   elementMaterial = (int*) malloc (sizeof(int) * numElements);
   map<int,int> elementMap;
   for(int i=0; i<numElements; i++)
   {
-    elements[i] = (int*) malloc (sizeof(int) * numElementVertices);
     for(int j=0; j< numElementVertices; j++)
     {
-      map<int,int> :: iterator iter2 = vertexMap.find((volumetricMesh.elements)[elements_[i]][j]);
+      map<int,int> :: iterator iter2 = vertexMap.find(volumetricMesh.getVertexIndex(elements_[i], j));
       if (iter2 == vertexMap.end())
       {
         printf("Internal error 1.\n");
         exit(1);
       }
-      elements[i][j] = iter2->second;
+      elements[numElementVertices * i + j] = iter2->second;
     }
 
     elementMaterial[i] = (volumetricMesh.elementMaterial)[elements_[i]];
@@ -2722,36 +2664,28 @@ VolumetricMesh::VolumetricMesh(const VolumetricMesh & volumetricMesh, int numEle
 // if vertexMap is non-null, it also returns a renaming datastructure: vertexMap[big mesh vertex] is the vertex index in the subset mesh
 void VolumetricMesh::setToSubsetMesh(std::set<int> & subsetElements, int removeIsolatedVertices, std::map<int,int> * vertexMap)
 {
-  int numRemovedElements = 0;
-  for(int el=0; el<numElements; el++)
-  {
-    if (subsetElements.find(el) == subsetElements.end())
-    {
-      delete(elements[el]);
-      elements[el] = NULL;
-      numRemovedElements++;
-    }
-  }
-
   int head = 0;
-  int tail = 0;
 
   int * lookupTable = (int *) malloc (sizeof(int) * numElements); 
   for(int i=0; i<numElements; i++)
     lookupTable[i] = i;
 
-  while (tail < numElements)
+  for(int tail=0; tail < numElements; tail++)
   {
-    if (elements[tail] != NULL)
+    if (subsetElements.find(tail) == subsetElements.end())
+      continue;
+
+    if (head != tail)
     {
-      elements[head] = elements[tail];
-      lookupTable[tail] = head;  // update to new index 
-      head++;
+      memmove(&elements[numElementVertices * head], &elements[numElementVertices * tail], sizeof(int) * numElementVertices);
+      elementMaterial[head] = elementMaterial[tail];
     }
-    tail++;
+    lookupTable[tail] = head;  // update to new index 
+    head++;
   }
-  numElements -= numRemovedElements;
-  elements = (int**) realloc (elements, sizeof(int*) * numElements);
+  numElements = head;
+  elements = (int*) realloc (elements, sizeof(int) * numElementVertices * numElements);
+  elementMaterial = (int*) realloc (elementMaterial, sizeof(int) * numElements);
 
   for(int setIndex=0; setIndex < numSets; setIndex++)
   {
@@ -2770,31 +2704,18 @@ void VolumetricMesh::setToSubsetMesh(std::set<int> & subsetElements, int removeI
 
   if (removeIsolatedVertices)
   {
-    set<int> retainedVertices;
+    char * retainedVertices = (char*) calloc (numVertices, sizeof(char));
     for(int el=0; el<numElements; el++)
       for(int j=0; j < numElementVertices; j++)
-        retainedVertices.insert(getVertexIndex(el,j));
+        retainedVertices[getVertexIndex(el,j)] = 1;
 
-    int numRemovedVertices = 0;
-    for(int v=0; v<numVertices; v++)
-    {
-      if (retainedVertices.find(v) == retainedVertices.end())
-      {
-        delete(vertices[v]);
-        vertices[v] = NULL;
-        numRemovedVertices++;
-      }
-    }
-  
     int head = 0;
-    int tail = 0;
-  
     int * renamingFunction = (int*) malloc (sizeof(int) * numVertices);
     if (vertexMap != NULL)
       vertexMap->clear();
-    while (tail < numVertices)
+    for(int tail=0; tail < numVertices; tail++)
     {
-      if (vertices[tail] != NULL)
+      if (retainedVertices[tail])
       {
         renamingFunction[tail] = head;
         if (vertexMap != NULL)
@@ -2802,108 +2723,81 @@ void VolumetricMesh::setToSubsetMesh(std::set<int> & subsetElements, int removeI
         vertices[head] = vertices[tail];
         head++;
       }
-      tail++;
     }
+    free(retainedVertices);
 
     // rename vertices inside the elements
-    for(int el=0; el<numElements; el++)
-      for(int j=0; j < numElementVertices; j++)
-        elements[el][j] = renamingFunction[getVertexIndex(el,j)];
+    for(int i=0; i<numElementVertices * numElements; i++)
+      elements[i] = renamingFunction[elements[i]];
    
     free(renamingFunction);
-    numVertices -= numRemovedVertices;
-    vertices = (Vec3d**) realloc (vertices, sizeof(Vec3d*) * numVertices );
+    numVertices = head;
+    vertices = (Vec3d*) realloc ((void*) vertices, sizeof(Vec3d) * numVertices);
   }
 }
 
-int VolumetricMesh::exportToEle(const char * baseFilename, int includeRegions) const
+int VolumetricMesh::renumber(const int * vertexPermutation, const int * elementPermutation)
 {
-  char s[1024];
-  sprintf(s, "%s.ele", baseFilename);
-
-  FILE * fout = fopen(s, "w");
-  if (!fout)
-  {       
-    printf("Error: could not write to %s.\n",s);
-    return 1;
-  }         
+  // check that the arrays are permutations
+  int numChecks = (numVertices > numElements) ? numVertices : numElements;
+  char * hit = (char*) malloc (sizeof(char) * (numChecks + 1)); // +1 to avoid a zero-size allocation
+  for(int pass=0; pass<2; pass++)
+  {
+    const int * permutation = (pass == 0) ? vertexPermutation : elementPermutation;
+    int n = (pass == 0) ? numVertices : numElements;
+    if (permutation == NULL)
+      continue;
 
-  int * elementRegion = NULL;
-  if (includeRegions)
-  {
-    elementRegion = (int*) malloc (sizeof(int) * getNumElements());
-    for(int el=0; el<getNumElements(); el++)
+    memset(hit, 0, sizeof(char) * n);
+    for(int i=0; i<n; i++)
     {
-      int found = 0;
-      for(int region=0; region < numRegions; region++)
+      if ((permutation[i] < 0) || (permutation[i] >= n) || hit[permutation[i]])
       {
-        int elementSet = (regions[region])->getSetIndex();
-
-        // seek for element in elementSet
-        if (sets[elementSet]->isMember(el))
-        {
-          if (found != 0)
-            printf("Warning: element %d (1-indexed) is in more than one region.\n",el+1);
-          else
-            found = region+1;
-        }
+        printf("Error: the given %s renumbering is not a permutation.\n", (pass == 0) ? "vertex" : "element");
+        free(hit);
+        return 1;
       }
-      if (found == 0)
-        printf("Warning: element %d (1-indexed) is not in any of the regions.\n",el+1);
-      elementRegion[el] = found;
+      hit[permutation[i]] = 1;
     }
   }
+  free(hit);
 
-  if (includeRegions)
-    fprintf(fout,"%d %d %d\n", numElements, numElementVertices, 1);
-  else
-    fprintf(fout,"%d %d %d\n", numElements, numElementVertices, 0);
+  if (vertexPermutation != NULL)
+  {
+    Vec3d * newVertices = (Vec3d*) malloc (sizeof(Vec3d) * numVertices);
+    for(int v=0; v<numVertices; v++)
+      newVertices[vertexPermutation[v]] = vertices[v];
+    free(vertices);
+    vertices = newVertices;
 
-  for(int el=0; el < numElements; el++)
-  {   
-    fprintf(fout,"%d ",el+1);
-    for(int j=0; j < numElementVertices; j++)
-    {   
-      fprintf(fout,"%d", getVertexIndex(el,j)+1);
-      if (j != numElementVertices - 1)
-        fprintf(fout," ");
-    } 
-    if (includeRegions)
+    for(int i=0; i<numElementVertices * numElements; i++)
+      elements[i] = vertexPermutation[elements[i]];
+  }
+
+  if (elementPermutation != NULL)
+  {
+    int * newElements = (int*) malloc (sizeof(int) * numElementVertices * numElements);
+    int * newElementMaterial = (int*) malloc (sizeof(int) * numElements);
+    for(int el=0; el<numElements; el++)
     {
-      fprintf(fout," %d", elementRegion[el]);
+      memcpy(&newElements[numElementVertices * elementPermutation[el]], &elements[numElementVertices * el], sizeof(int) * numElementVertices);
+      newElementMaterial[elementPermutation[el]] = elementMaterial[el];
     }
-    fprintf(fout,"\n");
-  }     
-        
-  fprintf(fout,"# generated by the volumetricMesh class\n");
-
-  fclose(fout);
-
-  if (includeRegions)
-    free(elementRegion);
-
-  sprintf(s, "%s.node", baseFilename);
-
-  fout = fopen(s, "w");
-  if (!fout)
-  {       
-    printf("Error: could not write to %s.\n",s);
-    return 1;
-  }         
-          
-  fprintf(fout,"%d %d %d %d\n", numVertices, 3, 0, 0);
-  for(int v=0; v < numVertices; v++)
-  {   
-    fprintf(fout,"%d ",v+1);
-    Vec3d vtx = *getVertex(v);
-    fprintf(fout,"%.15f %.15f %.15f\n", vtx[0], vtx[1], vtx[2]);
-  }     
-        
-  fprintf(fout,"# generated by the volumetricMesh class\n");
+    free(elements);
+    elements = newElements;
+    free(elementMaterial);
+    elementMaterial = newElementMaterial;
 
-  fclose(fout);
+    for(int setIndex=0; setIndex < numSets; setIndex++)
+    {
+      set<int> setElements;
+      sets[setIndex]->getElements(setElements);
+      sets[setIndex]->clear();
+      for(set<int>::iterator iter = setElements.begin(); iter != setElements.end(); iter++)
+        sets[setIndex]->insert(elementPermutation[*iter]);
+    }
+  }
 
   return 0;
 }
 
-
@@ -104,10 +104,19 @@ public:
   static elementType getElementType(void * fin, int memoryLoad = 0);
 
   inline int getNumVertices() const { return numVertices; }
-  inline Vec3d * getVertex(int i) const { return vertices[i]; }
-  inline Vec3d * getVertex(int element, int vertex) const { return vertices[elements[element][vertex]]; }
-  inline int getVertexIndex(int element, int vertex) const { return elements[element][vertex]; }
-  inline Vec3d ** getVertices() const { return vertices;} // advanced, internal datastructure
+  inline Vec3d * getVertex(int i) const { return &vertices[i]; }
+  inline Vec3d * getVertex(int element, int vertex) const { return &vertices[elements[numElementVertices * element + vertex]]; }
+  inline int getVertexIndex(int element, int vertex) const { return elements[numElementVertices * element + vertex]; }
+  inline Vec3d * getVertices() const { return vertices;} // advanced, internal datastructure
+
+  // advanced: direct (zero-copy) access to the internal storage, e.g., for solvers and renderers
+  // the vertex positions are a contiguous array of 3 x numVertices doubles (x0,y0,z0,x1,...)
+  // the element vertices are a contiguous array of numElementVertices x numElements integers (vertices of element 0, then of element 1, ...)
+  // the arrays are owned by the mesh; they are valid until the mesh is deleted or changed (e.g., by setToSubsetMesh, renumber, or CubicMesh::subdivide)
+  inline double * getVertexPositions() const { return (double*) vertices; }
+  inline int * getElementVertexIndices() const { return elements; }
+  inline const int * getElementVertexIndices(int element) const { return &elements[numElementVertices * element]; }
+
   inline int getNumElements() const { return numElements; }
   inline int getNumElementVertices() const { return numElementVertices; } 
 
@@ -176,6 +185,15 @@ public:
   // if vertexMap is non-null, it also returns a renaming datastructure: vertexMap[big mesh vertex] is the vertex index in the subset mesh
   void setToSubsetMesh(std::set<int> & subsetElements, int removeIsolatedVertices=1, std::map<int,int> * vertexMap = NULL);
 
+  // === renumbering ===
+
+  // (permanently) renumbers the vertices and elements of the mesh: old vertex v becomes vertex vertexPermutation[v], 
+  // and old element el becomes element elementPermutation[el]; either permutation can be NULL (numbering is then not changed)
+  // the element sets and the material of each element are renumbered accordingly (the order of vertices within each element is preserved)
+  // see generateMeshOrdering.h for bandwidth-reducing and space-filling-curve permutations, and for renumbering the associated data (fixed vertices, interpolants, vertex vectors)
+  // returns 0 on success, and 1 if the given arrays are not permutations (the mesh is then not modified)
+  int renumber(const int * vertexPermutation, const int * elementPermutation);
+
   // === interpolation ===
 
   // the interpolant is a triple (numTargetLocations, vertices, weights)
@@ -305,11 +323,11 @@ public:
 
 protected:
   int numVertices;
-  Vec3d ** vertices;
+  Vec3d * vertices; // contiguous, 3 x numVertices doubles
 
   int numElementVertices;
   int numElements;
-  int ** elements;
+  int * elements; // contiguous, numElementVertices x numElements; the vertices of element el are elements[numElementVertices * el + j], j=0,...,numElementVertices-1
 
   int numMaterials;
   int numSets;
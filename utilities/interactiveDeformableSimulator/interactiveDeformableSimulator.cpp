@@ -82,10 +82,13 @@ using namespace std;
 #include "implicitBackwardEulerSparse.h"
 #include "eulerSparse.h"
 #include "centralDifferencesSparse.h"
+#include "adaptiveTimestepSparse.h"
 #include "StVKInternalForces.h"
 #include "StVKStiffnessMatrix.h"
 #include "StVKInternalForcesMT.h"
 #include "StVKStiffnessMatrixMT.h"
+#include "StVKTetInternalForces.h"
+#include "StVKTetStiffnessMatrix.h"
 #include "StVKForceModel.h"
 #include "massSpringSystemForceModel.h"
 #include "corotationalLinearFEM.h"
@@ -99,13 +102,13 @@ using namespace std;
 #include "StVKIsotropicMaterial.h"
 #include "neoHookeanIsotropicMaterial.h"
 #include "MooneyRivlinIsotropicMaterial.h"
-#include "getIntegratorSolver.h"
 #include "volumetricMeshLoader.h"
 #include "StVKElementABCDLoader.h"
 #include "generateMeshGraph.h"
 #include "generateMassMatrix.h"
 #include "massSpringSystem.h"
 #include "massSpringSystemMT.h"
+#include "threadPool.h"
 #include "massSpringSystemFromObjMeshConfigFile.h"
 #include "massSpringSystemFromTetMeshConfigFile.h"
 #include "massSpringSystemFromCubicMeshConfigFile.h"
@@ -177,6 +180,8 @@ int corotationalLinearFEM_warp = 1;
 const int max_corotationalLinearFEM_warp = 2;
 char implicitSolverMethod[4096];
 char solverMethod[4096];
+char linearSolverMethod[4096];
+char pcgPreconditionerMethod[4096];
 char extraSceneGeometryFilename[4096];
 char lightingConfigFilename[4096];
 float dampingMassCoef; // Rayleigh mass damping
@@ -188,6 +193,10 @@ float deformableObjectCompliance = 1.0; // scales all user forces by the provide
 float frequencyScaling = 1.0; 
 int maxIterations; // for implicit integration
 double epsilon; // for implicit integration
+int inexactNewton; // for implicit integration with the PCG solver
+double adaptiveTimestepTolerance; // relative error tolerance of adaptive timestepping (0 = fixed timestep)
+int lumpedMass; // for explicit integration (Euler, symplectic Euler, central differences)
+int stVKTetDeformationGradient; // StVK with tet meshes: evaluate the StVK forces and stiffness matrices from the deformation gradients (instead of the ABCD integrals)
 char backgroundColorString[4096] = "255 255 255";
 int numInternalForceThreads;
 int numSolverThreads;
@@ -235,6 +244,7 @@ double * forceLoads = NULL;
 IntegratorBase * integratorBase = NULL;
 ImplicitNewmarkSparse * implicitNewmarkSparse = NULL;
 IntegratorBaseSparse * integratorBaseSparse = NULL;
+AdaptiveTimestepSparse * adaptiveTimestep = NULL;
 ForceModel * forceModel = NULL;
 StVKInternalForces * stVKInternalForces = NULL;
 StVKStiffnessMatrix * stVKStiffnessMatrix = NULL;
@@ -254,6 +264,8 @@ enum massSpringSystemSourceType { OBJ, TETMESH, CUBICMESH, CHAIN, NONE } massSpr
 enum deformableObjectType { STVK, COROTLINFEM, LINFEM, MASSSPRING, INVERTIBLEFEM, UNSPECIFIED } deformableObject = UNSPECIFIED;
 enum invertibleMaterialType { INV_STVK, INV_NEOHOOKEAN, INV_MOONEYRIVLIN, INV_NONE } invertibleMaterial = INV_NONE;
 enum solverType { IMPLICITNEWMARK, IMPLICITBACKWARDEULER, EULER, SYMPLECTICEULER, CENTRALDIFFERENCES, UNKNOWN } solver = UNKNOWN;
+IntegratorSparseSolver::solverType linearSolver = IntegratorSparseSolver::PCG;
+CGPreconditioner::preconditionerType pcgPreconditioner = CGPreconditioner::JACOBI;
 MassSpringSystem * massSpringSystem = NULL;
 RenderSprings * renderMassSprings = NULL;
 SparseMatrix * massMatrix = NULL;
@@ -605,7 +617,11 @@ void idleFunction(void)
     // timestep the dynamics 
     for(int i=0; i<substepsPerTimeStep; i++)
     {
-      int code = integratorBase->DoTimestep();
+      int code;
+      if (adaptiveTimestep != NULL)
+        code = adaptiveTimestep->Advance(timeStep / substepsPerTimeStep);
+      else
+        code = integratorBase->DoTimestep();
       printf("."); fflush(NULL);
 
       forceAssemblyLocalTime = integratorBaseSparse->GetForceAssemblyTime();
@@ -626,6 +642,8 @@ void idleFunction(void)
       {
         printf("The integrator went unstable. Reduce the timestep, or increase the number of substeps per timestep.\n");
         integratorBase->ResetToRest();
+        if (adaptiveTimestep != NULL)
+          adaptiveTimestep->Reset();
         for(int i=0; i<3*n; i++)
         {
           f_ext[i] = 0;
@@ -759,10 +777,14 @@ void idleFunction(void)
     char ptext1[96];
     sprintf(ptext1, "Force assembly: %G", forceAssemblyTime);
     forceAssemblyStaticText->set_text(ptext1);
-    char solverName[96];
-    GetIntegratorSolver(solverName);
     char ptext2[96];
-    sprintf(ptext2, "System solve (%s): %G", solverName, systemSolveTime);
+    if (integratorBaseSparse->GetLinearSolver() == NULL)
+      sprintf(ptext2, "System solve (lumped mass): %G", systemSolveTime);
+    else if (linearSolver == IntegratorSparseSolver::PCG)
+      sprintf(ptext2, "System solve (PCG, %s, %d iter): %G", CGPreconditioner::GetPreconditionerName(pcgPreconditioner), 
+        integratorBaseSparse->GetLinearSolver()->GetLastNumIterations(), systemSolveTime);
+    else
+      sprintf(ptext2, "System solve (%s): %G", IntegratorSparseSolver::GetSolverName(linearSolver), systemSolveTime);
     systemSolveStaticText->set_text(ptext2);
     Sync_GLUI();
 
@@ -787,6 +809,8 @@ void keyboardFunction(unsigned char key, int x, int y)
   switch (key)
   {
     case 27:
+      if (integratorBaseSparse->GetLinearSolver() != NULL)
+        integratorBaseSparse->GetLinearSolver()->PrintStatistics();
       exit(0);
 
     case 13:
@@ -1093,6 +1117,10 @@ void initSimulation()
   volumetricMesh = NULL;
   massSpringSystem = NULL;
 
+  // the multithreaded force models share one persistent pool of worker threads
+  if (numInternalForceThreads > 0)
+    ThreadPool::SetGlobalNumThreads(numInternalForceThreads);
+
   // set deformable material type
   if (strcmp(volumetricMeshFilename, "__none") != 0)
   {
@@ -1147,8 +1175,18 @@ void initSimulation()
     GenerateMassMatrix::computeMassMatrix(volumetricMesh, &massMatrix, inflate3Dim);
 
     // create the internal forces for STVK and linear FEM materials
-    if (deformableObject == STVK || deformableObject == LINFEM)  // LINFEM is constructed from stVKInternalForces
+    if ((deformableObject == STVK) && stVKTetDeformationGradient && (numInternalForceThreads == 0) && (volumetricMesh->getElementType() == VolumetricMesh::TET))
     {
+      printf("Generating internal forces and stiffness matrix models (deformation gradient)...\n"); fflush(NULL);
+      StVKTetInternalForces * stVKTetInternalForces = new StVKTetInternalForces((TetMesh*)volumetricMesh, addGravity, g);
+      stVKInternalForces = stVKTetInternalForces;
+      stVKStiffnessMatrix = new StVKTetStiffnessMatrix(stVKTetInternalForces);
+    }
+    else if (deformableObject == STVK || deformableObject == LINFEM)  // LINFEM is constructed from stVKInternalForces
+    {
+      if (stVKTetDeformationGradient && (deformableObject == STVK))
+        printf("Warning: stVKTetDeformationGradient requires a tet mesh, and numInternalForceThreads = 0. Using the ABCD integrals.\n");
+
       unsigned int loadingFlag = 0; // 0 = use the low-memory version, 1 = use the high-memory version
       StVKElementABCD * precomputedIntegrals = StVKElementABCDLoader::load(volumetricMesh, loadingFlag);
       if (precomputedIntegrals == NULL)
@@ -1546,33 +1584,37 @@ void initSimulation()
   // initialize the integrator
   printf("Initializing the integrator, n = %d...\n", n);
   printf("Solver type: %s\n", solverMethod);
+  if (linearSolver == IntegratorSparseSolver::PCG)
+    printf("Linear solver: PCG (preconditioner: %s)\n", CGPreconditioner::GetPreconditionerName(pcgPreconditioner));
+  else
+    printf("Linear solver: %s\n", IntegratorSparseSolver::GetSolverName(linearSolver));
 
   integratorBaseSparse = NULL;
   if (solver == IMPLICITNEWMARK)
   {
     implicitNewmarkSparse = new ImplicitNewmarkSparse(3*n, timeStep, massMatrix, forceModel, positiveDefinite, numFixedDOFs, fixedDOFs,
-       dampingMassCoef, dampingStiffnessCoef, maxIterations, epsilon, newmarkBeta, newmarkGamma, numSolverThreads);
+       dampingMassCoef, dampingStiffnessCoef, maxIterations, epsilon, newmarkBeta, newmarkGamma, numSolverThreads, linearSolver);
     integratorBaseSparse = implicitNewmarkSparse;
   }
   else if (solver == IMPLICITBACKWARDEULER)
   {
     implicitNewmarkSparse = new ImplicitBackwardEulerSparse(3*n, timeStep, massMatrix, forceModel, positiveDefinite, numFixedDOFs, fixedDOFs,
-       dampingMassCoef, dampingStiffnessCoef, maxIterations, epsilon, numSolverThreads);
+       dampingMassCoef, dampingStiffnessCoef, maxIterations, epsilon, numSolverThreads, linearSolver);
     integratorBaseSparse = implicitNewmarkSparse;
   }
   else if (solver == EULER)
   {
     int symplectic = 0;
-    integratorBaseSparse = new EulerSparse(3*n, timeStep, massMatrix, forceModel, symplectic, numFixedDOFs, fixedDOFs, dampingMassCoef);
+    integratorBaseSparse = new EulerSparse(3*n, timeStep, massMatrix, forceModel, symplectic, numFixedDOFs, fixedDOFs, dampingMassCoef, linearSolver, numSolverThreads, lumpedMass);
   }
   else if (solver == SYMPLECTICEULER)
   {
     int symplectic = 1;
-    integratorBaseSparse = new EulerSparse(3*n, timeStep, massMatrix, forceModel, symplectic, numFixedDOFs, fixedDOFs, dampingMassCoef);
+    integratorBaseSparse = new EulerSparse(3*n, timeStep, massMatrix, forceModel, symplectic, numFixedDOFs, fixedDOFs, dampingMassCoef, linearSolver, numSolverThreads, lumpedMass);
   }
   else if (solver == CENTRALDIFFERENCES)
   {
-    integratorBaseSparse = new CentralDifferencesSparse(3*n, timeStep, massMatrix, forceModel, numFixedDOFs, fixedDOFs, dampingMassCoef, dampingStiffnessCoef, centralDifferencesTangentialDampingUpdateMode, numSolverThreads);
+    integratorBaseSparse = new CentralDifferencesSparse(3*n, timeStep, massMatrix, forceModel, numFixedDOFs, fixedDOFs, dampingMassCoef, dampingStiffnessCoef, centralDifferencesTangentialDampingUpdateMode, numSolverThreads, linearSolver, lumpedMass);
   }
 
   integratorBase = integratorBaseSparse;
@@ -1584,6 +1626,8 @@ void initSimulation()
   }
 
   // set integration parameters
+  if (integratorBaseSparse->GetLinearSolver() != NULL)
+    integratorBaseSparse->GetLinearSolver()->SetPCGPreconditioner(pcgPreconditioner);
   integratorBaseSparse->SetDampingMatrix(LaplacianDampingMatrix);
   integratorBase->ResetToRest();
   integratorBase->SetState(uInitial, velInitial);
@@ -1592,10 +1636,22 @@ void initSimulation()
   if (implicitNewmarkSparse != NULL)
   {
     implicitNewmarkSparse->UseStaticSolver(staticSolver);
+    implicitNewmarkSparse->UseInexactNewton(inexactNewton);
     if (velInitial != NULL)
       implicitNewmarkSparse->SetState(implicitNewmarkSparse->Getq(), velInitial);
   }
 
+  if (adaptiveTimestepTolerance > 0)
+  {
+    if (dynamic_cast<CentralDifferencesSparse*>(integratorBaseSparse) != NULL)
+      printf("Warning: adaptive timestepping is not supported for central differences. Using a fixed timestep.\n");
+    else
+    {
+      printf("Using adaptive timestepping with relative tolerance %G.\n", adaptiveTimestepTolerance);
+      adaptiveTimestep = new AdaptiveTimestepSparse(integratorBaseSparse, adaptiveTimestepTolerance, 1E-3 * adaptiveTimestepTolerance);
+    }
+  }
+
   // clear fps buffer
   for(int i=0; i<fpsBufferSize; i++)
     fpsBuffer[i] = 0.0;
@@ -1660,6 +1716,10 @@ void initConfigurations()
 
   configFile.addOptionOptional("implicitSolverMethod", implicitSolverMethod, "none"); // this is now obsolete, but preserved for backward compatibility, use "solver" below
   configFile.addOptionOptional("solver", solverMethod, "implicitNewmark");
+  // the sparse linear solver: PCG, PARDISO, SPOOLES or CHOLESKY (see integratorSparseSolver.h)
+  configFile.addOptionOptional("linearSolver", linearSolverMethod, "PCG");
+  // the preconditioner for the PCG linear solver: JACOBI, BLOCK_JACOBI3, SSOR or IC0 (see CGPreconditioner.h)
+  configFile.addOptionOptional("pcgPreconditioner", pcgPreconditionerMethod, "JACOBI");
 
   configFile.addOptionOptional("centralDifferencesTangentialDampingUpdateMode", &centralDifferencesTangentialDampingUpdateMode, centralDifferencesTangentialDampingUpdateMode);
 
@@ -1689,6 +1749,10 @@ void initConfigurations()
   configFile.addOptionOptional("forceNeighborhoodSize", &forceNeighborhoodSize, forceNeighborhoodSize);
   configFile.addOptionOptional("maxIterations", &maxIterations, 1);
   configFile.addOptionOptional("epsilon", &epsilon, 1E-6);
+  configFile.addOptionOptional("inexactNewton", &inexactNewton, 0);
+  configFile.addOptionOptional("adaptiveTimestepTolerance", &adaptiveTimestepTolerance, 0.0);
+  configFile.addOptionOptional("lumpedMass", &lumpedMass, 0);
+  configFile.addOptionOptional("stVKTetDeformationGradient", &stVKTetDeformationGradient, 0);
   configFile.addOptionOptional("numInternalForceThreads", &numInternalForceThreads, 0);
   configFile.addOptionOptional("numSolverThreads", &numSolverThreads, 1);
   configFile.addOptionOptional("inversionThreshold", &inversionThreshold, -DBL_MAX);
@@ -1752,6 +1816,24 @@ void initConfigurations()
     printf("Error: unknown implicit solver specified.\n");
     exit(1);
   }
+
+  if (IntegratorSparseSolver::GetSolverType(linearSolverMethod, &linearSolver) != 0)
+  {
+    printf("Error: unknown linear solver specified: %s.\n", linearSolverMethod);
+    exit(1);
+  }
+
+  if (!IntegratorSparseSolver::IsAvailable(linearSolver))
+  {
+    printf("Error: linear solver %s is not available in this build.\n", linearSolverMethod);
+    exit(1);
+  }
+
+  if (CGPreconditioner::GetPreconditionerType(pcgPreconditionerMethod, &pcgPreconditioner) != 0)
+  {
+    printf("Error: unknown PCG preconditioner specified: %s.\n", pcgPreconditionerMethod);
+    exit(1);
+  }
 }
 
 // GLUI-related functions
@@ -1895,6 +1977,8 @@ void stopDeformations_buttonCallBack(int code)
 {
   integratorBase->ResetToRest();
   integratorBase->SetState(uInitial);
+  if (adaptiveTimestep != NULL)
+    adaptiveTimestep->Reset();
   memcpy(u, integratorBase->Getq(), sizeof(double) * 3 * n);
   deformableObjectRenderingMesh->SetVertexDeformations(u);
   timestepCounter = 0;
@@ -1908,6 +1992,8 @@ void staticSolver_checkboxCallBack(int code)
 
 void exit_buttonCallBack(int code)
 {
+  if (integratorBaseSparse->GetLinearSolver() != NULL)
+    integratorBaseSparse->GetLinearSolver()->PrintStatistics();
   exit(0);
 }
 
@@ -34,106 +34,37 @@
 /*
   A multi-threaded version of the StVKReducedInternalForces class, using 
   the wxWidgets threading API. This class requires the wxWidgets header 
-  files. 
+  files. The work is distributed dynamically over element chunks, 
+  by StVKReducedInternalForcesResumableMT (without checkpointing).
 */
 
-#include <vector>
 #include "wx/wx.h"
-#include "lapack-headers.h"
-#include "matrixIO.h"
-#include "matrixMacros.h"
-#include "matrixProjection.h"
 #include "StVKReducedInternalForcesWX.h"
 
-struct StVKReducedInternalForcesWX_threadArg
-{
-  StVKReducedInternalForcesWX * stVKReducedInternalForcesWX;
-  double * targetBuffer;
-  int rank;
-};
-
-void * StVKReducedInternalForcesWX_WorkerThread(void * arg)
-{
-  struct StVKReducedInternalForcesWX_threadArg * threadArgp = (struct StVKReducedInternalForcesWX_threadArg*) arg;
-  StVKReducedInternalForcesWX * stVKReducedInternalForcesWX = threadArgp->stVKReducedInternalForcesWX;
-  double * targetBuffer = threadArgp->targetBuffer;
-  int rank = threadArgp->rank;
-  int r = stVKReducedInternalForcesWX->Getr();
-  int startElement = stVKReducedInternalForcesWX->GetStartElement(rank);
-  int endElement = stVKReducedInternalForcesWX->GetEndElement(rank);
-
-  double * target[3] = { &targetBuffer[0], &targetBuffer[r*StVKReducedInternalForces::GetLinearSize(r)], &targetBuffer[r*(StVKReducedInternalForces::GetLinearSize(r) + StVKReducedInternalForces::GetQuadraticSize(r))] };
-  stVKReducedInternalForcesWX->ProcessElements(startElement, endElement, target);
-
-  return NULL;
-}
-
 class MyThread : public wxThread
 {
 public:
-  MyThread(void * arg_) : wxThread(wxTHREAD_JOINABLE), arg(arg_) {}
+  MyThread(StVKReducedInternalForcesWX * stVKReducedInternalForcesWX_) : wxThread(wxTHREAD_JOINABLE), stVKReducedInternalForcesWX(stVKReducedInternalForcesWX_) {}
 
 protected:
-  void * arg;
+  StVKReducedInternalForcesWX * stVKReducedInternalForcesWX;
   virtual ExitCode Entry();
 };
 
 MyThread::ExitCode MyThread::Entry()
 {
-  StVKReducedInternalForcesWX_WorkerThread(arg);
+  stVKReducedInternalForcesWX->ProcessChunks();
   return (MyThread::ExitCode)0;
 }
 
-StVKReducedInternalForcesWX::StVKReducedInternalForcesWX(int r, double * U, VolumetricMesh * volumetricMesh, StVKElementABCD * precomputedABCDIntegrals, bool addGravity_, int numThreads): StVKReducedInternalForces(r, U, volumetricMesh, precomputedABCDIntegrals, 1, addGravity_)
+StVKReducedInternalForcesWX::StVKReducedInternalForcesWX(int r, double * U, VolumetricMesh * volumetricMesh, StVKElementABCD * precomputedABCDIntegrals, bool addGravity_, int numThreads_): StVKReducedInternalForcesResumableMT(r, U, volumetricMesh, precomputedABCDIntegrals, addGravity_, 9.81, numThreads_, NULL, 600.0, 0, 1)
 {
-  internalForceBuffer = (double*) malloc (sizeof(double) * numThreads * r * (linearSize + quadraticSize + cubicSize));
-
-  // split the workload
-  int numElements = volumetricMesh->getNumElements();
-  startElement = (int*) malloc (sizeof(int) * numThreads);
-  endElement = (int*) malloc (sizeof(int) * numThreads);
-
-  int remainder = numElements % numThreads;
-  // the first 'remainder' nodes will process one element more
-  int jobSize = numElements / numThreads;
-
-  for(int rank=0; rank < numThreads; rank++)
-  {
-    if (rank < remainder)
-    {
-      startElement[rank] = rank * (jobSize+1);
-      endElement[rank] = (rank+1) * (jobSize+1);
-    }
-    else
-    {
-      startElement[rank] = remainder * (jobSize+1) + (rank-remainder) * jobSize;
-      endElement[rank] = remainder * (jobSize+1) + ((rank-remainder)+1) * jobSize;
-    }
-  }
-
-  printf("Reduced StVK coefficients computation info:\n");
-  printf("Total elements: %d \n",numElements);
-  printf("Num threads: %d \n",numThreads);
-  printf("Canonical job size: %d \n",jobSize);
-  printf("Num threads with job size augmented by one element: %d \n",remainder);
-
   // launch threads 
-  struct StVKReducedInternalForcesWX_threadArg * threadArgv = (struct StVKReducedInternalForcesWX_threadArg*) malloc (sizeof(struct StVKReducedInternalForcesWX_threadArg) * numThreads);
-
-  for(int i=0; i<numThreads; i++)
-  {
-    threadArgv[i].stVKReducedInternalForcesWX = this;
-    threadArgv[i].targetBuffer = &internalForceBuffer[i * r * (linearSize + quadraticSize + cubicSize)];
-    threadArgv[i].rank = i;
-  }
-    
-  memset(internalForceBuffer, 0, sizeof(double) * numThreads * r * (linearSize + quadraticSize + cubicSize));
-
   MyThread ** threads = (MyThread**) malloc (sizeof(MyThread*) * numThreads);
 
   for(int i=0; i<numThreads; i++)
   {
-    threads[i] = new MyThread(&threadArgv[i]);
+    threads[i] = new MyThread(this);
 
     if (threads[i]->Create() != wxTHREAD_NO_ERROR)
     {
@@ -162,42 +93,12 @@ StVKReducedInternalForcesWX::StVKReducedInternalForcesWX(int r, double * U, Volu
   }
 
   free(threads);
-  free(threadArgv);
-
-  // assemble
-  memset(linearCoef_, 0, sizeof(double) * r * linearSize);
-  memset(quadraticCoef_, 0, sizeof(double) * r * quadraticSize);
-  memset(cubicCoef_, 0, sizeof(double) * r * cubicSize);
-  for(int i=0; i<numThreads; i++)
-  {
-    double * sourceLinear = &internalForceBuffer[i * r * (linearSize + quadraticSize + cubicSize)];
-    for(int j=0; j<r*linearSize; j++)
-      linearCoef_[j] += sourceLinear[j];
 
-    double * sourceQuadratic = &internalForceBuffer[i * r * (linearSize + quadraticSize + cubicSize) + r * linearSize];
-    for(int j=0; j<r*quadraticSize; j++)
-      quadraticCoef_[j] += sourceQuadratic[j];
-
-    double * sourceCubic = &internalForceBuffer[i * r * (linearSize + quadraticSize + cubicSize) + r * (linearSize + quadraticSize)];
-    for(int j=0; j<r*cubicSize; j++)
-      cubicCoef_[j] += sourceCubic[j];
-  }
+  // the chunks have been added into the coefficients by ProcessChunks
+  Finish();
 }
 
 StVKReducedInternalForcesWX::~StVKReducedInternalForcesWX()
 {
-  free(startElement);
-  free(endElement);
-  free(internalForceBuffer);
-}
-
-int StVKReducedInternalForcesWX::GetStartElement(int rank)
-{
-  return startElement[rank];
-}
-
-int StVKReducedInternalForcesWX::GetEndElement(int rank)
-{
-  return endElement[rank];
 }
 
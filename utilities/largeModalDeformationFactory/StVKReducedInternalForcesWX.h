@@ -34,29 +34,22 @@
 /*
   A multi-threaded version of the StVKReducedInternalForces class, using 
   the wxWidgets threading API. This class requires the wxWidgets header 
-  files. 
+  files. The work is distributed dynamically over element chunks, 
+  by StVKReducedInternalForcesResumableMT (without checkpointing).
 */
 
 #ifndef _STVKREDUCEDINTERNALFORCESWX_H_
 #define _STVKREDUCEDINTERNALFORCESWX_H_
 
-#include "StVKReducedInternalForces.h"
+#include "StVKReducedInternalForcesResumableMT.h"
 
-class StVKReducedInternalForcesWX : public StVKReducedInternalForces
+class StVKReducedInternalForcesWX : public StVKReducedInternalForcesResumableMT
 {
 public:
   // creates the reduced coefficients
   StVKReducedInternalForcesWX(int r, double * U, VolumetricMesh * volumetricMesh, StVKElementABCD * precomputedABCDIntegrals, bool addGravity, int numThreads);
 
   ~StVKReducedInternalForcesWX();
-
-  int GetStartElement(int rank);  
-  int GetEndElement(int rank);
-
-protected:
-  int numThreads;
-  int * startElement, * endElement;
-  double * internalForceBuffer;
 };
 
 #endif
@@ -0,0 +1,176 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "computeCubicPolynomials" utility, Copyright (C) 2007 CMU, 2009 MIT,  *
+ *                                                     2014 USC          *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code author: Jernej Barbic                                            *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This utility is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this utility in the file LICENSE.txt                    *
+ *                                                                       *
+ * This utility is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+/*
+  Computes the reduced StVK cubic polynomials (a .cub file) for a given volumetric mesh and basis,
+  without a GUI (e.g., on a compute server). The computation is multi-threaded; partial results are 
+  periodically checkpointed to disk, so that an interrupted run (e.g., Ctrl-C, or a killed job) 
+  can be resumed by re-running the same command. See StVKReducedInternalForcesResumableMT.h .
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "volumetricMesh.h"
+#include "volumetricMeshLoader.h"
+#include "StVKElementABCDLoader.h"
+#include "StVKReducedInternalForcesResumableMT.h"
+#include "matrixIO.h"
+#include "getopts.h"
+
+static StVKReducedInternalForcesResumableMT * computation = NULL;
+
+static void stopHandler(int signal)
+{
+  // the threads finish their current chunks, then a checkpoint is saved
+  if (computation != NULL)
+    computation->RequestStop();
+}
+
+int main(int argc, char ** argv)
+{
+  if (argc < 4)
+  {
+    printf("Computes the reduced StVK cubic polynomials for the given volumetric mesh and basis.\n");
+    printf("Usage: %s <volumetric mesh file> <basis file> <output cubic polynomial file> [-r r] [-t num threads] [-c checkpoint file] [-i checkpoint interval] [-k chunk size]\n",argv[0]);
+    printf("  basis file: a binary matrix (3n x r), e.g., the nonlinear modes (.URendering) from LargeModalDeformationFactory\n");
+    printf("  -r : use only the first r columns of the basis (default: all)\n");
+    printf("  -t : number of threads (default: 1)\n");
+    printf("  -c : checkpoint file (default: <output cubic polynomial file>.checkpoint; \"none\" disables checkpointing)\n");
+    printf("  -i : minimal time between checkpoints, in seconds (default: 600)\n");
+    printf("  -k : number of elements per work chunk (default: automatic)\n");
+    printf("If the computation is interrupted (e.g., Ctrl-C), re-run the same command to resume from the checkpoint.\n");
+    return 0;
+  }
+
+  char * meshFilename = argv[1];
+  char * basisFilename = argv[2];
+  char * outputFilename = argv[3];
+
+  char rString[4096] = "-1";
+  char numThreadsString[4096] = "1";
+  char checkpointFilename[4096] = "__default";
+  char checkpointIntervalString[4096] = "600";
+  char chunkSizeString[4096] = "0";
+
+  opt_t opttable[] =
+  {
+    { (char*)"r", OPTSTR, &rString },
+    { (char*)"t", OPTSTR, &numThreadsString },
+    { (char*)"c", OPTSTR, &checkpointFilename },
+    { (char*)"i", OPTSTR, &checkpointIntervalString },
+    { (char*)"k", OPTSTR, &chunkSizeString },
+    { NULL, 0, NULL }
+  };
+
+  argv += 3;
+  argc -= 3;
+  int optup = getopts(argc,argv,opttable);
+  if (optup != argc)
+  {
+    printf("Error parsing options. Error at option %s.\n",argv[optup]);
+    return 1;
+  }
+
+  if (strcmp(checkpointFilename, "__default") == 0)
+    snprintf(checkpointFilename, 4096, "%s.checkpoint", outputFilename);
+  int r = strtol(rString, NULL, 10);
+  int numThreads = strtol(numThreadsString, NULL, 10);
+  double checkpointInterval = strtod(checkpointIntervalString, NULL);
+  int chunkSize = strtol(chunkSizeString, NULL, 10);
+  if (numThreads < 1)
+    numThreads = 1;
+
+  VolumetricMesh * volumetricMesh = VolumetricMeshLoader::load(meshFilename);
+  if (volumetricMesh == NULL)
+  {
+    printf("Error: unable to load the volumetric mesh from %s.\n", meshFilename);
+    return 1;
+  }
+
+  int n = volumetricMesh->getNumVertices();
+  printf("Num vertices: %d\n", n);
+  printf("Num elements: %d\n", volumetricMesh->getNumElements());
+
+  int m, rBasis;
+  double * U = NULL;
+  if (ReadMatrixFromDisk(basisFilename, &m, &rBasis, &U) != 0)
+  {
+    printf("Error: unable to load the basis from %s.\n", basisFilename);
+    return 1;
+  }
+
+  if (m != 3 * n)
+  {
+    printf("Error: the basis has %d rows, but the mesh has 3 * %d = %d degrees of freedom.\n", m, n, 3 * n);
+    return 1;
+  }
+
+  if ((r < 0) || (r > rBasis))
+    r = rBasis;
+  printf("r: %d\n", r);
+
+  StVKElementABCD * precomputedABCDIntegrals = StVKElementABCDLoader::load(volumetricMesh);
+
+  computation = new StVKReducedInternalForcesResumableMT(r, U, volumetricMesh, precomputedABCDIntegrals, false, 9.81, numThreads, 
+    (strcmp(checkpointFilename, "none") == 0) ? NULL : checkpointFilename, checkpointInterval, chunkSize, 1);
+
+  signal(SIGINT, stopHandler);
+  signal(SIGTERM, stopHandler);
+
+  int code = computation->Compute();
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+
+  if (code != 0)
+  {
+    printf("The computation did not complete (%d / %d chunks done).\n", computation->GetNumFinishedChunks(), computation->GetNumChunks());
+    if (code == 1)
+      printf("Re-run the same command to resume.\n");
+    return 1;
+  }
+
+  if (computation->Save(outputFilename) != 0)
+  {
+    printf("Error: unable to save the cubic polynomials to %s.\n", outputFilename);
+    return 1;
+  }
+  printf("Saved the cubic polynomials to %s.\n", outputFilename);
+
+  delete(computation);
+  delete(precomputedABCDIntegrals);
+  delete(volumetricMesh);
+  free(U);
+
+  return 0;
+}
+
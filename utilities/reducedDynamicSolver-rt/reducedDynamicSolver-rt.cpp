@@ -127,7 +127,6 @@ SceneObject * extraSceneGeometry = NULL;
 ModalMatrix * renderingModalMatrix = NULL;
 ImplicitNewmarkDense * implicitNewmarkDense = NULL;
 StVKReducedInternalForces * stVKReducedInternalForces = NULL;
-StVKReducedStiffnessMatrix * stVKReducedStiffnessMatrix = NULL;
 ReducedForceModel * reducedForceModel = NULL;
 ReducedStVKForceModel * reducedStVKForceModel;
 ReducedLinearStVKForceModel * reducedLinearStVKForceModel;
@@ -687,14 +686,17 @@ void initScene()
     stVKReducedInternalForces = new StVKReducedInternalForces(cubicPolynomialFilename); // normal version
   #endif
 
-  // create stiffness matrix polynomials
-  stVKReducedStiffnessMatrix = new StVKReducedStiffnessMatrix(stVKReducedInternalForces);
-
   // create the "internal force models" 
-  reducedStVKForceModel = new ReducedStVKForceModel(stVKReducedInternalForces, stVKReducedStiffnessMatrix);
-  reducedLinearStVKForceModel = new ReducedLinearStVKForceModel(stVKReducedStiffnessMatrix);
+  // (the tangent stiffness matrices are evaluated directly from the cubic polynomial; no stiffness matrix polynomials are precomputed)
+  reducedStVKForceModel = new ReducedStVKForceModel(stVKReducedInternalForces);
   reducedForceModel = reducedStVKForceModel;
 
+  // the linear model uses the stiffness matrix at the rest configuration
+  double * K = (double*) malloc (sizeof(double) * r * r);
+  double * zero = (double*) calloc (r, sizeof(double));
+  reducedStVKForceModel->GetTangentStiffnessMatrix(zero, K);
+  reducedLinearStVKForceModel = new ReducedLinearStVKForceModel(r, K);
+
   // init the implicit Newmark
   implicitNewmarkDense = new ImplicitNewmarkDense(r, timeStep, massMatrix, reducedForceModel, ImplicitNewmarkDense::positiveDefiniteMatrixSolver, dampingMassCoef, dampingStiffnessCoef);
   implicitNewmarkDense->SetTimestep(timeStep / substepsPerTimeStep);
@@ -712,10 +714,6 @@ void initScene()
     extraSceneGeometry = NULL;
 
   // compute lowest frequency of the system (smallest eigenvalue of K)
-  double * K = (double*) malloc (sizeof(double) * r * r);
-  double * zero = (double*) calloc (r, sizeof(double));
-  stVKReducedStiffnessMatrix->Evaluate(zero, K);
-
 /*
   // find smallest eigenvalue of K
   Matrix<double> KM(r, r, K, false, false);
@@ -733,9 +731,9 @@ void initScene()
     lowestFrequency = sqrt(lowestFrequency) / (2 * M_PI);
     printf("System lowest frequency is: %G\n", lowestFrequency);
   }
+*/
   free(zero);
   free(K);
-*/
 
   // set background color
   int colorR, colorG, colorB;
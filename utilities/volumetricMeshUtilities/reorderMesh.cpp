@@ -0,0 +1,237 @@
+/*************************************************************************
+ *                                                                       *
+ * Vega FEM Simulation Library Version 2.1                               *
+ *                                                                       *
+ * "reorderMesh" utility , Copyright (C) 2007 CMU, 2009 MIT, 2014 USC    *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * Code authors: Jernej Barbic                                           *
+ * http://www.jernejbarbic.com/code                                      *
+ *                                                                       *
+ * Research: Jernej Barbic, Fun Shing Sin, Daniel Schroeder,             *
+ *           Doug L. James, Jovan Popovic                                *
+ *                                                                       *
+ * Funding: National Science Foundation, Link Foundation,                *
+ *          Singapore-MIT GAMBIT Game Lab,                               *
+ *          Zumberge Research and Innovation Fund at USC                 *
+ *                                                                       *
+ * This utility is free software; you can redistribute it and/or         *
+ * modify it under the terms of the BSD-style license that is            *
+ * included with this utility in the file LICENSE.txt                    *
+ *                                                                       *
+ * This utility is distributed in the hope that it will be useful,       *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the file     *
+ * LICENSE.TXT for more details.                                         *
+ *                                                                       *
+ *************************************************************************/
+
+/*
+  Renumbers the vertices and elements of a volumetric mesh, for better memory locality 
+  and a smaller stiffness matrix bandwidth (see generateMeshOrdering.h).
+  The fixed vertices (.bou) and interpolant (.interp) files of the mesh can be renumbered at the same time.
+  Optionally, the permutations are saved, so that results can be mapped back to the original numbering.
+  Files that depend on the vertex numbering in other ways (e.g., mass matrices, modal bases) 
+  must be regenerated from the renumbered mesh.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "volumetricMesh.h"
+#include "volumetricMeshLoader.h"
+#include "generateMeshOrdering.h"
+#include "getopts.h"
+#include "loadList.h"
+
+// saves "new index (1-indexed)" of each old index, one per line
+static int SavePermutation(const char * filename, int n, int * permutation)
+{
+  FILE * fout = fopen(filename, "w");
+  if (!fout)
+  {
+    printf("Error: unable to open %s for writing.\n", filename);
+    return 1;
+  }
+  for(int i=0; i<n; i++)
+    fprintf(fout, "%d\n", permutation[i] + 1);
+  fclose(fout);
+  return 0;
+}
+
+// number of non-empty lines of the interpolant file (one line per target location)
+static int CountInterpolationLocations(const char * filename)
+{
+  FILE * fin = fopen(filename, "r");
+  if (!fin)
+    return -1;
+
+  int numLines = 0;
+  char s[16384];
+  while (fgets(s, 16384, fin) != NULL)
+  {
+    if ((s[0] != '\n') && (s[0] != '\r') && (s[0] != 0))
+      numLines++;
+  }
+  fclose(fin);
+  return numLines;
+}
+
+int main(int argc, char ** argv)
+{
+  if (argc < 3)
+  {
+    printf("Renumbers the vertices and elements of a volumetric mesh, to improve memory locality and reduce the stiffness matrix bandwidth.\n");
+    printf("Usage: %s <input volumetric mesh file> <output volumetric mesh file> [-o ordering] [-f input fixed vertices file] [-F output fixed vertices file] [-i input interpolant file] [-I output interpolant file] [-p output vertex permutation file] [-e output element permutation file]\n",argv[0]);
+    printf("-o : ordering: rcm (reverse Cuthill-McKee; default) or morton (Morton space-filling curve)\n");
+    printf("-f, -F : renumber the given (1-indexed) list of fixed vertices\n");
+    printf("-i, -I : renumber the given interpolant\n");
+    printf("-p, -e : save the permutations; line i gives the new (1-indexed) number of old vertex (element) i\n");
+    return 0;
+  }
+
+  char * inputMeshFilename = argv[1];
+  char * outputMeshFilename = argv[2];
+
+  char orderingString[4096] = "rcm";
+  char inputFixedVerticesFilename[4096] = "__none";
+  char outputFixedVerticesFilename[4096] = "__none";
+  char inputInterpolantFilename[4096] = "__none";
+  char outputInterpolantFilename[4096] = "__none";
+  char vertexPermutationFilename[4096] = "__none";
+  char elementPermutationFilename[4096] = "__none";
+
+  opt_t opttable[] =
+  {
+    { (char*)"o", OPTSTR, &orderingString },
+    { (char*)"f", OPTSTR, &inputFixedVerticesFilename },
+    { (char*)"F", OPTSTR, &outputFixedVerticesFilename },
+    { (char*)"i", OPTSTR, &inputInterpolantFilename },
+    { (char*)"I", OPTSTR, &outputInterpolantFilename },
+    { (char*)"p", OPTSTR, &vertexPermutationFilename },
+    { (char*)"e", OPTSTR, &elementPermutationFilename },
+    { NULL, 0, NULL }
+  };
+
+  argv += 2;
+  argc -= 2;
+  int optup = getopts(argc,argv,opttable);
+  if (optup != argc)
+  {
+    printf("Error parsing options. Error at option %s.\n",argv[optup]);
+    return 1;
+  }
+
+  GenerateMeshOrdering::orderingType ordering;
+  if (strcmp(orderingString, "rcm") == 0)
+    ordering = GenerateMeshOrdering::REVERSE_CUTHILL_MCKEE;
+  else if (strcmp(orderingString, "morton") == 0)
+    ordering = GenerateMeshOrdering::MORTON;
+  else
+  {
+    printf("Error: unknown ordering %s. Must be rcm or morton.\n", orderingString);
+    return 1;
+  }
+
+  if ((strcmp(inputFixedVerticesFilename, "__none") == 0) != (strcmp(outputFixedVerticesFilename, "__none") == 0))
+  {
+    printf("Error: both the input and the output fixed vertices file must be specified (-f, -F).\n");
+    return 1;
+  }
+
+  if ((strcmp(inputInterpolantFilename, "__none") == 0) != (strcmp(outputInterpolantFilename, "__none") == 0))
+  {
+    printf("Error: both the input and the output interpolant file must be specified (-i, -I).\n");
+    return 1;
+  }
+
+  VolumetricMesh * volumetricMesh = VolumetricMeshLoader::load(inputMeshFilename);
+  if (volumetricMesh == NULL)
+  {
+    printf("Error: unable to load the volumetric mesh from %s.\n", inputMeshFilename);
+    return 1;
+  }
+
+  int numVertices = volumetricMesh->getNumVertices();
+  int numElements = volumetricMesh->getNumElements();
+  printf("Num vertices: %d\n", numVertices);
+  printf("Num elements: %d\n", numElements);
+
+  int bandwidth;
+  double profile;
+  GenerateMeshOrdering::GetBandwidth(volumetricMesh, &bandwidth, &profile);
+  printf("Input mesh: bandwidth: %d, profile: %.0f\n", bandwidth, profile);
+
+  int * vertexPermutation;
+  int * elementPermutation;
+  GenerateMeshOrdering::Generate(volumetricMesh, ordering, &vertexPermutation, &elementPermutation);
+  if (volumetricMesh->renumber(vertexPermutation, elementPermutation) != 0)
+    return 1;
+
+  GenerateMeshOrdering::GetBandwidth(volumetricMesh, &bandwidth, &profile);
+  printf("Renumbered mesh: bandwidth: %d, profile: %.0f\n", bandwidth, profile);
+
+  printf("Saving the renumbered mesh to %s...\n", outputMeshFilename);
+  if (volumetricMesh->save(outputMeshFilename) != 0)
+  {
+    printf("Error: unable to save the mesh to %s.\n", outputMeshFilename);
+    return 1;
+  }
+
+  if (strcmp(inputFixedVerticesFilename, "__none") != 0)
+  {
+    int numFixedVertices;
+    int * fixedVertices;
+    int oneIndexed = 1;
+    if (LoadList::load(inputFixedVerticesFilename, &numFixedVertices, &fixedVertices, oneIndexed) != 0)
+    {
+      printf("Error: unable to load the fixed vertices from %s.\n", inputFixedVerticesFilename);
+      return 1;
+    }
+    GenerateMeshOrdering::RenumberIndices(numFixedVertices, fixedVertices, vertexPermutation);
+    LoadList::sort(numFixedVertices, fixedVertices);
+    printf("Saving %d renumbered fixed vertices to %s...\n", numFixedVertices, outputFixedVerticesFilename);
+    if (LoadList::save(outputFixedVerticesFilename, numFixedVertices, fixedVertices, oneIndexed) != 0)
+    {
+      printf("Error: unable to save the fixed vertices to %s.\n", outputFixedVerticesFilename);
+      return 1;
+    }
+    free(fixedVertices);
+  }
+
+  if (strcmp(inputInterpolantFilename, "__none") != 0)
+  {
+    int numInterpolationLocations = CountInterpolationLocations(inputInterpolantFilename);
+    int numElementVertices = VolumetricMesh::getNumInterpolationElementVertices(inputInterpolantFilename);
+    int * interpolationVertices;
+    double * interpolationWeights;
+    if ((numInterpolationLocations < 0) || (numElementVertices < 0) || 
+        (VolumetricMesh::loadInterpolationWeights(inputInterpolantFilename, numInterpolationLocations, numElementVertices, &interpolationVertices, &interpolationWeights) != 0))
+    {
+      printf("Error: unable to load the interpolant from %s.\n", inputInterpolantFilename);
+      return 1;
+    }
+    GenerateMeshOrdering::RenumberIndices(numInterpolationLocations * numElementVertices, interpolationVertices, vertexPermutation);
+    printf("Saving the renumbered interpolant (%d locations) to %s...\n", numInterpolationLocations, outputInterpolantFilename);
+    if (VolumetricMesh::saveInterpolationWeights(outputInterpolantFilename, numInterpolationLocations, numElementVertices, interpolationVertices, interpolationWeights) != 0)
+    {
+      printf("Error: unable to save the interpolant to %s.\n", outputInterpolantFilename);
+      return 1;
+    }
+    free(interpolationVertices);
+    free(interpolationWeights);
+  }
+
+  if ((strcmp(vertexPermutationFilename, "__none") != 0) && (SavePermutation(vertexPermutationFilename, numVertices, vertexPermutation) != 0))
+    return 1;
+
+  if ((strcmp(elementPermutationFilename, "__none") != 0) && (SavePermutation(elementPermutationFilename, numElements, elementPermutation) != 0))
+    return 1;
+
+  free(vertexPermutation);
+  free(elementPermutation);
+  delete(volumetricMesh);
+
+  return 0;
+}
+